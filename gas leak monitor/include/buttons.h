@@ -0,0 +1,51 @@
+#ifndef BUTTONS_H
+#define BUTTONS_H
+
+#include <Arduino.h>
+#include "button_logic.h"
+
+// Interrupt-driven button input. A CHANGE interrupt per pin stamps every
+// edge into a small lock-free ring (one producer: the GPIO ISR, one
+// consumer: the UI task), so presses made while the consumer is busy are
+// kept with their original timing. read() drains the ring through a
+// ButtonTracker per button and hands out debounced press/release,
+// long-press and auto-repeat events.
+
+#define BUTTON_MAX 4
+#define BUTTON_QUEUE_LENGTH 32  // Power of two; a bouncing press is a handful of edges
+
+class ButtonInput {
+public:
+  // Active-low pins with pull-ups; events report the index into pins
+  void begin(const uint8_t *pins, uint8_t count);
+
+  // Next due event; call from the consumer task until it returns false
+  bool read(ButtonEvent &event);
+
+  // Edges dropped because the ring was full
+  uint32_t overflows() const { return _overflows; }
+
+private:
+  struct Edge {
+    uint8_t button;
+    uint8_t pressed;
+    uint32_t timeMs;
+  };
+
+  static void onEdge(void *arg);
+  void push(uint8_t button);
+
+  static ButtonInput *_instance;
+
+  uint8_t _pins[BUTTON_MAX] = {};
+  uint8_t _count = 0;
+  ButtonTracker _trackers[BUTTON_MAX];
+  Edge _queue[BUTTON_QUEUE_LENGTH];
+  volatile uint32_t _head = 0;  // Written by the ISR only
+  volatile uint32_t _tail = 0;  // Written by the consumer only
+  volatile uint32_t _overflows = 0;
+};
+
+extern ButtonInput buttons;
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "json_pool.h"
+#include "command_table.h"
+#include "socket_hub.h"
+
+// WebSocket command dispatch; the name lookup lives in command_table.h
+
+#define COMMAND_MAX_BATCH 8
+#define COMMAND_ACK_POOL_SIZE 2048  // One variant page (json_pool.h) and the copied string ids
+#define COMMAND_ACK_BUFFER_SIZE 768  // COMMAND_MAX_BATCH results with 23-character ids and errors
+
+// Collects per-command results of one frame and sends them back as a single
+// {"type":"ack","results":[{"id":..,"ok":true|false,"error":".."}]} message.
+// Commands without an "id" are not acknowledged.
+class CommandAcks {
+public:
+  void begin(SocketHub &sockets) { _sockets = &sockets; }
+
+  void reset() { _count = 0; }
+  void add(JsonVariantConst id, const char *error);
+  void send(uint8_t num);
+
+private:
+  struct Result {
+    bool numeric;
+    int32_t number;
+    char text[24];
+    const char *error;
+  };
+
+  SocketHub *_sockets = NULL;
+  Result _results[COMMAND_MAX_BATCH];
+  size_t _count = 0;
+  JsonPool<COMMAND_ACK_POOL_SIZE> _pool;
+  char _buffer[COMMAND_ACK_BUFFER_SIZE];
+};
+
+extern CommandAcks commandAcks;
+
+#endif
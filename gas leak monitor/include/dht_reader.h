@@ -0,0 +1,52 @@
+#ifndef DHT_READER_H
+#define DHT_READER_H
+
+#include <Arduino.h>
+#include <driver/rmt.h>
+
+// Non-blocking DHT11/DHT22 driver.
+// start() only wakes the reader task: it holds the start pulse with
+// vTaskDelay(), lets the RMT peripheral time the 40-bit reply in hardware
+// and decodes temperature and humidity from the same transaction before
+// calling the completion callback. Nothing runs with interrupts disabled.
+
+enum DhtType {
+  DHT_TYPE_DHT11,
+  DHT_TYPE_DHT22
+};
+
+// Called from the reader task once per start(); ok is false on timeout or bad checksum
+typedef void (*DhtCallback)(float temperature, float humidity, bool ok);
+
+class DhtReader {
+public:
+  DhtReader(uint8_t pin, DhtType type, rmt_channel_t channel = RMT_CHANNEL_0)
+    : _pin(pin), _type(type), _channel(channel) {}
+
+  bool begin(BaseType_t core, UBaseType_t priority);
+  void onReading(DhtCallback callback) { _callback = callback; }
+
+  // Requests a conversion; returns false if one is already in flight
+  bool start();
+  bool busy() const { return _busy; }
+
+  // Duration of the last complete transaction, start pulse included
+  uint32_t lastTransactionUs() const { return _lastTransactionUs; }
+
+private:
+  static void taskEntry(void *parameter);
+  void run();
+  bool transact(float &temperature, float &humidity);
+  bool decode(const rmt_item32_t *items, size_t count, uint8_t data[5]);
+
+  uint8_t _pin;
+  DhtType _type;
+  rmt_channel_t _channel;
+  RingbufHandle_t _ringbuf = NULL;
+  TaskHandle_t _task = NULL;
+  DhtCallback _callback = NULL;
+  volatile bool _busy = false;
+  uint32_t _lastTransactionUs = 0;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef DISCOVERY_H
+#define DISCOVERY_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include <discovery_protocol.h>
+
+// Makes the monitor findable without typing an IP (see discovery_protocol.h):
+// mDNS host gasmon-<id>.local with a _smartgas._tcp service, and a UDP
+// responder that answers one broadcast request with one DiscoveryReply.
+// Both listen on the softAP and, once joined, the station interface.
+
+#define DISCOVERY_SERVICE "smartgas"
+#define DISCOVERY_HOST_PREFIX "gasmon-"
+#define DISCOVERY_HTTP_PORT 80
+#define DISCOVERY_WS_PATH "/ws"  // SOCKET_PATH, on the HTTP port
+#define DISCOVERY_REQUESTS_PER_POLL 4  // A request flood cannot stall the network loop
+
+class DeviceDiscovery {
+public:
+  bool begin(const String &deviceID, const char *firmware, bool aggregator);
+
+  // Answers pending UDP requests; call from the network loop
+  void poll();
+
+  uint32_t answered() const { return _answered; }
+
+private:
+  WiFiUDP _udp;
+  DiscoveryReply _reply = {};
+  bool _started = false;
+  uint32_t _answered = 0;
+};
+
+extern DeviceDiscovery discovery;
+
+#endif
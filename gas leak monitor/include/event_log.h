@@ -0,0 +1,146 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+// Append-only audit journal on LittleFS: alarm trips and resets, relay
+// changes, WiFi mode switches and the like. log() only copies the record
+// into a RAM queue under a spinlock, so it is safe from the alarm path;
+// poll() writes the queue out from a low-priority task in page-sized
+// batches, sooner for alarm events. The journal is a ring of segment files
+// named after the sequence number of their first record; the oldest one is
+// deleted once EVENT_SEGMENTS are full. Sequence numbers run on across
+// reboots, and every record carries a CRC, so a batch torn by a power loss
+// is cut off at the last intact record when the journal is reopened.
+//
+// GET /api/events?since=<seq> streams a chunked binary body:
+//   EventStreamHeader, then the records with seq >= since that are still
+//   kept, oldest first, little-endian. Poll with since = header.next.
+
+#define EVENT_BUFFER_RECORDS 64     // RAM queue between log() and flash
+#define EVENT_BATCH_RECORDS 16      // One 256-byte flash page per write
+#define EVENT_FLUSH_DELAY_MS 5000   // A partial batch waits at most this long
+#define EVENT_SEGMENT_RECORDS 1024  // 16 KB per segment file
+#define EVENT_SEGMENTS 4
+
+#define EVENT_STREAM_MAGIC 0x45  // 'E'
+#define EVENT_STREAM_VERSION 1
+
+enum EventType : uint8_t {
+  EVENT_BOOT = 1,         // detail: esp_reset_reason()
+  EVENT_ALARM_TRIP = 2,   // detail: EventCause
+  EVENT_ALARM_RESET = 3,  // detail: EventReset
+  EVENT_RELAY = 4,        // detail: EVENT_RELAY_ON | EventSource << 4
+  EVENT_WIFI_MODE = 5,    // detail: 1 softAP, 0 station
+  EVENT_PREALARM = 6,     // detail: 1 raised, 0 cleared
+  EVENT_CALIBRATION = 7,  // value: new R0 in thousandths of RL
+  EVENT_OTA = 8,          // detail: EventOtaStep, value: trial boots so far (ota.h)
+  EVENT_SPRINKLER = 9,    // detail: 1 on, 0 off
+  EVENT_RULES = 10        // New alarm rules loaded; value: rule count
+};
+
+enum EventCause : uint8_t {
+  EVENT_CAUSE_GAS = 0,          // Fast path, a rule met on a sampler sample
+  EVENT_CAUSE_TEMPERATURE = 1,
+  EVENT_CAUSE_HUMIDITY = 2
+};
+
+enum EventReset : uint8_t {
+  EVENT_RESET_MANUAL = 0,   // Reset command; drops latched rules
+  EVENT_RESET_CLEARED = 1   // The rules that raised it cleared
+};
+
+enum EventSource : uint8_t {
+  EVENT_SOURCE_COMMAND = 0,  // WebSocket or HTTP request
+  EVENT_SOURCE_ALARM = 1,    // Auto mode on an alarm trip
+  EVENT_SOURCE_PREALARM = 2
+};
+
+enum EventOtaStep : uint8_t {
+  EVENT_OTA_INSTALLED = 0,  // Verified and selected; the trial starts with the restart
+  EVENT_OTA_CONFIRMED = 1,
+  EVENT_OTA_ROLLED_BACK = 2
+};
+
+#define EVENT_RELAY_ON 0x01
+
+struct __attribute__((packed)) EventRecord {
+  uint32_t seq;
+  uint16_t boot;    // Journal boot count; time restarts with each boot
+  uint8_t type;     // EventType
+  uint8_t detail;   // Per type, see EventType
+  uint32_t timeMs;  // Since that boot
+  uint16_t value;   // Gas level in ppm when logged, unless the type says otherwise
+  uint16_t crc;     // CRC-16/CCITT of the bytes above
+};
+
+struct __attribute__((packed)) EventStreamHeader {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t recordSize;
+  uint8_t reserved;
+  uint32_t first;     // Seq of the first record that follows; older ones have rotated out
+  uint32_t next;      // Seq the next event will get
+  uint32_t uptimeMs;  // Current time in the current boot
+  uint16_t boot;
+  uint16_t reserved2;
+};
+
+class EventLog {
+public:
+  // Mounts LittleFS and reopens the journal; events logged before this are kept
+  bool begin();
+
+  // Queues one event; never touches flash, safe from any task
+  void log(EventType type, uint8_t detail, uint16_t value);
+
+  // Writes queued events when a batch is full or due; call from a low-priority task
+  void poll();
+
+  // Serves /api/events
+  void handleRequest(AsyncWebServerRequest *request);
+
+  uint32_t logged() const { return _nextSeq - _baseSeq; }
+  uint32_t dropped() const { return _dropped; }
+  uint32_t flushes() const { return _flushes; }
+  uint32_t writeFailures() const { return _writeFailures; }
+
+private:
+  struct Segment {
+    uint32_t first;
+    uint32_t count;  // Intact records
+  };
+
+  void flush(uint32_t count);
+  bool recover(Segment &segment, uint32_t &boot);
+  uint32_t readRecords(uint32_t seq, uint8_t *out, uint32_t count);
+  static void segmentPath(uint32_t first, char *path, size_t size);
+  static uint16_t checksum(const EventRecord &record);
+
+  EventRecord _queue[EVENT_BUFFER_RECORDS];
+  uint32_t _head = 0;        // Index of the oldest queued record
+  uint32_t _queued = 0;      // Records in _queue, starting at seq _flushedSeq
+  uint32_t _queuedAtMs = 0;  // When the oldest queued record was logged
+  bool _urgent = false;
+
+  // Before begin() records are numbered from 0; begin() moves them past the journal
+  uint32_t _baseSeq = 0;
+  uint32_t _nextSeq = 0;
+  uint32_t _flushedSeq = 0;
+  uint16_t _boot = 0;
+
+  Segment _segments[EVENT_SEGMENTS];
+  uint8_t _segmentCount = 0;  // Oldest first
+  bool _sealed = false;       // Newest segment is full or has a torn tail
+  bool _mounted = false;
+
+  uint32_t _dropped = 0;
+  uint32_t _flushes = 0;
+  uint32_t _writeFailures = 0;
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+extern EventLog events;
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef GAS_SAMPLER_H
+#define GAS_SAMPLER_H
+
+#include <Arduino.h>
+
+// Continuous MQ sensor sampling through the I2S built-in ADC mode.
+// The I2S DMA engine fills buffers at GAS_SAMPLER_RAW_RATE; a small task
+// decimates them into GAS_SAMPLER_RATE samples, keeps them in a ring buffer
+// and runs a median-of-5 + EMA filter, so read() never touches the ADC.
+
+#define GAS_SAMPLER_RAW_RATE 8000      // I2S ADC conversion rate (Hz)
+#define GAS_SAMPLER_DECIMATION 32      // Raw samples averaged per output sample
+#define GAS_SAMPLER_RATE (GAS_SAMPLER_RAW_RATE / GAS_SAMPLER_DECIMATION)  // 250 Hz
+#define GAS_SAMPLER_RING_SIZE 256      // Decimated samples kept (~1 s)
+#define GAS_SAMPLER_MEDIAN_WINDOW 5
+#define GAS_SAMPLER_EMA_SHIFT 3        // EMA weight 1/8 per sample
+#define GAS_SAMPLER_DMA_BUF_LEN 64     // Samples per DMA buffer (8 ms at the raw rate)
+#define GAS_SAMPLER_DMA_BUF_COUNT 8
+
+// Called from the sampler task for every decimated sample with the median
+// of the newest samples and the estimated micros() at which it was taken
+typedef void (*GasSampleCallback)(uint16_t median, uint32_t sampleTimeUs);
+
+class GasSampler {
+public:
+  // Starts the sampling task; falls back to timed analogRead() if the pin
+  // is not on ADC1 or the I2S driver cannot be installed.
+  bool begin(uint8_t pin, BaseType_t core, UBaseType_t priority);
+
+  // Latest filtered reading in raw ADC counts (0..4095)
+  float read() const;
+
+  // Latest unfiltered decimated sample
+  uint16_t readRaw() const;
+
+  // Number of decimated samples produced since begin()
+  uint32_t sampleCount() const { return _count; }
+
+  // Copies up to len of the most recent decimated samples, oldest first
+  size_t copyRecent(uint16_t *out, size_t len) const;
+
+  bool usingDma() const { return _dma; }
+
+  // Registers the per-sample hook; keep it short, it runs at GAS_SAMPLER_RATE
+  void onSample(GasSampleCallback callback) { _callback = callback; }
+
+private:
+  static void taskEntry(void *parameter);
+  void runDma();
+  void runPolled();
+  void push(uint16_t sample, uint32_t sampleTimeUs);
+
+  uint8_t _pin = 0;
+  int8_t _channel = -1;
+  bool _dma = false;
+  uint16_t _ring[GAS_SAMPLER_RING_SIZE] = {0};
+  volatile uint32_t _count = 0;
+  volatile uint32_t _filtered = 0;  // Fixed point, 4 fractional bits
+  bool _primed = false;
+  TaskHandle_t _task = NULL;
+  GasSampleCallback _callback = NULL;
+};
+
+extern GasSampler gasSampler;
+
+#endif
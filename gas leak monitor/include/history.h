@@ -0,0 +1,104 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+// On-device sensor history in three fixed-point tiers: every raw sample,
+// 1-minute rollups and 1-hour rollups (min/max/avg). Each tier is a ring
+// allocated once at boot, in PSRAM when the board has it. Timestamps are
+// seconds since boot; /api/history reports the current uptime so clients
+// can map them to wall-clock time.
+//
+// GET /api/history?from=<s>&to=<s>&res=raw|1m|1h streams a chunked binary body:
+//   HistoryHeader, then count records of recordSize bytes (HistorySample or
+//   HistoryRollup), little-endian. Without res, the finest tier that covers the
+//   range is picked.
+
+#define HISTORY_RAW_CAPACITY 900      // 30 min at the 2 s climate cadence, more while sampling slowly
+#define HISTORY_MINUTE_CAPACITY 360   // 6 h
+#define HISTORY_HOUR_CAPACITY 168     // 7 days
+#define HISTORY_PSRAM_SCALE 8         // Capacity multiplier when PSRAM is present
+
+#define HISTORY_MAGIC 0x48  // 'H'
+#define HISTORY_VERSION 2  // 2: gas in ppm
+
+enum HistoryResolution {
+  HISTORY_RAW = 0,
+  HISTORY_MINUTE = 1,
+  HISTORY_HOUR = 2
+};
+
+struct __attribute__((packed)) HistoryHeader {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t resolution;
+  uint8_t recordSize;
+  uint32_t uptime;   // Seconds since boot when the response started
+  uint32_t count;    // Records that follow (fewer if the ring overtakes the stream)
+};
+
+struct __attribute__((packed)) HistorySample {
+  uint32_t time;
+  int16_t temperature;  // 0.01 °C
+  uint16_t humidity;    // 0.01 %
+  uint16_t gasLevel;    // ppm
+};
+
+struct __attribute__((packed)) HistoryRollup {
+  uint32_t time;  // Start of the period
+  int16_t temperatureMin, temperatureMax, temperatureAvg;
+  uint16_t humidityMin, humidityMax, humidityAvg;
+  uint16_t gasMin, gasMax, gasAvg;
+};
+
+class HistoryStore {
+public:
+  bool begin();
+
+  // Records one sensor cycle; O(1), called from the sensing task
+  void add(float temperature, float humidity, float gasLevel);
+
+  // Serves /api/history
+  void handleRequest(AsyncWebServerRequest *request);
+
+  static uint32_t uptime();
+
+private:
+  struct Accumulator {
+    uint32_t start;
+    uint32_t count;
+    int32_t temperatureSum, humiditySum, gasSum;
+    int16_t temperatureMin, temperatureMax;
+    uint16_t humidityMin, humidityMax, gasMin, gasMax;
+  };
+
+  template <typename Record>
+  struct Ring {
+    Record *records = NULL;
+    uint32_t capacity = 0;
+    uint32_t count = 0;  // Total ever written; record seq lives at seq % capacity
+
+    uint32_t first() const { return count > capacity ? count - capacity : 0; }
+    void push(const Record &record) { records[count % capacity] = record; count++; }
+  };
+
+  static void roll(Accumulator &acc, Ring<HistoryRollup> &ring, uint32_t period, const HistorySample &sample);
+  static HistoryRollup finish(const Accumulator &acc);
+
+  // Sequence numbers of the first record at or after time, in one tier
+  uint32_t lowerBound(HistoryResolution resolution, uint32_t time);
+  uint32_t recordTime(HistoryResolution resolution, uint32_t seq);
+  bool copyRecord(HistoryResolution resolution, uint32_t seq, uint8_t *out);
+
+  Ring<HistorySample> _raw;
+  Ring<HistoryRollup> _minutes;
+  Ring<HistoryRollup> _hours;
+  Accumulator _minute = {};
+  Accumulator _hour = {};
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+extern HistoryStore history;
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef JSON_RESPONSE_H
+#define JSON_RESPONSE_H
+
+#include <ESPAsyncWebServer.h>
+#include <ArduinoJson.h>
+
+#define JSON_RESPONSE_SIZE 768  // /api/status, with the active rule names
+
+// AsyncWebServer response that serializes a document into a fixed buffer
+// owned by the response itself, instead of growing a String. The buffer
+// lives as long as the response, so concurrent requests never share it.
+class JsonBufferResponse : public AsyncAbstractResponse {
+public:
+  JsonBufferResponse(const JsonDocument &doc, int code = 200) {
+    _code = code;
+    _contentType = "application/json";
+    _contentLength = serializeJson(doc, _content, sizeof(_content));
+
+    // A document that ran out of arena, or does not fit, would go out cut
+    // short with the caller's status; report it instead
+    if (doc.overflowed() || measureJson(doc) >= sizeof(_content)) {
+      _code = 500;
+      _contentLength = snprintf(_content, sizeof(_content), "{\"error\":\"%s\"}",
+                                doc.overflowed() ? "JSON arena exhausted" : "response too large");
+    }
+  }
+
+  bool _sourceValid() const override { return true; }
+
+  size_t _fillBuffer(uint8_t *buf, size_t maxLen) override {
+    size_t remaining = _contentLength - _offset;
+    size_t len = remaining < maxLen ? remaining : maxLen;
+    memcpy(buf, _content + _offset, len);
+    _offset += len;
+    return len;
+  }
+
+private:
+  char _content[JSON_RESPONSE_SIZE];
+  size_t _offset = 0;
+};
+
+#endif
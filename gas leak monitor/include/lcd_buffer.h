@@ -0,0 +1,44 @@
+#ifndef LCD_BUFFER_H
+#define LCD_BUFFER_H
+
+#include <Arduino.h>
+#include <LiquidCrystal_I2C.h>
+
+#define LCD_BUFFER_MAX_COLS 20
+#define LCD_BUFFER_MAX_ROWS 4
+
+// Framebuffer in front of an HD44780 over I2C.
+// Drawing (clear/setCursor/print) only touches a RAM frame; flush() diffs it
+// against a shadow copy of what the panel shows and pushes just the changed
+// runs, one setCursor per run. Text past the last column is clipped instead
+// of wrapping into another row.
+class LcdBuffer : public Print {
+public:
+  LcdBuffer(LiquidCrystal_I2C &device, uint8_t cols, uint8_t rows);
+
+  // Initializes the panel; fastI2c switches the bus to 400 kHz
+  void begin(bool fastI2c);
+
+  void clear();
+  void setCursor(uint8_t col, uint8_t row);
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  // Pushes the changed cells to the panel
+  void flush() override;
+
+  // Characters sent to the panel since boot, for comparing against full redraws
+  uint32_t cellsWritten() const { return _cellsWritten; }
+
+private:
+  LiquidCrystal_I2C &_device;
+  uint8_t _cols;
+  uint8_t _rows;
+  uint8_t _col = 0;
+  uint8_t _row = 0;
+  char _frame[LCD_BUFFER_MAX_ROWS][LCD_BUFFER_MAX_COLS];
+  char _shown[LCD_BUFFER_MAX_ROWS][LCD_BUFFER_MAX_COLS];
+  uint32_t _cellsWritten = 0;
+};
+
+#endif
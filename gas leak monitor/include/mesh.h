@@ -0,0 +1,80 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <mesh_protocol.h>
+#include "json_pool.h"
+#include "socket_hub.h"
+#include "telemetry.h"
+
+// ESP-NOW link between gas monitors and smart switches (see mesh_protocol.h).
+// Every monitor broadcasts a MeshFrame each MESH_BROADCAST_INTERVAL_MS, and
+// immediately when its alarm or relay changes, so subscribed switches react
+// without any WiFi association. A monitor started as aggregator also keeps a
+// table of up to MAX_DEVICES peers and pushes it to its WebSocket clients as
+// {"type":"devices","devices":[...]}, so one connection shows the building.
+
+#define MAX_DEVICES 10
+#define MESH_BROADCAST_INTERVAL_MS 1000
+#define MESH_PUSH_INTERVAL_MS 500     // Aggregator: coalesce table pushes
+#define MESH_PEER_TIMEOUT_MS 10000    // Dropped from the table after this much silence
+#define MESH_JSON_POOL_SIZE 3072
+#define MESH_JSON_BUFFER_SIZE 1600
+
+class MeshLink {
+public:
+  bool begin(SocketHub &sockets, bool aggregator);
+
+  // Out-of-cadence broadcast, e.g. right after the alarm latched
+  void sendNow(const SensorSnapshot &snapshot);
+
+  // Latest state from the network task; broadcasts when due or when the alarm/relay changed
+  void publish(const SensorSnapshot &snapshot);
+
+  // Aggregator: pushes the device table when it changed; call from the network loop
+  void poll();
+
+  // Aggregator: device table to a single client
+  void sendDevices(uint8_t num);
+
+  bool aggregator() const { return _aggregator; }
+  uint32_t framesSent() const { return _sent; }
+  uint32_t framesReceived() const { return _received; }
+  uint32_t framesLost() const { return _lost; }
+
+private:
+  struct Peer {
+    bool used;
+    uint8_t mac[6];
+    MeshFrame frame;
+    uint32_t lastSeenMs;
+  };
+
+  static void onReceive(const uint8_t *mac, const uint8_t *data, int len);
+  void handleFrame(const uint8_t *mac, const MeshFrame &frame);
+  void broadcast(const SensorSnapshot &snapshot, bool urgent);
+  size_t buildDevices(uint32_t now);
+
+  static MeshLink *_instance;
+
+  SocketHub *_sockets = NULL;
+  bool _started = false;
+  bool _aggregator = false;
+  uint16_t _seq = 0;
+  uint8_t _lastFlags = 0;
+  uint32_t _lastBroadcastMs = 0;
+  uint32_t _lastPushMs = 0;
+  volatile bool _dirty = false;
+  uint32_t _sent = 0;
+  volatile uint32_t _received = 0;
+  volatile uint32_t _lost = 0;
+  Peer _peers[MAX_DEVICES] = {};
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  JsonPool<MESH_JSON_POOL_SIZE> _pool;
+  char _buffer[MESH_JSON_BUFFER_SIZE];
+};
+
+extern MeshLink mesh;
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+// Lightweight on-device instrumentation, served as Prometheus text on
+// /api/metrics. Recording is a bucket search and a few adds, so it stays on
+// in production builds; all formatting happens in the AsyncTCP task when a
+// scrape comes in, one small block at a time.
+
+#define METRICS_BUCKETS 12
+#define METRICS_BLOCK_SIZE 1536  // Largest rendered block: a family header plus one histogram series
+#define METRICS_CONTENT_TYPE "text/plain; version=0.0.4; charset=utf-8"
+
+// Latency histogram in microseconds, fixed bounds from 100 us to 250 ms.
+// Each histogram has a single writer task; a scrape from the other core can
+// catch a sample half-recorded, which is harmless for monitoring.
+class LatencyHistogram {
+public:
+  void observe(uint32_t us);
+
+  uint32_t bucket(uint8_t i) const { return _buckets[i]; }
+  uint64_t sumUs() const { return _sumUs; }
+  uint32_t lastUs() const { return _lastUs; }
+  uint32_t maxUs() const { return _maxUs; }
+
+  // Upper bounds in microseconds; the last bucket is +Inf
+  static const uint32_t bounds[METRICS_BUCKETS];
+
+private:
+  volatile uint32_t _buckets[METRICS_BUCKETS] = {};
+  volatile uint64_t _sumUs = 0;
+  volatile uint32_t _lastUs = 0;
+  volatile uint32_t _maxUs = 0;
+};
+
+// Records the lifetime of a scope into a histogram
+class MetricsTimer {
+public:
+  explicit MetricsTimer(LatencyHistogram &histogram) : _histogram(histogram), _started(micros()) {}
+  ~MetricsTimer() { _histogram.observe(micros() - _started); }
+
+private:
+  LatencyHistogram &_histogram;
+  uint32_t _started;
+};
+
+// Timings and counters recorded by the tasks
+struct DeviceMetrics {
+  LatencyHistogram sensorLoop;        // Work per sensing task iteration, queue waits excluded
+  LatencyHistogram networkLoop;
+  LatencyHistogram uiLoop;
+  LatencyHistogram dhtRead;           // Whole DHT transaction, start pulse included
+  LatencyHistogram lcdUpdate;
+  LatencyHistogram telemetryPublish;  // One publish to every connected client
+  LatencyHistogram webSocketSend;     // Time to queue one socket message
+  LatencyHistogram alarmTrip;         // Threshold crossing to relay/alarm output
+
+  volatile uint32_t webSocketConnects = 0;
+  volatile uint32_t webSocketDisconnects = 0;
+  volatile uint32_t webSocketBadFrames = 0;
+
+  // Boot stages in microseconds since reset; 0 until reached
+  volatile uint32_t bootSensingUs = 0;      // Sampler and sensing task started
+  volatile uint32_t bootFirstSampleUs = 0;  // First gas sample through the alarm path
+  volatile uint32_t bootNetworkUs = 0;      // softAP, servers and mesh up
+  volatile uint32_t bootUiUs = 0;           // LCD splash shown, UI task started
+};
+
+extern DeviceMetrics metrics;
+
+// Appends exposition lines to a fixed buffer. A line that does not fit is
+// dropped whole, so a block never ends in a torn line.
+class MetricsWriter {
+public:
+  MetricsWriter(char *buffer, size_t size) : _buffer(buffer), _size(size) {}
+
+  // # HELP and # TYPE lines for a family
+  void family(const char *name, const char *type, const char *help);
+
+  // One sample; labels is the text inside the braces, or NULL
+  void value(const char *name, const char *labels, uint32_t value);
+  void seconds(const char *name, const char *labels, uint64_t us);
+  void decimal(const char *name, const char *labels, float value);
+
+  // _bucket, _sum and _count lines in seconds
+  void histogram(const char *name, const char *labels, const LatencyHistogram &histogram);
+
+  size_t length() const { return _length; }
+
+private:
+  void append(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+  char *_buffer;
+  size_t _size;
+  size_t _length = 0;
+};
+
+// Renders block number `block` of the exposition; false once past the last one
+typedef bool (*MetricsRenderer)(uint16_t block, MetricsWriter &out);
+
+// Streams the exposition block by block from a buffer owned by the response,
+// so a scrape never holds more than METRICS_BLOCK_SIZE bytes of text and
+// concurrent scrapes never share state. Values within a family are read
+// together; different families may be a few milliseconds apart.
+class MetricsResponse : public AsyncAbstractResponse {
+public:
+  // chunked needs an HTTP/1.1 client; otherwise the body ends when the connection closes
+  MetricsResponse(MetricsRenderer renderer, bool chunked);
+
+  bool _sourceValid() const override { return true; }
+  size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
+
+private:
+  MetricsRenderer _renderer;
+  uint16_t _block = 0;
+  bool _finished = false;
+  size_t _length = 0;
+  size_t _offset = 0;
+  char _text[METRICS_BLOCK_SIZE];
+};
+
+#endif
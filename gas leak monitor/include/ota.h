@@ -0,0 +1,63 @@
+#ifndef OTA_H
+#define OTA_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <esp_timer.h>
+#include <ota_session.h>
+
+// Firmware updates over HTTP (the protocol is in ota_session.h) with
+// rollback. Chunks are written from the AsyncTCP task, which platformio.ini
+// pins to core 0, so the sensing core only feels the flash cache stall of
+// each 4 KB sector erase; the sampler's I2S DMA ring (gas_sampler.h) holds
+// 64 ms of samples and rides that out.
+//
+// A new image boots on trial: a record in NVS counts its boots, and poll()
+// confirms it once the sensing path has delivered a gas sample. An image
+// still unconfirmed after OTA_TRIAL_MS, or booting for the
+// OTA_TRIAL_BOOTS + 1st time, selects the previous image again and restarts.
+// This does not depend on the bootloader; one built with app rollback gets
+// its own check cancelled on confirm, and rolls back a crash before setup().
+
+#define OTA_TRIAL_BOOTS 3
+#define OTA_TRIAL_MS 60000
+#define OTA_TRIAL_MAGIC 0x4F544131  // "OTA1"
+
+class OtaService {
+public:
+  // Counts a trial boot, or rolls back when the trial is used up; call early in setup()
+  void begin();
+
+  // Registers the /api/ota routes
+  void addRoutes(AsyncWebServer &server);
+
+  // Confirms a trial image once healthy; call from a low-priority task
+  void poll(bool healthy);
+
+  // An uploaded image is verified and waiting for the restart
+  bool restartDue() const { return _session.restartDue(); }
+
+  bool trial() const { return _trial; }
+
+private:
+  struct TrialRecord {
+    uint32_t magic;
+    char image[17];     // Partition label of the image on trial
+    char previous[17];  // And of the one it replaced
+    uint8_t boots;
+  };
+
+  void sendStatus(AsyncWebServerRequest *request, int code);
+  void startTrial();
+  void rollBack();
+  static uint32_t chunkOffset(AsyncWebServerRequest *request);
+
+  OtaSession _session;
+  TrialRecord _record = {};
+  esp_timer_handle_t _timer = NULL;
+  volatile bool _trial = false;
+};
+
+extern OtaService ota;
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef RULE_STORE_H
+#define RULE_STORE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "rule_engine.h"
+
+// Alarm rules (rule_engine.h) in NVS, next to the settings. The RuleSet is
+// kept as one blob behind its version and size; a record that does not
+// match, or no longer compiles, gives way to the default rules. save() only
+// stages the set, poll() writes it from the same low-priority task as the
+// settings, so an upload never puts a flash write on the alarm path.
+
+#define RULE_STORE_VERSION 1
+
+class RuleStore {
+public:
+  // Loads the stored set, or the defaults; program is compiled from it
+  void begin(RuleSet &set, AlarmProgram &program);
+
+  // Stages a set for the next poll()
+  void save(const RuleSet &set);
+
+  // Writes a staged set; call periodically from a low-priority task
+  void poll();
+
+private:
+  struct Record {
+    uint16_t version;
+    uint16_t size;
+    RuleSet set;
+  };
+
+  Preferences _prefs;
+  Record _staged = {};
+  volatile bool _dirty = false;
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+extern RuleStore ruleStore;
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// Persistent settings in NVS. NVS is already a wear-leveled, log-structured
+// key/value store; the record is kept as one CRC-checked blob so a torn or
+// stale layout is detected and replaced by defaults. save() only stages the
+// record: the flash write happens in poll() once changes have settled for
+// SETTINGS_COMMIT_DELAY_MS (or SETTINGS_COMMIT_MAX_DELAY_MS after the first
+// unsaved change), so a burst of slider updates costs a single commit.
+//
+// Version 2 added gasR0 and moved gasThreshold from ADC counts to ppm; a
+// version 1 record is migrated with the default gas threshold.
+
+#define SETTINGS_VERSION 2
+#define SETTINGS_COMMIT_DELAY_MS 3000
+#define SETTINGS_COMMIT_MAX_DELAY_MS 15000
+
+struct DeviceSettings {
+  uint16_t version;
+  uint16_t size;
+  char apPassword[33];
+  char stationSSID[33];
+  char stationPassword[65];
+  uint8_t autoMode;
+  float gasThreshold;
+  float tempThreshold;
+  float gasR0;   // Sensor calibration (gas_ppm.h); 0 until calibrated
+  uint32_t crc;  // CRC-32 of everything above
+};
+
+class SettingsStore {
+public:
+  // Loads the record; falls back to the legacy EEPROM layout, then to defaults
+  void begin(const DeviceSettings &defaults);
+
+  DeviceSettings get();
+
+  // Stages a new record for the next deferred commit
+  void save(const DeviceSettings &settings);
+
+  // Commits staged changes when due; call periodically from a low-priority task
+  void poll();
+
+  // Commits staged changes right away (e.g. before a restart)
+  void commitNow();
+
+  uint32_t commitCount() const { return _commits; }
+
+private:
+  bool readRecord(DeviceSettings &settings);
+  bool readRecordV1(DeviceSettings &settings);
+  bool readLegacyEeprom(DeviceSettings &settings);
+  void commit();
+  static uint32_t checksum(const void *data, size_t len);
+
+  Preferences _prefs;
+  DeviceSettings _current = {};
+  bool _dirty = false;
+  uint32_t _firstChangeMs = 0;
+  uint32_t _lastChangeMs = 0;
+  uint32_t _commits = 0;
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+extern SettingsStore settings;
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef SOCKET_HUB_H
+#define SOCKET_HUB_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+// Real-time channel on the HTTP server: AsyncWebSocket at ws://<ip>/ws.
+// AsyncTCP delivers socket events in its own task; the hub queues them for
+// the network task, so telemetry, commands and the mesh push all run in one
+// task and address clients by a small slot number. Outgoing messages go
+// into the library's per-client queue, bounded by WS_MAX_QUEUED_MESSAGES
+// (platformio.ini) and drained by AsyncTCP as the client acknowledges. A
+// client whose queue stays full for SOCKET_SLOW_CLIENT_MS is closed, and
+// connections past SOCKET_MAX_CLIENTS are refused.
+//
+// AsyncTCP creates and frees the client objects in its own task. The hub
+// keeps their pointers in a table that only the connect and disconnect
+// events change, under _lock; the network task holds the same lock from
+// lookup to send, and around cleanupClients(), so a client cannot be freed
+// underneath it.
+
+#ifndef SOCKET_MAX_CLIENTS
+#define SOCKET_MAX_CLIENTS 12  // Each one holds a TCP PCB; lwIP has 16 by default
+#endif
+#define SOCKET_PATH "/ws"
+#define SOCKET_MESSAGE_MAX 512          // Largest command frame accepted
+#define SOCKET_INBOX_LENGTH 8           // Events waiting for the network task
+#define SOCKET_SLOW_CLIENT_MS 5000
+#define SOCKET_CHECK_INTERVAL_MS 1000   // Stale slot check and library cleanup
+#define SOCKET_CLOSE_TRY_AGAIN 1013
+
+enum SocketEventType : uint8_t {
+  SOCKET_CONNECTED,
+  SOCKET_DISCONNECTED,
+  SOCKET_TEXT
+};
+
+typedef void (*SocketHandler)(uint8_t num, SocketEventType type, const uint8_t *payload, size_t length);
+
+class SocketHub {
+public:
+  SocketHub() : _ws(SOCKET_PATH) {}
+
+  // Registers the endpoint on the server; handler runs in the network task
+  void begin(AsyncWebServer &server, SocketHandler handler);
+
+  // Dispatches queued socket events to the handler; call from the network task
+  void poll();
+
+  // Queues one message for a client; false when it is gone or its queue is full
+  bool send(uint8_t num, const uint8_t *data, size_t len, bool binary);
+  void broadcast(const char *text, size_t len);
+
+  bool connected(uint8_t num) const { return num < SOCKET_MAX_CLIENTS && _slots[num].id != 0; }
+  uint8_t count() const;
+
+  uint32_t rejected() const { return _rejected; }
+  uint32_t evicted() const { return _evicted; }
+  uint32_t refusedFrames() const { return _refusedFrames; }
+  uint32_t inboxDrops() const { return _inboxDrops; }
+
+private:
+  struct Slot {
+    uint32_t id;  // AsyncWebSocket client id; 0 when free
+    bool full;
+    uint32_t fullSinceMs;
+  };
+
+  // A client AsyncTCP has connected and not yet freed; guarded by _lock
+  struct Live {
+    uint32_t id;  // 0 when free
+    AsyncWebSocketClient *client;
+  };
+
+  struct InboxEvent {
+    uint32_t id;
+    SocketEventType type;
+    uint16_t length;
+    uint8_t payload[SOCKET_MESSAGE_MAX];
+  };
+
+  void onEvent(AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
+  void release(uint8_t num);
+  int slotOf(uint32_t id) const;
+  // With _lock held
+  AsyncWebSocketClient *liveClient(uint32_t id) const;
+  bool queue(Slot &slot, AsyncWebSocketClient *client, const uint8_t *data, size_t len, bool binary);
+
+  AsyncWebSocket _ws;
+  SocketHandler _handler = NULL;
+  QueueHandle_t _inbox = NULL;
+  SemaphoreHandle_t _lock = NULL;  // Recursive: closing a client may raise its disconnect in place
+  Live _live[SOCKET_MAX_CLIENTS] = {};
+  Slot _slots[SOCKET_MAX_CLIENTS] = {};
+  uint32_t _lastCheckMs = 0;
+  InboxEvent _incoming;  // AsyncTCP task only
+  InboxEvent _received;  // Network task only
+
+  volatile uint32_t _rejected = 0;
+  uint32_t _evicted = 0;
+  volatile uint32_t _refusedFrames = 0;
+  volatile uint32_t _inboxDrops = 0;
+};
+
+extern SocketHub sockets;
+
+#endif
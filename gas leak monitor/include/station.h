@@ -0,0 +1,67 @@
+#ifndef STATION_H
+#define STATION_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+// Station uplink next to the always-on softAP.
+// connect() only switches to AP+STA and starts the join; progress comes back
+// through WiFi.onEvent, and a dropped or failed join is retried from poll()
+// with exponential backoff. Nothing here waits on the radio, so callers on
+// the UI or sensing paths never block on network state.
+//
+// Note that the softAP follows the station onto the router's channel once it
+// associates, which briefly disturbs AP clients and ESP-NOW peers.
+
+#define STATION_BACKOFF_MIN_MS 1000
+#define STATION_BACKOFF_MAX_MS 60000
+
+enum StationState {
+  STATION_IDLE,        // Not wanted; AP only
+  STATION_CONNECTING,
+  STATION_CONNECTED,
+  STATION_BACKOFF      // Waiting to retry
+};
+
+class StationLink {
+public:
+  void begin();
+
+  // Starts joining in the background; any previous join is replaced
+  void connect(const char *ssid, const char *password);
+
+  // Leaves the network and drops back to AP only
+  void disconnect();
+
+  // Retries when the backoff expired; call from the network loop
+  void poll();
+
+  StationState state() const { return _state; }
+
+  // Bumped on every state change, so the UI can tell when to redraw
+  uint32_t changes() const { return _changes; }
+
+  // Remaining wait before the next attempt, in ms
+  uint32_t retryInMs() const;
+
+  uint32_t attempts() const { return _attempts; }
+  uint8_t lastReason() const { return _lastReason; }
+
+private:
+  void onEvent(arduino_event_id_t event, arduino_event_info_t info);
+  void setState(StationState state);
+  void attempt();
+
+  char _ssid[33] = {};
+  char _password[65] = {};
+  volatile StationState _state = STATION_IDLE;
+  volatile uint32_t _changes = 0;
+  volatile uint32_t _retryAtMs = 0;
+  volatile uint8_t _lastReason = 0;
+  uint32_t _backoffMs = STATION_BACKOFF_MIN_MS;
+  uint32_t _attempts = 0;
+};
+
+extern StationLink station;
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "json_pool.h"
+#include "sensor_snapshot.h"
+#include "socket_hub.h"
+#include "telemetry_codec.h"
+
+// Default per-client subscription: analog fields are only sent once they move
+// past their deadband, and at most once per interval. State changes (alarm,
+// relay, mode, thresholds) always go out immediately.
+#define TELEMETRY_DEFAULT_INTERVAL_MS 250
+#define TELEMETRY_MIN_INTERVAL_MS 50
+#define TELEMETRY_DEADBAND_TEMPERATURE 0.1f
+#define TELEMETRY_DEADBAND_HUMIDITY 0.5f
+#define TELEMETRY_DEADBAND_GAS 10.0f  // ppm
+
+// Static document arena and output buffer for outgoing JSON messages
+#define TELEMETRY_JSON_POOL_SIZE 1536
+#define TELEMETRY_JSON_BUFFER_SIZE 384
+
+// Per-client send accounting for /api/metrics. Messages wait in the socket
+// hub's bounded per-client queue; when it is full the delta stays pending
+// and later updates fold into it until the client catches up or is evicted.
+struct TelemetryClientStats {
+  uint32_t pending;    // Deltas waiting for the client's interval or queue room (0 or 1)
+  uint32_t messages;
+  uint32_t bytes;
+  uint32_t failures;   // Messages refused by a full client queue
+  uint32_t coalesced;  // Updates folded into a pending delta instead of sent
+};
+
+// Change-driven WebSocket telemetry. Every client gets a full snapshot on
+// connect and on getStatus; after that only the fields that changed since
+// what that client last received, coalesced and rate-limited per client.
+class TelemetryPublisher {
+public:
+  void begin(SocketHub &sockets, const String &deviceID);
+
+  void clientConnected(uint8_t num, const SensorSnapshot &snapshot);
+  void clientDisconnected(uint8_t num);
+
+  // Applies {"command":"subscribe","format":"json"|"binary","interval":ms,
+  //          "deadband":{"temperature":..,"humidity":..,"gasLevel":..}}
+  void subscribe(uint8_t num, JsonVariantConst options);
+
+  // Full snapshot to a single client
+  void sendSnapshot(uint8_t num, const SensorSnapshot &snapshot);
+
+  // New state from the sensing task; sends what is due right away
+  void publish(const SensorSnapshot &snapshot);
+
+  // Flushes deltas held back by the rate limit; call from the network loop
+  void poll();
+
+  // Caps every client's interval, e.g. while the sensing path runs fast; 0 lifts it
+  void setIntervalCap(uint16_t ms) { _intervalCapMs = ms; }
+
+  // Peak arena use and failed allocations, for sizing TELEMETRY_JSON_POOL_SIZE
+  size_t poolPeak() const { return _pool.peak(); }
+  uint32_t poolFailures() const { return _pool.failures(); }
+
+  // Send accounting of a connected client; false when the slot is free
+  bool clientStats(uint8_t num, TelemetryClientStats &stats) const;
+
+private:
+  struct Client {
+    bool connected;
+    bool dirty;
+    bool binary;
+    SensorSnapshot sent;
+    uint32_t lastSendMs;
+    uint16_t intervalMs;
+    TelemetryDeadband deadband;
+    uint32_t messages;
+    uint32_t bytes;
+    uint32_t failures;
+    uint32_t coalesced;
+  };
+
+  void flush(uint8_t num, uint32_t now);
+  void markSent(Client &client, const SensorSnapshot &snapshot, uint32_t now);
+  bool sendFrame(uint8_t num, const SensorSnapshot &snapshot, bool full);
+  bool sendJson(uint8_t num, const JsonDocument &doc);
+  bool transmit(uint8_t num, const uint8_t *data, size_t len, bool binary);
+
+  SocketHub *_sockets = NULL;
+  const String *_deviceID = NULL;
+  SensorSnapshot _latest = {};
+  volatile uint16_t _intervalCapMs = 0;
+  Client _clients[SOCKET_MAX_CLIENTS] = {};
+  JsonPool<TELEMETRY_JSON_POOL_SIZE> _pool;
+  char _buffer[TELEMETRY_JSON_BUFFER_SIZE];
+};
+
+extern TelemetryPublisher telemetry;
+
+#endif
@@ -0,0 +1,38 @@
+// Generated by tools/embed_web.py from web/ -- do not edit
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <Arduino.h>
+
+#define WEB_INDEX_HTML_LEN 409
+#define WEB_INDEX_HTML_ETAG "\"6cc36f73\""
+static const uint8_t WEB_INDEX_HTML_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x75, 0x52, 0xc1, 0x6e, 0xdc, 0x20,
+  0x10, 0xbd, 0xfb, 0x2b, 0xa6, 0x27, 0x7b, 0xa5, 0xae, 0x9d, 0xf4, 0x68, 0x63, 0x4b, 0x69, 0x36,
+  0xaa, 0xf6, 0x50, 0x35, 0x52, 0xd3, 0x43, 0x8f, 0x04, 0xc6, 0x6b, 0x2a, 0x0c, 0x08, 0x66, 0x93,
+  0x58, 0xd1, 0xfe, 0x7b, 0x07, 0xaf, 0x56, 0x69, 0x14, 0xf5, 0x02, 0x0c, 0xbc, 0x79, 0x7a, 0xef,
+  0x0d, 0xe2, 0xd3, 0xee, 0xc7, 0xed, 0xc3, 0xef, 0xfb, 0x3b, 0x98, 0x68, 0xb6, 0x43, 0x21, 0xd6,
+  0x4d, 0x4c, 0x28, 0x35, 0x17, 0x64, 0xc8, 0xe2, 0xf0, 0x73, 0x96, 0x91, 0xe0, 0x9b, 0x4c, 0xf0,
+  0xdd, 0x3b, 0x43, 0x3e, 0x8a, 0xe6, 0xfc, 0x50, 0x88, 0x19, 0x49, 0x82, 0x93, 0x33, 0xf6, 0xe5,
+  0x93, 0xc1, 0xe7, 0xe0, 0x23, 0x95, 0xa0, 0xbc, 0x23, 0x74, 0xd4, 0x97, 0xcf, 0x46, 0xd3, 0xd4,
+  0x6b, 0x7c, 0x32, 0x0a, 0xb7, 0x6b, 0xf1, 0x19, 0x0c, 0x33, 0x18, 0x69, 0xb7, 0x49, 0x49, 0x8b,
+  0xfd, 0x75, 0xc9, 0x24, 0x89, 0x16, 0x26, 0x7b, 0xf4, 0x7a, 0x79, 0x1d, 0xb9, 0x75, 0x3b, 0xca,
+  0xd9, 0xd8, 0xa5, 0xbd, 0x89, 0x8c, 0xeb, 0x08, 0x5f, 0x68, 0x2b, 0xad, 0x39, 0xb8, 0x56, 0x31,
+  0x29, 0xc6, 0x8e, 0xd5, 0x1c, 0x8c, 0x6b, 0xaf, 0xba, 0x20, 0xb5, 0x36, 0xee, 0xd0, 0x7e, 0xb9,
+  0x0a, 0x2f, 0xdd, 0x49, 0x34, 0x67, 0x9e, 0x42, 0x34, 0xab, 0x7a, 0x91, 0x09, 0xb3, 0xa1, 0xeb,
+  0x7f, 0x0c, 0x48, 0xa7, 0xe1, 0x01, 0xe7, 0x80, 0x51, 0xd2, 0x31, 0xe2, 0x9b, 0x21, 0x46, 0x15,
+  0x22, 0x0c, 0xbf, 0x12, 0x02, 0x4d, 0x08, 0xb3, 0x7f, 0x34, 0x16, 0x41, 0x86, 0x00, 0xa3, 0x8f,
+  0x30, 0x1e, 0xad, 0xe5, 0xc5, 0x29, 0x32, 0xde, 0xb1, 0x18, 0x5a, 0x6a, 0xd1, 0x84, 0xb5, 0x63,
+  0xb7, 0xba, 0x83, 0xfd, 0xae, 0x05, 0x91, 0x82, 0x74, 0x60, 0x74, 0x5f, 0x1a, 0x5d, 0x0e, 0x75,
+  0xcd, 0x98, 0x7c, 0x33, 0x5c, 0xa0, 0xfb, 0x7b, 0xb8, 0xd1, 0x3a, 0x62, 0x4a, 0xef, 0xb0, 0xa1,
+  0x1c, 0xde, 0x01, 0x93, 0x8a, 0x26, 0xd0, 0x50, 0x68, 0xaf, 0x8e, 0x33, 0x5b, 0xae, 0x0f, 0x48,
+  0x77, 0x16, 0xf3, 0xf1, 0xeb, 0xb2, 0xd7, 0x55, 0xee, 0xd8, 0xd4, 0x39, 0x97, 0xdb, 0x73, 0xd0,
+  0xd0, 0x83, 0xf5, 0x4a, 0x66, 0x6d, 0xf5, 0xe4, 0x13, 0xe5, 0x79, 0x74, 0xc5, 0x88, 0xa4, 0xa6,
+  0xaa, 0x6c, 0x64, 0x30, 0x9c, 0x0c, 0xdb, 0x4d, 0xb9, 0x6b, 0x42, 0x57, 0x5d, 0x8c, 0x40, 0x15,
+  0x37, 0xf0, 0x0a, 0x11, 0x39, 0x0a, 0x07, 0xb1, 0xfe, 0x93, 0xbc, 0xab, 0x36, 0x1d, 0x9c, 0x3e,
+  0xe0, 0x12, 0xe3, 0x0a, 0x80, 0xff, 0x2b, 0xd2, 0x1f, 0x14, 0xa5, 0xfa, 0x3c, 0xf7, 0xfd, 0xae,
+  0x2b, 0x4e, 0x9b, 0x8e, 0xa7, 0x72, 0xf1, 0x25, 0x9a, 0x75, 0x32, 0x9c, 0xf9, 0xfa, 0xe3, 0xfe,
+  0x02, 0x77, 0x9c, 0xff, 0x32, 0x82, 0x02, 0x00, 0x00,
+};
+
+#endif
@@ -0,0 +1,53 @@
+#include "button_logic.h"
+
+// Wrap-safe "a is at or after b" for millisecond timestamps
+static bool reached(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) >= 0;
+}
+
+void ButtonTracker::edge(bool pressed, uint32_t timeMs) {
+  // Every edge restarts the settle time, even when the level read back is
+  // unchanged: an odd number of bounces went by in between
+  _raw = pressed;
+  _rawSinceMs = timeMs;
+}
+
+bool ButtonTracker::update(uint32_t nowMs, ButtonEventType &type, uint32_t &timeMs) {
+  if (_raw != _stable) {
+    if (!reached(nowMs, _rawSinceMs + BUTTON_DEBOUNCE_MS)) {
+      return false;
+    }
+
+    _stable = _raw;
+    type = _stable ? BUTTON_PRESS : BUTTON_RELEASE;
+    timeMs = _rawSinceMs;
+    if (_stable) {
+      _long = false;
+      _repeats = 0;
+      _nextRepeatMs = _rawSinceMs + BUTTON_LONG_PRESS_MS;
+    }
+    return true;
+  }
+
+  if (!_stable || !reached(nowMs, _nextRepeatMs)) {
+    return false;
+  }
+
+  timeMs = _nextRepeatMs;
+  if (!_long) {
+    _long = true;
+    type = BUTTON_LONG_PRESS;
+    return true;
+  }
+
+  type = BUTTON_REPEAT;
+  _repeats++;
+  uint32_t interval = _repeats >= BUTTON_REPEAT_FAST_AFTER ? BUTTON_REPEAT_FAST_MS : BUTTON_REPEAT_MS;
+  _nextRepeatMs += interval;
+
+  // A consumer that fell behind gets one repeat, not a burst of catch-up ones
+  if (reached(nowMs, _nextRepeatMs)) {
+    _nextRepeatMs = nowMs + interval;
+  }
+  return true;
+}
@@ -0,0 +1,50 @@
+#ifndef BUTTON_LOGIC_H
+#define BUTTON_LOGIC_H
+
+#include <stdint.h>
+
+// Debounce, long-press and auto-repeat for one push button, driven by
+// timestamped raw edges instead of polling. A level only counts once it has
+// held for BUTTON_DEBOUNCE_MS; a press held past BUTTON_LONG_PRESS_MS
+// reports a long press and then repeats, speeding up after
+// BUTTON_REPEAT_FAST_AFTER repeats.
+
+#define BUTTON_DEBOUNCE_MS 30
+#define BUTTON_LONG_PRESS_MS 600
+#define BUTTON_REPEAT_MS 150
+#define BUTTON_REPEAT_FAST_MS 50
+#define BUTTON_REPEAT_FAST_AFTER 10
+
+enum ButtonEventType {
+  BUTTON_PRESS,
+  BUTTON_RELEASE,
+  BUTTON_LONG_PRESS,  // Once per press, right before the first repeat
+  BUTTON_REPEAT
+};
+
+struct ButtonEvent {
+  uint8_t button;
+  ButtonEventType type;
+  uint32_t timeMs;  // When the edge settled or the repeat fell due
+};
+
+class ButtonTracker {
+public:
+  // Raw level right after an edge, with the time the edge was seen
+  void edge(bool pressed, uint32_t timeMs);
+
+  // Next event due at nowMs; false when nothing is due yet
+  bool update(uint32_t nowMs, ButtonEventType &type, uint32_t &timeMs);
+
+  bool pressed() const { return _stable; }
+
+private:
+  bool _raw = false;
+  bool _stable = false;
+  bool _long = false;
+  uint32_t _rawSinceMs = 0;
+  uint32_t _nextRepeatMs = 0;
+  uint16_t _repeats = 0;
+};
+
+#endif
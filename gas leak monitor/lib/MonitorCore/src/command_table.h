@@ -0,0 +1,23 @@
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include <stdint.h>
+#include <ArduinoJson.h>
+
+// Command names are FNV-1a hashed at compile time and matched with a switch
+// (see COMMAND below), so a lookup is one hash of the incoming name, a jump
+// and a single strcmp to rule out collisions. Two registered names that
+// collide fail to compile as duplicate case labels.
+
+constexpr uint32_t commandHash(const char *name, uint32_t hash = 2166136261u) {
+  return *name ? commandHash(name + 1, (hash ^ (uint8_t)*name) * 16777619u) : hash;
+}
+
+// Returns NULL on success or a short error message
+typedef const char *(*CommandHandler)(uint8_t num, JsonObjectConst command);
+
+// Registers a command inside a lookup switch: COMMAND("getStatus", cmdGetStatus)
+#define COMMAND(name, fn) \
+  case commandHash(name): expected = name; handler = fn; break;
+
+#endif
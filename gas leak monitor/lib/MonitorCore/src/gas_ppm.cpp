@@ -0,0 +1,184 @@
+#include "gas_ppm.h"
+
+#include <math.h>
+
+namespace {
+
+// constexpr math for the table generators; libm is not constexpr
+
+constexpr double LN2 = 0.69314718055994531;
+
+constexpr double constLog2(double x) {
+  int exponent = 0;
+  while (x >= 2) { x /= 2; exponent++; }
+  while (x < 1) { x *= 2; exponent--; }
+  // ln(x) = 2 atanh((x - 1) / (x + 1)), converges fast for x in [1, 2)
+  double y = (x - 1) / (x + 1);
+  double term = y;
+  double sum = 0;
+  for (int k = 1; k < 40; k += 2) {
+    sum += term / k;
+    term *= y * y;
+  }
+  return exponent + 2 * sum / LN2;
+}
+
+constexpr double constExp2(double x) {
+  double term = 1;
+  double sum = 1;
+  for (int k = 1; k < 30; k++) {
+    term *= x * LN2 / k;
+    sum += term;
+  }
+  return sum;
+}
+
+constexpr int32_t q16(double value) {
+  return (int32_t)(value * 65536 + (value < 0 ? -0.5 : 0.5));
+}
+
+// log2(Rs/RL) by ADC count, one entry every 16 counts; the two ends are
+// clamped one count inside the rails where the divider has no answer
+#define LOG_TABLE_SHIFT 8  // Q4 ADC to table index
+#define LOG_TABLE_SIZE ((65536 >> LOG_TABLE_SHIFT) + 1)
+
+struct Log2Table {
+  int32_t v[LOG_TABLE_SIZE];
+};
+
+constexpr Log2Table makeRatioLog2() {
+  Log2Table table = {};
+  for (int i = 0; i < LOG_TABLE_SIZE; i++) {
+    double adc = i << (LOG_TABLE_SHIFT - 4);
+    if (adc < 1) adc = 1;
+    if (adc > GAS_PPM_ADC_FULL_SCALE - 1) adc = GAS_PPM_ADC_FULL_SCALE - 1;
+    table.v[i] = q16(constLog2((GAS_PPM_ADC_FULL_SCALE - adc) / adc));
+  }
+  return table;
+}
+
+// 2^(i/256) in Q16 for the fractional part of the result exponent
+#define EXP_TABLE_SIZE 257
+
+struct Exp2Table {
+  uint32_t v[EXP_TABLE_SIZE];
+};
+
+constexpr Exp2Table makeExp2() {
+  Exp2Table table = {};
+  for (int i = 0; i < EXP_TABLE_SIZE; i++) {
+    table.v[i] = (uint32_t)q16(constExp2(i / 256.0));
+  }
+  return table;
+}
+
+// Rs(T, H) / Rs(20 C, 33 %RH) from the MQ-2 datasheet, as log2 in Q16
+#define CLIMATE_T_MIN -10.0f
+#define CLIMATE_T_STEP 10.0f
+#define CLIMATE_T_POINTS 7
+#define CLIMATE_H_LOW 33.0f
+#define CLIMATE_H_HIGH 85.0f
+
+constexpr double CLIMATE_FACTOR[2][CLIMATE_T_POINTS] = {
+  {1.30, 1.20, 1.10, 1.00, 0.93, 0.88, 0.85},  // 33 %RH
+  {1.18, 1.08, 0.99, 0.90, 0.84, 0.80, 0.77},  // 85 %RH
+};
+
+struct ClimateTable {
+  int32_t v[2][CLIMATE_T_POINTS];
+};
+
+constexpr ClimateTable makeClimate() {
+  ClimateTable table = {};
+  for (int h = 0; h < 2; h++) {
+    for (int t = 0; t < CLIMATE_T_POINTS; t++) {
+      table.v[h][t] = q16(constLog2(CLIMATE_FACTOR[h][t]));
+    }
+  }
+  return table;
+}
+
+constexpr Log2Table RATIO_LOG2 = makeRatioLog2();
+constexpr Exp2Table EXP2 = makeExp2();
+constexpr ClimateTable CLIMATE_LOG2 = makeClimate();
+
+constexpr int32_t CURVE_B = q16(GAS_PPM_CURVE_B);
+constexpr int32_t CURVE_LOG2_A = q16(constLog2(GAS_PPM_CURVE_A));
+constexpr int32_t CLEAN_AIR_LOG2 = q16(constLog2(GAS_PPM_CLEAN_AIR_RATIO));
+constexpr uint32_t PPM_MAX_Q4 = (uint32_t)GAS_PPM_MAX << 4;
+
+static_assert(RATIO_LOG2.v[0] > RATIO_LOG2.v[LOG_TABLE_SIZE - 1], "log table must fall with ADC");
+static_assert(EXP2.v[0] == 65536 && EXP2.v[EXP_TABLE_SIZE - 1] == 131072, "exp2 table endpoints");
+
+}
+
+void GasPpmConverter::setR0(float r0) {
+  if (r0 > 0) {
+    _log2R0 = (int32_t)lroundf(log2f(r0) * 65536);
+    _calibrated = true;
+  } else {
+    _log2R0 = (int32_t)lroundf(log2f(GAS_PPM_DEFAULT_R0) * 65536);
+    _calibrated = false;
+  }
+}
+
+float GasPpmConverter::r0() const {
+  return exp2f(_log2R0 / 65536.0f);
+}
+
+void GasPpmConverter::calibrate(float cleanAirAdc) {
+  if (cleanAirAdc < 1) cleanAirAdc = 1;
+  if (cleanAirAdc > GAS_PPM_ADC_FULL_SCALE - 1) cleanAirAdc = GAS_PPM_ADC_FULL_SCALE - 1;
+  float ratio = (GAS_PPM_ADC_FULL_SCALE - cleanAirAdc) / cleanAirAdc;
+  _log2R0 = (int32_t)lroundf(log2f(ratio) * 65536) - _log2Climate - CLEAN_AIR_LOG2;
+  _calibrated = true;
+}
+
+void GasPpmConverter::setClimate(float temperature, float humidity) {
+  if (isnan(temperature) || isnan(humidity)) return;
+
+  float t = (temperature - CLIMATE_T_MIN) / CLIMATE_T_STEP;
+  if (t < 0) t = 0;
+  if (t > CLIMATE_T_POINTS - 1) t = CLIMATE_T_POINTS - 1;
+  int i = (int)t;
+  if (i > CLIMATE_T_POINTS - 2) i = CLIMATE_T_POINTS - 2;
+  float ft = t - i;
+
+  float h = (humidity - CLIMATE_H_LOW) / (CLIMATE_H_HIGH - CLIMATE_H_LOW);
+  if (h < 0) h = 0;
+  if (h > 1) h = 1;
+
+  float low = CLIMATE_LOG2.v[0][i] + (CLIMATE_LOG2.v[0][i + 1] - CLIMATE_LOG2.v[0][i]) * ft;
+  float high = CLIMATE_LOG2.v[1][i] + (CLIMATE_LOG2.v[1][i + 1] - CLIMATE_LOG2.v[1][i]) * ft;
+  _log2Climate = (int32_t)lroundf(low + (high - low) * h);
+}
+
+float GasPpmConverter::toPpm(float adc) const {
+  if (adc < 0) adc = 0;
+  if (adc > GAS_PPM_ADC_FULL_SCALE) adc = GAS_PPM_ADC_FULL_SCALE;
+  return convert((uint32_t)lroundf(adc * 16)) / 16.0f;
+}
+
+uint32_t GasPpmConverter::convert(uint32_t adcQ4) const {
+  uint32_t index = adcQ4 >> LOG_TABLE_SHIFT;
+  int32_t frac = adcQ4 & ((1 << LOG_TABLE_SHIFT) - 1);
+  if (index >= LOG_TABLE_SIZE - 1) {
+    index = LOG_TABLE_SIZE - 2;
+    frac = (1 << LOG_TABLE_SHIFT) - 1;
+  }
+  int32_t a = RATIO_LOG2.v[index];
+  int32_t ratio = a + (((RATIO_LOG2.v[index + 1] - a) * frac) >> LOG_TABLE_SHIFT);
+
+  // log2(ppm * 16) = log2(A) + B * log2(Rs/R0), with Rs taken back to the reference climate
+  int32_t x = ratio - _log2R0 - _log2Climate;
+  int32_t e = CURVE_LOG2_A + (int32_t)(((int64_t)CURVE_B * x) >> 16) + (4 << 16);
+  if (e < 0) return 0;
+  int32_t whole = e >> 16;
+  if (whole >= 20) return PPM_MAX_Q4;
+
+  uint32_t fracBits = e & 0xFFFF;
+  uint32_t lo = EXP2.v[fracBits >> 8];
+  uint32_t mantissa = lo + (((EXP2.v[(fracBits >> 8) + 1] - lo) * (fracBits & 0xFF)) >> 8);
+  uint32_t value = whole >= 16 ? mantissa << (whole - 16) : mantissa >> (16 - whole);
+  return value > PPM_MAX_Q4 ? PPM_MAX_Q4 : value;
+}
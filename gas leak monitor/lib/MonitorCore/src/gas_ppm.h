@@ -0,0 +1,57 @@
+#ifndef GAS_PPM_H
+#define GAS_PPM_H
+
+#include <stdint.h>
+
+// MQ sensor ADC reading to ppm in fixed point. The load resistor divider
+// gives Rs/RL = (full scale - adc) / adc, and the datasheet sensitivity
+// curve is a straight line in log-log space, ppm = A * (Rs/R0)^B. So the
+// whole conversion runs on Q16 log2 values:
+//
+//   log2(Rs/RL)       table lookup by ADC count, linearly interpolated
+//   - log2(R0/RL)     clean-air calibration (calibrate)
+//   - log2(k(T, H))   temperature/humidity correction (setClimate)
+//   * B + log2(A)     one 32x32 multiply
+//   2^x               table lookup and a shift
+//
+// The tables are generated at compile time from the constants below
+// (gas_ppm.cpp); change them for another sensor or target gas.
+
+#define GAS_PPM_CURVE_A 574.25        // MQ-2, LPG: ppm at Rs/R0 = 1
+#define GAS_PPM_CURVE_B -2.222        // d log(ppm) / d log(Rs/R0)
+#define GAS_PPM_CLEAN_AIR_RATIO 9.83  // Rs/R0 in clean air
+#define GAS_PPM_DEFAULT_R0 1.3f       // R0/RL until calibrated (clean air around ADC 300)
+#define GAS_PPM_ADC_FULL_SCALE 4095
+#define GAS_PPM_MAX 65535
+
+class GasPpmConverter {
+public:
+  GasPpmConverter() { setR0(0); }
+
+  // R0 as a multiple of the load resistor; 0 or less goes back to the uncalibrated default
+  void setR0(float r0);
+  float r0() const;
+  bool calibrated() const { return _calibrated; }
+
+  // Sets R0 from a steady clean-air reading taken at the current climate
+  void calibrate(float cleanAirAdc);
+
+  // Latest DHT reading; interpolates the correction over the datasheet grid
+  void setClimate(float temperature, float humidity);
+
+  // ppm in 1/16 units from an ADC count; integer only, cheap enough for every sampler output
+  uint32_t toPpmQ4(uint16_t adc) const { return convert((uint32_t)adc << 4); }
+
+  // ppm from a filtered (fractional) ADC level
+  float toPpm(float adc) const;
+
+private:
+  uint32_t convert(uint32_t adcQ4) const;
+
+  // Written by the sensing task, read per sample by the sampler; 32-bit stores are atomic
+  volatile int32_t _log2R0 = 0;
+  volatile int32_t _log2Climate = 0;
+  bool _calibrated = false;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#include "gas_trend.h"
+
+#include <math.h>
+
+void GasTrend::add(float value, uint32_t nowMs) {
+  if (!_primed) {
+    _primed = true;
+    _level = value;
+    _slope = 0;
+    _lastMs = nowMs;
+    return;
+  }
+
+  float dt = (nowMs - _lastMs) / 1000.0f;
+  if (dt <= 0) return;
+  _lastMs = nowMs;
+
+  // Weights from the elapsed time: the same decay whatever the feed rate
+  float alpha = 1.0f - expf(-dt / GAS_TREND_LEVEL_TAU_S);
+  float beta = 1.0f - expf(-dt / GAS_TREND_SLOPE_TAU_S);
+
+  float predicted = _level + _slope * dt;
+  float level = predicted + alpha * (value - predicted);
+  _slope += beta * ((level - _level) / dt - _slope);
+  _level = level;
+}
+
+float GasTrend::secondsTo(float threshold) const {
+  if (_level >= threshold) return 0;
+  if (_slope < GAS_TREND_MIN_SLOPE) return -1;
+  return (threshold - _level) / _slope;
+}
+
+bool preAlarmUpdate(bool active, float secondsToThreshold, float leadS, bool alarmActive) {
+  if (alarmActive || leadS <= 0 || secondsToThreshold < 0) {
+    return false;
+  }
+  if (active) {
+    return secondsToThreshold <= leadS * PREALARM_CLEAR_FACTOR;
+  }
+  return secondsToThreshold < leadS;
+}
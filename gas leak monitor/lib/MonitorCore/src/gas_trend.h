@@ -0,0 +1,45 @@
+#ifndef GAS_TREND_H
+#define GAS_TREND_H
+
+#include <stdint.h>
+
+// Incremental level and trend of the filtered gas signal (Holt's double
+// exponential smoothing, weighted by the time between samples so the
+// estimate does not depend on how often it is fed). O(1) per sample; the
+// sensing task feeds it on every gas check and both the adaptive sampling
+// rate and the rate-of-rise pre-alarm read from it.
+
+#define GAS_TREND_LEVEL_TAU_S 1.0f  // Smoothing of the level
+#define GAS_TREND_SLOPE_TAU_S 3.0f  // Smoothing of the slope
+#define GAS_TREND_MIN_SLOPE 1.0f    // ppm per second; flatter trends never reach a threshold
+
+class GasTrend {
+public:
+  void add(float value, uint32_t nowMs);
+
+  float level() const { return _level; }
+  float slope() const { return _slope; }  // ppm per second
+
+  // Projected seconds until the level reaches threshold: 0 once there,
+  // negative when the trend is flat or falling
+  float secondsTo(float threshold) const;
+
+private:
+  bool _primed = false;
+  float _level = 0;
+  float _slope = 0;
+  uint32_t _lastMs = 0;
+};
+
+// Rate-of-rise pre-alarm. Raised when the projected time to the gas
+// threshold drops below leadS while the alarm itself is not latched;
+// cleared once the projection moves past PREALARM_CLEAR_FACTOR * leadS,
+// the trend flattens, or the real alarm takes over.
+
+#define PREALARM_LEAD_S 30.0f
+#define PREALARM_CLEAR_FACTOR 2.0f
+
+// New pre-alarm state given the current one; leadS <= 0 disables it
+bool preAlarmUpdate(bool active, float secondsToThreshold, float leadS, bool alarmActive);
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef JSON_POOL_H
+#define JSON_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <ArduinoJson.h>
+
+// One ArduinoJson variant page: ARDUINOJSON_POOL_CAPACITY slots of two words,
+// 1 KB on the ESP32 and 4 KB on a 64-bit host. A document's first allocation
+// is a whole page, so an arena must hold more than that plus its strings.
+#define JSON_POOL_PAGE_SIZE (ARDUINOJSON_POOL_CAPACITY * 2 * sizeof(void *))
+
+// Fixed arena for ArduinoJson documents. Blocks are bump-allocated from a
+// static buffer and the arena rewinds as soon as every block is released, so
+// a document that is built (or parsed) and dropped per message never touches
+// the heap. Allocation fails cleanly when the arena is exhausted, which shows
+// up as doc.overflowed(). One pool per task: it is not thread safe.
+template <size_t Capacity>
+class JsonPool : public ArduinoJson::Allocator {
+public:
+  void *allocate(size_t size) override {
+    size_t total = align(sizeof(Header) + size);
+    if (_used + total > Capacity) {
+      _failures++;
+      return nullptr;
+    }
+
+    Header *header = reinterpret_cast<Header *>(_arena + _used);
+    header->size = total;
+    _last = _used;
+    _used += total;
+    _live++;
+    if (_used > _peak) _peak = _used;
+    return header + 1;
+  }
+
+  void deallocate(void *ptr) override {
+    if (ptr == nullptr) return;
+
+    // Give back the tail block straight away; everything else when the arena empties
+    Header *header = static_cast<Header *>(ptr) - 1;
+    if ((size_t)((uint8_t *)header - _arena) == _last) {
+      _used = _last;
+      _last = NO_BLOCK;
+    }
+    if (--_live == 0) {
+      _used = 0;
+      _last = NO_BLOCK;
+    }
+  }
+
+  void *reallocate(void *ptr, size_t newSize) override {
+    if (ptr == nullptr) return allocate(newSize);
+
+    Header *header = static_cast<Header *>(ptr) - 1;
+    size_t offset = (uint8_t *)header - _arena;
+    size_t total = align(sizeof(Header) + newSize);
+
+    // The tail block (usually a pool being shrunk to fit) resizes in place
+    if (offset == _last && offset + total <= Capacity) {
+      header->size = total;
+      _used = offset + total;
+      if (_used > _peak) _peak = _used;
+      return ptr;
+    }
+
+    if (total <= header->size) {
+      return ptr;
+    }
+
+    void *moved = allocate(newSize);
+    if (moved == nullptr) return nullptr;
+    memcpy(moved, ptr, header->size - sizeof(Header));
+    deallocate(ptr);
+    return moved;
+  }
+
+  size_t peak() const { return _peak; }
+  uint32_t failures() const { return _failures; }
+
+private:
+  struct Header {
+    size_t size;
+    size_t reserved;  // Keeps the payload 8-byte aligned
+  };
+
+  static_assert(Capacity > JSON_POOL_PAGE_SIZE + sizeof(Header),
+                "JsonPool cannot hold a single ArduinoJson variant page");
+
+  static const size_t NO_BLOCK = (size_t)-1;
+
+  static size_t align(size_t size) { return (size + 7) & ~(size_t)7; }
+
+  alignas(8) uint8_t _arena[Capacity];
+  size_t _used = 0;
+  size_t _last = NO_BLOCK;
+  size_t _live = 0;
+  size_t _peak = 0;
+  uint32_t _failures = 0;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "menu_logic.h"
+
+uint8_t menuHandleKey(MenuModel &menu, MenuKey key) {
+  switch (key) {
+    case MENU_KEY_MODE:
+      if (menu.screen == MAIN_SCREEN) {
+        menu.screen = MENU_MAIN;
+        menu.position = 0;
+        return MENU_EFFECT_REDRAW;
+      }
+      menu.screen = MAIN_SCREEN;
+      return MENU_EFFECT_SHOW_MAIN;
+
+    case MENU_KEY_UP:
+      switch (menu.screen) {
+        case SET_TEMP_THRESHOLD:
+          return MENU_EFFECT_TEMP_UP | MENU_EFFECT_REDRAW;
+        case SET_GAS_THRESHOLD:
+          return MENU_EFFECT_GAS_UP | MENU_EFFECT_REDRAW;
+        case WIFI_SETTINGS:
+          return MENU_EFFECT_TOGGLE_WIFI | MENU_EFFECT_REDRAW;
+        case MENU_MAIN:
+          menu.position = (menu.position - 1 + MENU_ITEMS) % MENU_ITEMS;
+          return MENU_EFFECT_REDRAW;
+        default:
+          return 0;
+      }
+
+    case MENU_KEY_DOWN:
+      switch (menu.screen) {
+        case MAIN_SCREEN:
+          return 0;
+        case MENU_MAIN:
+          {
+            // Enter the selected submenu
+            static const MenuState submenus[MENU_ITEMS] = {
+              SET_TEMP_THRESHOLD, SET_GAS_THRESHOLD, WIFI_SETTINGS, DEVICE_INFO
+            };
+            menu.screen = submenus[menu.position];
+          }
+          return MENU_EFFECT_REDRAW;
+        case SET_TEMP_THRESHOLD:
+          return MENU_EFFECT_TEMP_DOWN | MENU_EFFECT_REDRAW;
+        case SET_GAS_THRESHOLD:
+          return MENU_EFFECT_GAS_DOWN | MENU_EFFECT_REDRAW;
+        case WIFI_SETTINGS:
+          return MENU_EFFECT_TOGGLE_WIFI | MENU_EFFECT_REDRAW;
+        default:
+          // Navigate within the submenu
+          menu.position = (menu.position + 1) % MENU_ITEMS;
+          return MENU_EFFECT_REDRAW;
+      }
+  }
+  return 0;
+}
+
+bool menuKeyRepeats(const MenuModel &menu, MenuKey key) {
+  return key != MENU_KEY_MODE &&
+         (menu.screen == SET_TEMP_THRESHOLD || menu.screen == SET_GAS_THRESHOLD);
+}
@@ -0,0 +1,46 @@
+#ifndef MENU_LOGIC_H
+#define MENU_LOGIC_H
+
+#include <stdint.h>
+
+// LCD menu state machine, without the LCD: keys go in, the new screen and
+// the side effects the firmware has to carry out come out.
+
+enum MenuState {
+  MAIN_SCREEN,
+  MENU_MAIN,
+  SET_TEMP_THRESHOLD,
+  SET_GAS_THRESHOLD,
+  WIFI_SETTINGS,
+  DEVICE_INFO
+};
+
+enum MenuKey {
+  MENU_KEY_MODE,  // Button 1
+  MENU_KEY_UP,    // Button 2
+  MENU_KEY_DOWN   // Button 3 (also selects)
+};
+
+#define MENU_ITEMS 4
+
+// Effects returned by menuHandleKey, OR-ed together
+#define MENU_EFFECT_REDRAW 0x01       // Draw the current menu screen
+#define MENU_EFFECT_SHOW_MAIN 0x02    // Back on the live readings screen
+#define MENU_EFFECT_TEMP_UP 0x04      // tempThreshold += 1
+#define MENU_EFFECT_TEMP_DOWN 0x08    // tempThreshold -= 1
+#define MENU_EFFECT_GAS_UP 0x10       // gasThreshold += 10
+#define MENU_EFFECT_GAS_DOWN 0x20     // gasThreshold -= 10
+#define MENU_EFFECT_TOGGLE_WIFI 0x40  // Switch between AP and station
+
+struct MenuModel {
+  MenuState screen = MAIN_SCREEN;
+  int position = 0;
+};
+
+uint8_t menuHandleKey(MenuModel &menu, MenuKey key);
+
+// Whether a held key should auto-repeat on the current screen: only the
+// threshold steps do, never navigation or the WiFi toggle
+bool menuKeyRepeats(const MenuModel &menu, MenuKey key);
+
+#endif
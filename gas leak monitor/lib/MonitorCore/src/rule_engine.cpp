@@ -0,0 +1,269 @@
+#include "rule_engine.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RULE_DEFAULT_GAS_HYSTERESIS 50.0f  // ppm
+#define RULE_DEFAULT_TEMP_HYSTERESIS 1.0f  // °C
+#define RULE_MAX_VALUE 1000000.0f          // Keeps bounds well inside int32 at 1/16 units
+
+static const char *const sensorNames[RULE_SENSORS] = {"gas", "temp", "humidity"};
+static const char *const actionNames[] = {"alarm", "exhaust", "sprinkler", "notify"};  // Bit order
+static const int actionCount = sizeof(actionNames) / sizeof(actionNames[0]);
+
+static int nameIndex(const char *name, const char *const *names, int count) {
+  if (name == NULL) return -1;
+  for (int i = 0; i < count; i++) {
+    if (strcmp(name, names[i]) == 0) return i;
+  }
+  return -1;
+}
+
+static const char *parseCondition(JsonObjectConst json, RuleConditionSpec &condition) {
+  int sensor = nameIndex(json["sensor"], sensorNames, RULE_SENSORS);
+  if (sensor < 0) return "unknown sensor";
+  condition.sensor = sensor;
+
+  JsonVariantConst bound = json["above"];
+  condition.above = 1;
+  if (bound.isNull()) {
+    bound = json["below"];
+    condition.above = 0;
+  }
+
+  if (bound.is<const char *>() && strcmp(bound.as<const char *>(), "threshold") == 0) {
+    if (sensor == RULE_SENSOR_HUMIDITY) return "humidity has no threshold";
+    condition.relative = 1;
+    condition.value = json["offset"] | 0.0f;
+  } else if (bound.is<float>()) {
+    condition.value = bound.as<float>();
+  } else {
+    return "condition needs above or below";
+  }
+  if (!(fabsf(condition.value) <= RULE_MAX_VALUE)) return "bound out of range";
+
+  condition.hysteresis = json["hysteresis"] | 0.0f;
+  if (!(condition.hysteresis >= 0 && condition.hysteresis <= RULE_MAX_VALUE)) return "bad hysteresis";
+
+  float forMs = json["for"] | 0.0f;
+  if (!(forMs >= 0 && forMs <= RULE_MAX_FOR_MS)) return "bad duration";
+  condition.forMs = (uint32_t)forMs;
+  return NULL;
+}
+
+const char *parseRules(JsonArrayConst json, RuleSet &set) {
+  if (json.isNull()) return "rules must be an array";
+
+  RuleSet parsed = {};
+  for (JsonObjectConst rule : json) {
+    if (parsed.ruleCount == RULE_MAX_RULES) return "too many rules";
+    RuleSpec &spec = parsed.rules[parsed.ruleCount];
+
+    snprintf(spec.name, sizeof(spec.name), "%s", rule["name"] | "");
+    const char *when = rule["when"] | "any";
+    if (strcmp(when, "any") == 0) {
+      spec.any = 1;
+    } else if (strcmp(when, "all") != 0) {
+      return "when must be all or any";
+    }
+    spec.latch = rule["latch"] | false;
+
+    for (JsonVariantConst action : rule["actions"].as<JsonArrayConst>()) {
+      int bit = nameIndex(action.as<const char *>(), actionNames, actionCount);
+      if (bit < 0) return "unknown action";
+      spec.actions |= 1 << bit;
+    }
+    if (spec.actions == 0) return "rule without actions";
+
+    for (JsonObjectConst condition : rule["conditions"].as<JsonArrayConst>()) {
+      if (parsed.conditionCount == RULE_MAX_CONDITIONS) return "too many conditions";
+      const char *error = parseCondition(condition, parsed.conditions[parsed.conditionCount]);
+      if (error) return error;
+      parsed.conditionCount++;
+      spec.conditionCount++;
+    }
+    if (spec.conditionCount == 0) return "rule without conditions";
+    parsed.ruleCount++;
+  }
+
+  set = parsed;
+  return NULL;
+}
+
+void writeRules(JsonArray json, const RuleSet &set) {
+  uint8_t next = 0;
+  for (uint8_t r = 0; r < set.ruleCount; r++) {
+    const RuleSpec &spec = set.rules[r];
+    JsonObject rule = json.add<JsonObject>();
+    rule["name"] = spec.name;
+    rule["when"] = spec.any ? "any" : "all";
+    rule["latch"] = spec.latch != 0;
+
+    JsonArray conditions = rule["conditions"].to<JsonArray>();
+    for (uint8_t i = next; i < next + spec.conditionCount && i < set.conditionCount; i++) {
+      const RuleConditionSpec &c = set.conditions[i];
+      JsonObject condition = conditions.add<JsonObject>();
+      const char *bound = c.above ? "above" : "below";
+      condition["sensor"] = sensorNames[c.sensor % RULE_SENSORS];
+      if (c.relative) {
+        condition[bound] = "threshold";
+        if (c.value != 0) condition["offset"] = c.value;
+      } else {
+        condition[bound] = c.value;
+      }
+      if (c.hysteresis != 0) condition["hysteresis"] = c.hysteresis;
+      if (c.forMs != 0) condition["for"] = c.forMs;
+    }
+    next += spec.conditionCount;
+
+    JsonArray actions = rule["actions"].to<JsonArray>();
+    for (int bit = 0; bit < actionCount; bit++) {
+      if (spec.actions & (1 << bit)) actions.add(actionNames[bit]);
+    }
+  }
+}
+
+void defaultRules(RuleSet &set) {
+  set = {};
+  static const RuleSensor sensors[] = {RULE_SENSOR_GAS, RULE_SENSOR_TEMPERATURE};
+  static const char *const names[] = {"gas", "temperature"};
+  static const float hysteresis[] = {RULE_DEFAULT_GAS_HYSTERESIS, RULE_DEFAULT_TEMP_HYSTERESIS};
+
+  for (uint8_t r = 0; r < 2; r++) {
+    RuleSpec &rule = set.rules[r];
+    snprintf(rule.name, sizeof(rule.name), "%s", names[r]);
+    rule.any = 1;
+    rule.actions = RULE_ACTION_ALARM | RULE_ACTION_EXHAUST;
+    rule.conditionCount = 1;
+
+    RuleConditionSpec &condition = set.conditions[r];
+    condition.sensor = sensors[r];
+    condition.above = 1;
+    condition.relative = 1;
+    condition.hysteresis = hysteresis[r];
+  }
+  set.ruleCount = 2;
+  set.conditionCount = 2;
+}
+
+bool compileRules(const RuleSet &set, AlarmProgram &program) {
+  if (set.ruleCount > RULE_MAX_RULES || set.conditionCount > RULE_MAX_CONDITIONS) return false;
+
+  AlarmProgram compiled = {};
+  uint8_t next = 0;
+  for (uint8_t r = 0; r < set.ruleCount; r++) {
+    const RuleSpec &spec = set.rules[r];
+    if (spec.conditionCount == 0 || next + spec.conditionCount > set.conditionCount) return false;
+
+    for (uint8_t i = next; i < next + spec.conditionCount; i++) {
+      const RuleConditionSpec &c = set.conditions[i];
+      if (c.sensor >= RULE_SENSORS) return false;
+
+      AlarmCondition &out = compiled.conditions[i];
+      int32_t bound = (int32_t)lroundf(c.value * 16);
+      int32_t band = (int32_t)lroundf(c.hysteresis * 16);
+      out.enterQ4 = bound;
+      out.exitQ4 = c.above ? bound - band : bound + band;
+      out.forMs = c.forMs;
+      out.above = c.above;
+      out.relative = c.relative;
+      compiled.sensorConditions[c.sensor] |= 1u << i;
+      compiled.ruleConditions[r] |= 1u << i;
+    }
+    next += spec.conditionCount;
+
+    compiled.actions[r] = spec.actions;
+    if (spec.any) compiled.anyRules |= 1 << r;
+    if (spec.latch) compiled.latchRules |= 1 << r;
+  }
+  if (next != set.conditionCount) return false;
+
+  compiled.ruleCount = set.ruleCount;
+  program = compiled;
+  return true;
+}
+
+void RuleEngine::load(const AlarmProgram &program) {
+  _program = program;
+  _past = 0;
+  _met = 0;
+  _active = 0;
+  _latched = 0;
+  _actions = 0;
+}
+
+bool RuleEngine::update(RuleSensor sensor, int32_t valueQ4, int32_t thresholdQ4, uint32_t nowMs) {
+  if (sensor >= RULE_SENSORS) return false;
+
+  uint16_t pending = _program.sensorConditions[sensor];
+  uint16_t met = _met;
+  while (pending) {
+    uint8_t i = __builtin_ctz(pending);
+    uint16_t bit = 1u << i;
+    pending &= pending - 1;
+
+    // Entering takes the bound itself, staying only the hysteresis edge
+    const AlarmCondition &c = _program.conditions[i];
+    int32_t edge = (c.relative ? thresholdQ4 : 0) + ((_past & bit) ? c.exitQ4 : c.enterQ4);
+    bool past = c.above ? valueQ4 > edge : valueQ4 < edge;
+    if (!past) {
+      _past &= ~bit;
+      met &= ~bit;
+      continue;
+    }
+    if (!(_past & bit)) {
+      _past |= bit;
+      _sinceMs[i] = nowMs;
+    }
+    if (nowMs - _sinceMs[i] >= c.forMs) {
+      met |= bit;
+    }
+  }
+
+  // Most samples end here: no condition on this sensor changed
+  if (met == _met) return false;
+
+  uint8_t before = activeRules();
+  _met = met;
+  recombine();
+  return activeRules() != before;
+}
+
+bool RuleEngine::reset() {
+  uint8_t before = activeRules();
+  _latched = 0;
+  recombine();
+  return activeRules() != before;
+}
+
+uint8_t RuleEngine::rulesWith(uint8_t actions) const {
+  uint8_t rules = 0;
+  uint8_t active = activeRules();
+  while (active) {
+    uint8_t r = __builtin_ctz(active);
+    active &= active - 1;
+    if (_program.actions[r] & actions) rules |= 1 << r;
+  }
+  return rules;
+}
+
+void RuleEngine::recombine() {
+  uint8_t active = 0;
+  for (uint8_t r = 0; r < _program.ruleCount; r++) {
+    uint16_t conditions = _program.ruleConditions[r];
+    uint16_t met = _met & conditions;
+    bool on = (_program.anyRules & (1 << r)) ? met != 0 : met == conditions;
+    if (on) active |= 1 << r;
+  }
+  _active = active;
+  _latched |= active & _program.latchRules;
+
+  uint8_t actions = 0;
+  uint8_t rules = activeRules();
+  while (rules) {
+    actions |= _program.actions[__builtin_ctz(rules)];
+    rules &= rules - 1;
+  }
+  _actions = actions;
+}
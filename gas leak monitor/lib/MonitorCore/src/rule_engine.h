@@ -0,0 +1,134 @@
+#ifndef RULE_ENGINE_H
+#define RULE_ENGINE_H
+
+#include <stdint.h>
+#include <ArduinoJson.h>
+
+// Alarm rules, configurable at run time. A rule combines sensor conditions
+// with AND ("all") or OR ("any") and maps to actions. Rules arrive as JSON
+// and are checked into a RuleSet, the form that is stored and served back,
+// then compiled into an AlarmProgram of integer bounds and bitmasks.
+// RuleEngine::update() takes one reading of one sensor and only looks at
+// the conditions on that sensor; the rules are only recombined when one of
+// those conditions changed, with a mask compare per rule. A gas sample thus
+// costs a few integer compares however the rules are written, bounded by
+// the fixed table sizes, and needs no allocation.
+//
+// JSON, an array with one object per rule:
+//   {"name": "fire", "when": "all", "latch": false,
+//    "conditions": [{"sensor": "temp", "above": 55, "hysteresis": 2, "for": 5000},
+//                   {"sensor": "gas", "above": "threshold", "offset": -200}],
+//    "actions": ["alarm", "sprinkler", "notify"]}
+//
+// A condition is met once its sensor has stayed past the bound ("above" or
+// "below") for "for" ms, and clears once it is back past the bound by
+// "hysteresis". The bound "threshold" (plus an optional "offset") follows
+// the device's gas or temperature threshold as it is changed. A latched
+// rule keeps its actions after it clears, until reset(). Values are in ppm,
+// °C and %RH; the engine works in 1/16 of those units.
+
+#define RULE_MAX_RULES 8        // One bit each in the rule masks
+#define RULE_MAX_CONDITIONS 16  // Across all rules; one bit each in the condition masks
+#define RULE_NAME_SIZE 16
+#define RULE_MAX_FOR_MS 3600000
+
+enum RuleSensor : uint8_t {
+  RULE_SENSOR_GAS = 0,          // Same order as EventCause
+  RULE_SENSOR_TEMPERATURE = 1,
+  RULE_SENSOR_HUMIDITY = 2,
+  RULE_SENSORS = 3
+};
+
+#define RULE_ACTION_ALARM 0x01      // Buzzer and beacon, alarmActive
+#define RULE_ACTION_EXHAUST 0x02    // Exhaust relay, in auto mode
+#define RULE_ACTION_SPRINKLER 0x04
+#define RULE_ACTION_NOTIFY 0x08     // Pushed to the WebSocket clients
+
+struct RuleConditionSpec {
+  uint8_t sensor;    // RuleSensor
+  uint8_t above;     // 1 above the bound, 0 below it
+  uint8_t relative;  // value is an offset from the sensor's device threshold
+  uint8_t reserved;
+  float value;
+  float hysteresis;
+  uint32_t forMs;
+};
+
+struct RuleSpec {
+  char name[RULE_NAME_SIZE];
+  uint8_t any;             // 1 any condition, 0 all of them
+  uint8_t actions;         // RULE_ACTION_*
+  uint8_t latch;
+  uint8_t conditionCount;  // Next in RuleSet::conditions after the previous rule's
+};
+
+struct RuleSet {
+  uint8_t ruleCount;
+  uint8_t conditionCount;
+  RuleSpec rules[RULE_MAX_RULES];
+  RuleConditionSpec conditions[RULE_MAX_CONDITIONS];
+};
+
+// Parses a JSON rule array; returns NULL, or what is wrong and set is untouched
+const char *parseRules(JsonArrayConst json, RuleSet &set);
+
+// The JSON form of a set, as parseRules() takes it
+void writeRules(JsonArray json, const RuleSet &set);
+
+// Gas and temperature above their thresholds raise the alarm and the exhaust relay
+void defaultRules(RuleSet &set);
+
+struct AlarmCondition {
+  int32_t enterQ4;  // Past this the hold timer starts; added to the threshold when relative
+  int32_t exitQ4;   // Back past this the condition clears
+  uint32_t forMs;
+  uint8_t above;
+  uint8_t relative;
+};
+
+struct AlarmProgram {
+  AlarmCondition conditions[RULE_MAX_CONDITIONS];
+  uint16_t sensorConditions[RULE_SENSORS];  // Conditions on each sensor
+  uint16_t ruleConditions[RULE_MAX_RULES];  // Conditions of each rule
+  uint8_t actions[RULE_MAX_RULES];
+  uint8_t anyRules;    // Rules met by any of their conditions
+  uint8_t latchRules;
+  uint8_t ruleCount;
+};
+
+// False when the set is inconsistent (e.g. a corrupt stored copy)
+bool compileRules(const RuleSet &set, AlarmProgram &program);
+
+class RuleEngine {
+public:
+  // Starts over with a new program; nothing is met until readings come in
+  void load(const AlarmProgram &program);
+
+  // Feeds one reading and the sensor's device threshold, both in 1/16 units;
+  // returns true when activeRules() changed
+  bool update(RuleSensor sensor, int32_t valueQ4, int32_t thresholdQ4, uint32_t nowMs);
+
+  // Drops the latches; returns true when activeRules() changed
+  bool reset();
+
+  // Rules met now or latched
+  uint8_t activeRules() const { return _active | _latched; }
+
+  // Of those, the ones with any of the given actions
+  uint8_t rulesWith(uint8_t actions) const;
+
+  uint8_t actions() const { return _actions; }
+
+private:
+  void recombine();
+
+  AlarmProgram _program = {};
+  uint16_t _past = 0;  // Conditions past their bound; met once held for forMs
+  uint16_t _met = 0;
+  uint8_t _active = 0;
+  uint8_t _latched = 0;
+  uint8_t _actions = 0;
+  uint32_t _sinceMs[RULE_MAX_CONDITIONS] = {};
+};
+
+#endif
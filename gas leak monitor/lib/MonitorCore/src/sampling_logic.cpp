@@ -0,0 +1,20 @@
+#include "sampling_logic.h"
+
+bool SamplingScheduler::update(float gasLevel, float slope, float threshold, uint32_t nowMs) {
+  bool rising = slope > config.slopeBound;
+  bool near = threshold - gasLevel < config.marginBound;
+
+  if (rising || near) {
+    _calmSinceMs = nowMs;
+    if (!_fast) {
+      _fast = true;
+      _switches++;
+      return true;
+    }
+  } else if (_fast && nowMs - _calmSinceMs >= config.holdMs) {
+    _fast = false;
+    _switches++;
+    return true;
+  }
+  return false;
+}
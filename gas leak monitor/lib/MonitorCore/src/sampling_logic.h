@@ -0,0 +1,48 @@
+#ifndef SAMPLING_LOGIC_H
+#define SAMPLING_LOGIC_H
+
+#include <stdint.h>
+
+// Adaptive sensor cycle cadence. The gas level is checked every fast
+// interval, but a full cycle (alarm check, publish, LCD) only runs at the
+// slow interval while the air is steady. As soon as the level climbs faster
+// than slopeBound, or comes within marginBound of the threshold, every
+// check becomes a full cycle; the cadence drops back once neither has held
+// for holdMs.
+
+#define SAMPLING_SLOW_MS 5000
+#define SAMPLING_FAST_MS 250
+#define SAMPLING_SLOPE_BOUND 20.0f    // ppm per second
+#define SAMPLING_MARGIN_BOUND 100.0f  // ppm below gasThreshold
+#define SAMPLING_HOLD_MS 30000
+#define SAMPLING_MIN_INTERVAL_MS 100
+#define SAMPLING_MAX_INTERVAL_MS 60000
+
+struct SamplingConfig {
+  uint32_t slowMs;
+  uint32_t fastMs;
+  float slopeBound;
+  float marginBound;
+  uint32_t holdMs;
+};
+
+class SamplingScheduler {
+public:
+  SamplingConfig config = {
+    SAMPLING_SLOW_MS, SAMPLING_FAST_MS, SAMPLING_SLOPE_BOUND, SAMPLING_MARGIN_BOUND, SAMPLING_HOLD_MS
+  };
+
+  // Feeds one check; returns true when the rate changed
+  bool update(float gasLevel, float slope, float threshold, uint32_t nowMs);
+
+  bool fast() const { return _fast; }
+  uint32_t intervalMs() const { return _fast ? config.fastMs : config.slowMs; }
+  uint32_t switches() const { return _switches; }
+
+private:
+  bool _fast = false;
+  uint32_t _calmSinceMs = 0;
+  uint32_t _switches = 0;
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef SENSOR_SNAPSHOT_H
+#define SENSOR_SNAPSHOT_H
+
+// Consistent copy of the sensing state handed from the sensing task to networking and UI
+struct SensorSnapshot {
+  float temperature;
+  float humidity;
+  float gasLevel;
+  bool alarmActive;
+  bool relayState;
+  bool autoMode;
+  float gasThreshold;
+  float tempThreshold;
+  bool preAlarm;  // Gas rising toward the threshold (gas_trend.h)
+};
+
+#endif
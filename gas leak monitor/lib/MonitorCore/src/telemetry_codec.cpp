@@ -0,0 +1,80 @@
+#include "telemetry_codec.h"
+
+#include <math.h>
+
+static long clampRound(float value, long low, long high) {
+  long rounded = lroundf(value);
+  return rounded < low ? low : (rounded > high ? high : rounded);
+}
+
+uint8_t telemetryChanges(const SensorSnapshot &sent, const SensorSnapshot &latest,
+                         const TelemetryDeadband &deadband) {
+  uint8_t changes = 0;
+  if (latest.alarmActive != sent.alarmActive ||
+      latest.preAlarm != sent.preAlarm ||
+      latest.relayState != sent.relayState ||
+      latest.autoMode != sent.autoMode ||
+      latest.gasThreshold != sent.gasThreshold ||
+      latest.tempThreshold != sent.tempThreshold) {
+    changes |= TELEMETRY_CHANGED_STATE;
+  }
+  if (fabsf(latest.temperature - sent.temperature) > deadband.temperature) changes |= TELEMETRY_CHANGED_TEMPERATURE;
+  if (fabsf(latest.humidity - sent.humidity) > deadband.humidity) changes |= TELEMETRY_CHANGED_HUMIDITY;
+  if (fabsf(latest.gasLevel - sent.gasLevel) > deadband.gasLevel) changes |= TELEMETRY_CHANGED_GAS;
+  return changes;
+}
+
+void encodeTelemetryFrame(const SensorSnapshot &snapshot, bool full, uint32_t uptimeMs,
+                          TelemetryFrame &frame) {
+  frame.magic = TELEMETRY_FRAME_MAGIC;
+  frame.version = TELEMETRY_FRAME_VERSION;
+  frame.flags = (snapshot.alarmActive ? TELEMETRY_FLAG_ALARM : 0) |
+                (snapshot.relayState ? TELEMETRY_FLAG_RELAY : 0) |
+                (snapshot.autoMode ? TELEMETRY_FLAG_AUTO : 0) |
+                (snapshot.preAlarm ? TELEMETRY_FLAG_PREALARM : 0) |
+                (full ? TELEMETRY_FLAG_SNAPSHOT : 0);
+  frame.reserved = 0;
+  frame.uptimeMs = uptimeMs;
+  frame.temperature = (int16_t)clampRound(snapshot.temperature * 100.0f, -32768L, 32767L);
+  frame.humidity = (uint16_t)clampRound(snapshot.humidity * 100.0f, 0L, 65535L);
+  frame.gasLevel = (uint16_t)clampRound(snapshot.gasLevel, 0L, 65535L);
+  frame.gasThreshold = snapshot.gasThreshold;
+  frame.tempThreshold = snapshot.tempThreshold;
+}
+
+void writeTelemetrySnapshot(JsonVariant out, const SensorSnapshot &snapshot) {
+  out["temperature"] = snapshot.temperature;
+  out["humidity"] = snapshot.humidity;
+  out["gasLevel"] = snapshot.gasLevel;
+  out["alarmActive"] = snapshot.alarmActive;
+  out["preAlarm"] = snapshot.preAlarm;
+  out["relayState"] = snapshot.relayState;
+  out["autoMode"] = snapshot.autoMode;
+  out["gasThreshold"] = snapshot.gasThreshold;
+  out["tempThreshold"] = snapshot.tempThreshold;
+}
+
+void writeTelemetryDelta(JsonVariant out, const SensorSnapshot &sent, const SensorSnapshot &latest,
+                         uint8_t changes) {
+  if (changes & TELEMETRY_CHANGED_TEMPERATURE) out["temperature"] = latest.temperature;
+  if (changes & TELEMETRY_CHANGED_HUMIDITY) out["humidity"] = latest.humidity;
+  if (changes & TELEMETRY_CHANGED_GAS) out["gasLevel"] = latest.gasLevel;
+  if (latest.alarmActive != sent.alarmActive) out["alarmActive"] = latest.alarmActive;
+  if (latest.preAlarm != sent.preAlarm) out["preAlarm"] = latest.preAlarm;
+  if (latest.relayState != sent.relayState) out["relayState"] = latest.relayState;
+  if (latest.autoMode != sent.autoMode) out["autoMode"] = latest.autoMode;
+  if (latest.gasThreshold != sent.gasThreshold) out["gasThreshold"] = latest.gasThreshold;
+  if (latest.tempThreshold != sent.tempThreshold) out["tempThreshold"] = latest.tempThreshold;
+}
+
+void markTelemetryDelta(SensorSnapshot &sent, const SensorSnapshot &latest, uint8_t changes) {
+  if (changes & TELEMETRY_CHANGED_TEMPERATURE) sent.temperature = latest.temperature;
+  if (changes & TELEMETRY_CHANGED_HUMIDITY) sent.humidity = latest.humidity;
+  if (changes & TELEMETRY_CHANGED_GAS) sent.gasLevel = latest.gasLevel;
+  sent.alarmActive = latest.alarmActive;
+  sent.preAlarm = latest.preAlarm;
+  sent.relayState = latest.relayState;
+  sent.autoMode = latest.autoMode;
+  sent.gasThreshold = latest.gasThreshold;
+  sent.tempThreshold = latest.tempThreshold;
+}
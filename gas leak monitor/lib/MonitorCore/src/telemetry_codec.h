@@ -0,0 +1,62 @@
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include <stdint.h>
+#include <ArduinoJson.h>
+#include "sensor_snapshot.h"
+
+// Binary telemetry frame, sent with sendBIN to clients that subscribe with
+// "format":"binary". Little-endian, fixed layout; bump the version on any change.
+#define TELEMETRY_FRAME_MAGIC 0x47  // 'G'
+#define TELEMETRY_FRAME_VERSION 2  // 2: gasLevel in ppm
+#define TELEMETRY_FLAG_ALARM 0x01
+#define TELEMETRY_FLAG_RELAY 0x02
+#define TELEMETRY_FLAG_AUTO 0x04
+#define TELEMETRY_FLAG_SNAPSHOT 0x08
+#define TELEMETRY_FLAG_PREALARM 0x10
+
+struct __attribute__((packed)) TelemetryFrame {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t flags;
+  uint8_t reserved;
+  uint32_t uptimeMs;
+  int16_t temperature;   // 0.01 °C
+  uint16_t humidity;     // 0.01 %
+  uint16_t gasLevel;     // ppm
+  float gasThreshold;
+  float tempThreshold;
+};
+
+struct TelemetryDeadband {
+  float temperature;
+  float humidity;
+  float gasLevel;
+};
+
+// What moved between two snapshots (telemetryChanges)
+#define TELEMETRY_CHANGED_TEMPERATURE 0x01
+#define TELEMETRY_CHANGED_HUMIDITY 0x02
+#define TELEMETRY_CHANGED_GAS 0x04
+#define TELEMETRY_CHANGED_STATE 0x08  // Alarm, pre-alarm, relay, mode or thresholds
+
+// Analog fields count as changed once they move past their deadband
+uint8_t telemetryChanges(const SensorSnapshot &sent, const SensorSnapshot &latest,
+                         const TelemetryDeadband &deadband);
+
+void encodeTelemetryFrame(const SensorSnapshot &snapshot, bool full, uint32_t uptimeMs,
+                          TelemetryFrame &frame);
+
+// Every field, for "type":"snapshot" messages
+void writeTelemetrySnapshot(JsonVariant out, const SensorSnapshot &snapshot);
+
+// Only the changed fields, for "type":"delta" messages; sent is what the client has
+void writeTelemetryDelta(JsonVariant out, const SensorSnapshot &sent, const SensorSnapshot &latest,
+                         uint8_t changes);
+
+// Once that delta went out, records in sent what it carried: the state fields
+// and the analog fields flagged in changes. The others keep their baseline,
+// so drift below the deadband adds up until it is reported.
+void markTelemetryDelta(SensorSnapshot &sent, const SensorSnapshot &latest, uint8_t changes);
+
+#endif
@@ -0,0 +1,194 @@
+// Host micro-benchmarks for the MonitorCore hot paths: pio run -e native -t exec
+//
+// Each case reports wall time per call and heap allocations per call. Heap
+// allocations are counted through the global operator new and, for the
+// ArduinoJson cases, through the document allocator, so a JsonPool-backed case
+// should report zero.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <new>
+
+#include <ArduinoJson.h>
+#include "command_table.h"
+#include "gas_ppm.h"
+#include "json_pool.h"
+#include "menu_logic.h"
+#include "rule_engine.h"
+#include "telemetry_codec.h"
+
+#define BENCH_MIN_ITERATIONS 1000
+#define BENCH_MIN_NS 200000000LL  // Run each case for at least 0.2 s
+
+static size_t heapAllocations = 0;
+
+void *operator new(size_t size) {
+  heapAllocations++;
+  void *ptr = malloc(size ? size : 1);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+// Plain heap allocator for comparison with JsonPool, counted like operator new
+class CountingAllocator : public ArduinoJson::Allocator {
+public:
+  void *allocate(size_t size) override {
+    heapAllocations++;
+    return malloc(size);
+  }
+  void deallocate(void *ptr) override { free(ptr); }
+  void *reallocate(void *ptr, size_t size) override {
+    heapAllocations++;
+    return realloc(ptr, size);
+  }
+};
+
+// Keeps the optimizer from dropping a result
+static volatile uint32_t sink;
+
+template <typename Fn>
+static void bench(const char *name, Fn fn) {
+  typedef std::chrono::steady_clock Clock;
+
+  for (int i = 0; i < 100; i++) fn();  // Warm up caches and pools
+
+  size_t allocationsBefore = heapAllocations;
+  long long iterations = 0;
+  Clock::time_point start = Clock::now();
+  long long elapsed = 0;
+  do {
+    for (int i = 0; i < BENCH_MIN_ITERATIONS; i++) fn();
+    iterations += BENCH_MIN_ITERATIONS;
+    elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+  } while (elapsed < BENCH_MIN_NS);
+
+  printf("%-28s %10.1f ns/call %8.2f allocs/call\n", name,
+         (double)elapsed / iterations, (double)(heapAllocations - allocationsBefore) / iterations);
+}
+
+static SensorSnapshot sampleSnapshot(int step) {
+  SensorSnapshot snapshot;
+  snapshot.temperature = 24.0f + (step % 50) * 0.05f;
+  snapshot.humidity = 55.0f + (step % 20) * 0.3f;
+  snapshot.gasLevel = 300.0f + (step % 100) * 2.0f;
+  snapshot.alarmActive = false;
+  snapshot.relayState = (step / 97) % 2;
+  snapshot.autoMode = true;
+  snapshot.gasThreshold = 500.0f;
+  snapshot.tempThreshold = 35.0f;
+  snapshot.preAlarm = false;
+  return snapshot;
+}
+
+int main() {
+  static const char command[] = "{\"command\":\"setThresholds\",\"id\":7,\"gas\":480,\"temp\":33.5}";
+  static const TelemetryDeadband deadband = {0.1f, 0.5f, 10.0f};
+  static JsonPool<8192> pool;  // A host variant page is 4 KB (json_pool.h)
+  static CountingAllocator heap;
+  static char out[384];
+  int step = 0;
+
+  printf("%-28s %18s %20s\n", "case", "time", "heap");
+
+  // One gas sample through the default rules, crossing the threshold now and then
+  AlarmProgram program;
+  RuleSet rules;
+  defaultRules(rules);
+  compileRules(rules, program);
+  RuleEngine engine;
+  engine.load(program);
+  bench("ruleEngineGas", [&] {
+    int32_t ppmQ4 = (900 + (step++ % 256)) * 16;
+    sink = engine.update(RULE_SENSOR_GAS, ppmQ4, 1000 * 16, step);
+  });
+
+  bench("menuHandleKey", [&] {
+    static MenuModel menu;
+    static const MenuKey keys[] = {MENU_KEY_MODE, MENU_KEY_DOWN, MENU_KEY_DOWN, MENU_KEY_UP, MENU_KEY_MODE};
+    sink = menuHandleKey(menu, keys[step++ % 5]);
+  });
+
+  bench("telemetryChanges", [&] {
+    SensorSnapshot sent = sampleSnapshot(step);
+    SensorSnapshot latest = sampleSnapshot(step + 3);
+    step++;
+    sink = telemetryChanges(sent, latest, deadband);
+  });
+
+  bench("encodeTelemetryFrame", [&] {
+    TelemetryFrame frame;
+    encodeTelemetryFrame(sampleSnapshot(step++), false, step * 2000u, frame);
+    sink = frame.gasLevel;
+  });
+
+  bench("delta JSON (JsonPool)", [&] {
+    SensorSnapshot sent = sampleSnapshot(step);
+    SensorSnapshot latest = sampleSnapshot(step + 7);
+    step++;
+    JsonDocument doc(&pool);
+    doc["type"] = "delta";
+    writeTelemetryDelta(doc, sent, latest, telemetryChanges(sent, latest, deadband) | TELEMETRY_CHANGED_STATE);
+    sink = serializeJson(doc, out, sizeof(out));
+  });
+
+  bench("snapshot JSON (JsonPool)", [&] {
+    JsonDocument doc(&pool);
+    doc["type"] = "snapshot";
+    writeTelemetrySnapshot(doc, sampleSnapshot(step++));
+    sink = serializeJson(doc, out, sizeof(out));
+  });
+
+  bench("snapshot JSON (heap)", [&] {
+    JsonDocument doc(&heap);
+    doc["type"] = "snapshot";
+    writeTelemetrySnapshot(doc, sampleSnapshot(step++));
+    sink = serializeJson(doc, out, sizeof(out));
+  });
+
+  bench("command parse (JsonPool)", [&] {
+    JsonDocument doc(&pool);
+    deserializeJson(doc, command, sizeof(command) - 1);
+    const char *name = doc["command"];
+    // The keys cmdSetThresholds() reads
+    sink = name && commandHash(name) == commandHash("setThresholds") ? doc["gas"].as<float>() + doc["temp"].as<float>() : 0;
+  });
+
+  bench("command parse (heap)", [&] {
+    JsonDocument doc(&heap);
+    deserializeJson(doc, command, sizeof(command) - 1);
+    const char *name = doc["command"];
+    // The keys cmdSetThresholds() reads
+    sink = name && commandHash(name) == commandHash("setThresholds") ? doc["gas"].as<float>() + doc["temp"].as<float>() : 0;
+  });
+
+  // Per-sample ppm conversion against the float curve it replaces
+  static GasPpmConverter gasPpm;
+  gasPpm.setClimate(24.0f, 55.0f);
+
+  bench("gas ppm (tables)", [&] {
+    sink = gasPpm.toPpmQ4((uint16_t)(200 + (step++ & 1023)));
+  });
+
+  bench("gas ppm (powf)", [&] {
+    float adc = 200 + (step++ & 1023);
+    float ratio = (GAS_PPM_ADC_FULL_SCALE - adc) / adc / GAS_PPM_DEFAULT_R0;
+    sink = (uint32_t)(GAS_PPM_CURVE_A * powf(ratio, GAS_PPM_CURVE_B) * 16);
+  });
+
+  bench("commandHash", [&] {
+    static const char *const names[] = {"getStatus", "subscribe", "setRelay", "setThresholds"};
+    sink = commandHash(names[step++ & 3]);
+  });
+
+  if (pool.failures() != 0) {
+    printf("JsonPool overflowed %u times; results are not representative\n", (unsigned)pool.failures());
+    return 1;
+  }
+  return 0;
+}
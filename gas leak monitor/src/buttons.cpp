@@ -0,0 +1,67 @@
+#include "buttons.h"
+
+#include <soc/gpio_struct.h>
+
+ButtonInput buttons;
+ButtonInput *ButtonInput::_instance = NULL;
+
+void ButtonInput::begin(const uint8_t *pins, uint8_t count) {
+  _instance = this;
+  _count = count > BUTTON_MAX ? BUTTON_MAX : count;
+
+  for (uint8_t i = 0; i < _count; i++) {
+    _pins[i] = pins[i];
+    pinMode(_pins[i], INPUT_PULLUP);
+    attachInterruptArg(_pins[i], onEdge, (void *)(uintptr_t)i, CHANGE);
+  }
+}
+
+void IRAM_ATTR ButtonInput::onEdge(void *arg) {
+  _instance->push((uint8_t)(uintptr_t)arg);
+}
+
+// Runs in the GPIO ISR: read the level straight from the input register and stamp it
+void IRAM_ATTR ButtonInput::push(uint8_t button) {
+  uint8_t pin = _pins[button];
+  uint32_t level = pin < 32 ? (GPIO.in >> pin) & 1 : (GPIO.in1.data >> (pin - 32)) & 1;
+
+  uint32_t head = _head;
+  if (head - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE) >= BUTTON_QUEUE_LENGTH) {
+    _overflows = _overflows + 1;
+    return;
+  }
+
+  Edge &edge = _queue[head % BUTTON_QUEUE_LENGTH];
+  edge.button = button;
+  edge.pressed = level == 0;
+  edge.timeMs = millis();
+  __atomic_store_n(&_head, head + 1, __ATOMIC_RELEASE);
+}
+
+bool ButtonInput::read(ButtonEvent &event) {
+  uint32_t head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+
+  for (;;) {
+    // Replay queued edges in order, letting each tracker report what fell due
+    // before the next edge; a tap made while the consumer was busy still
+    // comes out as a press and a release
+    uint32_t tail = _tail;
+    bool queued = tail != head;
+    uint32_t now = queued ? _queue[tail % BUTTON_QUEUE_LENGTH].timeMs : millis();
+
+    for (uint8_t i = 0; i < _count; i++) {
+      if (_trackers[i].update(now, event.type, event.timeMs)) {
+        event.button = i;
+        return true;
+      }
+    }
+
+    if (!queued) {
+      return false;
+    }
+
+    const Edge &edge = _queue[tail % BUTTON_QUEUE_LENGTH];
+    _trackers[edge.button].edge(edge.pressed, edge.timeMs);
+    __atomic_store_n(&_tail, tail + 1, __ATOMIC_RELEASE);
+  }
+}
@@ -0,0 +1,50 @@
+#include "commands.h"
+
+CommandAcks commandAcks;
+
+void CommandAcks::add(JsonVariantConst id, const char *error) {
+  if (id.isNull() || _count == COMMAND_MAX_BATCH) {
+    return;
+  }
+
+  Result &result = _results[_count++];
+  result.numeric = id.is<int32_t>();
+  result.number = result.numeric ? id.as<int32_t>() : 0;
+  result.text[0] = '\0';
+  if (!result.numeric) {
+    const char *text = id.as<const char *>();
+    strlcpy(result.text, text ? text : "", sizeof(result.text));
+  }
+  result.error = error;
+}
+
+void CommandAcks::send(uint8_t num) {
+  if (_sockets == NULL || _count == 0) {
+    return;
+  }
+
+  JsonDocument doc(&_pool);
+  doc["type"] = "ack";
+  JsonArray results = doc["results"].to<JsonArray>();
+  for (size_t i = 0; i < _count; i++) {
+    JsonObject entry = results.add<JsonObject>();
+    if (_results[i].numeric) {
+      entry["id"] = _results[i].number;
+    } else {
+      entry["id"] = (const char *)_results[i].text;
+    }
+    entry["ok"] = _results[i].error == NULL;
+    if (_results[i].error != NULL) {
+      entry["error"] = _results[i].error;
+    }
+  }
+
+  // Never send an ack cut short by the arena or the buffer
+  if (doc.overflowed() || measureJson(doc) >= sizeof(_buffer)) {
+    Serial.printf("[%u] Ack for %u commands dropped, it does not fit\n", num, (unsigned)_count);
+  } else {
+    size_t len = serializeJson(doc, _buffer, sizeof(_buffer));
+    _sockets->send(num, (const uint8_t *)_buffer, len, false);
+  }
+  _count = 0;
+}
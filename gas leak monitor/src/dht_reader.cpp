@@ -0,0 +1,145 @@
+#include "dht_reader.h"
+
+#define DHT_RMT_CLK_DIV 80          // 1 tick = 1 us
+#define DHT_RMT_IDLE_US 200         // Longest DHT level is ~80 us, so this ends the frame
+#define DHT_RMT_FILTER_TICKS 100    // Ignore glitches shorter than ~1.25 us (APB ticks)
+#define DHT_BIT_THRESHOLD_US 48     // High time: ~27 us for 0, ~70 us for 1
+#define DHT_REPLY_TIMEOUT_MS 20     // Full reply takes ~5 ms
+#define DHT_MAX_HIGH_PULSES 48
+
+bool DhtReader::begin(BaseType_t core, UBaseType_t priority) {
+  rmt_config_t config = RMT_DEFAULT_CONFIG_RX((gpio_num_t)_pin, _channel);
+  config.clk_div = DHT_RMT_CLK_DIV;
+  config.rx_config.idle_threshold = DHT_RMT_IDLE_US;
+  config.rx_config.filter_en = true;
+  config.rx_config.filter_ticks_thresh = DHT_RMT_FILTER_TICKS;
+
+  if (rmt_config(&config) != ESP_OK || rmt_driver_install(_channel, 512, 0) != ESP_OK) {
+    Serial.println("DHT RMT driver install failed");
+    return false;
+  }
+  rmt_get_ringbuf_handle(_channel, &_ringbuf);
+
+  // Idle line is high through the pull-up
+  pinMode(_pin, INPUT_PULLUP);
+
+  return xTaskCreatePinnedToCore(taskEntry, "dht", 3072, this, priority, &_task, core) == pdPASS;
+}
+
+bool DhtReader::start() {
+  if (_task == NULL || _busy) {
+    return false;
+  }
+  _busy = true;
+  xTaskNotifyGive(_task);
+  return true;
+}
+
+void DhtReader::taskEntry(void *parameter) {
+  static_cast<DhtReader *>(parameter)->run();
+}
+
+void DhtReader::run() {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    uint32_t started = micros();
+    float temperature = NAN;
+    float humidity = NAN;
+    bool ok = transact(temperature, humidity);
+    _lastTransactionUs = micros() - started;
+
+    _busy = false;
+    if (_callback) {
+      _callback(temperature, humidity, ok);
+    }
+  }
+}
+
+bool DhtReader::transact(float &temperature, float &humidity) {
+  // Drop anything left over from an aborted frame
+  size_t size = 0;
+  void *stale;
+  while ((stale = xRingbufferReceive(_ringbuf, &size, 0)) != NULL) {
+    vRingbufferReturnItem(_ringbuf, stale);
+  }
+
+  // Start pulse: DHT11 needs >= 18 ms low, DHT22 >= 1 ms; the task sleeps meanwhile
+  pinMode(_pin, OUTPUT);
+  digitalWrite(_pin, LOW);
+  vTaskDelay(pdMS_TO_TICKS(_type == DHT_TYPE_DHT11 ? 20 : 2));
+
+  // Release the line and let the RMT time the reply
+  pinMode(_pin, INPUT_PULLUP);
+  rmt_set_pin(_channel, RMT_MODE_RX, (gpio_num_t)_pin);
+  rmt_rx_start(_channel, true);
+
+  rmt_item32_t *items = (rmt_item32_t *)xRingbufferReceive(_ringbuf, &size, pdMS_TO_TICKS(DHT_REPLY_TIMEOUT_MS));
+  rmt_rx_stop(_channel);
+  if (items == NULL) {
+    return false;
+  }
+
+  uint8_t data[5];
+  bool valid = decode(items, size / sizeof(rmt_item32_t), data);
+  vRingbufferReturnItem(_ringbuf, items);
+  if (!valid) {
+    return false;
+  }
+
+  if (_type == DHT_TYPE_DHT11) {
+    humidity = data[0] + data[1] * 0.1f;
+    temperature = data[2];
+    if (data[3] & 0x80) {
+      temperature = -1 - temperature;
+    }
+    temperature += (data[3] & 0x0F) * 0.1f;
+  } else {
+    humidity = ((data[0] << 8) | data[1]) * 0.1f;
+    temperature = (((data[2] & 0x7F) << 8) | data[3]) * 0.1f;
+    if (data[2] & 0x80) {
+      temperature = -temperature;
+    }
+  }
+  return true;
+}
+
+// The data bits are the last 40 high pulses of the frame; everything before
+// them is the line release and the 80 us response preamble
+bool DhtReader::decode(const rmt_item32_t *items, size_t count, uint8_t data[5]) {
+  uint16_t highs[DHT_MAX_HIGH_PULSES];
+  size_t highCount = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    uint16_t durations[2] = { (uint16_t)items[i].duration0, (uint16_t)items[i].duration1 };
+    uint8_t levels[2] = { (uint8_t)items[i].level0, (uint8_t)items[i].level1 };
+    for (int half = 0; half < 2; half++) {
+      // A zero duration marks the idle end of the frame
+      if (durations[half] == 0) {
+        i = count;
+        break;
+      }
+      if (levels[half] == 1) {
+        if (highCount == DHT_MAX_HIGH_PULSES) {
+          return false;
+        }
+        highs[highCount++] = durations[half];
+      }
+    }
+  }
+
+  if (highCount < 40) {
+    return false;
+  }
+
+  memset(data, 0, 5);
+  const uint16_t *bits = highs + (highCount - 40);
+  for (int bit = 0; bit < 40; bit++) {
+    data[bit / 8] <<= 1;
+    if (bits[bit] > DHT_BIT_THRESHOLD_US) {
+      data[bit / 8] |= 1;
+    }
+  }
+
+  return ((data[0] + data[1] + data[2] + data[3]) & 0xFF) == data[4];
+}
@@ -0,0 +1,57 @@
+#include "discovery.h"
+
+#include <ESPmDNS.h>
+
+DeviceDiscovery discovery;
+
+bool DeviceDiscovery::begin(const String &deviceID, const char *firmware, bool aggregator) {
+  // The reply never changes, so it is built once
+  _reply.magic = DISCOVERY_MAGIC;
+  _reply.version = DISCOVERY_VERSION;
+  _reply.kind = DISCOVERY_KIND_MONITOR;
+  _reply.flags = aggregator ? DISCOVERY_FLAG_AGGREGATOR : 0;
+  _reply.httpPort = DISCOVERY_HTTP_PORT;
+  _reply.wsPort = DISCOVERY_HTTP_PORT;
+  discoveryCopyText(_reply.wsPath, sizeof(_reply.wsPath), DISCOVERY_WS_PATH);
+  discoveryCopyText(_reply.deviceId, sizeof(_reply.deviceId), deviceID.c_str());
+  discoveryCopyText(_reply.firmware, sizeof(_reply.firmware), firmware);
+
+  String host = DISCOVERY_HOST_PREFIX + deviceID;
+  host.toLowerCase();
+  if (MDNS.begin(host.c_str())) {
+    MDNS.addService(DISCOVERY_SERVICE, "tcp", DISCOVERY_HTTP_PORT);
+    MDNS.addServiceTxt(DISCOVERY_SERVICE, "tcp", "id", deviceID.c_str());
+    MDNS.addServiceTxt(DISCOVERY_SERVICE, "tcp", "fw", firmware);
+    MDNS.addServiceTxt(DISCOVERY_SERVICE, "tcp", "ws", DISCOVERY_WS_PATH);
+    MDNS.addServiceTxt(DISCOVERY_SERVICE, "tcp", "wsport", String(DISCOVERY_HTTP_PORT).c_str());
+    MDNS.addServiceTxt(DISCOVERY_SERVICE, "tcp", "udp", String(DISCOVERY_PORT).c_str());
+    MDNS.addServiceTxt(DISCOVERY_SERVICE, "tcp", "aggregator", aggregator ? "1" : "0");
+  } else {
+    Serial.println("mDNS responder failed to start");
+  }
+
+  _started = _udp.begin(DISCOVERY_PORT);
+  Serial.printf("Discovery: %s.local, UDP %u\n", host.c_str(), DISCOVERY_PORT);
+  return _started;
+}
+
+void DeviceDiscovery::poll() {
+  if (!_started) return;
+
+  for (uint8_t i = 0; i < DISCOVERY_REQUESTS_PER_POLL; i++) {
+    int len = _udp.parsePacket();
+    if (len <= 0) return;
+
+    uint8_t request[sizeof(DiscoveryRequest)];
+    int read = _udp.read(request, sizeof(request));
+    if (len != read || !discoveryRequestMatches(request, read, DISCOVERY_KIND_MONITOR)) {
+      continue;
+    }
+
+    _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
+    _udp.write((const uint8_t *)&_reply, sizeof(_reply));
+    if (_udp.endPacket()) {
+      _answered++;
+    }
+  }
+}
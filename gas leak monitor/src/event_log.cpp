@@ -0,0 +1,342 @@
+#include "event_log.h"
+
+#include <LittleFS.h>
+
+#define EVENT_DIR "/events"
+#define EVENT_SCAN_LIMIT (EVENT_SEGMENTS * 2)  // Segment files looked at when reopening
+
+EventLog events;
+
+bool EventLog::begin() {
+  if (!LittleFS.begin(true)) {
+    Serial.println("Event log: LittleFS mount failed, events stay in RAM");
+    return false;
+  }
+  if (!LittleFS.exists(EVENT_DIR)) {
+    LittleFS.mkdir(EVENT_DIR);
+  }
+
+  // Segment files by first sequence number, ascending; anything past the newest
+  // EVENT_SEGMENTS is left over from an interrupted rotation
+  uint32_t found[EVENT_SCAN_LIMIT];
+  uint8_t foundCount = 0;
+  File dir = LittleFS.open(EVENT_DIR);
+  for (File file = dir.openNextFile(); file && foundCount < EVENT_SCAN_LIMIT; file = dir.openNextFile()) {
+    const char *name = strrchr(file.name(), '/');
+    uint32_t first = strtoul(name ? name + 1 : file.name(), NULL, 16);
+    file.close();
+
+    uint8_t i = foundCount++;
+    while (i > 0 && found[i - 1] > first) {
+      found[i] = found[i - 1];
+      i--;
+    }
+    found[i] = first;
+  }
+  dir.close();
+
+  char path[24];
+  uint8_t skip = foundCount > EVENT_SEGMENTS ? foundCount - EVENT_SEGMENTS : 0;
+  for (uint8_t i = 0; i < skip; i++) {
+    segmentPath(found[i], path, sizeof(path));
+    LittleFS.remove(path);
+  }
+
+  // Only a segment's tail can be torn; each one is cut at its last intact record
+  Segment segments[EVENT_SEGMENTS];
+  uint8_t segmentCount = 0;
+  uint32_t lastBoot = 0;
+  bool clean = true;
+  for (uint8_t i = skip; i < foundCount; i++) {
+    Segment &segment = segments[segmentCount++];
+    segment.first = found[i];
+    clean = recover(segment, lastBoot);
+  }
+
+  uint32_t base = 0;
+  if (segmentCount > 0) {
+    const Segment &newest = segments[segmentCount - 1];
+    base = newest.first + newest.count;
+  }
+
+  // Everything logged since reset moves behind the records already on flash
+  portENTER_CRITICAL(&_mux);
+  memcpy(_segments, segments, sizeof(segments));
+  _segmentCount = segmentCount;
+  _sealed = !clean || (segmentCount > 0 && segments[segmentCount - 1].count >= EVENT_SEGMENT_RECORDS);
+  _boot = lastBoot + 1;
+  for (uint32_t i = 0; i < _queued; i++) {
+    EventRecord &record = _queue[(_head + i) % EVENT_BUFFER_RECORDS];
+    record.seq += base;
+    record.boot = _boot;
+  }
+  _baseSeq += base;
+  _nextSeq += base;
+  _flushedSeq += base;
+  _mounted = true;
+  portEXIT_CRITICAL(&_mux);
+
+  Serial.printf("Event log: boot %u, next event %u, %u segments\n", _boot, _nextSeq, _segmentCount);
+  return true;
+}
+
+void EventLog::log(EventType type, uint8_t detail, uint16_t value) {
+  uint32_t now = millis();
+
+  portENTER_CRITICAL(&_mux);
+  if (_queued >= EVENT_BUFFER_RECORDS) {
+    _dropped++;
+  } else {
+    EventRecord &record = _queue[(_head + _queued) % EVENT_BUFFER_RECORDS];
+    record.seq = _nextSeq++;
+    record.boot = _boot;
+    record.type = type;
+    record.detail = detail;
+    record.timeMs = now;
+    record.value = value;
+    record.crc = 0;  // Filled in when the record leaves RAM
+    if (_queued == 0) {
+      _queuedAtMs = now;
+    }
+    _queued++;
+    // Alarms right away; OTA steps before the restart that follows them
+    if (type == EVENT_ALARM_TRIP || type == EVENT_ALARM_RESET || type == EVENT_OTA) {
+      _urgent = true;
+    }
+  }
+  portEXIT_CRITICAL(&_mux);
+}
+
+void EventLog::poll() {
+  if (!_mounted) return;
+
+  portENTER_CRITICAL(&_mux);
+  uint32_t queued = _queued;
+  bool due = queued >= EVENT_BATCH_RECORDS ||
+             (queued > 0 && (_urgent || millis() - _queuedAtMs >= EVENT_FLUSH_DELAY_MS));
+  portEXIT_CRITICAL(&_mux);
+
+  if (due) {
+    flush(queued < EVENT_BATCH_RECORDS ? queued : EVENT_BATCH_RECORDS);
+  }
+}
+
+void EventLog::flush(uint32_t count) {
+  char path[24];
+
+  // The next batch starts a new segment, dropping the oldest when the ring is full
+  if (_segmentCount == 0 || _sealed) {
+    uint32_t oldest = _segments[0].first;
+    bool rotate = _segmentCount == EVENT_SEGMENTS;
+
+    portENTER_CRITICAL(&_mux);
+    if (rotate) {
+      memmove(_segments, _segments + 1, sizeof(Segment) * (EVENT_SEGMENTS - 1));
+      _segmentCount--;
+    }
+    _segments[_segmentCount].first = _flushedSeq;
+    _segments[_segmentCount].count = 0;
+    _segmentCount++;
+    portEXIT_CRITICAL(&_mux);
+    _sealed = false;
+
+    // A reader still inside it just ends its stream early
+    if (rotate) {
+      segmentPath(oldest, path, sizeof(path));
+      LittleFS.remove(path);
+    }
+  }
+
+  Segment &segment = _segments[_segmentCount - 1];
+  if (count > EVENT_SEGMENT_RECORDS - segment.count) {
+    count = EVENT_SEGMENT_RECORDS - segment.count;
+  }
+
+  EventRecord batch[EVENT_BATCH_RECORDS];
+  portENTER_CRITICAL(&_mux);
+  for (uint32_t i = 0; i < count; i++) {
+    batch[i] = _queue[(_head + i) % EVENT_BUFFER_RECORDS];
+  }
+  portEXIT_CRITICAL(&_mux);
+  for (uint32_t i = 0; i < count; i++) {
+    batch[i].crc = checksum(batch[i]);
+  }
+
+  segmentPath(segment.first, path, sizeof(path));
+  File file = LittleFS.open(path, FILE_APPEND);
+  size_t written = 0;
+  if (file) {
+    written = file.write((const uint8_t *)batch, count * sizeof(EventRecord));
+    file.close();
+  }
+
+  if (written != count * sizeof(EventRecord)) {
+    // Never append behind a partial batch; retry into a fresh segment after the flush delay
+    _writeFailures++;
+    _sealed = true;
+    portENTER_CRITICAL(&_mux);
+    _queuedAtMs = millis();
+    _urgent = false;
+    portEXIT_CRITICAL(&_mux);
+    return;
+  }
+
+  portENTER_CRITICAL(&_mux);
+  segment.count += count;
+  _head = (_head + count) % EVENT_BUFFER_RECORDS;
+  _queued -= count;
+  _flushedSeq += count;
+  if (_queued == 0) {
+    _urgent = false;
+  }
+  portEXIT_CRITICAL(&_mux);
+
+  if (segment.count >= EVENT_SEGMENT_RECORDS) {
+    _sealed = true;
+  }
+  _flushes++;
+}
+
+// Counts the intact records of a segment; false when its tail was torn
+bool EventLog::recover(Segment &segment, uint32_t &boot) {
+  char path[24];
+  segmentPath(segment.first, path, sizeof(path));
+  File file = LittleFS.open(path, FILE_READ);
+  if (!file) {
+    segment.count = 0;
+    return false;
+  }
+
+  size_t size = file.size();
+  uint32_t count = size / sizeof(EventRecord);
+  while (count > 0) {
+    EventRecord record;
+    file.seek((count - 1) * sizeof(EventRecord));
+    if (file.read((uint8_t *)&record, sizeof(record)) == sizeof(record) &&
+        record.crc == checksum(record) && record.seq == segment.first + count - 1) {
+      if (record.boot > boot) {
+        boot = record.boot;
+      }
+      break;
+    }
+    count--;
+  }
+  file.close();
+
+  segment.count = count;
+  return count * sizeof(EventRecord) == size;
+}
+
+// Copies up to count records from seq on, from the RAM queue or flash; 0 once seq is gone
+uint32_t EventLog::readRecords(uint32_t seq, uint8_t *out, uint32_t count) {
+  uint32_t read = 0;
+
+  portENTER_CRITICAL(&_mux);
+  if (seq >= _flushedSeq) {
+    uint32_t offset = seq - _flushedSeq;
+    if (offset < _queued) {
+      read = _queued - offset < count ? _queued - offset : count;
+      for (uint32_t i = 0; i < read; i++) {
+        memcpy(out + i * sizeof(EventRecord), &_queue[(_head + offset + i) % EVENT_BUFFER_RECORDS], sizeof(EventRecord));
+      }
+    }
+    portEXIT_CRITICAL(&_mux);
+
+    for (uint32_t i = 0; i < read; i++) {
+      EventRecord record;
+      memcpy(&record, out + i * sizeof(EventRecord), sizeof(record));
+      record.crc = checksum(record);
+      memcpy(out + i * sizeof(EventRecord), &record, sizeof(record));
+    }
+    return read;
+  }
+
+  // Newest segment that holds seq; a range rewritten after a failed batch supersedes the older tail
+  Segment segment = {0, 0};
+  for (int i = _segmentCount - 1; i >= 0; i--) {
+    if (_segments[i].first <= seq && seq < _segments[i].first + _segments[i].count) {
+      segment = _segments[i];
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&_mux);
+  if (segment.count == 0) return 0;
+
+  uint32_t available = segment.first + segment.count - seq;
+  if (count > available) count = available;
+
+  char path[24];
+  segmentPath(segment.first, path, sizeof(path));
+  File file = LittleFS.open(path, FILE_READ);
+  if (!file) return 0;
+  if (file.seek((seq - segment.first) * sizeof(EventRecord))) {
+    read = file.read(out, count * sizeof(EventRecord)) / sizeof(EventRecord);
+  }
+  file.close();
+  return read;
+}
+
+void EventLog::handleRequest(AsyncWebServerRequest *request) {
+  EventStreamHeader header = {};
+  header.magic = EVENT_STREAM_MAGIC;
+  header.version = EVENT_STREAM_VERSION;
+  header.recordSize = sizeof(EventRecord);
+  header.uptimeMs = millis();
+  header.boot = _boot;
+
+  portENTER_CRITICAL(&_mux);
+  uint32_t first = _segmentCount > 0 ? _segments[0].first : _flushedSeq;
+  header.next = _nextSeq;
+  portEXIT_CRITICAL(&_mux);
+
+  // A since past the end belongs to an older journal; start over from the oldest record
+  uint32_t since = request->hasParam("since") ? strtoul(request->getParam("since")->value().c_str(), NULL, 10) : 0;
+  header.first = since < first || since > header.next ? first : since;
+
+  AsyncWebServerResponse *response = request->beginChunkedResponse("application/octet-stream",
+    [this, header](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      size_t written = 0;
+      size_t offset = index;
+      if (offset == 0) {
+        if (maxLen < sizeof(header)) return 0;
+        memcpy(buffer, &header, sizeof(header));
+        written = sizeof(header);
+        offset = sizeof(header);
+      }
+
+      // Only whole records are written, so the byte offset gives the next record
+      uint32_t seq = header.first + (offset - sizeof(header)) / sizeof(EventRecord);
+      while (seq < header.next && written + sizeof(EventRecord) <= maxLen) {
+        uint32_t room = (maxLen - written) / sizeof(EventRecord);
+        uint32_t wanted = header.next - seq < room ? header.next - seq : room;
+        uint32_t read = readRecords(seq, buffer + written, wanted);
+        if (read == 0) {
+          break;  // Rotated out while streaming; end the body early
+        }
+        written += read * sizeof(EventRecord);
+        seq += read;
+      }
+      return written;
+    });
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+}
+
+void EventLog::segmentPath(uint32_t first, char *path, size_t size) {
+  snprintf(path, size, EVENT_DIR "/%08x", (unsigned)first);
+}
+
+// Bitwise CRC-16/CCITT; one record at a time outside the spinlock
+uint16_t EventLog::checksum(const EventRecord &record) {
+  const uint8_t *data = (const uint8_t *)&record;
+  size_t len = offsetof(EventRecord, crc);
+
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
@@ -0,0 +1,146 @@
+#include "gas_sampler.h"
+
+#include <driver/i2s.h>
+#include <driver/adc.h>
+
+#define GAS_SAMPLER_I2S_PORT I2S_NUM_0
+
+GasSampler gasSampler;
+
+bool GasSampler::begin(uint8_t pin, BaseType_t core, UBaseType_t priority) {
+  _pin = pin;
+  _channel = digitalPinToAnalogChannel(pin);
+
+  // The I2S ADC mode only reaches ADC1 (channels 0..7), which also keeps working with WiFi on
+  if (_channel >= 0 && _channel < ADC1_CHANNEL_MAX) {
+    i2s_config_t config = {};
+    config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN);
+    config.sample_rate = GAS_SAMPLER_RAW_RATE;
+    config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+    config.communication_format = I2S_COMM_FORMAT_STAND_MSB;
+    config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+    config.dma_buf_count = GAS_SAMPLER_DMA_BUF_COUNT;
+    config.dma_buf_len = GAS_SAMPLER_DMA_BUF_LEN;
+    config.use_apll = false;
+
+    if (i2s_driver_install(GAS_SAMPLER_I2S_PORT, &config, 0, NULL) == ESP_OK) {
+      adc1_config_width(ADC_WIDTH_BIT_12);
+      adc1_config_channel_atten((adc1_channel_t)_channel, ADC_ATTEN_DB_11);
+      i2s_set_adc_mode(ADC_UNIT_1, (adc1_channel_t)_channel);
+      i2s_adc_enable(GAS_SAMPLER_I2S_PORT);
+      _dma = true;
+    } else {
+      Serial.println("I2S ADC driver install failed, using polled gas sampling");
+    }
+  } else {
+    Serial.println("Gas sensor pin is not on ADC1, using polled gas sampling");
+  }
+
+  return xTaskCreatePinnedToCore(taskEntry, "gasSampler", 3072, this, priority, &_task, core) == pdPASS;
+}
+
+float GasSampler::read() const {
+  return _filtered / 16.0f;
+}
+
+uint16_t GasSampler::readRaw() const {
+  uint32_t count = _count;
+  if (count == 0) return 0;
+  return _ring[(count - 1) % GAS_SAMPLER_RING_SIZE];
+}
+
+size_t GasSampler::copyRecent(uint16_t *out, size_t len) const {
+  uint32_t count = _count;
+  if (len > count) len = count;
+  if (len > GAS_SAMPLER_RING_SIZE) len = GAS_SAMPLER_RING_SIZE;
+
+  uint32_t start = count - len;
+  for (size_t i = 0; i < len; i++) {
+    out[i] = _ring[(start + i) % GAS_SAMPLER_RING_SIZE];
+  }
+  return len;
+}
+
+void GasSampler::taskEntry(void *parameter) {
+  GasSampler *sampler = static_cast<GasSampler *>(parameter);
+  if (sampler->_dma) {
+    sampler->runDma();
+  } else {
+    sampler->runPolled();
+  }
+}
+
+// Blocks on the DMA queue, so the task costs nothing between buffers
+void GasSampler::runDma() {
+  static uint16_t buffer[GAS_SAMPLER_DMA_BUF_LEN];
+  uint32_t sum = 0;
+  uint16_t summed = 0;
+
+  for (;;) {
+    size_t bytesRead = 0;
+    if (i2s_read(GAS_SAMPLER_I2S_PORT, buffer, sizeof(buffer), &bytesRead, portMAX_DELAY) != ESP_OK) {
+      continue;
+    }
+
+    // The last sample of the buffer was converted just before the read returned
+    uint32_t now = micros();
+    size_t samples = bytesRead / sizeof(uint16_t);
+    for (size_t i = 0; i < samples; i++) {
+      // Top 4 bits carry the channel number, the low 12 bits the conversion
+      sum += buffer[i] & 0x0FFF;
+      if (++summed == GAS_SAMPLER_DECIMATION) {
+        uint32_t age = (samples - 1 - i) * (1000000UL / GAS_SAMPLER_RAW_RATE);
+        push(sum / GAS_SAMPLER_DECIMATION, now - age);
+        sum = 0;
+        summed = 0;
+      }
+    }
+  }
+}
+
+void GasSampler::runPolled() {
+  TickType_t lastWake = xTaskGetTickCount();
+  TickType_t period = pdMS_TO_TICKS(1000 / GAS_SAMPLER_RATE);
+  if (period == 0) period = 1;
+
+  for (;;) {
+    push(analogRead(_pin), micros());
+    vTaskDelayUntil(&lastWake, period);
+  }
+}
+
+void GasSampler::push(uint16_t sample, uint32_t sampleTimeUs) {
+  uint32_t count = _count;
+  _ring[count % GAS_SAMPLER_RING_SIZE] = sample;
+  _count = ++count;
+
+  // Median of the newest samples knocks out single-sample spikes
+  uint16_t window[GAS_SAMPLER_MEDIAN_WINDOW];
+  size_t n = count < GAS_SAMPLER_MEDIAN_WINDOW ? count : GAS_SAMPLER_MEDIAN_WINDOW;
+  for (size_t i = 0; i < n; i++) {
+    uint16_t value = _ring[(count - 1 - i) % GAS_SAMPLER_RING_SIZE];
+    size_t j = i;
+    while (j > 0 && window[j - 1] > value) {
+      window[j] = window[j - 1];
+      j--;
+    }
+    window[j] = value;
+  }
+  uint16_t medianSample = window[n / 2];
+  int32_t median = (int32_t)medianSample << 4;
+
+  // EMA smooths what is left of the noise
+  if (!_primed) {
+    _filtered = median;
+    _primed = true;
+  } else {
+    int32_t filtered = (int32_t)_filtered;
+    filtered += (median - filtered) >> GAS_SAMPLER_EMA_SHIFT;
+    _filtered = filtered;
+  }
+
+  if (_callback) {
+    _callback(medianSample, sampleTimeUs);
+  }
+}
@@ -0,0 +1,229 @@
+#include "history.h"
+
+#include <esp_timer.h>
+
+HistoryStore history;
+
+template <typename Record>
+static bool allocateRing(Record *&records, uint32_t &capacity, uint32_t base) {
+  // Allocated once at boot, so there is nothing to fragment later
+  if (psramFound()) {
+    capacity = base * HISTORY_PSRAM_SCALE;
+    records = (Record *)ps_malloc(capacity * sizeof(Record));
+    if (records != NULL) return true;
+  }
+  capacity = base;
+  records = (Record *)malloc(capacity * sizeof(Record));
+  return records != NULL;
+}
+
+bool HistoryStore::begin() {
+  bool ok = allocateRing(_raw.records, _raw.capacity, HISTORY_RAW_CAPACITY) &&
+            allocateRing(_minutes.records, _minutes.capacity, HISTORY_MINUTE_CAPACITY) &&
+            allocateRing(_hours.records, _hours.capacity, HISTORY_HOUR_CAPACITY);
+  if (!ok) {
+    Serial.println("History buffer allocation failed");
+    _raw.capacity = _minutes.capacity = _hours.capacity = 0;
+  }
+  return ok;
+}
+
+uint32_t HistoryStore::uptime() {
+  return (uint32_t)(esp_timer_get_time() / 1000000ULL);
+}
+
+void HistoryStore::add(float temperature, float humidity, float gasLevel) {
+  if (_raw.capacity == 0) return;
+
+  HistorySample sample;
+  sample.time = uptime();
+  sample.temperature = (int16_t)constrain(lroundf(temperature * 100.0f), -32768L, 32767L);
+  sample.humidity = (uint16_t)constrain(lroundf(humidity * 100.0f), 0L, 65535L);
+  sample.gasLevel = (uint16_t)constrain(lroundf(gasLevel), 0L, 65535L);
+
+  portENTER_CRITICAL(&_mux);
+  _raw.push(sample);
+  roll(_minute, _minutes, 60, sample);
+  roll(_hour, _hours, 3600, sample);
+  portEXIT_CRITICAL(&_mux);
+}
+
+// Closes the running period when the sample falls into a new one, then folds the sample in
+void HistoryStore::roll(Accumulator &acc, Ring<HistoryRollup> &ring, uint32_t period, const HistorySample &sample) {
+  uint32_t start = sample.time - sample.time % period;
+  if (acc.count > 0 && acc.start != start) {
+    ring.push(finish(acc));
+    acc.count = 0;
+  }
+
+  if (acc.count == 0) {
+    acc.start = start;
+    acc.temperatureSum = acc.humiditySum = acc.gasSum = 0;
+    acc.temperatureMin = acc.temperatureMax = sample.temperature;
+    acc.humidityMin = acc.humidityMax = sample.humidity;
+    acc.gasMin = acc.gasMax = sample.gasLevel;
+  }
+
+  acc.count++;
+  acc.temperatureSum += sample.temperature;
+  acc.humiditySum += sample.humidity;
+  acc.gasSum += sample.gasLevel;
+  if (sample.temperature < acc.temperatureMin) acc.temperatureMin = sample.temperature;
+  if (sample.temperature > acc.temperatureMax) acc.temperatureMax = sample.temperature;
+  if (sample.humidity < acc.humidityMin) acc.humidityMin = sample.humidity;
+  if (sample.humidity > acc.humidityMax) acc.humidityMax = sample.humidity;
+  if (sample.gasLevel < acc.gasMin) acc.gasMin = sample.gasLevel;
+  if (sample.gasLevel > acc.gasMax) acc.gasMax = sample.gasLevel;
+}
+
+HistoryRollup HistoryStore::finish(const Accumulator &acc) {
+  HistoryRollup rollup;
+  rollup.time = acc.start;
+  rollup.temperatureMin = acc.temperatureMin;
+  rollup.temperatureMax = acc.temperatureMax;
+  rollup.temperatureAvg = acc.temperatureSum / (int32_t)acc.count;
+  rollup.humidityMin = acc.humidityMin;
+  rollup.humidityMax = acc.humidityMax;
+  rollup.humidityAvg = acc.humiditySum / acc.count;
+  rollup.gasMin = acc.gasMin;
+  rollup.gasMax = acc.gasMax;
+  rollup.gasAvg = acc.gasSum / acc.count;
+  return rollup;
+}
+
+uint32_t HistoryStore::recordTime(HistoryResolution resolution, uint32_t seq) {
+  switch (resolution) {
+    case HISTORY_RAW: return _raw.records[seq % _raw.capacity].time;
+    case HISTORY_MINUTE: return _minutes.records[seq % _minutes.capacity].time;
+    default: return _hours.records[seq % _hours.capacity].time;
+  }
+}
+
+// Binary search over the live part of a ring; call with _mux held
+uint32_t HistoryStore::lowerBound(HistoryResolution resolution, uint32_t time) {
+  uint32_t low, high;
+  switch (resolution) {
+    case HISTORY_RAW: low = _raw.first(); high = _raw.count; break;
+    case HISTORY_MINUTE: low = _minutes.first(); high = _minutes.count; break;
+    default: low = _hours.first(); high = _hours.count; break;
+  }
+
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    if (recordTime(resolution, mid) < time) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+// Copies one record if the ring has not overwritten it yet
+bool HistoryStore::copyRecord(HistoryResolution resolution, uint32_t seq, uint8_t *out) {
+  bool ok = false;
+
+  portENTER_CRITICAL(&_mux);
+  switch (resolution) {
+    case HISTORY_RAW:
+      if (seq >= _raw.first() && seq < _raw.count) {
+        memcpy(out, &_raw.records[seq % _raw.capacity], sizeof(HistorySample));
+        ok = true;
+      }
+      break;
+    case HISTORY_MINUTE:
+      if (seq >= _minutes.first() && seq < _minutes.count) {
+        memcpy(out, &_minutes.records[seq % _minutes.capacity], sizeof(HistoryRollup));
+        ok = true;
+      }
+      break;
+    default:
+      if (seq >= _hours.first() && seq < _hours.count) {
+        memcpy(out, &_hours.records[seq % _hours.capacity], sizeof(HistoryRollup));
+        ok = true;
+      }
+      break;
+  }
+  portEXIT_CRITICAL(&_mux);
+
+  return ok;
+}
+
+void HistoryStore::handleRequest(AsyncWebServerRequest *request) {
+  if (_raw.capacity == 0) {
+    request->send(503, "application/json", "{\"error\":\"history unavailable\"}");
+    return;
+  }
+
+  uint32_t now = uptime();
+  uint32_t from = request->hasParam("from") ? request->getParam("from")->value().toInt() : 0;
+  uint32_t to = request->hasParam("to") ? request->getParam("to")->value().toInt() : now;
+  if (to > now) {
+    to = now;
+  }
+  if (to < from) {
+    request->send(400, "application/json", "{\"error\":\"to before from\"}");
+    return;
+  }
+
+  // Finest tier whose ring spans the requested range, unless the client asked for one
+  HistoryResolution resolution;
+  String res = request->hasParam("res") ? request->getParam("res")->value() : "";
+  if (res == "raw") {
+    resolution = HISTORY_RAW;
+  } else if (res == "1m") {
+    resolution = HISTORY_MINUTE;
+  } else if (res == "1h") {
+    resolution = HISTORY_HOUR;
+  } else if (res.length() > 0) {
+    request->send(400, "application/json", "{\"error\":\"res must be raw, 1m or 1h\"}");
+    return;
+  } else {
+    uint32_t span = to - from;
+    if (span <= _raw.capacity * 2) {
+      resolution = HISTORY_RAW;
+    } else if (span <= _minutes.capacity * 60) {
+      resolution = HISTORY_MINUTE;
+    } else {
+      resolution = HISTORY_HOUR;
+    }
+  }
+
+  portENTER_CRITICAL(&_mux);
+  uint32_t startSeq = lowerBound(resolution, from);
+  uint32_t endSeq = lowerBound(resolution, to + 1);
+  portEXIT_CRITICAL(&_mux);
+
+  HistoryHeader header;
+  header.magic = HISTORY_MAGIC;
+  header.version = HISTORY_VERSION;
+  header.resolution = resolution;
+  header.recordSize = resolution == HISTORY_RAW ? sizeof(HistorySample) : sizeof(HistoryRollup);
+  header.uptime = now;
+  header.count = endSeq - startSeq;
+
+  AsyncWebServerResponse *response = request->beginChunkedResponse("application/octet-stream",
+    [this, header, startSeq](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      size_t written = 0;
+      size_t offset = index;
+      if (offset == 0) {
+        if (maxLen < sizeof(header)) return 0;
+        memcpy(buffer, &header, sizeof(header));
+        written = sizeof(header);
+        offset = sizeof(header);
+      }
+
+      // Only whole records are written, so the byte offset gives the next record
+      uint32_t sent = (offset - sizeof(header)) / header.recordSize;
+      while (sent < header.count && written + header.recordSize <= maxLen) {
+        if (!copyRecord((HistoryResolution)header.resolution, startSeq + sent, buffer + written)) {
+          break;  // Overwritten while streaming; end the body early
+        }
+        written += header.recordSize;
+        sent++;
+      }
+      return written;
+    });
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+}
@@ -0,0 +1,80 @@
+#include "lcd_buffer.h"
+
+#include <Wire.h>
+
+// An unchanged cell this short between two changed runs is cheaper to
+// rewrite than a second setCursor command
+#define LCD_BUFFER_MERGE_GAP 1
+
+LcdBuffer::LcdBuffer(LiquidCrystal_I2C &device, uint8_t cols, uint8_t rows)
+  : _device(device),
+    _cols(cols > LCD_BUFFER_MAX_COLS ? LCD_BUFFER_MAX_COLS : cols),
+    _rows(rows > LCD_BUFFER_MAX_ROWS ? LCD_BUFFER_MAX_ROWS : rows) {
+  memset(_frame, ' ', sizeof(_frame));
+  memset(_shown, ' ', sizeof(_shown));
+}
+
+void LcdBuffer::begin(bool fastI2c) {
+  if (fastI2c) {
+    Wire.setClock(400000);
+  }
+  _device.init();
+  _device.backlight();
+
+  // One real clear so the shadow matches the panel
+  _device.clear();
+  memset(_frame, ' ', sizeof(_frame));
+  memset(_shown, ' ', sizeof(_shown));
+}
+
+void LcdBuffer::clear() {
+  memset(_frame, ' ', sizeof(_frame));
+  _col = 0;
+  _row = 0;
+}
+
+void LcdBuffer::setCursor(uint8_t col, uint8_t row) {
+  _col = col;
+  _row = row;
+}
+
+size_t LcdBuffer::write(uint8_t c) {
+  if (_row >= _rows || _col >= _cols) {
+    return 1;  // Clipped
+  }
+  _frame[_row][_col++] = c;
+  return 1;
+}
+
+void LcdBuffer::flush() {
+  for (uint8_t row = 0; row < _rows; row++) {
+    uint8_t col = 0;
+    while (col < _cols) {
+      if (_frame[row][col] == _shown[row][col]) {
+        col++;
+        continue;
+      }
+
+      // Extend the run over changed cells and short unchanged gaps
+      uint8_t start = col;
+      uint8_t end = col + 1;
+      uint8_t scan = end;
+      while (scan < _cols) {
+        if (_frame[row][scan] != _shown[row][scan]) {
+          end = scan + 1;
+        } else if (scan - end >= LCD_BUFFER_MERGE_GAP) {
+          break;
+        }
+        scan++;
+      }
+
+      _device.setCursor(start, row);
+      for (uint8_t i = start; i < end; i++) {
+        _device.write((uint8_t)_frame[row][i]);
+        _shown[row][i] = _frame[row][i];
+      }
+      _cellsWritten += end - start;
+      col = end;
+    }
+  }
+}
@@ -1,77 +1,184 @@
 #include <WiFi.h>
 #include <WiFiAP.h>
-#include <WebSocketsServer.h>
 #include <ArduinoJson.h>
-#include <DHT.h>
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
-#include <EEPROM.h>
 #include <HTTPClient.h>
 #include <ESPAsyncWebServer.h>
 #include <AsyncTCP.h>
+#include <boards.h>
+#include "gas_sampler.h"
+#include "dht_reader.h"
+#include "telemetry.h"
+#include "rule_engine.h"
+#include "menu_logic.h"
+#include "sampling_logic.h"
+#include "gas_trend.h"
+#include "gas_ppm.h"
+#include "json_pool.h"
+#include "json_response.h"
+#include "commands.h"
+#include "lcd_buffer.h"
+#include "settings.h"
+#include "history.h"
+#include "web_assets.h"
+#include "mesh.h"
+#include "station.h"
+#include "metrics.h"
+#include "buttons.h"
+#include "event_log.h"
+#include "socket_hub.h"
+#include "discovery.h"
+#include "ota.h"
+#include "rule_store.h"
 
-// Pin definitions
-#define DHT_PIN 4        // DHT11 sensor connected to D4
-#define BUTTON1_PIN 26   // Button 1 connected to D26 (Mode)
-#define BUTTON2_PIN 27   // Button 2 connected to D27 (Up)
-#define BUTTON3_PIN 25   // Button 3 connected to D25 (Down)
-#define ALARM_PIN 23     // Alarm connected to D23
-#define SMOKE_SENSOR_PIN 33  // MQ gas sensor connected to D33
-#define RELAY_PIN 17     // Relay module connected to D17
+// Pin map (boards.h); outputs go straight to the GPIO registers
+#ifndef MONITOR_BOARD
+#define MONITOR_BOARD GasMonitorDevkitV1
+#endif
+using Board = MONITOR_BOARD;
+using RelayOut = Board::Relay;
+using AlarmOut = Board::Alarm;
+using SprinklerOut = Board::Sprinkler;
 
 // Constants
-#define EEPROM_SIZE 512
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "2.0.0"  // Reported by /api/status, mDNS and UDP discovery
+#endif
 #define AP_SSID_PREFIX "Smart Gas Monitor"
 #define AP_PASSWORD "12345678"  // Default password, will be changed during setup
-#define MAX_DEVICES 10
 #define LCD_COLS 16
 #define LCD_ROWS 4
 #define LCD_ADDR 0x27  // I2C address for LCD (may vary)
+#define LCD_I2C_FAST false  // 400 kHz I2C; most PCF8574 backpacks cope, check yours
+#ifndef MESH_AGGREGATOR
+#define MESH_AGGREGATOR false  // Build one monitor with -DMESH_AGGREGATOR=true to collect the others
+#endif
+#ifndef PREALARM_RELAY
+#define PREALARM_RELAY true  // In auto mode the pre-alarm already starts the exhaust fan
+#endif
+
+// Task layout: sensing/alarms own core 1, networking and UI share core 0 with the WiFi stack
+#define SENSOR_TASK_CORE 1
+#define NETWORK_TASK_CORE 0
+#define UI_TASK_CORE 0
+#define SENSOR_TASK_PRIORITY 5
+#define SAMPLER_TASK_PRIORITY 6
+#define DHT_TASK_PRIORITY 4
+#define NETWORK_TASK_PRIORITY 3
+#define UI_TASK_PRIORITY 1
+#define SENSOR_TASK_STACK 4096
+#define NETWORK_TASK_STACK 8192
+#define UI_TASK_STACK 4096
+#define CLIMATE_INTERVAL_MS 2000  // DHT11 needs 1 s between reads; the gas cadence adapts (sampling_logic.h)
+#define CONTROL_QUEUE_LENGTH 8
+#define COMMAND_JSON_POOL_SIZE 3072  // A full batch takes two variant pages (json_pool.h) and its strings
+#define API_JSON_POOL_SIZE 2048      // One page for /api/status, plus the copied strings
+#define RULES_JSON_POOL_SIZE 6144  // A full rule set takes three variant pages (json_pool.h) and its strings
+#define RULES_JSON_MAX 3072        // Largest POST /api/rules body
+#define BOOT_SPLASH_MS 2000  // "System Ready" stays on the LCD this long; nothing waits for it
+#define GAS_CALIBRATION_CHECKS 40  // Gas checks averaged for R0 (10 s at the fast interval)
 
 // DHT sensor
-#define DHTTYPE DHT11
-DHT dht(DHT_PIN, DHTTYPE);
+#define DHTTYPE DHT_TYPE_DHT11
+DhtReader dht(Board::dhtPin, DHTTYPE);
 
-// LCD Display
-LiquidCrystal_I2C lcd(LCD_ADDR, LCD_COLS, LCD_ROWS);
+// LCD Display, drawn through a framebuffer that only pushes changed cells
+LiquidCrystal_I2C lcdDevice(LCD_ADDR, LCD_COLS, LCD_ROWS);
+LcdBuffer lcd(lcdDevice, LCD_COLS, LCD_ROWS);
 
-// Web server and WebSocket
+// Web server; the WebSocket endpoint lives on it at /ws (socket_hub.h)
 AsyncWebServer server(80);
-WebSocketsServer webSocket = WebSocketsServer(81);
 
 // Variables
 float temperature = 0;
 float humidity = 0;
-float gasLevel = 0;
+float gasLevel = 0;   // ppm
+float gasRaw = 0;     // Filtered ADC level behind gasLevel
+bool climateValid = false;  // A DHT reading has come in; the climate rules wait for it
 bool alarmActive = false;
 bool relayState = false;
 bool autoMode = true;
-float gasThreshold = 500;  // Default gas threshold (adjust based on sensor)
+float gasThreshold = 1000;  // Default gas threshold in ppm (an MQ-2 reads LPG from 200 ppm)
 float tempThreshold = 35;  // Default temperature threshold in °C
 
-// Button states
-bool menuButtonState = false;
-bool button2State = false;
-bool button3State = false;
-bool menuButtonLastState = false;
-bool button2LastState = false;
-bool button3LastState = false;
-unsigned long lastButtonDebounceTime = 0;
-unsigned long debounceDelay = 50;
-
-// Menu system
-enum MenuState {
-  MAIN_SCREEN,
-  MENU_MAIN,
-  SET_TEMP_THRESHOLD,
-  SET_GAS_THRESHOLD,
-  WIFI_SETTINGS,
-  DEVICE_INFO
+// Actuator requests from networking/UI; only the sensing task drives AlarmOut and RelayOut
+enum ControlType {
+  CONTROL_SET_RELAY,
+  CONTROL_RESET_ALARM,
+  CONTROL_PUBLISH,
+  CONTROL_ALARM_TRIPPED,
+  CONTROL_CLIMATE_READY,
+  CONTROL_CALIBRATE
+};
+
+struct ControlMessage {
+  ControlType type;
+  bool value;
+};
+
+// Result of one DHT transaction, handed from the reader task to the sensing task
+struct ClimateReading {
+  float temperature;
+  float humidity;
+  bool ok;
+};
+
+// Task handles and queues
+TaskHandle_t sensorTaskHandle = NULL;
+TaskHandle_t networkTaskHandle = NULL;
+TaskHandle_t uiTaskHandle = NULL;
+QueueHandle_t controlQueue = NULL;    // networking/UI -> sensing
+QueueHandle_t telemetryQueue = NULL;  // sensing -> networking (latest snapshot only)
+QueueHandle_t displayQueue = NULL;    // sensing -> UI (latest snapshot only)
+QueueHandle_t climateQueue = NULL;    // DHT reader -> sensing (latest reading only)
+
+// Static JSON arenas: commands are parsed in the network task, API replies built in the AsyncTCP task
+JsonPool<COMMAND_JSON_POOL_SIZE> commandPool;
+JsonPool<API_JSON_POOL_SIZE> apiPool;
+JsonPool<RULES_JSON_POOL_SIZE> rulesPool;
+
+// Alarm/relay state is changed by both the fast gas path and the sensing task
+portMUX_TYPE alarmMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Alarm rules (rule_engine.h): gas conditions run on every sampler sample,
+// climate ones on every sensor cycle. The engine and the outputs it drives
+// are only touched under alarmMux.
+RuleEngine alarmRules;
+RuleSet ruleSet;                   // Source of the loaded program; swapped in with it under alarmMux
+uint8_t ruleActions = 0;           // Actions the outputs currently follow
+bool ruleRelay = false;            // The rules switched the relay on and may switch it off again
+bool sprinklerState = false;
+volatile uint32_t lastGasQ4 = 0;   // Latest sample, to prime a newly loaded program
+volatile uint8_t notifyRules = 0;  // Active rules with the notify action, for the network task
+
+// What one change of the rule actions did to the outputs
+struct RuleOutputs {
+  bool changed;     // Active rules changed
+  uint8_t raised;   // Actions that just started
+  uint8_t cleared;  // Actions that just ended
+  int8_t relay;     // -1 untouched, else the new relay state
 };
 
-MenuState currentMenu = MAIN_SCREEN;
-int menuPosition = 0;
-const int MAX_MENU_ITEMS = 4;
+// Buttons in event order: index i of Board::buttonPins reports as button i
+const MenuKey buttonKeys[] = {MENU_KEY_MODE, MENU_KEY_UP, MENU_KEY_DOWN};
+
+// ADC to ppm conversion and its clean-air calibration
+GasPpmConverter gasPpm;
+uint16_t calibrationLeft = 0;  // Gas checks still to average; 0 when idle
+float calibrationSum = 0;
+
+// Gas trend, and the sampling rate and pre-alarm that follow it
+GasTrend gasTrend;
+SamplingScheduler sampling;
+float gasSlope = 0;
+bool preAlarm = false;
+bool preAlarmRelay = false;  // The pre-alarm switched the relay on and may switch it off again
+float preAlarmLeadS = PREALARM_LEAD_S;
+uint32_t preAlarmCount = 0;
+
+// Menu system (state machine in menu_logic)
+MenuModel menu;
 
 // Network settings
 String apSSID;
@@ -82,58 +189,99 @@ bool apMode = true;
 bool configMode = false;
 String deviceID;
 
-// EEPROM addresses
-const int ADDR_AP_PASS = 0;
-const int ADDR_STATION_SSID = 32;
-const int ADDR_STATION_PASS = 64;
-const int ADDR_GAS_THRESHOLD = 128;
-const int ADDR_TEMP_THRESHOLD = 132;
-const int ADDR_AUTO_MODE = 136;
-
 // Function prototypes
-void handleWebSocketMessage(uint8_t num, WStype_t type, uint8_t * payload, size_t length);
-void sendSensorData();
-void updateLCD();
+void handleWebSocketMessage(uint8_t num, SocketEventType type, const uint8_t *payload, size_t length);
+void updateLCD(const SensorSnapshot &snapshot);
 void checkAlarms();
+RuleOutputs feedRules(RuleSensor sensor, int32_t valueQ4, int32_t thresholdQ4);
+RuleOutputs applyRuleActions();
+void logRuleOutputs(const RuleOutputs &out, EventCause cause, EventReset reset, uint16_t value);
+const char *loadRules(JsonArrayConst json);
+void triggerWaterSprinkler(bool val);
+uint8_t broadcastNotifyRules();
+uint16_t gasEventValue();
+void onGasSample(uint16_t median, uint32_t sampleTimeUs);
+void onClimateReading(float newTemperature, float newHumidity, bool ok);
+void completeSensorCycle(bool climate);
+void checkGasTrend();
+void updatePreAlarm(float secondsToThreshold);
+SensorSnapshot captureSnapshot();
+void publishSnapshot();
+bool requestControl(ControlType type, bool value);
+void dispatchCommand(uint8_t num, JsonObjectConst command);
+CommandHandler findCommand(const char *name);
+const char *cmdGetStatus(uint8_t num, JsonObjectConst command);
+const char *cmdGetDevices(uint8_t num, JsonObjectConst command);
+const char *cmdSubscribe(uint8_t num, JsonObjectConst command);
+const char *cmdSetRelay(uint8_t num, JsonObjectConst command);
+const char *cmdSetAutoMode(uint8_t num, JsonObjectConst command);
+const char *cmdSetThresholds(uint8_t num, JsonObjectConst command);
+const char *cmdSetSampling(uint8_t num, JsonObjectConst command);
+const char *cmdCalibrate(uint8_t num, JsonObjectConst command);
+const char *cmdReset(uint8_t num, JsonObjectConst command);
+void startSensing();
+void startNetwork();
+void sensorTask(void *parameter);
+void networkTask(void *parameter);
+void uiTask(void *parameter);
 void saveSettings();
 void loadSettings();
 void setupAccessPoint();
 void setupStation();
 void handleButtons();
+void handleMenuKey(MenuKey key);
 void navigateMenu();
+bool renderMetrics(uint16_t block, MetricsWriter &out);
 
 void setup() {
-  // Initialize Serial communication
+  // Stage 1, safety first: outputs in a known state, then the thresholds and
+  // the sensing/alarm path. Nothing here waits on the radio or the LCD.
   Serial.begin(115200);
   Serial.println("Starting Smart Gas and Temperature Monitor System");
   
-  // Initialize pins
-  pinMode(BUTTON1_PIN, INPUT_PULLUP);
-  pinMode(BUTTON2_PIN, INPUT_PULLUP);
-  pinMode(BUTTON3_PIN, INPUT_PULLUP);
-  pinMode(ALARM_PIN, OUTPUT);
-  pinMode(RELAY_PIN, OUTPUT);
-  pinMode(SMOKE_SENSOR_PIN, INPUT);
-  
-  digitalWrite(ALARM_PIN, LOW);
-  digitalWrite(RELAY_PIN, LOW);
-  
-  // Initialize EEPROM
-  EEPROM.begin(EEPROM_SIZE);
+  AlarmOut::begin(false);
+  RelayOut::begin(false);
+  if (Board::hasSprinkler) {
+    SprinklerOut::begin(false);
+  }
+  pinMode(Board::gasAdcPin, INPUT);
+
+  // Kept in RAM until the journal is opened in stage 2
+  events.log(EVENT_BOOT, esp_reset_reason(), 0);
   
-  // Load settings from EEPROM
+  // Load settings from NVS
   loadSettings();
+
+  // A freshly updated image counts this boot against its trial
+  ota.begin();
+
+  // Alarm rules from NVS, or the two threshold rules
+  AlarmProgram program;
+  ruleStore.begin(ruleSet, program);
+  alarmRules.load(program);
+
+  // Sensor history rings
+  history.begin();
+
+  startSensing();
+  metrics.bootSensingUs = esp_timer_get_time();
+
+  // Stage 2 runs on the Arduino loop task, the lowest priority on the sensing
+  // core, so the sampler and the sensing task preempt all of it.
+
+  // Buttons are captured by interrupt from here on; events wait for the UI task
+  buttons.begin(Board::buttonPins, Board::buttonCount);
   
   // Initialize LCD
   Wire.begin();
-  lcd.init();
-  lcd.backlight();
+  lcd.begin(LCD_I2C_FAST);
   lcd.clear();
   lcd.setCursor(0, 0);
   lcd.print("Initializing...");
-  
-  // Initialize DHT sensor
-  dht.begin();
+  lcd.flush();
+
+  // Event journal; mounting formats LittleFS on the very first boot
+  events.begin();
   
   // Generate unique device ID based on MAC address
   uint8_t mac[6];
@@ -144,87 +292,177 @@ void setup() {
   
   apSSID = AP_SSID_PREFIX;
   
-  // // Setup network
-  // if (stationSSID.length() > 0) {
-  //   setupStation();
-  //   setupAccessPoint();
-  //   // If station connection fails, fall back to AP mode
-  //   if (WiFi.status() != WL_CONNECTED) {
-  //     setupAccessPoint();
-  //   }
-  // } else {
-    
-  // }
+  // Setup network; the station uplink, when selected, joins in the background
+  station.begin();
   setupAccessPoint();
   
-  // Setup WebSocket server
-  webSocket.begin();
-  webSocket.onEvent(handleWebSocketMessage);
+  // Setup WebSocket endpoint
+  sockets.begin(server, handleWebSocketMessage);
+  telemetry.begin(sockets, deviceID);
+  commandAcks.begin(sockets);
+  mesh.begin(sockets, MESH_AGGREGATOR);
+  discovery.begin(deviceID, FIRMWARE_VERSION, MESH_AGGREGATOR);
   
   // Setup HTTP server routes
+  // Static page from flash; it fetches /api/status for the live values
   server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
-    String html = "<html><head>";
-    html += "<title>Smart Gas Monitor</title>";
-    html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
-    html += "<style>body{font-family:Arial;text-align:center;margin:0;padding:20px;}</style>";
-    html += "</head><body>";
-    html += "<h1>Smart Gas and Temperature Monitor</h1>";
-    html += "<p>Use the mobile app for full functionality.</p>";
-    html += "<p>Device ID: " + deviceID + "</p>";
-    html += "<p>IP Address: " + WiFi.localIP().toString() + "</p>";
-    html += "</body></html>";
-    request->send(200, "text/html", html);
+    AsyncWebServerResponse *response;
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == WEB_INDEX_HTML_ETAG) {
+      response = request->beginResponse(304);
+    } else {
+      response = request->beginResponse_P(200, "text/html", WEB_INDEX_HTML_GZ, WEB_INDEX_HTML_LEN);
+      response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", WEB_INDEX_HTML_ETAG);
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
   });
   
   server.on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request) {
-    DynamicJsonDocument doc(1024);
+    JsonDocument doc(&apiPool);
     doc["temperature"] = temperature;
     doc["humidity"] = humidity;
     doc["gasLevel"] = gasLevel;
+    doc["gasRaw"] = gasRaw;
+    doc["gasR0"] = gasPpm.r0();
+    doc["calibrated"] = gasPpm.calibrated();
+    doc["calibrating"] = calibrationLeft > 0;
     doc["alarmActive"] = alarmActive;
+    doc["preAlarm"] = preAlarm;
     doc["relayState"] = relayState;
+    if (Board::hasSprinkler) {
+      doc["sprinkler"] = sprinklerState;
+    }
     doc["autoMode"] = autoMode;
     doc["gasThreshold"] = gasThreshold;
     doc["tempThreshold"] = tempThreshold;
-    doc["deviceID"] = deviceID;
-    
-    String response;
-    serializeJson(doc, response);
-    request->send(200, "application/json", response);
+    doc["deviceID"] = deviceID.c_str();
+    doc["firmware"] = FIRMWARE_VERSION;
+
+    JsonArray active = doc["activeRules"].to<JsonArray>();
+    uint8_t rules = alarmRules.activeRules();
+    for (uint8_t r = 0; r < ruleSet.ruleCount; r++) {
+      if (rules & (1 << r)) active.add(ruleSet.rules[r].name);
+    }
+
+    JsonObject rate = doc["sampling"].to<JsonObject>();
+    rate["mode"] = sampling.fast() ? "fast" : "slow";
+    rate["intervalMs"] = sampling.intervalMs();
+    rate["gasSlope"] = gasSlope;
+
+    static const char *const stationStates[] = {"idle", "connecting", "connected", "backoff"};
+    JsonObject sta = doc["station"].to<JsonObject>();
+    sta["state"] = stationStates[station.state()];
+    sta["attempts"] = station.attempts();
+    sta["lastReason"] = station.lastReason();
+    if (station.state() == STATION_CONNECTED) {
+      sta["ip"] = WiFi.localIP().toString();
+    }
+
+    // Heap health, to confirm fragmentation has stopped
+    doc["freeHeap"] = ESP.getFreeHeap();
+    doc["largestFreeBlock"] = ESP.getMaxAllocHeap();
+    doc["minFreeHeap"] = ESP.getMinFreeHeap();
+
+    request->send(new JsonBufferResponse(doc));
+  });
+  
+  server.on("/api/history", HTTP_GET, [](AsyncWebServerRequest *request) {
+    history.handleRequest(request);
+  });
+  
+  server.on("/api/events", HTTP_GET, [](AsyncWebServerRequest *request) {
+    events.handleRequest(request);
+  });
+  
+  // Prometheus scrape target; rendered block by block, nothing is collected here
+  server.on("/api/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+    AsyncWebServerResponse *response = new MetricsResponse(renderMetrics, request->version() > 0);
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
   });
   
   server.on("/api/control", HTTP_POST, [](AsyncWebServerRequest *request) {
     if (request->hasParam("relay", true)) {
       String value = request->getParam("relay", true)->value();
-      relayState = (value == "1" || value == "true" || value == "on");
-      digitalWrite(RELAY_PIN, relayState ? HIGH : LOW);
+      requestControl(CONTROL_SET_RELAY, value == "1" || value == "true" || value == "on");
     }
     
     if (request->hasParam("auto", true)) {
       String value = request->getParam("auto", true)->value();
       autoMode = (value == "1" || value == "true" || value == "on");
-      EEPROM.write(ADDR_AUTO_MODE, autoMode);
-      EEPROM.commit();
     }
     
     if (request->hasParam("gasThreshold", true)) {
       gasThreshold = request->getParam("gasThreshold", true)->value().toFloat();
-      EEPROM.writeFloat(ADDR_GAS_THRESHOLD, gasThreshold);
-      EEPROM.commit();
     }
     
     if (request->hasParam("tempThreshold", true)) {
       tempThreshold = request->getParam("tempThreshold", true)->value().toFloat();
-      EEPROM.writeFloat(ADDR_TEMP_THRESHOLD, tempThreshold);
-      EEPROM.commit();
     }
     
+    // Staged only; the settings store commits once the changes settle
+    saveSettings();
+    requestControl(CONTROL_PUBLISH, true);
     request->send(200, "application/json", "{\"status\":\"ok\"}");
   });
   
+  // Alarm rules (rule_engine.h); POST takes the array GET returns, or {"rules": [...]}
+  server.on("/api/rules", HTTP_GET, [](AsyncWebServerRequest *request) {
+    JsonDocument doc(&rulesPool);
+    writeRules(doc["rules"].to<JsonArray>(), ruleSet);
+    AsyncResponseStream *response = request->beginResponseStream("application/json", measureJson(doc));
+    serializeJson(doc, *response);
+    request->send(response);
+  });
+
+  server.on("/api/rules", HTTP_POST,
+    [](AsyncWebServerRequest *request) {
+      const char *body = (const char *)request->_tempObject;
+      if (body == NULL) {
+        request->send(request->contentLength() > RULES_JSON_MAX ? 413 : 400, "application/json",
+                      "{\"error\":\"rules must be a JSON body\"}");
+        return;
+      }
+
+      const char *error;
+      {
+        JsonDocument doc(&rulesPool);
+        DeserializationError parsed = deserializeJson(doc, body, request->contentLength());
+        JsonArrayConst rules = doc.is<JsonArrayConst>() ? doc.as<JsonArrayConst>() : doc["rules"].as<JsonArrayConst>();
+        error = parsed ? parsed.c_str() : loadRules(rules);
+      }
+
+      JsonDocument reply(&apiPool);
+      if (error) {
+        reply["error"] = error;
+      } else {
+        reply["status"] = "ok";
+        reply["rules"] = ruleSet.ruleCount;
+      }
+      request->send(new JsonBufferResponse(reply, error ? 400 : 200));
+    },
+    NULL,
+    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+      // The whole body is needed before parsing; the request frees _tempObject
+      if (total > RULES_JSON_MAX) return;
+      if (index == 0) {
+        request->_tempObject = malloc(total + 1);
+      }
+      char *body = (char *)request->_tempObject;
+      if (body == NULL || index + len > total) return;
+      memcpy(body + index, data, len);
+      body[index + len] = '\0';
+    });
+  
+  // Firmware upload; chunks stream into the inactive app partition
+  ota.addRoutes(server);
+  
   server.begin();
+  startNetwork();
+  metrics.bootNetworkUs = esp_timer_get_time();
   
-  // Display ready message
+  // Display ready message; the UI task takes over once BOOT_SPLASH_MS has passed
   lcd.clear();
   lcd.setCursor(0, 0);
   lcd.print("System Ready");
@@ -234,270 +472,774 @@ void setup() {
   } else {
     lcd.print("WiFi: Connected");
   }
-  delay(2000);
+  lcd.flush();
+
+  xTaskCreatePinnedToCore(uiTask, "ui", UI_TASK_STACK, NULL,
+                          UI_TASK_PRIORITY, &uiTaskHandle, UI_TASK_CORE);
+  metrics.bootUiUs = esp_timer_get_time();
+
+  Serial.printf("Boot: sensing %u ms, first gas sample %u ms, network %u ms, UI %u ms\n",
+                metrics.bootSensingUs / 1000, metrics.bootFirstSampleUs / 1000,
+                metrics.bootNetworkUs / 1000, metrics.bootUiUs / 1000);
 }
 
 void loop() {
-  // Handle WebSocket communications
-  webSocket.loop();
-  
-  // Read sensors (every 2 seconds)
-  static unsigned long lastSensorRead = 0;
-  if (millis() - lastSensorRead > 2000) {
-    lastSensorRead = millis();
-    
-    // Read temperature and humidity
-    float newTemperature = dht.readTemperature();
-    float newHumidity = dht.readHumidity();
-    
-    // Only update if readings are valid
-    if (!isnan(newTemperature) && !isnan(newHumidity)) {
-      temperature = newTemperature;
-      humidity = newHumidity;
+  // All work runs in the pinned tasks; the Arduino loop task is not needed
+  vTaskDelete(NULL);
+}
+
+// Queues first, so the sampler's alarm path can post from its first sample;
+// the snapshot queues just hold the latest state until networking and UI start
+void startSensing() {
+  controlQueue = xQueueCreate(CONTROL_QUEUE_LENGTH, sizeof(ControlMessage));
+  telemetryQueue = xQueueCreate(1, sizeof(SensorSnapshot));
+  displayQueue = xQueueCreate(1, sizeof(SensorSnapshot));
+  climateQueue = xQueueCreate(1, sizeof(ClimateReading));
+
+  // Continuous gas sampling on the sensing core, with the fast alarm path on every sample
+  gasSampler.onSample(onGasSample);
+  gasSampler.begin(Board::gasAdcPin, SENSOR_TASK_CORE, SAMPLER_TASK_PRIORITY);
+
+  // DHT readings arrive through onClimateReading()
+  dht.onReading(onClimateReading);
+  dht.begin(SENSOR_TASK_CORE, DHT_TASK_PRIORITY);
+
+  xTaskCreatePinnedToCore(sensorTask, "sensor", SENSOR_TASK_STACK, NULL,
+                          SENSOR_TASK_PRIORITY, &sensorTaskHandle, SENSOR_TASK_CORE);
+}
+
+void startNetwork() {
+  xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK, NULL,
+                          NETWORK_TASK_PRIORITY, &networkTaskHandle, NETWORK_TASK_CORE);
+}
+
+// Sensing and alarm task: the only writer of the sensor state and the actuator pins
+void sensorTask(void *parameter) {
+  TickType_t lastCheck = xTaskGetTickCount() - pdMS_TO_TICKS(sampling.config.fastMs);
+  TickType_t lastCycle = xTaskGetTickCount() - pdMS_TO_TICKS(SAMPLING_MAX_INTERVAL_MS);
+  TickType_t lastClimate = xTaskGetTickCount() - pdMS_TO_TICKS(CLIMATE_INTERVAL_MS);
+
+  for (;;) {
+    // Wait for a control request until the next gas check is due
+    TickType_t elapsed = xTaskGetTickCount() - lastCheck;
+    TickType_t interval = pdMS_TO_TICKS(sampling.config.fastMs);
+    TickType_t wait = elapsed >= interval ? 0 : interval - elapsed;
+
+    ControlMessage control;
+    bool received = xQueueReceive(controlQueue, &control, wait) == pdTRUE;
+    MetricsTimer busy(metrics.sensorLoop);
+
+    if (received) {
+      switch (control.type) {
+        case CONTROL_SET_RELAY:
+          preAlarmRelay = false;  // An explicit choice is never undone by the pre-alarm or the rules
+          ruleRelay = false;
+          if (relayState != control.value) {
+            events.log(EVENT_RELAY, (control.value ? EVENT_RELAY_ON : 0) | EVENT_SOURCE_COMMAND << 4, gasEventValue());
+          }
+          relayState = control.value;
+          RelayOut::write(relayState);
+          break;
+        case CONTROL_RESET_ALARM:
+          {
+            // Drops the latched rules; rules still met keep their actions
+            portENTER_CRITICAL(&alarmMux);
+            RuleOutputs out = {};
+            out.relay = -1;
+            if (alarmRules.reset()) {
+              out = applyRuleActions();
+              out.changed = true;
+            }
+            portEXIT_CRITICAL(&alarmMux);
+            logRuleOutputs(out, EVENT_CAUSE_GAS, EVENT_RESET_MANUAL, gasEventValue());
+            if (alarmActive) {
+              Serial.println("Alarm reset: its rules are still met");
+            }
+          }
+          break;
+        case CONTROL_PUBLISH:
+          break;
+        case CONTROL_ALARM_TRIPPED:
+          // Peers hear about it before the WebSocket clients do
+          mesh.sendNow(captureSnapshot());
+          Serial.printf("Gas alarm tripped, output latency %u us (max %u us)\n",
+                        metrics.alarmTrip.lastUs(), metrics.alarmTrip.maxUs());
+          break;
+        case CONTROL_CLIMATE_READY:
+          {
+            ClimateReading reading;
+            if (xQueueReceive(climateQueue, &reading, 0) == pdTRUE && reading.ok) {
+              temperature = reading.temperature;
+              humidity = reading.humidity;
+              climateValid = true;
+              gasPpm.setClimate(temperature, humidity);
+            }
+            completeSensorCycle(true);
+          }
+          continue;
+        case CONTROL_CALIBRATE:
+          calibrationSum = 0;
+          calibrationLeft = GAS_CALIBRATION_CHECKS;
+          Serial.println("Gas calibration started, keep the sensor in clean air");
+          break;
+      }
+      publishSnapshot();
+      continue;
+    }
+
+    lastCheck = xTaskGetTickCount();
+
+    // Steady air only gets a full cycle every slow interval
+    checkGasTrend();
+    if (!sampling.fast() && lastCheck - lastCycle < pdMS_TO_TICKS(sampling.config.slowMs)) {
+      continue;
+    }
+    lastCycle = lastCheck;
+
+    // Start a temperature/humidity conversion when one is due; that cycle completes
+    // when it reports back. Fast cycles in between only refresh the gas level.
+    if (lastCycle - lastClimate >= pdMS_TO_TICKS(CLIMATE_INTERVAL_MS) && dht.start()) {
+      lastClimate = lastCycle;
+    } else {
+      completeSensorCycle(false);
     }
-    
-    // Read gas sensor
-    gasLevel = analogRead(SMOKE_SENSOR_PIN);
-    
-    // Check alarm conditions
-    checkAlarms();
-    
-    // Update LCD
-    updateLCD();
-    
-    // Send updated data to connected clients
-    sendSensorData();
   }
-  
-  // Handle button presses for menu navigation
-  handleButtons();
 }
 
-void handleWebSocketMessage(uint8_t num, WStype_t type, uint8_t * payload, size_t length) {
+// Feeds the gas trend, then adapts the sampling rate and the pre-alarm to it
+void checkGasTrend() {
+  uint32_t now = millis();
+  float raw = gasSampler.read();
+  if (calibrationLeft > 0) {
+    calibrationSum += raw;
+    if (--calibrationLeft == 0) {
+      gasPpm.calibrate(calibrationSum / GAS_CALIBRATION_CHECKS);
+      saveSettings();
+      events.log(EVENT_CALIBRATION, 0, (uint16_t)constrain(lroundf(gasPpm.r0() * 1000), 0L, 65535L));
+      Serial.printf("Gas calibration done, R0 = %.3f RL\n", gasPpm.r0());
+    }
+  }
+  gasTrend.add(gasPpm.toPpm(raw), now);
+  gasSlope = gasTrend.slope();
+
+  if (sampling.update(gasTrend.level(), gasSlope, gasThreshold, now)) {
+    // Clients and the LCD follow the cycle rate: every cycle publishes, and no
+    // client's rate limit holds a fast cycle back
+    telemetry.setIntervalCap(sampling.fast() ? sampling.config.fastMs : 0);
+    Serial.printf("Sampling %s, every %u ms (slope %.1f/s)\n",
+                  sampling.fast() ? "fast" : "slow", sampling.intervalMs(), gasSlope);
+  }
+
+  updatePreAlarm(gasTrend.secondsTo(gasThreshold));
+}
+
+// Raises or clears the pre-alarm; in auto mode it also runs the exhaust relay ahead of the alarm
+void updatePreAlarm(float secondsToThreshold) {
+  bool active = preAlarmUpdate(preAlarm, secondsToThreshold, preAlarmLeadS, alarmActive);
+  if (active == preAlarm) return;
+  preAlarm = active;
+  bool switched = false;
+
+  portENTER_CRITICAL(&alarmMux);
+  if (active) {
+    if (PREALARM_RELAY && autoMode && !relayState) {
+      relayState = true;
+      RelayOut::on();
+      preAlarmRelay = true;
+      switched = true;
+    }
+  } else {
+    // Rules that run the exhaust keep the relay they need
+    if (preAlarmRelay && !(ruleActions & RULE_ACTION_EXHAUST)) {
+      relayState = false;
+      RelayOut::off();
+      switched = true;
+    }
+    preAlarmRelay = false;
+  }
+  portEXIT_CRITICAL(&alarmMux);
+
+  events.log(EVENT_PREALARM, active ? 1 : 0, gasEventValue());
+  if (switched) {
+    events.log(EVENT_RELAY, (active ? EVENT_RELAY_ON : 0) | EVENT_SOURCE_PREALARM << 4, gasEventValue());
+  }
+
+  if (active) {
+    preAlarmCount++;
+    Serial.printf("Gas pre-alarm: threshold in %.0f s at %.1f/s\n", secondsToThreshold, gasSlope);
+  }
+  publishSnapshot();
+}
+
+// Second half of a sensor cycle, once the DHT transaction (if any) has finished
+void completeSensorCycle(bool climate) {
+  // Latest filtered gas reading from the continuous sampler
+  gasRaw = gasSampler.read();
+  gasLevel = gasPpm.toPpm(gasRaw);
+
+  // Check alarm conditions
+  checkAlarms();
+
+  // The history keeps the climate cadence, so fast cycles do not shorten what it covers
+  if (climate) {
+    history.add(temperature, humidity, gasLevel);
+  }
+
+  // Hand the new readings to the LCD and the connected clients
+  publishSnapshot();
+}
+
+// DHT completion callback, runs in the reader task
+void onClimateReading(float newTemperature, float newHumidity, bool ok) {
+  metrics.dhtRead.observe(dht.lastTransactionUs());
+
+  ClimateReading reading = { newTemperature, newHumidity, ok && !isnan(newTemperature) && !isnan(newHumidity) };
+  xQueueOverwrite(climateQueue, &reading);
+  requestControl(CONTROL_CLIMATE_READY, reading.ok);
+}
+
+// Networking task: services the WebSocket server and pushes changes to the clients
+void networkTask(void *parameter) {
+  SensorSnapshot snapshot = captureSnapshot();
+  uint8_t notified = 0;
+
+  for (;;) {
+    bool fresh = xQueueReceive(telemetryQueue, &snapshot, pdMS_TO_TICKS(5)) == pdTRUE;
+    MetricsTimer busy(metrics.networkLoop);
+
+    sockets.poll();
+
+    if (fresh) {
+      telemetry.publish(snapshot);
+    }
+
+    // Deltas held back by a client's rate limit
+    telemetry.poll();
+
+    // Rules with the notify action, whenever that set changes
+    if (notifyRules != notified) {
+      notified = broadcastNotifyRules();
+    }
+
+    // ESP-NOW cadence broadcast and, on the aggregator, the device table
+    mesh.publish(snapshot);
+    mesh.poll();
+
+    // Station join retries; never waits on the radio
+    station.poll();
+
+    // App discovery broadcasts
+    discovery.poll();
+  }
+}
+
+// UI task: button handling and LCD refresh
+void uiTask(void *parameter) {
+  SensorSnapshot snapshot;
+  uint32_t stationChanges = station.changes();
+  TickType_t splashStart = xTaskGetTickCount();
+  bool splash = true;
+
+  for (;;) {
+    bool fresh = xQueueReceive(displayQueue, &snapshot, pdMS_TO_TICKS(10)) == pdTRUE;
+    MetricsTimer busy(metrics.uiLoop);
+
+    // The boot splash gives way to the readings, or to the menu on a key press
+    if (splash && xTaskGetTickCount() - splashStart >= pdMS_TO_TICKS(BOOT_SPLASH_MS)) {
+      splash = false;
+      snapshot = captureSnapshot();
+      fresh = true;
+    }
+
+    // Handle button presses for menu navigation
+    handleButtons();
+    if (menu.screen != MAIN_SCREEN) {
+      splash = false;
+    }
+
+    // Station progress shows up on the WiFi and device info screens as it happens
+    if (station.changes() != stationChanges) {
+      stationChanges = station.changes();
+      if (menu.screen == WIFI_SETTINGS || menu.screen == DEVICE_INFO) {
+        navigateMenu();
+      }
+    }
+
+    if (fresh && !splash) {
+      updateLCD(snapshot);
+    }
+
+    // Deferred settings commit and event journal batches; flash writes stall both cores briefly, so keep them here
+    settings.poll();
+    ruleStore.poll();
+    events.poll();
+
+    // A new image is confirmed by its first gas sample through the alarm path;
+    // a verified upload restarts once staged settings and its event are on flash
+    ota.poll(metrics.bootFirstSampleUs != 0);
+    if (ota.restartDue()) {
+      settings.commitNow();
+      ruleStore.poll();
+      events.poll();
+      ESP.restart();
+    }
+  }
+}
+
+// Gas level as logged with journal events
+uint16_t gasEventValue() {
+  return (uint16_t)constrain(lroundf(gasLevel), 0L, 65535L);
+}
+
+SensorSnapshot captureSnapshot() {
+  SensorSnapshot snapshot;
+  snapshot.temperature = temperature;
+  snapshot.humidity = humidity;
+  snapshot.gasLevel = gasLevel;
+  snapshot.alarmActive = alarmActive;
+  snapshot.relayState = relayState;
+  snapshot.autoMode = autoMode;
+  snapshot.gasThreshold = gasThreshold;
+  snapshot.tempThreshold = tempThreshold;
+  snapshot.preAlarm = preAlarm;
+  return snapshot;
+}
+
+// Replace whatever the consumers have not picked up yet with the latest state
+void publishSnapshot() {
+  SensorSnapshot snapshot = captureSnapshot();
+  xQueueOverwrite(telemetryQueue, &snapshot);
+  xQueueOverwrite(displayQueue, &snapshot);
+}
+
+// Queue an actuator change for the sensing task; never blocks the caller
+bool requestControl(ControlType type, bool value) {
+  ControlMessage control = { type, value };
+  if (xQueueSend(controlQueue, &control, 0) != pdTRUE) {
+    Serial.println("Control queue full, request dropped");
+    return false;
+  }
+  return true;
+}
+
+void handleWebSocketMessage(uint8_t num, SocketEventType type, const uint8_t *payload, size_t length) {
   switch(type) {
-    case WStype_DISCONNECTED:
-      Serial.printf("[%u] Disconnected!\n", num);
+    case SOCKET_DISCONNECTED:
+      metrics.webSocketDisconnects++;
+      telemetry.clientDisconnected(num);
       break;
-    case WStype_CONNECTED:
-      {
-        IPAddress ip = webSocket.remoteIP(num);
-        Serial.printf("[%u] Connected from %d.%d.%d.%d\n", num, ip[0], ip[1], ip[2], ip[3]);
-        
-        // Send current status to newly connected client
-        sendSensorData();
-      }
+    case SOCKET_CONNECTED:
+      // Send full status to newly connected client, deltas after that
+      metrics.webSocketConnects++;
+      telemetry.clientConnected(num, captureSnapshot());
       break;
-    case WStype_TEXT:
+    case SOCKET_TEXT:
       {
-        String message = String((char*)payload);
-        Serial.printf("[%u] Received text: %s\n", num, message.c_str());
-        
-        DynamicJsonDocument doc(1024);
-        DeserializationError error = deserializeJson(doc, message);
-        
-        if (!error) {
-          if (doc.containsKey("command")) {
-            String command = doc["command"];
-            
-            if (command == "getStatus") {
-              sendSensorData();
-            }
-            else if (command == "setRelay") {
-              if (doc.containsKey("state")) {
-                relayState = doc["state"];
-                digitalWrite(RELAY_PIN, relayState ? HIGH : LOW);
-                sendSensorData();
-              }
-            }
-            else if (command == "setAutoMode") {
-              if (doc.containsKey("state")) {
-                autoMode = doc["state"];
-                EEPROM.write(ADDR_AUTO_MODE, autoMode);
-                EEPROM.commit();
-                sendSensorData();
-              }
-            }
-            else if (command == "setThresholds") {
-              if (doc.containsKey("gas")) {
-                gasThreshold = doc["gas"];
-                EEPROM.writeFloat(ADDR_GAS_THRESHOLD, gasThreshold);
-              }
-              if (doc.containsKey("temp")) {
-                tempThreshold = doc["temp"];
-                EEPROM.writeFloat(ADDR_TEMP_THRESHOLD, tempThreshold);
-              }
-              EEPROM.commit();
-              sendSensorData();
-            }
-            else if (command == "reset") {
-              if (doc.containsKey("alarm") && doc["alarm"]) {
-                alarmActive = false;
-                digitalWrite(ALARM_PIN, LOW);
-                sendSensorData();
-              }
-            }
+        // Parse straight from the frame buffer into the static arena
+        JsonDocument doc(&commandPool);
+        DeserializationError error = deserializeJson(doc, (const char *)payload, length);
+        if (error) {
+          metrics.webSocketBadFrames++;
+          Serial.printf("[%u] Bad command frame: %s\n", num, error.c_str());
+          break;
+        }
+
+        // A frame holds one command object or a batch of them
+        commandAcks.reset();
+        if (doc.is<JsonArrayConst>()) {
+          for (JsonObjectConst command : doc.as<JsonArrayConst>()) {
+            dispatchCommand(num, command);
           }
+        } else {
+          dispatchCommand(num, doc.as<JsonObjectConst>());
         }
+        commandAcks.send(num);
       }
       break;
   }
 }
 
-void sendSensorData() {
-  DynamicJsonDocument doc(1024);
-  doc["deviceID"] = deviceID;
-  doc["temperature"] = temperature;
-  doc["humidity"] = humidity;
-  doc["gasLevel"] = gasLevel;
-  doc["alarmActive"] = alarmActive;
-  doc["relayState"] = relayState;
-  doc["autoMode"] = autoMode;
-  doc["gasThreshold"] = gasThreshold;
-  doc["tempThreshold"] = tempThreshold;   
-  
-  String message;
-  serializeJson(doc, message);
-  webSocket.broadcastTXT(message);
+void dispatchCommand(uint8_t num, JsonObjectConst command) {
+  const char *name = command["command"] | "";
+  CommandHandler handler = findCommand(name);
+  const char *error = handler ? handler(num, command) : "unknown command";
+  commandAcks.add(command["id"], error);
 }
 
-void updateLCD() {
-  if (currentMenu == MAIN_SCREEN) {
+// Registered WebSocket commands
+CommandHandler findCommand(const char *name) {
+  const char *expected = NULL;
+  CommandHandler handler = NULL;
+
+  switch (commandHash(name)) {
+    COMMAND("getStatus", cmdGetStatus)
+    COMMAND("getDevices", cmdGetDevices)
+    COMMAND("subscribe", cmdSubscribe)
+    COMMAND("setRelay", cmdSetRelay)
+    COMMAND("setAutoMode", cmdSetAutoMode)
+    COMMAND("setThresholds", cmdSetThresholds)
+    COMMAND("setSampling", cmdSetSampling)
+    COMMAND("calibrate", cmdCalibrate)
+    COMMAND("reset", cmdReset)
+  }
+
+  return (expected != NULL && strcmp(name, expected) == 0) ? handler : NULL;
+}
+
+const char *cmdGetStatus(uint8_t num, JsonObjectConst command) {
+  telemetry.sendSnapshot(num, captureSnapshot());
+  return NULL;
+}
+
+const char *cmdGetDevices(uint8_t num, JsonObjectConst command) {
+  if (!mesh.aggregator()) {
+    return "not an aggregator";
+  }
+  mesh.sendDevices(num);
+  return NULL;
+}
+
+const char *cmdSubscribe(uint8_t num, JsonObjectConst command) {
+  telemetry.subscribe(num, command);
+  telemetry.sendSnapshot(num, captureSnapshot());
+  return NULL;
+}
+
+const char *cmdSetRelay(uint8_t num, JsonObjectConst command) {
+  if (!command["state"].is<bool>()) return "missing state";
+
+  // The sensing task applies it and publishes the new state
+  return requestControl(CONTROL_SET_RELAY, command["state"]) ? NULL : "busy";
+}
+
+const char *cmdSetAutoMode(uint8_t num, JsonObjectConst command) {
+  if (!command["state"].is<bool>()) return "missing state";
+
+  autoMode = command["state"];
+  saveSettings();
+  telemetry.publish(captureSnapshot());
+  return NULL;
+}
+
+const char *cmdSetThresholds(uint8_t num, JsonObjectConst command) {
+  if (command["gas"].is<float>()) {
+    gasThreshold = command["gas"];
+  }
+  if (command["temp"].is<float>()) {
+    tempThreshold = command["temp"];
+  }
+  if (command["preAlarmLead"].is<float>()) {
+    preAlarmLeadS = command["preAlarmLead"];  // Seconds; 0 disables it. Runtime only
+  }
+  saveSettings();
+  telemetry.publish(captureSnapshot());
+  return NULL;
+}
+
+// {"command":"setSampling","slowMs":..,"fastMs":..,"slope":..,"margin":..,"holdMs":..}; runtime only
+const char *cmdSetSampling(uint8_t num, JsonObjectConst command) {
+  SamplingConfig config = sampling.config;
+  if (command["slowMs"].is<uint32_t>()) config.slowMs = command["slowMs"];
+  if (command["fastMs"].is<uint32_t>()) config.fastMs = command["fastMs"];
+  if (command["slope"].is<float>()) config.slopeBound = command["slope"];
+  if (command["margin"].is<float>()) config.marginBound = command["margin"];
+  if (command["holdMs"].is<uint32_t>()) config.holdMs = command["holdMs"];
+
+  if (config.fastMs < SAMPLING_MIN_INTERVAL_MS || config.slowMs > SAMPLING_MAX_INTERVAL_MS ||
+      config.fastMs > config.slowMs) {
+    return "bad interval";
+  }
+  sampling.config = config;
+  if (sampling.fast()) {
+    telemetry.setIntervalCap(config.fastMs);
+  }
+  return NULL;
+}
+
+// {"command":"calibrate"}: the sensor must sit in clean air until "calibrated" turns true
+const char *cmdCalibrate(uint8_t num, JsonObjectConst command) {
+  return requestControl(CONTROL_CALIBRATE, true) ? NULL : "busy";
+}
+
+const char *cmdReset(uint8_t num, JsonObjectConst command) {
+  if (!command["alarm"].as<bool>()) return NULL;
+  return requestControl(CONTROL_RESET_ALARM, true) ? NULL : "busy";
+}
+
+void updateLCD(const SensorSnapshot &snapshot) {
+  if (menu.screen == MAIN_SCREEN) {
+    MetricsTimer timer(metrics.lcdUpdate);
     lcd.clear();
     lcd.setCursor(0, 0);
     lcd.print("Temp: ");
-    lcd.print(temperature, 1);
+    lcd.print(snapshot.temperature, 1);
     lcd.print((char)223);
     lcd.print("C");
     
     lcd.setCursor(0, 1);
     lcd.print("Humidity: ");
-    lcd.print(humidity, 1);
+    lcd.print(snapshot.humidity, 1);
     lcd.print("%");
     
     lcd.setCursor(0, 2);
-    lcd.print("Gas Level: ");
-    lcd.print(gasLevel, 0);
+    lcd.print("Gas: ");
+    lcd.print(snapshot.gasLevel, 0);
+    lcd.print(" ppm");
     
     lcd.setCursor(0, 3);
-    if (alarmActive) {
+    if (snapshot.alarmActive) {
       lcd.print("ALARM ACTIVE!");
     } else {
       lcd.print("Status: Normal");
     }
+    lcd.flush();
   }
 }
 
+// Climate rules, on every cycle once a DHT reading is in so their hold
+// timers keep running; the gas rules run on each sample in onGasSample()
 void checkAlarms() {
-  bool shouldAlarm = false;
-  
-  // Check gas level threshold
-  if (gasLevel > gasThreshold) {
-    shouldAlarm = true;
+  if (!climateValid) return;
+
+  RuleOutputs out = feedRules(RULE_SENSOR_TEMPERATURE, lroundf(temperature * 16), lroundf(tempThreshold * 16));
+  logRuleOutputs(out, EVENT_CAUSE_TEMPERATURE, EVENT_RESET_CLEARED, gasEventValue());
+  bool raised = out.raised & RULE_ACTION_ALARM;
 
+  out = feedRules(RULE_SENSOR_HUMIDITY, lroundf(humidity * 16), 0);
+  logRuleOutputs(out, EVENT_CAUSE_HUMIDITY, EVENT_RESET_CLEARED, gasEventValue());
+  raised |= out.raised & RULE_ACTION_ALARM;
+
+  if (raised) {
+    mesh.sendNow(captureSnapshot());
   }
-  
-  // Check temperature threshold
-  if (temperature > tempThreshold) {
-    shouldAlarm = true;
+}
+
+// Feeds one reading to the rules and drives the outputs if that changed them
+RuleOutputs feedRules(RuleSensor sensor, int32_t valueQ4, int32_t thresholdQ4) {
+  RuleOutputs out = {};
+  out.relay = -1;
+  uint32_t now = millis();
+
+  portENTER_CRITICAL(&alarmMux);
+  if (alarmRules.update(sensor, valueQ4, thresholdQ4, now)) {
+    out = applyRuleActions();
+    out.changed = true;
   }
-  
-  // Set alarm state
-  if (shouldAlarm && !alarmActive) {
+  portEXIT_CRITICAL(&alarmMux);
+  return out;
+}
+
+// Brings the outputs in line with the actions of the active rules; call with alarmMux held
+RuleOutputs applyRuleActions() {
+  RuleOutputs out = {};
+  out.relay = -1;
+  uint8_t actions = alarmRules.actions();
+  out.raised = actions & ~ruleActions;
+  out.cleared = ruleActions & ~actions;
+  ruleActions = actions;
+
+  if (out.raised & RULE_ACTION_ALARM) {
     alarmActive = true;
-    digitalWrite(ALARM_PIN, HIGH);
-    
-    // In auto mode, also activate the relay (e.g., to turn on exhaust fan)
-    if (autoMode) {
+    AlarmOut::on();
+  } else if (out.cleared & RULE_ACTION_ALARM) {
+    alarmActive = false;
+    AlarmOut::off();
+  }
+
+  // In auto mode the exhaust runs while its rules do; a relay someone
+  // switched on by hand stays on after them
+  if ((out.raised & RULE_ACTION_EXHAUST) && autoMode) {
+    ruleRelay = !relayState || preAlarmRelay;
+    preAlarmRelay = false;
+    if (!relayState) {
       relayState = true;
-      digitalWrite(RELAY_PIN, HIGH);
+      RelayOut::on();
+      out.relay = 1;
+    }
+  } else if ((out.cleared & RULE_ACTION_EXHAUST) && ruleRelay) {
+    ruleRelay = false;
+    if (PREALARM_RELAY && preAlarm) {
+      preAlarmRelay = true;  // Still on the way up; the pre-alarm switches it off
+    } else {
+      relayState = false;
+      RelayOut::off();
+      out.relay = 0;
     }
-  } 
-  // Note: We don't automatically turn off the alarm - it requires manual reset
+  }
+
+  if ((out.raised | out.cleared) & RULE_ACTION_SPRINKLER) {
+    triggerWaterSprinkler(out.raised & RULE_ACTION_SPRINKLER);
+  }
+  notifyRules = alarmRules.rulesWith(RULE_ACTION_NOTIFY);
+  return out;
 }
 
+// Journals what one rule change did; RAM only, the UI task writes the journal
+void logRuleOutputs(const RuleOutputs &out, EventCause cause, EventReset reset, uint16_t value) {
+  if (out.raised & RULE_ACTION_ALARM) {
+    events.log(EVENT_ALARM_TRIP, cause, value);
+  } else if (out.cleared & RULE_ACTION_ALARM) {
+    events.log(EVENT_ALARM_RESET, reset, value);
+  }
+  if (out.relay >= 0) {
+    events.log(EVENT_RELAY, (out.relay ? EVENT_RELAY_ON : 0) | EVENT_SOURCE_ALARM << 4, value);
+  }
+  if ((out.raised | out.cleared) & RULE_ACTION_SPRINKLER) {
+    events.log(EVENT_SPRINKLER, (out.raised & RULE_ACTION_SPRINKLER) ? 1 : 0, value);
+  }
+}
 
-void triggerWaterSprinkler(bool val){
-  if(val){
-    digitalWrite(RELAY_PIN, HIGH);
-  }else{
-    digitalWrite(RELAY_PIN, LOW);
+// Fast gas alarm path, called by the sampler for every 250 Hz sample
+void onGasSample(uint16_t median, uint32_t sampleTimeUs) {
+  if (metrics.bootFirstSampleUs == 0) {
+    metrics.bootFirstSampleUs = esp_timer_get_time();
+  }
+
+  // Integer table conversion; the rules compare in 1/16 ppm
+  uint32_t ppmQ4 = gasPpm.toPpmQ4(median);
+  lastGasQ4 = ppmQ4;
+  RuleOutputs out = feedRules(RULE_SENSOR_GAS, ppmQ4, lroundf(gasThreshold * 16));
+  if (!out.changed) {
+    return;
+  }
+
+  logRuleOutputs(out, EVENT_CAUSE_GAS, EVENT_RESET_CLEARED, ppmQ4 >> 4);
+  if (out.raised & RULE_ACTION_ALARM) {
+    metrics.alarmTrip.observe(micros() - sampleTimeUs);
+
+    // Let the sensing task log it and publish the new state to the clients
+    requestControl(CONTROL_ALARM_TRIPPED, true);
+  } else {
+    requestControl(CONTROL_PUBLISH, true);
   }
-  sendSensorData();
 }
-void saveSettings() {
-  // Save AP password (if changed)
-  for (int i = 0; i < apPassword.length(); i++) {
-    EEPROM.write(ADDR_AP_PASS + i, apPassword[i]);
+
+// Swaps in a new rule set from the API; returns NULL, or what is wrong with it
+const char *loadRules(JsonArrayConst json) {
+  RuleSet set;
+  const char *error = parseRules(json, set);
+  if (error) return error;
+
+  AlarmProgram program;
+  if (!compileRules(set, program)) return "rules do not compile";
+  if (!Board::hasSprinkler) {
+    for (uint8_t r = 0; r < set.ruleCount; r++) {
+      if (set.rules[r].actions & RULE_ACTION_SPRINKLER) return "this board has no sprinkler";
+    }
   }
-  EEPROM.write(ADDR_AP_PASS + apPassword.length(), 0); // Null terminator
-  
-  // Save station SSID (if set)
-  for (int i = 0; i < stationSSID.length(); i++) {
-    EEPROM.write(ADDR_STATION_SSID + i, stationSSID[i]);
+
+  // The new program starts from the latest readings, so outputs its rules
+  // share with the old ones carry on instead of dropping for a sample
+  uint32_t now = millis();
+  // The names go with the program, so a rule bit never maps to an old name
+  portENTER_CRITICAL(&alarmMux);
+  ruleSet = set;
+  alarmRules.load(program);
+  alarmRules.update(RULE_SENSOR_GAS, lastGasQ4, lroundf(gasThreshold * 16), now);
+  if (climateValid) {
+    alarmRules.update(RULE_SENSOR_TEMPERATURE, lroundf(temperature * 16), lroundf(tempThreshold * 16), now);
+    alarmRules.update(RULE_SENSOR_HUMIDITY, lroundf(humidity * 16), 0, now);
   }
-  EEPROM.write(ADDR_STATION_SSID + stationSSID.length(), 0); // Null terminator
-  
-  // Save station password (if set)
-  for (int i = 0; i < stationPassword.length(); i++) {
-    EEPROM.write(ADDR_STATION_PASS + i, stationPassword[i]);
+  RuleOutputs out = applyRuleActions();
+  portEXIT_CRITICAL(&alarmMux);
+
+  ruleStore.save(set);
+  logRuleOutputs(out, EVENT_CAUSE_GAS, EVENT_RESET_CLEARED, gasEventValue());
+  events.log(EVENT_RULES, 0, set.ruleCount);
+  requestControl(CONTROL_PUBLISH, true);
+  return NULL;
+}
+
+// {"type":"rules","active":[names]} to every client; runs in the network task
+// and returns the rules it reported
+uint8_t broadcastNotifyRules() {
+  // Rule bits and names are swapped together under alarmMux (loadRules)
+  char names[RULE_MAX_RULES][RULE_NAME_SIZE];
+  portENTER_CRITICAL(&alarmMux);
+  uint8_t rules = notifyRules;
+  for (uint8_t r = 0; r < RULE_MAX_RULES; r++) {
+    if (rules & (1 << r)) memcpy(names[r], ruleSet.rules[r].name, RULE_NAME_SIZE);
   }
-  EEPROM.write(ADDR_STATION_PASS + stationPassword.length(), 0); // Null terminator
-  
-  // Save thresholds
-  EEPROM.writeFloat(ADDR_GAS_THRESHOLD, gasThreshold);
-  EEPROM.writeFloat(ADDR_TEMP_THRESHOLD, tempThreshold);
-  
-  // Save auto mode setting
-  EEPROM.write(ADDR_AUTO_MODE, autoMode ? 1 : 0);
-  
-  // Commit changes
-  EEPROM.commit();
+  portEXIT_CRITICAL(&alarmMux);
+
+  char text[192];  // Eight full names fit
+  size_t len = 0;
+  {
+    JsonDocument doc(&commandPool);
+    doc["type"] = "rules";
+    JsonArray active = doc["active"].to<JsonArray>();
+    for (uint8_t r = 0; r < RULE_MAX_RULES; r++) {
+      if (rules & (1 << r)) active.add((const char *)names[r]);
+    }
+    if (!doc.overflowed() && measureJson(doc) < sizeof(text)) {
+      len = serializeJson(doc, text, sizeof(text));
+    }
+  }
+  if (len > 0) {
+    sockets.broadcast(text, len);
+  }
+  return rules;
+}
+
+// Sprinkler valve relay; driven by the rules with the sprinkler action
+void triggerWaterSprinkler(bool val) {
+  sprinklerState = val;
+  SprinklerOut::write(val);
+}
+
+// Stages the current settings; the store commits them once changes settle
+void saveSettings() {
+  DeviceSettings record = {};
+  strlcpy(record.apPassword, apPassword.c_str(), sizeof(record.apPassword));
+  strlcpy(record.stationSSID, stationSSID.c_str(), sizeof(record.stationSSID));
+  strlcpy(record.stationPassword, stationPassword.c_str(), sizeof(record.stationPassword));
+  record.gasThreshold = gasThreshold;
+  record.tempThreshold = tempThreshold;
+  record.autoMode = autoMode ? 1 : 0;
+  record.gasR0 = gasPpm.calibrated() ? gasPpm.r0() : 0;
+  settings.save(record);
 }
 
 void loadSettings() {
+  DeviceSettings defaults = {};
+  strlcpy(defaults.apPassword, AP_PASSWORD, sizeof(defaults.apPassword));
+  defaults.gasThreshold = 1000;
+  defaults.tempThreshold = 35;
+  defaults.autoMode = 1;
+  settings.begin(defaults);
+
+  DeviceSettings record = settings.get();
+
   // Load AP password
-  apPassword = "";
-  for (int i = 0; i < 32; i++) {
-    char c = EEPROM.read(ADDR_AP_PASS + i);
-    if (c == 0) break;
-    apPassword += c;
-  }
+  apPassword = record.apPassword;
   if (apPassword.length() == 0) {
     apPassword = AP_PASSWORD;
   }
   
-  // Load station SSID
-  stationSSID = "";
-  for (int i = 0; i < 32; i++) {
-    char c = EEPROM.read(ADDR_STATION_SSID + i);
-    if (c == 0) break;
-    stationSSID += c;
-  }
-  
-  // Load station password
-  stationPassword = "";
-  for (int i = 0; i < 32; i++) {
-    char c = EEPROM.read(ADDR_STATION_PASS + i);
-    if (c == 0) break;
-    stationPassword += c;
-  }
+  // Load station credentials
+  stationSSID = record.stationSSID;
+  stationPassword = record.stationPassword;
   
   // Load thresholds
-  gasThreshold = EEPROM.readFloat(ADDR_GAS_THRESHOLD);
-  if (isnan(gasThreshold) || gasThreshold < 0 || gasThreshold > 4095) {
-    gasThreshold = 500; // Default if invalid
+  gasThreshold = record.gasThreshold;
+  if (isnan(gasThreshold) || gasThreshold < 0 || gasThreshold > GAS_PPM_MAX) {
+    gasThreshold = 1000; // Default if invalid
   }
+
+  // Sensor calibration; 0 until the first clean-air run
+  gasPpm.setR0(record.gasR0);
   
-  tempThreshold = EEPROM.readFloat(ADDR_TEMP_THRESHOLD);
+  tempThreshold = record.tempThreshold;
   if (isnan(tempThreshold) || tempThreshold < 0 || tempThreshold > 100) {
     tempThreshold = 35; // Default if invalid
   }
   
   // Load auto mode setting
-  autoMode = EEPROM.read(ADDR_AUTO_MODE) == 1;
+  autoMode = record.autoMode == 1;
 }
 
 void setupAccessPoint() {
+  station.disconnect();
 
   const char* password = "12345678";
   Serial.println("Setting up Access Point...");
@@ -516,184 +1258,80 @@ void setupAccessPoint() {
   apMode = true;
 }
 
-// void setupStation() {
-//   Serial.println("Connecting to WiFi network...");
-//   WiFi.begin(stationSSID.c_str(), stationPassword.c_str());
-  
-//   // Wait for connection with timeout
-//   int timeout = 0;
-//   while (WiFi.status() != WL_CONNECTED && timeout < 20) {
-//     delay(500);
-//     Serial.print(".");
-//     timeout++;
-//   }
-  
-//   if (WiFi.status() == WL_CONNECTED) {
-//     Serial.println("");
-//     Serial.print("Connected to ");
-//     Serial.println(stationSSID);
-//     Serial.print("IP address: ");
-//     Serial.println(WiFi.localIP());
-//     apMode = false;
-//   } else {
-//     Serial.println("");
-//     Serial.println("Connection failed");
-//   }
-// }
-
-
+// Joins the configured network next to the softAP; returns at once
 void setupStation() {
   Serial.println("Connecting to WiFi network...");
-  
-  // CHANGE: Set up AP mode first to ensure it's always active
-  WiFi.softAP(apSSID.c_str(), apPassword.c_str());
-  Serial.print("AP IP address: ");
-  Serial.println(WiFi.softAPIP());
-  
-  // Then connect to the WiFi network
-  WiFi.mode(WIFI_AP_STA); // CHANGE: Set mode to both AP and Station
-  WiFi.begin(stationSSID.c_str(), stationPassword.c_str());
-  
-  // Wait for connection with timeout
-  int timeout = 0;
-  while (WiFi.status() != WL_CONNECTED && timeout < 20) {
-    delay(500);
-    Serial.print(".");
-    timeout++;
-  }
-  
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("");
-    Serial.print("Connected to ");
-    Serial.println(stationSSID);
-    Serial.print("IP address: ");
-    Serial.println(WiFi.localIP());
-    apMode = false; // Still mark as station mode for the UI
-  } else {
-    Serial.println("");
-    Serial.println("Connection failed");
-  }
+  station.connect(stationSSID.c_str(), stationPassword.c_str());
 }
+
+// Menu keys from the button event queue. A held up/down key repeats, but
+// only on the screen the press started on and only where it steps a value
 void handleButtons() {
-  // Read button states with debounce
-  bool menuButton = digitalRead(BUTTON1_PIN) == LOW;
-  bool b2 = digitalRead(BUTTON2_PIN) == LOW;
-  bool b3 = digitalRead(BUTTON3_PIN) == LOW;
-  
-  if (menuButton != menuButtonLastState || b2 != button2LastState || b3 != button3LastState) {
-    lastButtonDebounceTime = millis();
-  }
-  
-  if ((millis() - lastButtonDebounceTime) > debounceDelay) {
-    // If button state has changed, update the state
-    if (menuButton != menuButtonState) {
-      menuButtonState = menuButton;
-      if (menuButtonState) {
-        // Button 1 (Mode) pressed
-        if (currentMenu == MAIN_SCREEN) {
-          currentMenu = MENU_MAIN;
-          menuPosition = 0;
-          navigateMenu();
-        } else {
-          currentMenu = MAIN_SCREEN;
-          updateLCD();
+  static MenuState pressedOn[Board::buttonCount];
+
+  ButtonEvent event;
+  while (buttons.read(event)) {
+    MenuKey key = buttonKeys[event.button];
+    switch (event.type) {
+      case BUTTON_PRESS:
+        pressedOn[event.button] = menu.screen;
+        handleMenuKey(key);
+        break;
+      case BUTTON_REPEAT:
+        if (menu.screen == pressedOn[event.button] && menuKeyRepeats(menu, key)) {
+          handleMenuKey(key);
         }
-      }
+        break;
+      default:
+        break;
     }
-    
-    if (b2 != button2State) {
-      button2State = b2;
-      if (button2State ) {
-
-        if(currentMenu == SET_TEMP_THRESHOLD) {
-          // Button 2 (Up) pressed
-          tempThreshold += 1;
-          navigateMenu();
-        } else if(currentMenu == SET_GAS_THRESHOLD) {
-          // Button 2 (Up) pressed
-          gasThreshold += 10;
-          navigateMenu();
-        }else if (currentMenu == WIFI_SETTINGS) {
-          apMode = !apMode;
-          if (apMode) {
-            setupAccessPoint();
-          } else {
-            setupStation();
-        }
-       
-          
-        }
-        else if( currentMenu == MENU_MAIN){
-        // Button 2 (Up) pressed
-        menuPosition = (menuPosition - 1 + MAX_MENU_ITEMS) % MAX_MENU_ITEMS;
-        navigateMenu();}
-      }
-    }
-    
-    if (b3 != button3State) {
-      button3State = b3;
-      if (button3State && currentMenu != MAIN_SCREEN) {
-        // Button 3 (Down/Select) pressed
-        if (currentMenu == MENU_MAIN) {
-          // Enter selected submenu
-          switch(menuPosition) {
-            case 0: // Temperature Threshold
-              currentMenu = SET_TEMP_THRESHOLD;
-              break;
-            case 1: // Gas Threshold
-              currentMenu = SET_GAS_THRESHOLD;
-              break;
-            case 2: // WiFi Settings
-              currentMenu = WIFI_SETTINGS;
-              break;
-            case 3: // Device Info
-              currentMenu = DEVICE_INFO;
-              break;
-          }
-        } else if (currentMenu == SET_TEMP_THRESHOLD) {
-          // In temp threshold menu, decrease temperature threshold
-          tempThreshold -= 1;
-        } else if (currentMenu == SET_GAS_THRESHOLD) {
-          // In gas threshold menu, decrease gas threshold
-          gasThreshold -= 10;
-        } else if (currentMenu == WIFI_SETTINGS) {
-          // Toggle AP mode
-          apMode = !apMode;
-          if (apMode) {
-            setupAccessPoint();
-          } else {
-            setupStation();
-          }
-        } else {
-          // Navigate within submenu
-          menuPosition = (menuPosition + 1) % MAX_MENU_ITEMS;
-        }
-        navigateMenu();
-      }
+  }
+}
+
+// Runs one key through the menu state machine and carries out its effects
+void handleMenuKey(MenuKey key) {
+  uint8_t effects = menuHandleKey(menu, key);
+
+  if (effects & (MENU_EFFECT_TEMP_UP | MENU_EFFECT_TEMP_DOWN | MENU_EFFECT_GAS_UP | MENU_EFFECT_GAS_DOWN)) {
+    if (effects & MENU_EFFECT_TEMP_UP) tempThreshold += 1;
+    if (effects & MENU_EFFECT_TEMP_DOWN) tempThreshold -= 1;
+    if (effects & MENU_EFFECT_GAS_UP) gasThreshold += 10;
+    if (effects & MENU_EFFECT_GAS_DOWN) gasThreshold -= 10;
+    saveSettings();
+  }
+
+  if (effects & MENU_EFFECT_TOGGLE_WIFI) {
+    apMode = !apMode;
+    events.log(EVENT_WIFI_MODE, apMode ? 1 : 0, gasEventValue());
+    if (apMode) {
+      setupAccessPoint();
+    } else {
+      setupStation();
     }
-  
   }
-  
-  menuButtonLastState = menuButton;
-  button2LastState = b2;
-  button3LastState = b3;
+
+  if (effects & MENU_EFFECT_SHOW_MAIN) {
+    updateLCD(captureSnapshot());
+  } else if (effects & MENU_EFFECT_REDRAW) {
+    navigateMenu();
+  }
 }
 
 void navigateMenu() {
   lcd.clear();
   
-  switch (currentMenu) {
+  switch (menu.screen) {
     case MENU_MAIN:
       lcd.setCursor(0, 0);
       lcd.print("MENU:");
       lcd.setCursor(0, 1);
-      lcd.print(menuPosition == 0 ? "> " : "  ");
+      lcd.print(menu.position == 0 ? "> " : "  ");
       lcd.print("Temperature");
       lcd.setCursor(0, 2);
-      lcd.print(menuPosition == 1 ? "> " : "  ");
+      lcd.print(menu.position == 1 ? "> " : "  ");
       lcd.print("Gas Level");
       lcd.setCursor(0, 3);
-      lcd.print(menuPosition == 2 ? "> " : "  ");
+      lcd.print(menu.position == 2 ? "> " : "  ");
       lcd.print("WiFi Settings");
       break;
       
@@ -717,6 +1355,7 @@ void navigateMenu() {
       lcd.setCursor(0, 1);
       lcd.print("Curr: ");
       lcd.print(gasThreshold, 0);
+      lcd.print(" ppm");
       lcd.setCursor(0, 2);
       lcd.print("UP: +10  DOWN: -10");
       lcd.setCursor(0, 3);
@@ -730,7 +1369,19 @@ void navigateMenu() {
       if (apMode) {
         lcd.print("Mode: AP");
       } else {
-        lcd.print("Mode: Station");
+        switch (station.state()) {
+          case STATION_CONNECTED:
+            lcd.print("STA: Connected");
+            break;
+          case STATION_BACKOFF:
+            lcd.print("STA: Retry ");
+            lcd.print((station.retryInMs() + 999) / 1000);
+            lcd.print("s");
+            break;
+          default:
+            lcd.print("STA: Connecting");
+            break;
+        }
       }
       lcd.setCursor(0, 2);
       lcd.print("SSID: ");
@@ -753,7 +1404,227 @@ void navigateMenu() {
       break;
       
     default:
-      updateLCD();
+      updateLCD(captureSnapshot());
       break;
   }
-}
\ No newline at end of file
+  lcd.flush();
+}
+// One sample per connected WebSocket client
+void renderClientFamily(MetricsWriter &out, const char *name, const char *type, const char *help,
+                        uint32_t TelemetryClientStats::*field) {
+  out.family(name, type, help);
+
+  TelemetryClientStats stats;
+  char labels[16];
+  for (uint8_t num = 0; num < SOCKET_MAX_CLIENTS; num++) {
+    if (telemetry.clientStats(num, stats)) {
+      snprintf(labels, sizeof(labels), "client=\"%u\"", num);
+      out.value(name, labels, stats.*field);
+    }
+  }
+}
+
+// /api/metrics exposition, one block per call. A family's samples must stay
+// contiguous, and every block has to fit in METRICS_BLOCK_SIZE.
+bool renderMetrics(uint16_t block, MetricsWriter &out) {
+  static const char *const taskNames[] = {"sensor", "network", "ui"};
+  char labels[32];
+
+  switch (block) {
+    case 0:
+      out.family("gasmon_uptime_seconds", "gauge", "Time since boot");
+      out.seconds("gasmon_uptime_seconds", NULL, esp_timer_get_time());
+      out.family("gasmon_heap_free_bytes", "gauge", "Free heap");
+      out.value("gasmon_heap_free_bytes", NULL, ESP.getFreeHeap());
+      out.family("gasmon_heap_largest_free_block_bytes", "gauge", "Largest allocatable heap block");
+      out.value("gasmon_heap_largest_free_block_bytes", NULL, ESP.getMaxAllocHeap());
+      out.family("gasmon_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+      out.value("gasmon_heap_min_free_bytes", NULL, ESP.getMinFreeHeap());
+      return true;
+
+    case 1:
+      {
+        TaskHandle_t tasks[] = {sensorTaskHandle, networkTaskHandle, uiTaskHandle};
+        out.family("gasmon_task_stack_free_bytes", "gauge", "Lowest free stack space seen per task");
+        for (uint8_t i = 0; i < 3; i++) {
+          if (tasks[i] != NULL) {
+            snprintf(labels, sizeof(labels), "task=\"%s\"", taskNames[i]);
+            out.value("gasmon_task_stack_free_bytes", labels, uxTaskGetStackHighWaterMark(tasks[i]));
+          }
+        }
+      }
+      return true;
+
+    case 2:
+    case 3:
+    case 4:
+      {
+        const LatencyHistogram *loops[] = {&metrics.sensorLoop, &metrics.networkLoop, &metrics.uiLoop};
+        uint8_t i = block - 2;
+        if (i == 0) {
+          out.family("gasmon_loop_busy_seconds", "histogram", "Work per task loop iteration, queue waits excluded");
+        }
+        snprintf(labels, sizeof(labels), "task=\"%s\"", taskNames[i]);
+        out.histogram("gasmon_loop_busy_seconds", labels, *loops[i]);
+      }
+      return true;
+
+    case 5:
+      out.family("gasmon_dht_read_seconds", "histogram", "DHT transaction time, start pulse included");
+      out.histogram("gasmon_dht_read_seconds", NULL, metrics.dhtRead);
+      return true;
+
+    case 6:
+      out.family("gasmon_lcd_update_seconds", "histogram", "Main screen redraw and flush");
+      out.histogram("gasmon_lcd_update_seconds", NULL, metrics.lcdUpdate);
+      return true;
+
+    case 7:
+      out.family("gasmon_telemetry_publish_seconds", "histogram", "Telemetry publish to all WebSocket clients");
+      out.histogram("gasmon_telemetry_publish_seconds", NULL, metrics.telemetryPublish);
+      return true;
+
+    case 8:
+      out.family("gasmon_websocket_send_seconds", "histogram", "Time to queue one WebSocket message");
+      out.histogram("gasmon_websocket_send_seconds", NULL, metrics.webSocketSend);
+      return true;
+
+    case 9:
+      out.family("gasmon_alarm_trip_latency_seconds", "histogram", "Gas threshold crossing to alarm/relay output");
+      out.histogram("gasmon_alarm_trip_latency_seconds", NULL, metrics.alarmTrip);
+      return true;
+
+    case 10:
+      out.family("gasmon_alarm_trip_latency_max_seconds", "gauge", "Slowest alarm trip since boot");
+      out.seconds("gasmon_alarm_trip_latency_max_seconds", NULL, metrics.alarmTrip.maxUs());
+      out.family("gasmon_alarm_active", "gauge", "Alarm latched");
+      out.value("gasmon_alarm_active", NULL, alarmActive ? 1 : 0);
+      out.family("gasmon_rules_active", "gauge", "Alarm rules met or latched");
+      out.value("gasmon_rules_active", NULL, __builtin_popcount(alarmRules.activeRules()));
+      out.family("gasmon_prealarm_active", "gauge", "Gas projected to reach the threshold within the lead time");
+      out.value("gasmon_prealarm_active", NULL, preAlarm ? 1 : 0);
+      out.family("gasmon_prealarms_total", "counter", "Pre-alarms raised");
+      out.value("gasmon_prealarms_total", NULL, preAlarmCount);
+      return true;
+
+    case 11:
+      out.family("gasmon_websocket_clients", "gauge", "Connected WebSocket clients");
+      out.value("gasmon_websocket_clients", NULL, sockets.count());
+      out.family("gasmon_websocket_connects_total", "counter", "WebSocket connections accepted");
+      out.value("gasmon_websocket_connects_total", NULL, metrics.webSocketConnects);
+      out.family("gasmon_websocket_disconnects_total", "counter", "WebSocket connections closed");
+      out.value("gasmon_websocket_disconnects_total", NULL, metrics.webSocketDisconnects);
+      out.family("gasmon_websocket_bad_frames_total", "counter", "Command frames that failed to parse");
+      out.value("gasmon_websocket_bad_frames_total", NULL, metrics.webSocketBadFrames);
+      out.family("gasmon_websocket_rejected_total", "counter", "Connections refused at the client limit");
+      out.value("gasmon_websocket_rejected_total", NULL, sockets.rejected());
+      out.family("gasmon_websocket_evicted_total", "counter", "Clients closed after their send queue stayed full");
+      out.value("gasmon_websocket_evicted_total", NULL, sockets.evicted());
+      out.family("gasmon_websocket_refused_frames_total", "counter", "Fragmented, binary or oversized frames ignored");
+      out.value("gasmon_websocket_refused_frames_total", NULL, sockets.refusedFrames());
+      out.family("gasmon_websocket_inbox_drops_total", "counter", "Socket events lost to a full network task queue");
+      out.value("gasmon_websocket_inbox_drops_total", NULL, sockets.inboxDrops());
+      return true;
+
+    // One per-client family per block; SOCKET_MAX_CLIENTS samples fill most of one
+    case 12:
+      renderClientFamily(out, "gasmon_websocket_client_queue_depth", "gauge",
+                         "Telemetry deltas held back by the rate limit or a full queue", &TelemetryClientStats::pending);
+      return true;
+
+    case 13:
+      renderClientFamily(out, "gasmon_websocket_client_coalesced_total", "counter",
+                         "Updates folded into a pending delta", &TelemetryClientStats::coalesced);
+      return true;
+
+    case 14:
+      renderClientFamily(out, "gasmon_websocket_client_messages_total", "counter",
+                         "Telemetry messages sent", &TelemetryClientStats::messages);
+      return true;
+
+    case 15:
+      renderClientFamily(out, "gasmon_websocket_client_sent_bytes_total", "counter",
+                         "Telemetry payload bytes sent", &TelemetryClientStats::bytes);
+      return true;
+
+    case 16:
+      renderClientFamily(out, "gasmon_websocket_client_send_failures_total", "counter",
+                         "Telemetry messages refused by a full client queue", &TelemetryClientStats::failures);
+      return true;
+
+    case 17:
+      out.family("gasmon_json_pool_peak_bytes", "gauge", "Peak use of a static JSON arena");
+      out.value("gasmon_json_pool_peak_bytes", "pool=\"command\"", commandPool.peak());
+      out.value("gasmon_json_pool_peak_bytes", "pool=\"api\"", apiPool.peak());
+      out.value("gasmon_json_pool_peak_bytes", "pool=\"rules\"", rulesPool.peak());
+      out.value("gasmon_json_pool_peak_bytes", "pool=\"telemetry\"", telemetry.poolPeak());
+      out.family("gasmon_json_pool_failures_total", "counter", "Allocations a static JSON arena refused");
+      out.value("gasmon_json_pool_failures_total", "pool=\"command\"", commandPool.failures());
+      out.value("gasmon_json_pool_failures_total", "pool=\"api\"", apiPool.failures());
+      out.value("gasmon_json_pool_failures_total", "pool=\"rules\"", rulesPool.failures());
+      out.value("gasmon_json_pool_failures_total", "pool=\"telemetry\"", telemetry.poolFailures());
+      return true;
+
+    case 18:
+      out.family("gasmon_gas_samples_total", "counter", "ADC samples taken by the gas sampler");
+      out.value("gasmon_gas_samples_total", NULL, gasSampler.sampleCount());
+      out.family("gasmon_lcd_cells_written_total", "counter", "Characters pushed to the LCD");
+      out.value("gasmon_lcd_cells_written_total", NULL, lcd.cellsWritten());
+      out.family("gasmon_settings_commits_total", "counter", "Settings records written to NVS");
+      out.value("gasmon_settings_commits_total", NULL, settings.commitCount());
+      out.family("gasmon_button_overflows_total", "counter", "Button edges dropped by a full queue");
+      out.value("gasmon_button_overflows_total", NULL, buttons.overflows());
+      return true;
+
+    case 19:
+      out.family("gasmon_mesh_frames_total", "counter", "ESP-NOW frames by outcome");
+      out.value("gasmon_mesh_frames_total", "result=\"sent\"", mesh.framesSent());
+      out.value("gasmon_mesh_frames_total", "result=\"received\"", mesh.framesReceived());
+      out.value("gasmon_mesh_frames_total", "result=\"lost\"", mesh.framesLost());
+      out.family("gasmon_station_connected", "gauge", "Station uplink associated");
+      out.value("gasmon_station_connected", NULL, station.state() == STATION_CONNECTED ? 1 : 0);
+      out.family("gasmon_station_attempts_total", "counter", "Station join attempts");
+      out.value("gasmon_station_attempts_total", NULL, station.attempts());
+      return true;
+
+    case 20:
+      out.family("gasmon_sampling_interval_seconds", "gauge", "Current sensor cycle interval");
+      out.seconds("gasmon_sampling_interval_seconds", NULL, sampling.intervalMs() * 1000ULL);
+      out.family("gasmon_sampling_switches_total", "counter", "Changes between the slow and fast cadence");
+      out.value("gasmon_sampling_switches_total", NULL, sampling.switches());
+      out.family("gasmon_gas_slope", "gauge", "Gas level trend, ppm per second");
+      out.decimal("gasmon_gas_slope", NULL, gasSlope);
+      out.family("gasmon_gas_ppm", "gauge", "Last published gas level");
+      out.decimal("gasmon_gas_ppm", NULL, gasLevel);
+      out.family("gasmon_gas_adc", "gauge", "Filtered sensor ADC level behind gasmon_gas_ppm");
+      out.decimal("gasmon_gas_adc", NULL, gasRaw);
+      out.family("gasmon_gas_r0_ratio", "gauge", "Sensor R0 as a multiple of the load resistor");
+      out.decimal("gasmon_gas_r0_ratio", NULL, gasPpm.r0());
+      return true;
+
+    case 21:
+      out.family("gasmon_boot_stage_seconds", "gauge", "Time from reset to each boot stage");
+      out.seconds("gasmon_boot_stage_seconds", "stage=\"sensing\"", metrics.bootSensingUs);
+      out.seconds("gasmon_boot_stage_seconds", "stage=\"first_sample\"", metrics.bootFirstSampleUs);
+      out.seconds("gasmon_boot_stage_seconds", "stage=\"network\"", metrics.bootNetworkUs);
+      out.seconds("gasmon_boot_stage_seconds", "stage=\"ui\"", metrics.bootUiUs);
+      return true;
+
+    case 22:
+      out.family("gasmon_events_logged_total", "counter", "Journal events logged since boot");
+      out.value("gasmon_events_logged_total", NULL, events.logged());
+      out.family("gasmon_events_dropped_total", "counter", "Journal events lost to a full RAM queue");
+      out.value("gasmon_events_dropped_total", NULL, events.dropped());
+      out.family("gasmon_events_flushes_total", "counter", "Journal batches written to flash");
+      out.value("gasmon_events_flushes_total", NULL, events.flushes());
+      out.family("gasmon_events_write_failures_total", "counter", "Journal batches that failed to write");
+      out.value("gasmon_events_write_failures_total", NULL, events.writeFailures());
+      return true;
+
+    case 23:
+      out.family("gasmon_discovery_replies_total", "counter", "UDP discovery requests answered");
+      out.value("gasmon_discovery_replies_total", NULL, discovery.answered());
+      return true;
+  }
+  return false;
+}
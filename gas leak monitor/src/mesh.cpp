@@ -0,0 +1,185 @@
+#include "mesh.h"
+
+#include <WiFi.h>
+#include <esp_now.h>
+
+MeshLink mesh;
+MeshLink *MeshLink::_instance = NULL;
+
+static uint8_t meshFlags(const SensorSnapshot &snapshot) {
+  return (snapshot.alarmActive ? MESH_FLAG_ALARM : 0) |
+         (snapshot.relayState ? MESH_FLAG_RELAY : 0) |
+         (snapshot.autoMode ? MESH_FLAG_AUTO : 0);
+}
+
+bool MeshLink::begin(SocketHub &sockets, bool aggregator) {
+  _sockets = &sockets;
+  _aggregator = aggregator;
+  _instance = this;
+
+  // Needs the WiFi driver up; frames go out on the softAP's channel
+  if (esp_now_init() != ESP_OK) {
+    Serial.println("ESP-NOW init failed, mesh disabled");
+    return false;
+  }
+
+  esp_now_peer_info_t peer = {};
+  memcpy(peer.peer_addr, MESH_BROADCAST, sizeof(peer.peer_addr));
+  peer.channel = 0;  // Current channel
+  peer.ifidx = WIFI_IF_AP;
+  peer.encrypt = false;
+  if (esp_now_add_peer(&peer) != ESP_OK) {
+    Serial.println("ESP-NOW broadcast peer failed, mesh disabled");
+    esp_now_deinit();
+    return false;
+  }
+
+  esp_now_register_recv_cb(onReceive);
+  _started = true;
+  return true;
+}
+
+void MeshLink::sendNow(const SensorSnapshot &snapshot) {
+  broadcast(snapshot, true);
+}
+
+void MeshLink::publish(const SensorSnapshot &snapshot) {
+  uint8_t flags = meshFlags(snapshot);
+  if (flags != _lastFlags) {
+    broadcast(snapshot, true);
+  } else if (millis() - _lastBroadcastMs >= MESH_BROADCAST_INTERVAL_MS) {
+    broadcast(snapshot, false);
+  }
+}
+
+void MeshLink::broadcast(const SensorSnapshot &snapshot, bool urgent) {
+  if (!_started) return;
+
+  MeshFrame frame;
+  frame.magic = MESH_MAGIC;
+  frame.version = MESH_VERSION;
+  frame.kind = MESH_KIND_MONITOR;
+  frame.flags = meshFlags(snapshot) | (urgent ? MESH_FLAG_URGENT : 0);
+  frame.temperature = (int16_t)constrain(lroundf(snapshot.temperature * 100.0f), -32768L, 32767L);
+  frame.humidity = (uint16_t)constrain(lroundf(snapshot.humidity * 100.0f), 0L, 65535L);
+  frame.gasLevel = (uint16_t)constrain(lroundf(snapshot.gasLevel), 0L, 65535L);
+  frame.uptimeMs = millis();
+
+  // The sensing task (alarm) and the network task (cadence) both send
+  portENTER_CRITICAL(&_mux);
+  frame.seq = _seq++;
+  _lastFlags = frame.flags & ~MESH_FLAG_URGENT;
+  _lastBroadcastMs = frame.uptimeMs;
+  portEXIT_CRITICAL(&_mux);
+
+  if (esp_now_send(MESH_BROADCAST, (const uint8_t *)&frame, sizeof(frame)) == ESP_OK) {
+    _sent++;
+  }
+}
+
+// Runs in the WiFi task
+void MeshLink::onReceive(const uint8_t *mac, const uint8_t *data, int len) {
+  if (_instance == NULL || !meshFrameValid(data, len)) {
+    return;
+  }
+  MeshFrame frame;
+  memcpy(&frame, data, sizeof(frame));
+  _instance->handleFrame(mac, frame);
+}
+
+void MeshLink::handleFrame(const uint8_t *mac, const MeshFrame &frame) {
+  _received++;
+  if (!_aggregator) {
+    return;
+  }
+
+  uint32_t now = millis();
+  portENTER_CRITICAL(&_mux);
+  Peer *slot = NULL;
+  for (size_t i = 0; i < MAX_DEVICES; i++) {
+    if (_peers[i].used && memcmp(_peers[i].mac, mac, 6) == 0) {
+      slot = &_peers[i];
+      break;
+    }
+    if (slot == NULL && (!_peers[i].used || now - _peers[i].lastSeenMs > MESH_PEER_TIMEOUT_MS)) {
+      slot = &_peers[i];  // Free or expired; keep looking for an existing entry
+    }
+  }
+  if (slot != NULL) {
+    if (slot->used && memcmp(slot->mac, mac, 6) == 0) {
+      // Backwards jumps are a peer reboot, not loss
+      uint16_t gap = frame.seq - slot->frame.seq - 1;
+      if (gap < 0x8000) {
+        _lost += gap;
+      }
+    }
+    slot->used = true;
+    memcpy(slot->mac, mac, 6);
+    slot->frame = frame;
+    slot->lastSeenMs = now;
+    _dirty = true;
+  }
+  portEXIT_CRITICAL(&_mux);
+}
+
+void MeshLink::poll() {
+  if (!_aggregator || !_dirty) return;
+
+  uint32_t now = millis();
+  if (now - _lastPushMs < MESH_PUSH_INTERVAL_MS) return;
+  _lastPushMs = now;
+  _dirty = false;
+
+  size_t len = buildDevices(now);
+  if (len > 0) {
+    _sockets->broadcast(_buffer, len);
+  }
+}
+
+void MeshLink::sendDevices(uint8_t num) {
+  size_t len = buildDevices(millis());
+  if (len > 0) {
+    _sockets->send(num, (const uint8_t *)_buffer, len, false);
+  }
+}
+
+size_t MeshLink::buildDevices(uint32_t now) {
+  Peer peers[MAX_DEVICES];
+  portENTER_CRITICAL(&_mux);
+  memcpy(peers, _peers, sizeof(peers));
+  portEXIT_CRITICAL(&_mux);
+
+  JsonDocument doc(&_pool);
+  doc["type"] = "devices";
+  JsonArray devices = doc["devices"].to<JsonArray>();
+  for (size_t i = 0; i < MAX_DEVICES; i++) {
+    const Peer &peer = peers[i];
+    uint32_t age = now - peer.lastSeenMs;
+    if (!peer.used || age > MESH_PEER_TIMEOUT_MS) {
+      continue;
+    }
+
+    char id[18];
+    snprintf(id, sizeof(id), "%02X:%02X:%02X:%02X:%02X:%02X",
+             peer.mac[0], peer.mac[1], peer.mac[2], peer.mac[3], peer.mac[4], peer.mac[5]);
+
+    JsonObject device = devices.add<JsonObject>();
+    device["id"] = id;
+    device["age"] = age;
+    device["relay"] = (peer.frame.flags & MESH_FLAG_RELAY) != 0;
+    device["auto"] = (peer.frame.flags & MESH_FLAG_AUTO) != 0;
+    if (peer.frame.kind == MESH_KIND_MONITOR) {
+      device["kind"] = "monitor";
+      device["alarm"] = (peer.frame.flags & MESH_FLAG_ALARM) != 0;
+      device["temperature"] = peer.frame.temperature / 100.0f;
+      device["humidity"] = peer.frame.humidity / 100.0f;
+      device["gasLevel"] = peer.frame.gasLevel;
+    } else {
+      device["kind"] = "switch";
+      device["pir"] = (peer.frame.flags & MESH_FLAG_PIR) != 0;
+    }
+  }
+
+  size_t len = serializeJson(doc, _buffer, sizeof(_buffer));
+  return doc.overflowed() ? 0 : len;
+}
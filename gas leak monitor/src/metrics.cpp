@@ -0,0 +1,123 @@
+#include "metrics.h"
+
+#include <stdarg.h>
+
+DeviceMetrics metrics;
+
+const uint32_t LatencyHistogram::bounds[METRICS_BUCKETS] = {
+  100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, UINT32_MAX
+};
+
+void LatencyHistogram::observe(uint32_t us) {
+  uint8_t i = 0;
+  while (us > bounds[i]) {
+    i++;  // The +Inf bound stops the scan
+  }
+  _buckets[i] = _buckets[i] + 1;
+  _sumUs = _sumUs + us;
+  _lastUs = us;
+  if (us > _maxUs) {
+    _maxUs = us;
+  }
+}
+
+void MetricsWriter::append(const char *format, ...) {
+  size_t remaining = _size - _length;
+
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(_buffer + _length, remaining, format, args);
+  va_end(args);
+
+  if (len > 0 && (size_t)len < remaining) {
+    _length += len;
+  }
+}
+
+void MetricsWriter::family(const char *name, const char *type, const char *help) {
+  append("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void MetricsWriter::value(const char *name, const char *labels, uint32_t value) {
+  if (labels != NULL) {
+    append("%s{%s} %u\n", name, labels, value);
+  } else {
+    append("%s %u\n", name, value);
+  }
+}
+
+void MetricsWriter::seconds(const char *name, const char *labels, uint64_t us) {
+  double value = us / 1e6;
+  if (labels != NULL) {
+    append("%s{%s} %.6f\n", name, labels, value);
+  } else {
+    append("%s %.6f\n", name, value);
+  }
+}
+
+void MetricsWriter::decimal(const char *name, const char *labels, float value) {
+  if (labels != NULL) {
+    append("%s{%s} %g\n", name, labels, value);
+  } else {
+    append("%s %g\n", name, value);
+  }
+}
+
+void MetricsWriter::histogram(const char *name, const char *labels, const LatencyHistogram &histogram) {
+  const char *separator = labels != NULL ? "," : "";
+  if (labels == NULL) labels = "";
+
+  // Buckets are stored per range; the exposition wants them cumulative
+  uint32_t count = 0;
+  for (uint8_t i = 0; i < METRICS_BUCKETS; i++) {
+    count += histogram.bucket(i);
+    if (LatencyHistogram::bounds[i] == UINT32_MAX) {
+      append("%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, separator, count);
+    } else {
+      append("%s_bucket{%s%sle=\"%g\"} %u\n", name, labels, separator, LatencyHistogram::bounds[i] / 1e6, count);
+    }
+  }
+
+  // The count comes from the buckets so it always matches +Inf
+  if (*labels) {
+    append("%s_sum{%s} %.6f\n%s_count{%s} %u\n", name, labels, histogram.sumUs() / 1e6, name, labels, count);
+  } else {
+    append("%s_sum %.6f\n%s_count %u\n", name, histogram.sumUs() / 1e6, name, count);
+  }
+}
+
+MetricsResponse::MetricsResponse(MetricsRenderer renderer, bool chunked) : _renderer(renderer) {
+  _code = 200;
+  _contentType = METRICS_CONTENT_TYPE;
+  _sendContentLength = false;
+  _chunked = chunked;
+}
+
+size_t MetricsResponse::_fillBuffer(uint8_t *buf, size_t maxLen) {
+  size_t written = 0;
+
+  while (written < maxLen) {
+    if (_offset == _length) {
+      if (_finished) break;
+
+      // Render the next block that has anything in it
+      MetricsWriter out(_text, sizeof(_text));
+      while (out.length() == 0) {
+        if (!_renderer(_block++, out)) {
+          _finished = true;
+          break;
+        }
+      }
+      _length = out.length();
+      _offset = 0;
+      continue;
+    }
+
+    size_t remaining = _length - _offset;
+    size_t len = remaining < maxLen - written ? remaining : maxLen - written;
+    memcpy(buf + written, _text + _offset, len);
+    _offset += len;
+    written += len;
+  }
+  return written;
+}
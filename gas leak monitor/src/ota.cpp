@@ -0,0 +1,167 @@
+#include "ota.h"
+
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+
+#include "event_log.h"
+
+#define OTA_NAMESPACE "ota"
+#define OTA_TRIAL_KEY "trial"
+
+OtaService ota;
+
+// Keeps initArduino() from confirming an image the bootloader holds on
+// trial; poll() does that once the sensing path works
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+
+void OtaService::begin() {
+  Preferences prefs;
+  prefs.begin(OTA_NAMESPACE, false);
+  size_t len = prefs.getBytes(OTA_TRIAL_KEY, &_record, sizeof(_record));
+  if (len != sizeof(_record) || _record.magic != OTA_TRIAL_MAGIC) {
+    prefs.end();
+    return;
+  }
+
+  // The bootloader or rollBack() went back to the previous image
+  const esp_partition_t *running = esp_ota_get_running_partition();
+  if (strcmp(running->label, _record.image) != 0) {
+    Serial.printf("OTA: image in %s failed its trial, running %s again\n", _record.image, running->label);
+    events.log(EVENT_OTA, EVENT_OTA_ROLLED_BACK, _record.boots);
+    prefs.remove(OTA_TRIAL_KEY);
+    prefs.end();
+    return;
+  }
+
+  _record.boots++;
+  prefs.putBytes(OTA_TRIAL_KEY, &_record, sizeof(_record));
+  prefs.end();
+  if (_record.boots > OTA_TRIAL_BOOTS) {
+    rollBack();
+    return;
+  }
+
+  esp_timer_create_args_t args = {};
+  args.callback = [](void *) { ota.rollBack(); };
+  args.name = "ota_trial";
+  esp_timer_create(&args, &_timer);
+  esp_timer_start_once(_timer, OTA_TRIAL_MS * 1000ULL);
+  _trial = true;
+  Serial.printf("OTA: %s on trial, boot %u of %u\n", _record.image, _record.boots, OTA_TRIAL_BOOTS);
+}
+
+void OtaService::addRoutes(AsyncWebServer &server) {
+  server.on("/api/ota", HTTP_GET, [this](AsyncWebServerRequest *request) {
+    sendStatus(request, 200);
+  });
+
+  server.on("/api/ota/begin", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    if (!request->hasParam("size") || !request->hasParam("md5")) {
+      sendStatus(request, 400);
+      return;
+    }
+    uint32_t size = strtoul(request->getParam("size")->value().c_str(), NULL, 10);
+    sendStatus(request, _session.begin(size, request->getParam("md5")->value().c_str()));
+  });
+
+  // The body is written piece by piece as it arrives; the reply says whether
+  // all of it landed, so a retried chunk that already did is acknowledged
+  server.on("/api/ota/chunk", HTTP_POST,
+    [this](AsyncWebServerRequest *request) {
+      if (!request->hasParam("offset")) {
+        sendStatus(request, 400);
+        return;
+      }
+      uint32_t end = chunkOffset(request) + request->contentLength();
+      int code = _session.state() == OTA_FAILED ? 500 : _session.offset() == end ? 200 : 409;
+      sendStatus(request, code);
+    },
+    NULL,
+    [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+      if (request->hasParam("offset")) {
+        _session.write(chunkOffset(request) + index, data, len);
+      }
+    });
+
+  server.on("/api/ota/finish", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    bool installed = _session.state() == OTA_READY;
+    int code = _session.finish();
+    if (code == 200 && !installed) {
+      startTrial();
+    }
+    sendStatus(request, code);
+  });
+
+  server.on("/api/ota/abort", HTTP_POST, [this](AsyncWebServerRequest *request) {
+    _session.abort();
+    sendStatus(request, 200);
+  });
+}
+
+void OtaService::poll(bool healthy) {
+  if (!_trial || !healthy) return;
+
+  esp_timer_stop(_timer);
+  _trial = false;
+  esp_ota_mark_app_valid_cancel_rollback();
+
+  Preferences prefs;
+  prefs.begin(OTA_NAMESPACE, false);
+  prefs.remove(OTA_TRIAL_KEY);
+  prefs.end();
+  events.log(EVENT_OTA, EVENT_OTA_CONFIRMED, _record.boots);
+  Serial.printf("OTA: image in %s confirmed\n", _record.image);
+}
+
+void OtaService::sendStatus(AsyncWebServerRequest *request, int code) {
+  char json[OTA_STATUS_SIZE];
+  _session.formatStatus(json, sizeof(json));
+  request->send(code, "application/json", json);
+}
+
+// Update.end() has already made the new image the boot partition
+void OtaService::startTrial() {
+  if (_trial) {
+    // Replaced while on trial itself; the next boot judges the newest image
+    esp_timer_stop(_timer);
+    _trial = false;
+  }
+
+  _record = {};
+  _record.magic = OTA_TRIAL_MAGIC;
+  strlcpy(_record.image, esp_ota_get_boot_partition()->label, sizeof(_record.image));
+  strlcpy(_record.previous, esp_ota_get_running_partition()->label, sizeof(_record.previous));
+
+  Preferences prefs;
+  prefs.begin(OTA_NAMESPACE, false);
+  prefs.putBytes(OTA_TRIAL_KEY, &_record, sizeof(_record));
+  prefs.end();
+  events.log(EVENT_OTA, EVENT_OTA_INSTALLED, 0);
+}
+
+// Runs from setup() or the esp_timer task; the record stays, so the next
+// boot finds the previous image running and logs the rollback
+void OtaService::rollBack() {
+  const esp_partition_t *previous =
+    esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, _record.previous);
+  if (previous == NULL || esp_ota_set_boot_partition(previous) != ESP_OK) {
+    // Nothing to go back to; keep running rather than restart forever
+    Serial.printf("OTA: cannot roll back to %s, keeping %s\n", _record.previous, _record.image);
+    _trial = false;
+    Preferences prefs;
+    prefs.begin(OTA_NAMESPACE, false);
+    prefs.remove(OTA_TRIAL_KEY);
+    prefs.end();
+    return;
+  }
+
+  Serial.printf("OTA: %s failed its trial, rolling back to %s\n", _record.image, previous->label);
+  esp_restart();
+}
+
+uint32_t OtaService::chunkOffset(AsyncWebServerRequest *request) {
+  return strtoul(request->getParam("offset")->value().c_str(), NULL, 10);
+}
@@ -0,0 +1,46 @@
+#include "rule_store.h"
+
+#define RULE_STORE_NAMESPACE "gasrules"
+#define RULE_STORE_KEY "rules"
+
+RuleStore ruleStore;
+
+void RuleStore::begin(RuleSet &set, AlarmProgram &program) {
+  _prefs.begin(RULE_STORE_NAMESPACE, false);
+
+  Record record;
+  if (_prefs.getBytesLength(RULE_STORE_KEY) == sizeof(Record) &&
+      _prefs.getBytes(RULE_STORE_KEY, &record, sizeof(record)) == sizeof(record) &&
+      record.version == RULE_STORE_VERSION && record.size == sizeof(Record) &&
+      compileRules(record.set, program)) {
+    set = record.set;
+    return;
+  }
+
+  // Nothing stored yet, or an old layout: the two threshold rules
+  defaultRules(set);
+  compileRules(set, program);
+}
+
+void RuleStore::save(const RuleSet &set) {
+  portENTER_CRITICAL(&_mux);
+  _staged.set = set;
+  _dirty = true;
+  portEXIT_CRITICAL(&_mux);
+}
+
+void RuleStore::poll() {
+  if (!_dirty) return;
+
+  portENTER_CRITICAL(&_mux);
+  Record record = _staged;
+  _dirty = false;
+  portEXIT_CRITICAL(&_mux);
+
+  record.version = RULE_STORE_VERSION;
+  record.size = sizeof(Record);
+  if (_prefs.putBytes(RULE_STORE_KEY, &record, sizeof(record)) != sizeof(record)) {
+    Serial.println("Rule commit failed");
+    _dirty = true;
+  }
+}
@@ -0,0 +1,168 @@
+#include "settings.h"
+
+#include <EEPROM.h>
+
+#define SETTINGS_NAMESPACE "gasmon"
+#define SETTINGS_KEY "settings"
+
+// Layout used by firmware before the NVS store, read once for migration
+#define LEGACY_EEPROM_SIZE 512
+#define LEGACY_ADDR_AP_PASS 0
+#define LEGACY_ADDR_STATION_SSID 32
+#define LEGACY_ADDR_STATION_PASS 64
+#define LEGACY_ADDR_GAS_THRESHOLD 128
+#define LEGACY_ADDR_TEMP_THRESHOLD 132
+#define LEGACY_ADDR_AUTO_MODE 136
+
+// Version 1 record: the current layout up to tempThreshold, then its CRC
+#define SETTINGS_V1_DATA_SIZE offsetof(DeviceSettings, gasR0)
+#define SETTINGS_V1_SIZE (SETTINGS_V1_DATA_SIZE + sizeof(uint32_t))
+
+SettingsStore settings;
+
+void SettingsStore::begin(const DeviceSettings &defaults) {
+  _prefs.begin(SETTINGS_NAMESPACE, false);
+
+  DeviceSettings loaded;
+  if (readRecord(loaded)) {
+    _current = loaded;
+    return;
+  }
+
+  // Older layouts keep everything but the gas threshold, which was in ADC counts
+  _current = defaults;
+  if (readRecordV1(_current)) {
+    _current.gasThreshold = defaults.gasThreshold;
+    _current.gasR0 = defaults.gasR0;
+    Serial.println("Migrating settings from version 1");
+  } else if (readLegacyEeprom(_current)) {
+    Serial.println("Migrating settings from EEPROM layout");
+  } else {
+    Serial.println("No valid settings record, using defaults");
+  }
+
+  // Write the migrated/default record once so the next boot takes the fast path
+  _dirty = true;
+  commit();
+}
+
+DeviceSettings SettingsStore::get() {
+  portENTER_CRITICAL(&_mux);
+  DeviceSettings copy = _current;
+  portEXIT_CRITICAL(&_mux);
+  return copy;
+}
+
+void SettingsStore::save(const DeviceSettings &settings) {
+  uint32_t now = millis();
+
+  portENTER_CRITICAL(&_mux);
+  if (memcmp(_current.apPassword, settings.apPassword, offsetof(DeviceSettings, crc) - offsetof(DeviceSettings, apPassword)) != 0) {
+    memcpy(_current.apPassword, settings.apPassword, offsetof(DeviceSettings, crc) - offsetof(DeviceSettings, apPassword));
+    if (!_dirty) {
+      _firstChangeMs = now;
+    }
+    _lastChangeMs = now;
+    _dirty = true;
+  }
+  portEXIT_CRITICAL(&_mux);
+}
+
+void SettingsStore::poll() {
+  if (!_dirty) return;
+
+  uint32_t now = millis();
+  if (now - _lastChangeMs >= SETTINGS_COMMIT_DELAY_MS || now - _firstChangeMs >= SETTINGS_COMMIT_MAX_DELAY_MS) {
+    commit();
+  }
+}
+
+void SettingsStore::commitNow() {
+  if (_dirty) {
+    commit();
+  }
+}
+
+void SettingsStore::commit() {
+  portENTER_CRITICAL(&_mux);
+  DeviceSettings record = _current;
+  _dirty = false;
+  portEXIT_CRITICAL(&_mux);
+
+  record.version = SETTINGS_VERSION;
+  record.size = sizeof(DeviceSettings);
+  record.crc = checksum(&record, offsetof(DeviceSettings, crc));
+
+  if (_prefs.putBytes(SETTINGS_KEY, &record, sizeof(record)) != sizeof(record)) {
+    Serial.println("Settings commit failed");
+    _dirty = true;
+    return;
+  }
+  _commits++;
+}
+
+bool SettingsStore::readRecord(DeviceSettings &settings) {
+  if (_prefs.getBytesLength(SETTINGS_KEY) != sizeof(DeviceSettings)) {
+    return false;
+  }
+  _prefs.getBytes(SETTINGS_KEY, &settings, sizeof(settings));
+
+  return settings.version == SETTINGS_VERSION &&
+         settings.size == sizeof(DeviceSettings) &&
+         settings.crc == checksum(&settings, offsetof(DeviceSettings, crc));
+}
+
+bool SettingsStore::readRecordV1(DeviceSettings &settings) {
+  if (_prefs.getBytesLength(SETTINGS_KEY) != SETTINGS_V1_SIZE) {
+    return false;
+  }
+  uint8_t raw[SETTINGS_V1_SIZE];
+  _prefs.getBytes(SETTINGS_KEY, raw, sizeof(raw));
+
+  DeviceSettings record;
+  uint32_t crc;
+  memcpy(&record, raw, SETTINGS_V1_DATA_SIZE);
+  memcpy(&crc, raw + SETTINGS_V1_DATA_SIZE, sizeof(crc));
+  if (record.version != 1 || record.size != SETTINGS_V1_SIZE || crc != checksum(raw, SETTINGS_V1_DATA_SIZE)) {
+    return false;
+  }
+
+  memcpy(&settings, &record, SETTINGS_V1_DATA_SIZE);
+  return true;
+}
+
+bool SettingsStore::readLegacyEeprom(DeviceSettings &settings) {
+  if (!EEPROM.begin(LEGACY_EEPROM_SIZE)) {
+    return false;
+  }
+
+  float gas = EEPROM.readFloat(LEGACY_ADDR_GAS_THRESHOLD);
+  float temp = EEPROM.readFloat(LEGACY_ADDR_TEMP_THRESHOLD);
+
+  // An erased or never-written sector has no usable thresholds
+  bool valid = !isnan(gas) && gas >= 0 && gas <= 4095 && !isnan(temp) && temp >= 0 && temp <= 100;
+  if (valid) {
+    EEPROM.readString(LEGACY_ADDR_AP_PASS, settings.apPassword, 32);
+    EEPROM.readString(LEGACY_ADDR_STATION_SSID, settings.stationSSID, 32);
+    EEPROM.readString(LEGACY_ADDR_STATION_PASS, settings.stationPassword, 32);
+    settings.tempThreshold = temp;
+    settings.autoMode = EEPROM.read(LEGACY_ADDR_AUTO_MODE) == 1;
+  }
+
+  EEPROM.end();
+  return valid;
+}
+
+// Bitwise CRC-32 (IEEE); runs a handful of times per boot/commit, so no table
+uint32_t SettingsStore::checksum(const void *data, size_t len) {
+  const uint8_t *bytes = (const uint8_t *)data;
+
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= bytes[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
@@ -0,0 +1,214 @@
+#include "socket_hub.h"
+
+SocketHub sockets;
+
+void SocketHub::begin(AsyncWebServer &server, SocketHandler handler) {
+  _handler = handler;
+  _inbox = xQueueCreate(SOCKET_INBOX_LENGTH, sizeof(InboxEvent));
+  _lock = xSemaphoreCreateRecursiveMutex();
+  _ws.onEvent([this](AsyncWebSocket *ws, AsyncWebSocketClient *client, AwsEventType type,
+                     void *arg, uint8_t *data, size_t len) {
+    onEvent(client, type, arg, data, len);
+  });
+  server.addHandler(&_ws);
+}
+
+// AsyncTCP task: tracks the client pointer and copies the event into the inbox
+void SocketHub::onEvent(AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
+  InboxEvent &event = _incoming;
+  event.id = client->id();
+  event.length = 0;
+
+  switch (type) {
+    case WS_EVT_CONNECT:
+      {
+        Live *entry = NULL;
+        xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+        for (uint8_t i = 0; i < SOCKET_MAX_CLIENTS && entry == NULL; i++) {
+          if (_live[i].id == 0) entry = &_live[i];
+        }
+        if (entry != NULL && _ws.count() <= SOCKET_MAX_CLIENTS) {
+          entry->id = event.id;
+          entry->client = client;
+        } else {
+          entry = NULL;
+        }
+        xSemaphoreGiveRecursive(_lock);
+        if (entry == NULL) {
+          _rejected++;
+          client->close(SOCKET_CLOSE_TRY_AGAIN);
+          return;
+        }
+      }
+      event.type = SOCKET_CONNECTED;
+      break;
+
+    case WS_EVT_DISCONNECT:
+      // The client is freed once this returns; waits out a send in progress
+      xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+      for (uint8_t i = 0; i < SOCKET_MAX_CLIENTS; i++) {
+        if (_live[i].id == event.id) {
+          _live[i].id = 0;
+          _live[i].client = NULL;
+        }
+      }
+      xSemaphoreGiveRecursive(_lock);
+      event.type = SOCKET_DISCONNECTED;
+      break;
+
+    case WS_EVT_DATA:
+      {
+        // Commands are small; whole single-frame text messages only
+        AwsFrameInfo *info = (AwsFrameInfo *)arg;
+        if (!info->final || info->index != 0 || info->len != len || info->opcode != WS_TEXT ||
+            len > SOCKET_MESSAGE_MAX) {
+          _refusedFrames++;
+          return;
+        }
+        event.type = SOCKET_TEXT;
+        event.length = len;
+        memcpy(event.payload, data, len);
+      }
+      break;
+
+    default:
+      return;
+  }
+
+  if (xQueueSend(_inbox, &event, 0) != pdTRUE) {
+    _inboxDrops++;
+    if (type == WS_EVT_CONNECT) {
+      client->close(SOCKET_CLOSE_TRY_AGAIN);
+    }
+    // A lost disconnect is caught by the stale slot check in poll()
+  }
+}
+
+void SocketHub::poll() {
+  if (_inbox == NULL) return;
+
+  while (xQueueReceive(_inbox, &_received, 0) == pdTRUE) {
+    int num = slotOf(_received.id);
+
+    switch (_received.type) {
+      case SOCKET_CONNECTED:
+        if (num < 0) {
+          num = slotOf(0);
+        }
+        if (num < 0) {
+          _rejected++;
+          xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+          if (AsyncWebSocketClient *client = liveClient(_received.id)) {
+            client->close(SOCKET_CLOSE_TRY_AGAIN);
+          }
+          xSemaphoreGiveRecursive(_lock);
+          break;
+        }
+        _slots[num].id = _received.id;
+        _slots[num].full = false;
+        _handler(num, SOCKET_CONNECTED, NULL, 0);
+        break;
+
+      case SOCKET_DISCONNECTED:
+        if (num >= 0) {
+          release(num);
+        }
+        break;
+
+      case SOCKET_TEXT:
+        if (num >= 0) {
+          _handler(num, SOCKET_TEXT, _received.payload, _received.length);
+        }
+        break;
+    }
+  }
+
+  // Slots whose disconnect never made it through the inbox, then the library's own bookkeeping
+  uint32_t now = millis();
+  if (now - _lastCheckMs >= SOCKET_CHECK_INTERVAL_MS) {
+    _lastCheckMs = now;
+    for (uint8_t num = 0; num < SOCKET_MAX_CLIENTS; num++) {
+      if (_slots[num].id == 0) continue;
+      xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+      bool gone = liveClient(_slots[num].id) == NULL;
+      xSemaphoreGiveRecursive(_lock);
+      if (gone) {
+        release(num);
+      }
+    }
+    xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+    _ws.cleanupClients(SOCKET_MAX_CLIENTS);
+    xSemaphoreGiveRecursive(_lock);
+  }
+}
+
+bool SocketHub::send(uint8_t num, const uint8_t *data, size_t len, bool binary) {
+  if (!connected(num)) return false;
+
+  // Held until the message is queued, so AsyncTCP cannot free the client meanwhile
+  xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+  AsyncWebSocketClient *client = liveClient(_slots[num].id);
+  bool queued = client != NULL && queue(_slots[num], client, data, len, binary);
+  xSemaphoreGiveRecursive(_lock);
+  return queued;
+}
+
+bool SocketHub::queue(Slot &slot, AsyncWebSocketClient *client, const uint8_t *data, size_t len, bool binary) {
+  // A full queue means the client is not keeping up; the caller coalesces and retries
+  if (client->queueIsFull()) {
+    uint32_t now = millis();
+    if (!slot.full) {
+      slot.full = true;
+      slot.fullSinceMs = now;
+    } else if (now - slot.fullSinceMs >= SOCKET_SLOW_CLIENT_MS) {
+      _evicted++;
+      client->close(SOCKET_CLOSE_TRY_AGAIN);
+      slot.full = false;
+    }
+    return false;
+  }
+  slot.full = false;
+
+  if (binary) {
+    client->binary((const char *)data, len);
+  } else {
+    client->text((const char *)data, len);
+  }
+  return true;
+}
+
+void SocketHub::broadcast(const char *text, size_t len) {
+  for (uint8_t num = 0; num < SOCKET_MAX_CLIENTS; num++) {
+    if (_slots[num].id != 0) {
+      send(num, (const uint8_t *)text, len, false);
+    }
+  }
+}
+
+uint8_t SocketHub::count() const {
+  uint8_t count = 0;
+  for (uint8_t num = 0; num < SOCKET_MAX_CLIENTS; num++) {
+    if (_slots[num].id != 0) count++;
+  }
+  return count;
+}
+
+void SocketHub::release(uint8_t num) {
+  _slots[num].id = 0;
+  _handler(num, SOCKET_DISCONNECTED, NULL, 0);
+}
+
+int SocketHub::slotOf(uint32_t id) const {
+  for (uint8_t num = 0; num < SOCKET_MAX_CLIENTS; num++) {
+    if (_slots[num].id == id) return num;
+  }
+  return -1;
+}
+
+AsyncWebSocketClient *SocketHub::liveClient(uint32_t id) const {
+  if (id == 0) return NULL;
+  for (uint8_t i = 0; i < SOCKET_MAX_CLIENTS; i++) {
+    if (_live[i].id == id) return _live[i].client;
+  }
+  return NULL;
+}
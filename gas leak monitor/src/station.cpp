@@ -0,0 +1,85 @@
+#include "station.h"
+
+StationLink station;
+
+void StationLink::begin() {
+  WiFi.onEvent([](arduino_event_id_t event, arduino_event_info_t info) {
+    station.onEvent(event, info);
+  });
+}
+
+void StationLink::connect(const char *ssid, const char *password) {
+  strlcpy(_ssid, ssid, sizeof(_ssid));
+  strlcpy(_password, password, sizeof(_password));
+  _backoffMs = STATION_BACKOFF_MIN_MS;
+
+  // Keeps the softAP up while the station interface joins
+  WiFi.mode(WIFI_AP_STA);
+  WiFi.setAutoReconnect(false);  // Retries are paced here instead
+  attempt();
+}
+
+void StationLink::disconnect() {
+  if (_state == STATION_IDLE) return;
+
+  setState(STATION_IDLE);
+  WiFi.disconnect(false);
+  WiFi.mode(WIFI_AP);
+}
+
+void StationLink::poll() {
+  if (_state == STATION_BACKOFF && (int32_t)(millis() - _retryAtMs) >= 0) {
+    attempt();
+  }
+}
+
+uint32_t StationLink::retryInMs() const {
+  if (_state != STATION_BACKOFF) return 0;
+  int32_t remaining = (int32_t)(_retryAtMs - millis());
+  return remaining > 0 ? remaining : 0;
+}
+
+void StationLink::attempt() {
+  if (_ssid[0] == '\0') {
+    setState(STATION_IDLE);
+    return;
+  }
+  _attempts++;
+  setState(STATION_CONNECTING);
+  WiFi.begin(_ssid, _password);
+}
+
+// Runs in the WiFi event task; only records state, poll() does the retrying
+void StationLink::onEvent(arduino_event_id_t event, arduino_event_info_t info) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      if (_state == STATION_IDLE) break;
+      _backoffMs = STATION_BACKOFF_MIN_MS;
+      setState(STATION_CONNECTED);
+      Serial.print("Station connected, IP address: ");
+      Serial.println(WiFi.localIP());
+      break;
+
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      if (_state == STATION_IDLE) break;
+      _lastReason = info.wifi_sta_disconnected.reason;
+      if (_state == STATION_BACKOFF) break;  // Echo of an attempt already given up on
+
+      // Jitter keeps several monitors from retrying in lockstep after a router reboot
+      _retryAtMs = millis() + _backoffMs + esp_random() % (_backoffMs / 4 + 1);
+      Serial.printf("Station disconnected (reason %u), retrying in %u ms\n", _lastReason, _backoffMs);
+      _backoffMs = min<uint32_t>(_backoffMs * 2, STATION_BACKOFF_MAX_MS);
+      setState(STATION_BACKOFF);
+      break;
+
+    default:
+      break;
+  }
+}
+
+void StationLink::setState(StationState state) {
+  if (_state != state) {
+    _state = state;
+    _changes++;
+  }
+}
@@ -0,0 +1,202 @@
+#include "telemetry.h"
+#include "metrics.h"
+
+TelemetryPublisher telemetry;
+
+void TelemetryPublisher::begin(SocketHub &sockets, const String &deviceID) {
+  _sockets = &sockets;
+  _deviceID = &deviceID;
+}
+
+void TelemetryPublisher::clientConnected(uint8_t num, const SensorSnapshot &snapshot) {
+  if (num >= SOCKET_MAX_CLIENTS) return;
+
+  Client &client = _clients[num];
+  client.connected = true;
+  client.dirty = false;
+  client.binary = false;
+  client.intervalMs = TELEMETRY_DEFAULT_INTERVAL_MS;
+  client.deadband.temperature = TELEMETRY_DEADBAND_TEMPERATURE;
+  client.deadband.humidity = TELEMETRY_DEADBAND_HUMIDITY;
+  client.deadband.gasLevel = TELEMETRY_DEADBAND_GAS;
+  client.messages = 0;
+  client.bytes = 0;
+  client.failures = 0;
+  client.coalesced = 0;
+
+  _latest = snapshot;
+  sendSnapshot(num, snapshot);
+}
+
+void TelemetryPublisher::clientDisconnected(uint8_t num) {
+  if (num >= SOCKET_MAX_CLIENTS) return;
+  _clients[num].connected = false;
+}
+
+void TelemetryPublisher::subscribe(uint8_t num, JsonVariantConst options) {
+  if (num >= SOCKET_MAX_CLIENTS) return;
+  Client &client = _clients[num];
+
+  // Text JSON stays the default; binary is opt-in per client
+  const char *format = options["format"];
+  if (format != NULL) {
+    client.binary = strcmp(format, "binary") == 0;
+  }
+
+  if (options["interval"].is<int>()) {
+    int interval = options["interval"];
+    client.intervalMs = constrain(interval, TELEMETRY_MIN_INTERVAL_MS, 60000);
+  }
+
+  JsonVariantConst deadband = options["deadband"];
+  if (deadband["temperature"].is<float>()) client.deadband.temperature = fabsf(deadband["temperature"].as<float>());
+  if (deadband["humidity"].is<float>()) client.deadband.humidity = fabsf(deadband["humidity"].as<float>());
+  if (deadband["gasLevel"].is<float>()) client.deadband.gasLevel = fabsf(deadband["gasLevel"].as<float>());
+}
+
+void TelemetryPublisher::sendSnapshot(uint8_t num, const SensorSnapshot &snapshot) {
+  if (_sockets == NULL || num >= SOCKET_MAX_CLIENTS) return;
+
+  bool sent;
+  if (_clients[num].binary) {
+    sent = sendFrame(num, snapshot, true);
+  } else {
+    JsonDocument doc(&_pool);
+    doc["type"] = "snapshot";
+    doc["deviceID"] = _deviceID->c_str();
+    writeTelemetrySnapshot(doc, snapshot);
+    sent = sendJson(num, doc);
+  }
+
+  // A refused snapshot leaves the client dirty; the next flush sends a delta against what it had
+  if (sent) {
+    markSent(_clients[num], snapshot, millis());
+  } else {
+    _clients[num].dirty = true;
+  }
+}
+
+void TelemetryPublisher::publish(const SensorSnapshot &snapshot) {
+  MetricsTimer timer(metrics.telemetryPublish);
+  _latest = snapshot;
+
+  uint32_t now = millis();
+  for (uint8_t num = 0; num < SOCKET_MAX_CLIENTS; num++) {
+    if (_clients[num].connected) {
+      if (_clients[num].dirty) {
+        _clients[num].coalesced++;
+      }
+      _clients[num].dirty = true;
+      flush(num, now);
+    }
+  }
+}
+
+void TelemetryPublisher::poll() {
+  uint32_t now = millis();
+  for (uint8_t num = 0; num < SOCKET_MAX_CLIENTS; num++) {
+    if (_clients[num].connected && _clients[num].dirty) {
+      flush(num, now);
+    }
+  }
+}
+
+// Sends the latest state to one client as a delta against what it last received
+void TelemetryPublisher::flush(uint8_t num, uint32_t now) {
+  Client &client = _clients[num];
+  const SensorSnapshot &latest = _latest;
+
+  uint8_t changes = telemetryChanges(client.sent, latest, client.deadband);
+  if (changes == 0) {
+    client.dirty = false;
+    return;
+  }
+
+  // Analog-only changes wait for the client's interval; the next poll picks them up
+  uint16_t interval = client.intervalMs;
+  uint16_t cap = _intervalCapMs;
+  if (cap != 0 && cap < interval) {
+    interval = cap;
+  }
+  if (!(changes & TELEMETRY_CHANGED_STATE) && now - client.lastSendMs < interval) {
+    return;
+  }
+
+  // A refused send leaves client.sent alone and the client dirty, so the
+  // change goes out, folded with later ones, on the next flush
+  if (client.binary) {
+    // Binary frames are fixed layout and always carry every field
+    if (sendFrame(num, latest, false)) {
+      markSent(client, latest, now);
+    }
+    return;
+  }
+
+  bool sent;
+  {
+    JsonDocument doc(&_pool);
+    doc["type"] = "delta";
+    writeTelemetryDelta(doc, client.sent, latest, changes);
+    sent = sendJson(num, doc);
+  }
+
+  // Only what the delta carried; analog fields under the deadband keep their baseline
+  if (sent) {
+    markTelemetryDelta(client.sent, latest, changes);
+    client.lastSendMs = now;
+    client.dirty = false;
+  }
+}
+
+// Serializes into the reusable output buffer; no String, no heap
+bool TelemetryPublisher::sendJson(uint8_t num, const JsonDocument &doc) {
+  size_t len = serializeJson(doc, _buffer, sizeof(_buffer));
+  if (doc.overflowed() || len == 0) {
+    Serial.println("Telemetry JSON pool exhausted, message dropped");
+    return false;
+  }
+  return transmit(num, (const uint8_t *)_buffer, len, false);
+}
+
+bool TelemetryPublisher::transmit(uint8_t num, const uint8_t *data, size_t len, bool binary) {
+  Client &client = _clients[num];
+
+  bool ok;
+  {
+    MetricsTimer timer(metrics.webSocketSend);
+    ok = _sockets->send(num, data, len, binary);
+  }
+
+  if (ok) {
+    client.messages++;
+    client.bytes += len;
+  } else {
+    client.failures++;
+  }
+  return ok;
+}
+
+bool TelemetryPublisher::clientStats(uint8_t num, TelemetryClientStats &stats) const {
+  if (num >= SOCKET_MAX_CLIENTS || !_clients[num].connected) return false;
+
+  const Client &client = _clients[num];
+  stats.pending = client.dirty ? 1 : 0;
+  stats.messages = client.messages;
+  stats.bytes = client.bytes;
+  stats.failures = client.failures;
+  stats.coalesced = client.coalesced;
+  return true;
+}
+
+void TelemetryPublisher::markSent(Client &client, const SensorSnapshot &snapshot, uint32_t now) {
+  client.sent = snapshot;
+  client.lastSendMs = now;
+  client.dirty = false;
+}
+
+bool TelemetryPublisher::sendFrame(uint8_t num, const SensorSnapshot &snapshot, bool full) {
+  TelemetryFrame frame;
+  encodeTelemetryFrame(snapshot, full, millis(), frame);
+
+  return transmit(num, (const uint8_t *)&frame, sizeof(frame), true);
+}
@@ -0,0 +1,128 @@
+// Button debounce, long press and auto-repeat (button_logic.h): pio test -e native
+#include <unity.h>
+#include "button_logic.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Next event at nowMs; fails the test when nothing is due
+static ButtonEventType next(ButtonTracker &button, uint32_t nowMs, uint32_t &timeMs) {
+  ButtonEventType type = BUTTON_RELEASE;
+  TEST_ASSERT_TRUE_MESSAGE(button.update(nowMs, type, timeMs), "expected an event");
+  return type;
+}
+
+static void assertIdle(ButtonTracker &button, uint32_t nowMs) {
+  ButtonEventType type;
+  uint32_t timeMs;
+  TEST_ASSERT_FALSE(button.update(nowMs, type, timeMs));
+}
+
+static void test_press_settles_after_the_debounce_time() {
+  ButtonTracker button;
+  uint32_t timeMs;
+  button.edge(true, 100);
+  assertIdle(button, 100 + BUTTON_DEBOUNCE_MS - 1);
+
+  TEST_ASSERT_EQUAL(BUTTON_PRESS, next(button, 100 + BUTTON_DEBOUNCE_MS, timeMs));
+  TEST_ASSERT_EQUAL_UINT32(100, timeMs);
+  TEST_ASSERT_TRUE(button.pressed());
+  assertIdle(button, 100 + BUTTON_DEBOUNCE_MS);
+}
+
+static void test_bounces_restart_the_settle_time() {
+  ButtonTracker button;
+  uint32_t timeMs;
+  button.edge(true, 0);
+  button.edge(false, 5);
+  button.edge(true, 12);
+  assertIdle(button, 12 + BUTTON_DEBOUNCE_MS - 1);
+
+  TEST_ASSERT_EQUAL(BUTTON_PRESS, next(button, 12 + BUTTON_DEBOUNCE_MS, timeMs));
+  TEST_ASSERT_EQUAL_UINT32(12, timeMs);
+}
+
+static void test_a_glitch_shorter_than_the_debounce_is_ignored() {
+  ButtonTracker button;
+  button.edge(true, 0);
+  button.edge(false, 10);
+  assertIdle(button, 10 + BUTTON_DEBOUNCE_MS);
+  TEST_ASSERT_FALSE(button.pressed());
+}
+
+static void test_release_is_reported() {
+  ButtonTracker button;
+  uint32_t timeMs;
+  button.edge(true, 0);
+  next(button, BUTTON_DEBOUNCE_MS, timeMs);
+  button.edge(false, 200);
+
+  TEST_ASSERT_EQUAL(BUTTON_RELEASE, next(button, 200 + BUTTON_DEBOUNCE_MS, timeMs));
+  TEST_ASSERT_EQUAL_UINT32(200, timeMs);
+  TEST_ASSERT_FALSE(button.pressed());
+  assertIdle(button, 5000);
+}
+
+static void test_long_press_then_repeats_speed_up() {
+  ButtonTracker button;
+  uint32_t timeMs;
+  button.edge(true, 0);
+  next(button, BUTTON_DEBOUNCE_MS, timeMs);
+  assertIdle(button, BUTTON_LONG_PRESS_MS - 1);
+
+  TEST_ASSERT_EQUAL(BUTTON_LONG_PRESS, next(button, BUTTON_LONG_PRESS_MS, timeMs));
+  TEST_ASSERT_EQUAL_UINT32(BUTTON_LONG_PRESS_MS, timeMs);
+
+  // The first repeat is due with the long press, then one every BUTTON_REPEAT_MS
+  uint32_t due = BUTTON_LONG_PRESS_MS;
+  for (int repeat = 1; repeat <= BUTTON_REPEAT_FAST_AFTER; repeat++) {
+    TEST_ASSERT_EQUAL(BUTTON_REPEAT, next(button, due, timeMs));
+    TEST_ASSERT_EQUAL_UINT32(due, timeMs);
+    uint32_t interval = repeat >= BUTTON_REPEAT_FAST_AFTER ? BUTTON_REPEAT_FAST_MS : BUTTON_REPEAT_MS;
+    assertIdle(button, due + interval - 1);
+    due += interval;
+  }
+
+  TEST_ASSERT_EQUAL(BUTTON_REPEAT, next(button, due, timeMs));
+  assertIdle(button, due + BUTTON_REPEAT_FAST_MS - 1);
+  TEST_ASSERT_EQUAL(BUTTON_REPEAT, next(button, due + BUTTON_REPEAT_FAST_MS, timeMs));
+}
+
+static void test_a_late_consumer_gets_one_repeat() {
+  ButtonTracker button;
+  uint32_t timeMs;
+  button.edge(true, 0);
+  next(button, BUTTON_DEBOUNCE_MS, timeMs);
+  next(button, BUTTON_LONG_PRESS_MS, timeMs);
+  next(button, BUTTON_LONG_PRESS_MS, timeMs);
+
+  TEST_ASSERT_EQUAL(BUTTON_REPEAT, next(button, 5000, timeMs));
+  assertIdle(button, 5000);
+  assertIdle(button, 5000 + BUTTON_REPEAT_MS - 1);
+  TEST_ASSERT_EQUAL(BUTTON_REPEAT, next(button, 5000 + BUTTON_REPEAT_MS, timeMs));
+}
+
+static void test_timestamps_wrap() {
+  ButtonTracker button;
+  uint32_t timeMs;
+  uint32_t start = 0xFFFFFFF0u;
+  button.edge(true, start);
+  assertIdle(button, start + 10);
+
+  TEST_ASSERT_EQUAL(BUTTON_PRESS, next(button, start + BUTTON_DEBOUNCE_MS, timeMs));
+  TEST_ASSERT_EQUAL_UINT32(start, timeMs);
+  assertIdle(button, start + BUTTON_LONG_PRESS_MS - 1);
+  TEST_ASSERT_EQUAL(BUTTON_LONG_PRESS, next(button, start + BUTTON_LONG_PRESS_MS, timeMs));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_press_settles_after_the_debounce_time);
+  RUN_TEST(test_bounces_restart_the_settle_time);
+  RUN_TEST(test_a_glitch_shorter_than_the_debounce_is_ignored);
+  RUN_TEST(test_release_is_reported);
+  RUN_TEST(test_long_press_then_repeats_speed_up);
+  RUN_TEST(test_a_late_consumer_gets_one_repeat);
+  RUN_TEST(test_timestamps_wrap);
+  return UNITY_END();
+}
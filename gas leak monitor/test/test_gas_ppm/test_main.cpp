@@ -0,0 +1,99 @@
+// Fixed-point ADC to ppm conversion (gas_ppm.h) against the float curve: pio test -e native
+#include <math.h>
+#include <unity.h>
+#include "gas_ppm.h"
+
+void setUp() {}
+void tearDown() {}
+
+// The datasheet curve in floating point, at the reference climate unless k says otherwise
+static float curvePpm(float adc, float r0, float k = 1.0f) {
+  float ratio = (GAS_PPM_ADC_FULL_SCALE - adc) / adc / r0 / k;
+  return GAS_PPM_CURVE_A * powf(ratio, GAS_PPM_CURVE_B);
+}
+
+static void test_uncalibrated_default() {
+  GasPpmConverter gas;
+  TEST_ASSERT_FALSE(gas.calibrated());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, GAS_PPM_DEFAULT_R0, gas.r0());
+
+  gas.setR0(2.5f);
+  TEST_ASSERT_TRUE(gas.calibrated());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 2.5f, gas.r0());
+
+  gas.setR0(0);
+  TEST_ASSERT_FALSE(gas.calibrated());
+}
+
+static void test_tables_follow_the_curve() {
+  GasPpmConverter gas;
+  for (int adc = 200; adc <= 3800; adc += 75) {
+    float expected = curvePpm(adc, GAS_PPM_DEFAULT_R0);
+    if (expected < 10 || expected > GAS_PPM_MAX) continue;
+    float ppm = gas.toPpmQ4(adc) / 16.0f;
+    TEST_ASSERT_FLOAT_WITHIN(expected * 0.02f, expected, ppm);
+  }
+}
+
+static void test_ppm_rises_with_the_adc_and_clamps() {
+  GasPpmConverter gas;
+  uint32_t last = 0;
+  for (int adc = 0; adc <= GAS_PPM_ADC_FULL_SCALE; adc++) {
+    uint32_t ppmQ4 = gas.toPpmQ4(adc);
+    TEST_ASSERT_TRUE(ppmQ4 >= last);
+    TEST_ASSERT_TRUE(ppmQ4 <= (uint32_t)GAS_PPM_MAX << 4);
+    last = ppmQ4;
+  }
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)GAS_PPM_MAX << 4, gas.toPpmQ4(GAS_PPM_ADC_FULL_SCALE));
+}
+
+static void test_fractional_level_matches_the_sample_path() {
+  GasPpmConverter gas;
+  for (int adc = 500; adc <= 3000; adc += 250) {
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, gas.toPpmQ4(adc) / 16.0f, gas.toPpm(adc));
+  }
+  float between = gas.toPpm(1000.5f);
+  TEST_ASSERT_TRUE(between > gas.toPpm(1000) && between < gas.toPpm(1001));
+}
+
+static void test_clean_air_calibration() {
+  GasPpmConverter gas;
+  gas.calibrate(300);
+  TEST_ASSERT_TRUE(gas.calibrated());
+
+  // Rs/R0 reads back as the clean-air ratio at the calibration level
+  float r0 = (GAS_PPM_ADC_FULL_SCALE - 300.0f) / 300.0f / GAS_PPM_CLEAN_AIR_RATIO;
+  TEST_ASSERT_FLOAT_WITHIN(r0 * 0.01f, r0, gas.r0());
+  float expected = curvePpm(300, r0);
+  TEST_ASSERT_FLOAT_WITHIN(expected * 0.03f, expected, gas.toPpm(300));
+}
+
+static void test_climate_correction() {
+  GasPpmConverter reference;
+  GasPpmConverter warm;
+
+  // 20 °C / 33 %RH is the datasheet reference: no correction
+  warm.setClimate(20, 33);
+  TEST_ASSERT_EQUAL_UINT32(reference.toPpmQ4(1500), warm.toPpmQ4(1500));
+
+  // Warm, humid air lowers Rs (factor 0.77), which the conversion takes back out
+  warm.setClimate(50, 85);
+  float expected = curvePpm(1500, GAS_PPM_DEFAULT_R0, 0.77f);
+  TEST_ASSERT_TRUE(warm.toPpmQ4(1500) < reference.toPpmQ4(1500));
+  TEST_ASSERT_FLOAT_WITHIN(expected * 0.02f, expected, warm.toPpm(1500));
+
+  // Missing readings keep the last correction
+  warm.setClimate(NAN, 50);
+  TEST_ASSERT_FLOAT_WITHIN(expected * 0.02f, expected, warm.toPpm(1500));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_uncalibrated_default);
+  RUN_TEST(test_tables_follow_the_curve);
+  RUN_TEST(test_ppm_rises_with_the_adc_and_clamps);
+  RUN_TEST(test_fractional_level_matches_the_sample_path);
+  RUN_TEST(test_clean_air_calibration);
+  RUN_TEST(test_climate_correction);
+  return UNITY_END();
+}
@@ -0,0 +1,98 @@
+// LCD menu state machine (menu_logic.h): pio test -e native
+#include <unity.h>
+#include "menu_logic.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_mode_opens_and_closes_the_menu() {
+  MenuModel menu;
+  menu.position = 2;
+  TEST_ASSERT_EQUAL_UINT8(MENU_EFFECT_REDRAW, menuHandleKey(menu, MENU_KEY_MODE));
+  TEST_ASSERT_EQUAL(MENU_MAIN, menu.screen);
+  TEST_ASSERT_EQUAL(0, menu.position);
+
+  TEST_ASSERT_EQUAL_UINT8(MENU_EFFECT_SHOW_MAIN, menuHandleKey(menu, MENU_KEY_MODE));
+  TEST_ASSERT_EQUAL(MAIN_SCREEN, menu.screen);
+}
+
+static void test_main_screen_ignores_up_and_down() {
+  MenuModel menu;
+  TEST_ASSERT_EQUAL_UINT8(0, menuHandleKey(menu, MENU_KEY_UP));
+  TEST_ASSERT_EQUAL_UINT8(0, menuHandleKey(menu, MENU_KEY_DOWN));
+  TEST_ASSERT_EQUAL(MAIN_SCREEN, menu.screen);
+}
+
+static void test_up_wraps_around_the_menu() {
+  MenuModel menu;
+  menuHandleKey(menu, MENU_KEY_MODE);
+  TEST_ASSERT_EQUAL_UINT8(MENU_EFFECT_REDRAW, menuHandleKey(menu, MENU_KEY_UP));
+  TEST_ASSERT_EQUAL(MENU_ITEMS - 1, menu.position);
+  menuHandleKey(menu, MENU_KEY_UP);
+  TEST_ASSERT_EQUAL(MENU_ITEMS - 2, menu.position);
+}
+
+static void test_down_enters_the_selected_submenu() {
+  static const MenuState expected[MENU_ITEMS] = {
+    SET_TEMP_THRESHOLD, SET_GAS_THRESHOLD, WIFI_SETTINGS, DEVICE_INFO
+  };
+  for (int item = 0; item < MENU_ITEMS; item++) {
+    MenuModel menu;
+    menuHandleKey(menu, MENU_KEY_MODE);
+    menu.position = item;
+    TEST_ASSERT_EQUAL_UINT8(MENU_EFFECT_REDRAW, menuHandleKey(menu, MENU_KEY_DOWN));
+    TEST_ASSERT_EQUAL(expected[item], menu.screen);
+  }
+}
+
+static void test_threshold_screens_step_the_thresholds() {
+  MenuModel menu;
+  menu.screen = SET_TEMP_THRESHOLD;
+  TEST_ASSERT_EQUAL_UINT8(MENU_EFFECT_TEMP_UP | MENU_EFFECT_REDRAW, menuHandleKey(menu, MENU_KEY_UP));
+  TEST_ASSERT_EQUAL_UINT8(MENU_EFFECT_TEMP_DOWN | MENU_EFFECT_REDRAW, menuHandleKey(menu, MENU_KEY_DOWN));
+  TEST_ASSERT_EQUAL(SET_TEMP_THRESHOLD, menu.screen);
+
+  menu.screen = SET_GAS_THRESHOLD;
+  TEST_ASSERT_EQUAL_UINT8(MENU_EFFECT_GAS_UP | MENU_EFFECT_REDRAW, menuHandleKey(menu, MENU_KEY_UP));
+  TEST_ASSERT_EQUAL_UINT8(MENU_EFFECT_GAS_DOWN | MENU_EFFECT_REDRAW, menuHandleKey(menu, MENU_KEY_DOWN));
+  TEST_ASSERT_EQUAL(SET_GAS_THRESHOLD, menu.screen);
+}
+
+static void test_wifi_screen_toggles_on_either_key() {
+  MenuModel menu;
+  menu.screen = WIFI_SETTINGS;
+  TEST_ASSERT_EQUAL_UINT8(MENU_EFFECT_TOGGLE_WIFI | MENU_EFFECT_REDRAW, menuHandleKey(menu, MENU_KEY_UP));
+  TEST_ASSERT_EQUAL_UINT8(MENU_EFFECT_TOGGLE_WIFI | MENU_EFFECT_REDRAW, menuHandleKey(menu, MENU_KEY_DOWN));
+  TEST_ASSERT_EQUAL(WIFI_SETTINGS, menu.screen);
+}
+
+static void test_only_threshold_steps_repeat() {
+  MenuModel menu;
+  TEST_ASSERT_FALSE(menuKeyRepeats(menu, MENU_KEY_UP));
+
+  menu.screen = MENU_MAIN;
+  TEST_ASSERT_FALSE(menuKeyRepeats(menu, MENU_KEY_DOWN));
+
+  menu.screen = WIFI_SETTINGS;
+  TEST_ASSERT_FALSE(menuKeyRepeats(menu, MENU_KEY_UP));
+
+  menu.screen = SET_TEMP_THRESHOLD;
+  TEST_ASSERT_TRUE(menuKeyRepeats(menu, MENU_KEY_UP));
+  TEST_ASSERT_TRUE(menuKeyRepeats(menu, MENU_KEY_DOWN));
+  TEST_ASSERT_FALSE(menuKeyRepeats(menu, MENU_KEY_MODE));
+
+  menu.screen = SET_GAS_THRESHOLD;
+  TEST_ASSERT_TRUE(menuKeyRepeats(menu, MENU_KEY_DOWN));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_mode_opens_and_closes_the_menu);
+  RUN_TEST(test_main_screen_ignores_up_and_down);
+  RUN_TEST(test_up_wraps_around_the_menu);
+  RUN_TEST(test_down_enters_the_selected_submenu);
+  RUN_TEST(test_threshold_screens_step_the_thresholds);
+  RUN_TEST(test_wifi_screen_toggles_on_either_key);
+  RUN_TEST(test_only_threshold_steps_repeat);
+  return UNITY_END();
+}
@@ -0,0 +1,214 @@
+// Alarm rules (rule_engine.h): hysteresis, hold times, latches, AND/OR: pio test -e native
+#include <string.h>
+#include <unity.h>
+#include "rule_engine.h"
+
+// Readings and device thresholds go in as 1/16 units
+#define Q4(value) ((int32_t)((value) * 16))
+
+void setUp() {}
+void tearDown() {}
+
+static RuleConditionSpec condition(RuleSensor sensor, bool above, float value,
+                                   float hysteresis = 0, uint32_t forMs = 0, bool relative = false) {
+  RuleConditionSpec spec = {};
+  spec.sensor = sensor;
+  spec.above = above;
+  spec.relative = relative;
+  spec.value = value;
+  spec.hysteresis = hysteresis;
+  spec.forMs = forMs;
+  return spec;
+}
+
+// Appends a rule with its conditions, as parseRules() lays them out
+static void addRule(RuleSet &set, const char *name, bool any, uint8_t actions, bool latch,
+                    const RuleConditionSpec *conditions, uint8_t count) {
+  RuleSpec &rule = set.rules[set.ruleCount++];
+  strncpy(rule.name, name, sizeof(rule.name) - 1);
+  rule.any = any;
+  rule.actions = actions;
+  rule.latch = latch;
+  rule.conditionCount = count;
+  for (uint8_t i = 0; i < count; i++) {
+    set.conditions[set.conditionCount++] = conditions[i];
+  }
+}
+
+static void load(RuleEngine &engine, const RuleSet &set) {
+  AlarmProgram program;
+  TEST_ASSERT_TRUE(compileRules(set, program));
+  engine.load(program);
+}
+
+static void test_default_rules_trip_and_clear_with_hysteresis() {
+  RuleSet set;
+  defaultRules(set);
+  RuleEngine engine;
+  load(engine, set);
+
+  TEST_ASSERT_FALSE(engine.update(RULE_SENSOR_GAS, Q4(1000), Q4(1000), 0));
+  TEST_ASSERT_TRUE(engine.update(RULE_SENSOR_GAS, Q4(1001), Q4(1000), 1));
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.activeRules());
+  TEST_ASSERT_EQUAL_HEX8(RULE_ACTION_ALARM | RULE_ACTION_EXHAUST, engine.actions());
+
+  // Inside the 50 ppm band the rule holds; below it, it clears
+  TEST_ASSERT_FALSE(engine.update(RULE_SENSOR_GAS, Q4(960), Q4(1000), 2));
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.activeRules());
+  TEST_ASSERT_TRUE(engine.update(RULE_SENSOR_GAS, Q4(949), Q4(1000), 3));
+  TEST_ASSERT_EQUAL_HEX8(0, engine.activeRules());
+  TEST_ASSERT_EQUAL_HEX8(0, engine.actions());
+
+  // Temperature is its own rule, on its own threshold
+  TEST_ASSERT_TRUE(engine.update(RULE_SENSOR_TEMPERATURE, Q4(36), Q4(35), 4));
+  TEST_ASSERT_EQUAL_HEX8(0x02, engine.activeRules());
+}
+
+static void test_relative_bounds_follow_the_threshold() {
+  RuleSet set;
+  defaultRules(set);
+  RuleEngine engine;
+  load(engine, set);
+
+  TEST_ASSERT_TRUE(engine.update(RULE_SENSOR_GAS, Q4(900), Q4(800), 0));
+  TEST_ASSERT_TRUE(engine.update(RULE_SENSOR_GAS, Q4(900), Q4(1000), 1));
+  TEST_ASSERT_EQUAL_HEX8(0, engine.activeRules());
+}
+
+static void test_hold_time_needs_a_steady_reading() {
+  RuleSet set = {};
+  RuleConditionSpec hot = condition(RULE_SENSOR_TEMPERATURE, true, 50, 0, 5000);
+  addRule(set, "fire", true, RULE_ACTION_SPRINKLER, false, &hot, 1);
+  RuleEngine engine;
+  load(engine, set);
+
+  TEST_ASSERT_FALSE(engine.update(RULE_SENSOR_TEMPERATURE, Q4(55), 0, 1000));
+  TEST_ASSERT_FALSE(engine.update(RULE_SENSOR_TEMPERATURE, Q4(55), 0, 5999));
+
+  // A dip restarts the hold
+  TEST_ASSERT_FALSE(engine.update(RULE_SENSOR_TEMPERATURE, Q4(45), 0, 6000));
+  TEST_ASSERT_FALSE(engine.update(RULE_SENSOR_TEMPERATURE, Q4(55), 0, 7000));
+  TEST_ASSERT_FALSE(engine.update(RULE_SENSOR_TEMPERATURE, Q4(55), 0, 11999));
+  TEST_ASSERT_TRUE(engine.update(RULE_SENSOR_TEMPERATURE, Q4(55), 0, 12000));
+  TEST_ASSERT_EQUAL_HEX8(RULE_ACTION_SPRINKLER, engine.actions());
+}
+
+static void test_all_needs_every_condition() {
+  RuleSet set = {};
+  RuleConditionSpec both[] = {
+    condition(RULE_SENSOR_TEMPERATURE, true, 55, 2),
+    condition(RULE_SENSOR_GAS, true, -200, 0, 0, true),
+  };
+  addRule(set, "fire", false, RULE_ACTION_ALARM | RULE_ACTION_SPRINKLER, false, both, 2);
+  RuleEngine engine;
+  load(engine, set);
+
+  TEST_ASSERT_FALSE(engine.update(RULE_SENSOR_TEMPERATURE, Q4(60), Q4(35), 0));
+  TEST_ASSERT_EQUAL_HEX8(0, engine.activeRules());
+  TEST_ASSERT_TRUE(engine.update(RULE_SENSOR_GAS, Q4(850), Q4(1000), 1));
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.activeRules());
+
+  // Either one clearing drops the rule
+  TEST_ASSERT_TRUE(engine.update(RULE_SENSOR_TEMPERATURE, Q4(52), Q4(35), 2));
+  TEST_ASSERT_EQUAL_HEX8(0, engine.activeRules());
+}
+
+static void test_any_takes_one_condition() {
+  RuleSet set = {};
+  RuleConditionSpec either[] = {
+    condition(RULE_SENSOR_HUMIDITY, false, 20),
+    condition(RULE_SENSOR_HUMIDITY, true, 90),
+  };
+  addRule(set, "humidity", true, RULE_ACTION_NOTIFY, false, either, 2);
+  RuleEngine engine;
+  load(engine, set);
+
+  TEST_ASSERT_FALSE(engine.update(RULE_SENSOR_HUMIDITY, Q4(50), 0, 0));
+  TEST_ASSERT_TRUE(engine.update(RULE_SENSOR_HUMIDITY, Q4(15), 0, 1));
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.rulesWith(RULE_ACTION_NOTIFY));
+  TEST_ASSERT_TRUE(engine.update(RULE_SENSOR_HUMIDITY, Q4(50), 0, 2));
+  TEST_ASSERT_TRUE(engine.update(RULE_SENSOR_HUMIDITY, Q4(95), 0, 3));
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.activeRules());
+}
+
+static void test_latch_holds_until_reset() {
+  RuleSet set = {};
+  RuleConditionSpec gas = condition(RULE_SENSOR_GAS, true, 0, 0, 0, true);
+  RuleConditionSpec hot = condition(RULE_SENSOR_TEMPERATURE, true, 40);
+  addRule(set, "gas", true, RULE_ACTION_ALARM, true, &gas, 1);
+  addRule(set, "hot", true, RULE_ACTION_EXHAUST, false, &hot, 1);
+  RuleEngine engine;
+  load(engine, set);
+
+  TEST_ASSERT_TRUE(engine.update(RULE_SENSOR_GAS, Q4(1200), Q4(1000), 0));
+  TEST_ASSERT_FALSE(engine.update(RULE_SENSOR_GAS, Q4(500), Q4(1000), 1));
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.activeRules());
+  TEST_ASSERT_EQUAL_HEX8(RULE_ACTION_ALARM, engine.actions());
+
+  // Only the latch goes; the other rule is untouched
+  TEST_ASSERT_TRUE(engine.update(RULE_SENSOR_TEMPERATURE, Q4(45), 0, 2));
+  TEST_ASSERT_TRUE(engine.reset());
+  TEST_ASSERT_EQUAL_HEX8(0x02, engine.activeRules());
+  TEST_ASSERT_EQUAL_HEX8(RULE_ACTION_EXHAUST, engine.actions());
+  TEST_ASSERT_FALSE(engine.reset());
+}
+
+static void test_reset_keeps_a_rule_that_is_still_met() {
+  RuleSet set = {};
+  RuleConditionSpec gas = condition(RULE_SENSOR_GAS, true, 1000);
+  addRule(set, "gas", true, RULE_ACTION_ALARM, true, &gas, 1);
+  RuleEngine engine;
+  load(engine, set);
+
+  engine.update(RULE_SENSOR_GAS, Q4(1200), 0, 0);
+  TEST_ASSERT_FALSE(engine.reset());
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.activeRules());
+}
+
+static void test_other_sensors_leave_rules_alone() {
+  RuleSet set;
+  defaultRules(set);
+  RuleEngine engine;
+  load(engine, set);
+
+  TEST_ASSERT_FALSE(engine.update(RULE_SENSOR_HUMIDITY, Q4(99), 0, 0));
+  TEST_ASSERT_FALSE(engine.update(RULE_SENSORS, Q4(5000), 0, 0));
+  TEST_ASSERT_EQUAL_HEX8(0, engine.activeRules());
+}
+
+static void test_inconsistent_sets_do_not_compile() {
+  AlarmProgram program;
+  RuleSet set;
+  defaultRules(set);
+  TEST_ASSERT_TRUE(compileRules(set, program));
+
+  RuleSet bad = set;
+  bad.conditionCount = 3;
+  TEST_ASSERT_FALSE(compileRules(bad, program));
+
+  bad = set;
+  bad.conditions[1].sensor = RULE_SENSORS;
+  TEST_ASSERT_FALSE(compileRules(bad, program));
+
+  bad = set;
+  bad.rules[0].conditionCount = 0;
+  TEST_ASSERT_FALSE(compileRules(bad, program));
+
+  bad = set;
+  bad.ruleCount = RULE_MAX_RULES + 1;
+  TEST_ASSERT_FALSE(compileRules(bad, program));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_default_rules_trip_and_clear_with_hysteresis);
+  RUN_TEST(test_relative_bounds_follow_the_threshold);
+  RUN_TEST(test_hold_time_needs_a_steady_reading);
+  RUN_TEST(test_all_needs_every_condition);
+  RUN_TEST(test_any_takes_one_condition);
+  RUN_TEST(test_latch_holds_until_reset);
+  RUN_TEST(test_reset_keeps_a_rule_that_is_still_met);
+  RUN_TEST(test_other_sensors_leave_rules_alone);
+  RUN_TEST(test_inconsistent_sets_do_not_compile);
+  return UNITY_END();
+}
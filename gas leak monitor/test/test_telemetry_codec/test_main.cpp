@@ -0,0 +1,178 @@
+// Binary telemetry frame layout and deadbands (telemetry_codec.h): pio test -e native
+//
+// The apps decode the frame by byte offset (smart_gas_app/lib/main.dart), so
+// these offsets are the wire format and must only change with the version.
+#include <stddef.h>
+#include <string.h>
+#include <unity.h>
+#include "telemetry_codec.h"
+
+void setUp() {}
+void tearDown() {}
+
+static SensorSnapshot sampleSnapshot() {
+  SensorSnapshot snapshot = {};
+  snapshot.temperature = 23.456f;
+  snapshot.humidity = 55.5f;
+  snapshot.gasLevel = 812.4f;
+  snapshot.alarmActive = false;
+  snapshot.relayState = true;
+  snapshot.autoMode = true;
+  snapshot.gasThreshold = 1000;
+  snapshot.tempThreshold = 35;
+  snapshot.preAlarm = false;
+  return snapshot;
+}
+
+static void test_frame_layout() {
+  TEST_ASSERT_EQUAL(22, sizeof(TelemetryFrame));
+  TEST_ASSERT_EQUAL(0, offsetof(TelemetryFrame, magic));
+  TEST_ASSERT_EQUAL(1, offsetof(TelemetryFrame, version));
+  TEST_ASSERT_EQUAL(2, offsetof(TelemetryFrame, flags));
+  TEST_ASSERT_EQUAL(4, offsetof(TelemetryFrame, uptimeMs));
+  TEST_ASSERT_EQUAL(8, offsetof(TelemetryFrame, temperature));
+  TEST_ASSERT_EQUAL(10, offsetof(TelemetryFrame, humidity));
+  TEST_ASSERT_EQUAL(12, offsetof(TelemetryFrame, gasLevel));
+  TEST_ASSERT_EQUAL(14, offsetof(TelemetryFrame, gasThreshold));
+  TEST_ASSERT_EQUAL(18, offsetof(TelemetryFrame, tempThreshold));
+}
+
+static void test_frame_bytes_are_little_endian() {
+  TelemetryFrame frame;
+  encodeTelemetryFrame(sampleSnapshot(), true, 0x01020304u, frame);
+
+  uint8_t bytes[sizeof(frame)];
+  memcpy(bytes, &frame, sizeof(frame));
+  TEST_ASSERT_EQUAL_HEX8(TELEMETRY_FRAME_MAGIC, bytes[0]);
+  TEST_ASSERT_EQUAL_HEX8(TELEMETRY_FRAME_VERSION, bytes[1]);
+  TEST_ASSERT_EQUAL_HEX8(TELEMETRY_FLAG_RELAY | TELEMETRY_FLAG_AUTO | TELEMETRY_FLAG_SNAPSHOT, bytes[2]);
+  TEST_ASSERT_EQUAL_HEX8(0, bytes[3]);
+
+  static const uint8_t uptime[] = {0x04, 0x03, 0x02, 0x01};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(uptime, bytes + 4, 4);
+
+  // 23.456 °C as 2346 hundredths, 55.5 %RH as 5550, 812.4 ppm as 812
+  TEST_ASSERT_EQUAL_UINT8(2346 & 0xFF, bytes[8]);
+  TEST_ASSERT_EQUAL_UINT8(2346 >> 8, bytes[9]);
+  TEST_ASSERT_EQUAL_UINT8(5550 & 0xFF, bytes[10]);
+  TEST_ASSERT_EQUAL_UINT8(5550 >> 8, bytes[11]);
+  TEST_ASSERT_EQUAL_UINT8(812 & 0xFF, bytes[12]);
+  TEST_ASSERT_EQUAL_UINT8(812 >> 8, bytes[13]);
+
+  float gasThreshold;
+  float tempThreshold;
+  memcpy(&gasThreshold, bytes + 14, sizeof(gasThreshold));
+  memcpy(&tempThreshold, bytes + 18, sizeof(tempThreshold));
+  TEST_ASSERT_EQUAL_FLOAT(1000, gasThreshold);
+  TEST_ASSERT_EQUAL_FLOAT(35, tempThreshold);
+}
+
+static void test_frame_flags_and_clamping() {
+  SensorSnapshot snapshot = sampleSnapshot();
+  snapshot.alarmActive = true;
+  snapshot.relayState = false;
+  snapshot.autoMode = false;
+  snapshot.preAlarm = true;
+  snapshot.temperature = -400;
+  snapshot.humidity = -1;
+  snapshot.gasLevel = 100000;
+
+  TelemetryFrame frame;
+  encodeTelemetryFrame(snapshot, false, 0, frame);
+  TEST_ASSERT_EQUAL_HEX8(TELEMETRY_FLAG_ALARM | TELEMETRY_FLAG_PREALARM, frame.flags);
+  TEST_ASSERT_EQUAL_INT16(-32768, frame.temperature);
+  TEST_ASSERT_EQUAL_UINT16(0, frame.humidity);
+  TEST_ASSERT_EQUAL_UINT16(65535, frame.gasLevel);
+}
+
+static void test_changes_respect_the_deadbands() {
+  static const TelemetryDeadband deadband = {0.1f, 0.5f, 10.0f};
+  SensorSnapshot sent = sampleSnapshot();
+  SensorSnapshot latest = sent;
+  latest.temperature += 0.05f;
+  latest.humidity += 0.4f;
+  latest.gasLevel += 9;
+  TEST_ASSERT_EQUAL_HEX8(0, telemetryChanges(sent, latest, deadband));
+
+  latest.temperature += 0.1f;
+  latest.gasLevel += 2;
+  TEST_ASSERT_EQUAL_HEX8(TELEMETRY_CHANGED_TEMPERATURE | TELEMETRY_CHANGED_GAS,
+                         telemetryChanges(sent, latest, deadband));
+
+  latest = sent;
+  latest.humidity -= 0.6f;
+  TEST_ASSERT_EQUAL_HEX8(TELEMETRY_CHANGED_HUMIDITY, telemetryChanges(sent, latest, deadband));
+}
+
+static void test_any_state_field_is_a_change() {
+  static const TelemetryDeadband deadband = {0.1f, 0.5f, 10.0f};
+  SensorSnapshot sent = sampleSnapshot();
+
+  SensorSnapshot latest = sent;
+  latest.preAlarm = true;
+  TEST_ASSERT_EQUAL_HEX8(TELEMETRY_CHANGED_STATE, telemetryChanges(sent, latest, deadband));
+
+  latest = sent;
+  latest.tempThreshold = 36;
+  TEST_ASSERT_EQUAL_HEX8(TELEMETRY_CHANGED_STATE, telemetryChanges(sent, latest, deadband));
+
+  latest = sent;
+  latest.relayState = false;
+  TEST_ASSERT_EQUAL_HEX8(TELEMETRY_CHANGED_STATE, telemetryChanges(sent, latest, deadband));
+}
+
+// A delta the client queue refused is never marked, so the change is still pending
+static void test_refused_delta_is_retried() {
+  static const TelemetryDeadband deadband = {0.1f, 0.5f, 10.0f};
+  SensorSnapshot sent = sampleSnapshot();
+  SensorSnapshot latest = sent;
+  latest.alarmActive = true;
+  latest.gasLevel += 50;
+
+  uint8_t changes = telemetryChanges(sent, latest, deadband);
+  TEST_ASSERT_EQUAL_HEX8(TELEMETRY_CHANGED_STATE | TELEMETRY_CHANGED_GAS, changes);
+
+  // Still pending on the next flush, with the reading that came in meanwhile
+  latest.relayState = false;
+  TEST_ASSERT_EQUAL_HEX8(TELEMETRY_CHANGED_STATE | TELEMETRY_CHANGED_GAS, telemetryChanges(sent, latest, deadband));
+
+  markTelemetryDelta(sent, latest, telemetryChanges(sent, latest, deadband));
+  TEST_ASSERT_TRUE(sent.alarmActive);
+  TEST_ASSERT_FALSE(sent.relayState);
+  TEST_ASSERT_EQUAL_FLOAT(latest.gasLevel, sent.gasLevel);
+  TEST_ASSERT_EQUAL_HEX8(0, telemetryChanges(sent, latest, deadband));
+}
+
+// Fields a delta did not carry keep their baseline, so slow drift is reported once it adds up
+static void test_sub_deadband_drift_accumulates() {
+  static const TelemetryDeadband deadband = {0.1f, 0.5f, 10.0f};
+  SensorSnapshot sent = sampleSnapshot();
+  SensorSnapshot latest = sent;
+  float baseline = sent.temperature;
+
+  // A state change goes out with the temperature 0.06 off; the temperature stays unsent
+  latest.temperature += 0.06f;
+  latest.relayState = false;
+  uint8_t changes = telemetryChanges(sent, latest, deadband);
+  TEST_ASSERT_EQUAL_HEX8(TELEMETRY_CHANGED_STATE, changes);
+  markTelemetryDelta(sent, latest, changes);
+  TEST_ASSERT_EQUAL_FLOAT(baseline, sent.temperature);
+
+  latest.temperature += 0.06f;
+  changes = telemetryChanges(sent, latest, deadband);
+  TEST_ASSERT_EQUAL_HEX8(TELEMETRY_CHANGED_TEMPERATURE, changes);
+  markTelemetryDelta(sent, latest, changes);
+  TEST_ASSERT_EQUAL_FLOAT(latest.temperature, sent.temperature);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_frame_layout);
+  RUN_TEST(test_frame_bytes_are_little_endian);
+  RUN_TEST(test_frame_flags_and_clamping);
+  RUN_TEST(test_changes_respect_the_deadbands);
+  RUN_TEST(test_any_state_field_is_a_change);
+  RUN_TEST(test_refused_delta_is_retried);
+  RUN_TEST(test_sub_deadband_drift_accumulates);
+  return UNITY_END();
+}
@@ -0,0 +1,63 @@
+#ifndef DISCOVERY_PROTOCOL_H
+#define DISCOVERY_PROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+
+// UDP discovery shared by the gas monitors, the smart switches and the apps.
+// An app broadcasts one DiscoveryRequest to DISCOVERY_PORT; every device of
+// the requested kind answers the sender with one DiscoveryReply, so a whole
+// building shows up after a single round-trip. The device address is the
+// reply's source address. The same details are advertised over mDNS as
+// _smartgas._tcp / _smartswitch._tcp with TXT records. Little-endian, fixed
+// layout; bump the version on any change.
+
+#define DISCOVERY_PORT 47810
+
+#define DISCOVERY_MAGIC 0x44  // 'D'
+#define DISCOVERY_VERSION 1
+
+#define DISCOVERY_KIND_ANY 0  // Request only; kinds match MESH_KIND_*
+#define DISCOVERY_KIND_MONITOR 1
+#define DISCOVERY_KIND_SWITCH 2
+
+#define DISCOVERY_FLAG_AGGREGATOR 0x01  // Monitor collects the mesh device table
+
+#define DISCOVERY_ID_SIZE 16
+#define DISCOVERY_FIRMWARE_SIZE 12
+#define DISCOVERY_PATH_SIZE 8
+
+struct __attribute__((packed)) DiscoveryRequest {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t kind;  // DISCOVERY_KIND_ANY or the one kind wanted
+  uint8_t reserved;
+};
+
+struct __attribute__((packed)) DiscoveryReply {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t kind;
+  uint8_t flags;
+  uint16_t httpPort;
+  uint16_t wsPort;
+  char wsPath[DISCOVERY_PATH_SIZE];          // NUL-padded, e.g. "/ws"
+  char deviceId[DISCOVERY_ID_SIZE];          // NUL-padded
+  char firmware[DISCOVERY_FIRMWARE_SIZE];    // NUL-padded
+};
+
+// True when a request is well-formed and asks for this device's kind
+inline bool discoveryRequestMatches(const uint8_t *data, int len, uint8_t kind) {
+  if (len != (int)sizeof(DiscoveryRequest) || data[0] != DISCOVERY_MAGIC || data[1] != DISCOVERY_VERSION) {
+    return false;
+  }
+  return data[2] == DISCOVERY_KIND_ANY || data[2] == kind;
+}
+
+// Copies text into a fixed field, NUL-padded; a value that fills it has no NUL
+inline void discoveryCopyText(char *field, size_t size, const char *text) {
+  memset(field, 0, size);
+  strncpy(field, text, size);
+}
+
+#endif
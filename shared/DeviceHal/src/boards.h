@@ -0,0 +1,46 @@
+#ifndef BOARDS_H
+#define BOARDS_H
+
+#include "fast_gpio.h"
+
+// Pin maps of the supported boards. A firmware picks one with its
+// *_BOARD build flag (e.g. -DMONITOR_BOARD=GasMonitorDevkitV1) and only
+// refers to Board::Relay, Board::pirPin and so on, so a new variant is a new
+// struct here rather than a fork of main.cpp. Each product only
+// instantiates the boards of its own chip.
+
+#if defined(ESP32)
+
+// ESP32 DOIT DevKit v1 with the 16x4 I2C LCD, DHT11 and an MQ sensor
+struct GasMonitorDevkitV1 {
+  using Relay = GpioOutput<17>;  // Exhaust fan / valve relay module
+  using Alarm = GpioOutput<23>;  // Buzzer and beacon
+  using Sprinkler = NoOutput;    // See GasMonitorDevkitV1Sprinkler
+  static constexpr bool hasSprinkler = false;
+  static constexpr uint8_t gasAdcPin = 33;  // ADC1, usable with WiFi on
+  static constexpr uint8_t dhtPin = 4;
+  static constexpr uint8_t buttonPins[] = {26, 27, 25};  // Mode, Up, Down; active low
+  static constexpr uint8_t buttonCount = 3;
+};
+
+// The same with a second relay module on GPIO16 for a sprinkler valve.
+// GPIO16 is free on the WROOM-32 of the DevKit v1; WROVER modules use it
+// for PSRAM, so a WROVER variant needs another pin.
+struct GasMonitorDevkitV1Sprinkler : GasMonitorDevkitV1 {
+  using Sprinkler = GpioOutput<16>;
+  static constexpr bool hasSprinkler = true;
+};
+
+#endif
+
+#if defined(ESP8266)
+
+// ESP-01 relay board with a PIR on the second GPIO
+struct SmartSwitchEsp01 {
+  using Relay = GpioOutput<0>;
+  using Pir = GpioInput<2>;
+};
+
+#endif
+
+#endif
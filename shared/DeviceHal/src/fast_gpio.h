@@ -0,0 +1,125 @@
+#ifndef FAST_GPIO_H
+#define FAST_GPIO_H
+
+#include <Arduino.h>
+
+#if defined(ESP32)
+#include <soc/gpio_struct.h>
+#elif !defined(ESP8266)
+#error "fast_gpio.h supports ESP32 and ESP8266"
+#endif
+
+// GPIO with the pin and polarity fixed at compile time. Every access
+// inlines to a single register write or read (GPIO.out_w1ts/out_w1tc and
+// GPIO.in on the ESP32, GPOS/GPOC and GPI on the ESP8266) instead of going
+// through the Arduino pin-mapping layer, so it is cheap enough for ISRs,
+// critical sections and the alarm path. Only begin() uses pinMode.
+//
+// Boards (boards.h) name their pins as these types, e.g.
+//   using Relay = GpioOutput<17>;
+//   Relay::begin(false); Relay::write(on);
+
+template <uint8_t Pin, bool ActiveHigh = true>
+struct GpioOutput {
+#if defined(ESP32)
+  static_assert(Pin < 34, "GPIO34-39 are input only");
+#else
+  static_assert(Pin <= 16, "ESP8266 has GPIO0-16");
+#endif
+
+  static constexpr uint8_t pin = Pin;
+
+  // Drives the inactive (or given) level before switching to output, so the pin never glitches
+  static void begin(bool active = false) {
+    write(active);
+    pinMode(Pin, OUTPUT);
+  }
+
+  static inline void on() { writeLevel(ActiveHigh); }
+  static inline void off() { writeLevel(!ActiveHigh); }
+  static inline void write(bool active) { writeLevel(active == ActiveHigh); }
+
+  // Level last written to the output latch, as active/inactive
+  static inline bool active() { return readLatch() == ActiveHigh; }
+
+private:
+  static inline __attribute__((always_inline)) void writeLevel(bool high) {
+#if defined(ESP32)
+    if constexpr (Pin < 32) {
+      if (high) GPIO.out_w1ts = 1UL << Pin;
+      else GPIO.out_w1tc = 1UL << Pin;
+    } else {
+      if (high) GPIO.out1_w1ts.val = 1UL << (Pin - 32);
+      else GPIO.out1_w1tc.val = 1UL << (Pin - 32);
+    }
+#else
+    if constexpr (Pin < 16) {
+      if (high) GPOS = 1UL << Pin;
+      else GPOC = 1UL << Pin;
+    } else {
+      if (high) GP16O |= 1;
+      else GP16O &= ~1;
+    }
+#endif
+  }
+
+  static inline __attribute__((always_inline)) bool readLatch() {
+#if defined(ESP32)
+    if constexpr (Pin < 32) {
+      return (GPIO.out >> Pin) & 1;
+    } else {
+      return (GPIO.out1.val >> (Pin - 32)) & 1;
+    }
+#else
+    if constexpr (Pin < 16) {
+      return (GPO >> Pin) & 1;
+    } else {
+      return GP16O & 1;
+    }
+#endif
+  }
+};
+
+// Stand-in for an optional output a board does not wire: every access is a
+// no-op, so firmware code stays the same and the board's has* flag says
+// whether the output is real
+struct NoOutput {
+  static void begin(bool active = false) {}
+  static inline void on() {}
+  static inline void off() {}
+  static inline void write(bool active) {}
+  static inline bool active() { return false; }
+};
+
+template <uint8_t Pin, bool ActiveHigh = true, uint8_t Mode = INPUT>
+struct GpioInput {
+#if defined(ESP32)
+  static_assert(Pin < 40, "ESP32 has GPIO0-39");
+#else
+  static_assert(Pin <= 16, "ESP8266 has GPIO0-16");
+#endif
+
+  static constexpr uint8_t pin = Pin;
+
+  static void begin() { pinMode(Pin, Mode); }
+
+  static inline __attribute__((always_inline)) bool level() {
+#if defined(ESP32)
+    if constexpr (Pin < 32) {
+      return (GPIO.in >> Pin) & 1;
+    } else {
+      return (GPIO.in1.data >> (Pin - 32)) & 1;
+    }
+#else
+    if constexpr (Pin < 16) {
+      return (GPI >> Pin) & 1;
+    } else {
+      return GP16I & 1;
+    }
+#endif
+  }
+
+  static inline bool active() { return level() == ActiveHigh; }
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef GROUP_PROTOCOL_H
+#define GROUP_PROTOCOL_H
+
+#include <stdint.h>
+
+// UDP group control for the smart switches. One GroupCommand sent to the
+// multicast group (or as a broadcast, or unicast to one switch) sets the
+// relay of every switch in that group. Commands set a state instead of
+// toggling it and carry a per-sender sequence number, so a sender simply
+// repeats a command until it sees the acks it expects: a switch applies each
+// (sender, seq) once and acks every copy. Switches that got the command over
+// UDP relay it once over ESP-NOW, for switches on another softAP.
+// Little-endian, fixed layout; bump the version on any change.
+
+#define GROUP_PORT 47811
+#define GROUP_MULTICAST_ADDR 239, 255, 71, 1
+
+#define GROUP_MAGIC 0x47  // 'G'
+#define GROUP_VERSION 1
+
+#define GROUP_TYPE_COMMAND 1
+#define GROUP_TYPE_ACK 2
+
+#define GROUP_MAX_GROUPS 32  // Group IDs 0..31, one bit each of a switch's mask
+#define GROUP_ALL 0xFF
+
+#define GROUP_ACTION_RELAY_OFF 0
+#define GROUP_ACTION_RELAY_ON 1
+
+#define GROUP_FLAG_NO_ACK 0x01     // Fire and forget
+#define GROUP_FLAG_FORWARDED 0x02  // Relayed over ESP-NOW; never relayed again
+
+#define GROUP_ACK_APPLIED 0
+#define GROUP_ACK_UNCHANGED 1  // Relay was already in that state
+#define GROUP_ACK_DUPLICATE 2  // Seen this (sender, seq) before; nothing done
+#define GROUP_ACK_BLOCKED 3    // Auto mode or a mesh gas alarm owns the relay
+#define GROUP_ACK_STALE 4      // Older seq than the last one applied from this sender
+
+struct __attribute__((packed)) GroupCommand {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t type;    // GROUP_TYPE_COMMAND
+  uint8_t action;  // GROUP_ACTION_*
+  uint8_t group;   // 0..31 or GROUP_ALL
+  uint8_t flags;   // GROUP_FLAG_*
+  uint16_t reserved;
+  uint32_t sender;  // Random per sender, picked once at startup
+  uint32_t seq;     // Incremented per new command; repeats keep it
+};
+
+struct __attribute__((packed)) GroupAck {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t type;    // GROUP_TYPE_ACK
+  uint8_t status;  // GROUP_ACK_*
+  uint8_t group;   // Echoed from the command
+  uint8_t relay;   // Relay state after the command, 0 or 1
+  uint8_t mac[6];  // Switch station MAC, identifies the device
+  uint32_t sender;
+  uint32_t seq;
+};
+
+inline bool groupCommandValid(const uint8_t *data, int len) {
+  return len == (int)sizeof(GroupCommand) && data[0] == GROUP_MAGIC && data[1] == GROUP_VERSION &&
+         data[2] == GROUP_TYPE_COMMAND;
+}
+
+#endif
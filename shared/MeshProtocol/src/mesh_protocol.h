@@ -0,0 +1,43 @@
+#ifndef MESH_PROTOCOL_H
+#define MESH_PROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+
+// ESP-NOW frame shared by the gas monitors and the smart switches.
+// Every device broadcasts one on a fixed cadence and right away when its
+// alarm/relay state changes; the sender is identified by the ESP-NOW source
+// MAC. All devices have to be on the same WiFi channel. Little-endian, fixed
+// layout; bump the version on any change.
+
+#define MESH_MAGIC 0x4D  // 'M'
+#define MESH_VERSION 2  // 2: gasLevel in ppm
+
+#define MESH_KIND_MONITOR 1
+#define MESH_KIND_SWITCH 2
+
+#define MESH_FLAG_ALARM 0x01
+#define MESH_FLAG_RELAY 0x02
+#define MESH_FLAG_AUTO 0x04
+#define MESH_FLAG_PIR 0x08
+#define MESH_FLAG_URGENT 0x10  // Sent out of cadence because the state changed
+
+struct __attribute__((packed)) MeshFrame {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t kind;
+  uint8_t flags;
+  uint16_t seq;
+  int16_t temperature;  // 0.01 °C, monitors only
+  uint16_t humidity;    // 0.01 %, monitors only
+  uint16_t gasLevel;    // ppm, monitors only
+  uint32_t uptimeMs;
+};
+
+static const uint8_t MESH_BROADCAST[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+inline bool meshFrameValid(const uint8_t *data, int len) {
+  return len == (int)sizeof(MeshFrame) && data[0] == MESH_MAGIC && data[1] == MESH_VERSION;
+}
+
+#endif
@@ -0,0 +1,122 @@
+#include "ota_session.h"
+
+#if defined(ESP32)
+#include <Update.h>
+#elif defined(ESP8266)
+#include <Updater.h>
+#endif
+
+static const char *const stateNames[] = {"idle", "receiving", "ready", "failed"};
+
+static bool parseMd5(const char *text, char *out) {
+  if (text == NULL || strlen(text) != 32) return false;
+  for (uint8_t i = 0; i < 32; i++) {
+    if (!isxdigit((unsigned char)text[i])) return false;
+    out[i] = tolower((unsigned char)text[i]);
+  }
+  out[32] = '\0';
+  return true;
+}
+
+int OtaSession::begin(uint32_t size, const char *md5) {
+  char expected[33];
+  if (size == 0 || !parseMd5(md5, expected)) {
+    return 400;
+  }
+  if (_state == OTA_READY) {
+    return 409;
+  }
+
+  // Same image as the open session: the client resumes at offset()
+  if (_state == OTA_RECEIVING && size == _size && strcmp(expected, _md5) == 0) {
+    return 200;
+  }
+
+  abort();
+  if (!Update.begin(size, U_FLASH)) {
+    failFromUpdate();
+    return 400;  // Mostly an image larger than the slot
+  }
+  Update.setMD5(expected);
+
+  memcpy(_md5, expected, sizeof(_md5));
+  _size = size;
+  _offset = 0;
+  _error[0] = '\0';
+  _state = OTA_RECEIVING;
+  Serial.printf("OTA: receiving %lu bytes, md5 %s\n", (unsigned long)size, _md5);
+  return 200;
+}
+
+int OtaSession::write(uint32_t offset, const uint8_t *data, size_t len) {
+  if (_state != OTA_RECEIVING || offset != _offset || len > _size - _offset) {
+    return _state == OTA_FAILED ? 500 : 409;
+  }
+
+  // Buffers up to one sector; a full sector is erased and written right here
+  size_t written = Update.write(const_cast<uint8_t *>(data), len);
+  _offset += written;
+  if (written != len) {
+    failFromUpdate();
+    return 500;
+  }
+  return 200;
+}
+
+int OtaSession::finish() {
+  if (_state == OTA_READY) {
+    return 200;
+  }
+  if (_state != OTA_RECEIVING || _offset != _size) {
+    return 409;
+  }
+
+  // Checks the MD5 and only then marks the new image for the next boot
+  if (!Update.end()) {
+    failFromUpdate();
+    return 500;
+  }
+  _readyAtMs = millis();
+  _state = OTA_READY;
+  Serial.println("OTA: image verified, restarting into it");
+  return 200;
+}
+
+void OtaSession::abort() {
+  if (_state == OTA_RECEIVING) {
+#if defined(ESP32)
+    Update.abort();
+#else
+    Update.end(false);  // Unfinished, so this only drops the session
+#endif
+  }
+  if (_state != OTA_READY) {
+    _state = OTA_IDLE;
+    _size = 0;
+    _offset = 0;
+    _md5[0] = '\0';
+  }
+}
+
+bool OtaSession::restartDue() const {
+  return _state == OTA_READY && millis() - _readyAtMs >= OTA_RESTART_DELAY_MS;
+}
+
+size_t OtaSession::formatStatus(char *buf, size_t size) const {
+  return snprintf(buf, size,
+                  "{\"state\":\"%s\",\"size\":%lu,\"offset\":%lu,\"md5\":\"%s\",\"error\":\"%s\"}",
+                  stateNames[_state], (unsigned long)_size, (unsigned long)_offset, _md5, _error);
+}
+
+// Keeps the reason for GET /api/ota and drops whatever Update still holds
+void OtaSession::failFromUpdate() {
+#if defined(ESP32)
+  strlcpy(_error, Update.errorString(), sizeof(_error));
+  Update.abort();
+#else
+  strlcpy(_error, Update.getErrorString().c_str(), sizeof(_error));
+  Update.end(false);
+#endif
+  _state = OTA_FAILED;
+  Serial.printf("OTA: failed, %s\n", _error);
+}
@@ -0,0 +1,76 @@
+#ifndef OTA_SESSION_H
+#define OTA_SESSION_H
+
+#include <Arduino.h>
+
+// Resumable firmware upload on top of the core's Update class. Each firmware
+// only maps its web server onto these calls:
+//
+//   POST /api/ota/begin?size=<bytes>&md5=<hex>  opens the inactive image slot
+//   POST /api/ota/chunk?offset=<bytes>          raw body, the next piece of the image
+//   POST /api/ota/finish                        checks size and MD5, then restarts into it
+//   POST /api/ota/abort
+//   GET  /api/ota                               state, offset, size, md5, error (JSON)
+//
+// Chunks go straight through Update.write, which holds at most one flash
+// sector in RAM, so the image is never buffered. A chunk must start where the
+// image ends so far; anything else is refused with 409 and the current
+// offset, which is also where a client resumes after a dropped connection.
+// Nothing is reset when a connection drops, and begin() with the same size
+// and MD5 resumes the open session instead of starting over. The new image is
+// only selected for the next boot once Update.end() has checked its MD5; the
+// restart itself is left to the firmware (restartDue()), after the reply to
+// finish has gone out.
+//
+// Not thread-safe: call everything except restartDue() from the task that
+// runs the web server.
+
+#define OTA_RESTART_DELAY_MS 1000  // Between a successful finish and the restart
+#define OTA_ERROR_SIZE 48
+#define OTA_STATUS_SIZE 192  // Fits formatStatus() with the longest error
+
+enum OtaState {
+  OTA_IDLE,
+  OTA_RECEIVING,
+  OTA_READY,   // Verified and selected; restarting
+  OTA_FAILED   // See error(); begin() starts over
+};
+
+class OtaSession {
+public:
+  // Each call returns the HTTP status to answer with
+
+  // 200 for a new or resumed session, 400 for a bad size or MD5, 409 while restarting
+  int begin(uint32_t size, const char *md5);
+
+  // 200 when written, 409 when offset is not where the image ends, 500 when flash failed
+  int write(uint32_t offset, const uint8_t *data, size_t len);
+
+  // 200 when the image checked out and is selected for the next boot
+  int finish();
+
+  void abort();
+
+  // A finished image waits for the restart and the reply has had time to go out
+  bool restartDue() const;
+
+  OtaState state() const { return _state; }
+  uint32_t size() const { return _size; }
+  uint32_t offset() const { return _offset; }
+  const char *error() const { return _error; }
+
+  // The GET /api/ota body
+  size_t formatStatus(char *buf, size_t size) const;
+
+private:
+  void failFromUpdate();
+
+  volatile OtaState _state = OTA_IDLE;
+  uint32_t _size = 0;
+  volatile uint32_t _offset = 0;
+  uint32_t _readyAtMs = 0;
+  char _md5[33] = {};
+  char _error[OTA_ERROR_SIZE] = {};
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef DISCOVERY_H
+#define DISCOVERY_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include <discovery_protocol.h>
+
+// Makes the switch findable without typing an IP (see discovery_protocol.h):
+// mDNS host smartswitch-<id>.local with a _smartswitch._tcp service, and a
+// UDP responder that answers one broadcast request with one DiscoveryReply.
+
+#define DISCOVERY_SERVICE "smartswitch"
+#define DISCOVERY_HOST_PREFIX "smartswitch-"
+#define DISCOVERY_HTTP_PORT 80
+#define DISCOVERY_WS_PORT 81
+#define DISCOVERY_WS_PATH "/"
+#define DISCOVERY_REQUESTS_PER_POLL 2
+
+class DeviceDiscovery {
+public:
+  bool begin(const char *firmware);
+
+  // Runs the mDNS responder and answers pending UDP requests; call from loop()
+  void poll();
+
+private:
+  WiFiUDP _udp;
+  DiscoveryReply _reply = {};
+  bool _started = false;
+};
+
+extern DeviceDiscovery discovery;
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef EEPROM_LAYOUT_H
+#define EEPROM_LAYOUT_H
+
+// Emulated EEPROM sector shared by the modules that keep settings in flash.
+// Every user calls EEPROM.begin(EEPROM_SIZE), so none resizes it under another.
+
+#define EEPROM_SIZE 64
+#define GROUP_EEPROM_OFFSET 0   // group_control.h, 12 bytes
+#define STATE_EEPROM_OFFSET 16  // state_store.h, 16 bytes
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef GROUP_CONTROL_H
+#define GROUP_CONTROL_H
+
+#include <Arduino.h>
+#include <lwip/udp.h>
+#include <group_protocol.h>
+#include "eeprom_layout.h"
+
+// Switch side of the UDP group protocol (see group_protocol.h). Listens on
+// GROUP_PORT for multicast, broadcast and unicast commands through a raw
+// lwIP socket, so a command is applied as soon as it arrives instead of
+// after the loop's idle delay; every switch in the group then switches
+// within a few milliseconds of the others. Runs in the SDK context, between
+// loop() iterations, like the ESP-NOW receive path.
+//
+// Group membership is a mask of the 32 group IDs, kept in EEPROM and set
+// with /setmode?groups=1,4,7 (or groups=none).
+
+#define GROUP_SENDERS 4  // Senders whose last sequence number is remembered
+#define GROUP_EEPROM_MAGIC 0x47A1
+
+// Applies a group action; returns a GROUP_ACK_* status and the new relay state
+typedef uint8_t (*GroupActionCallback)(uint8_t action, bool &relay);
+
+class GroupControl {
+public:
+  // relay is the switch's relay state, reported in acks of repeated commands
+  bool begin(GroupActionCallback callback, const volatile bool *relay);
+
+  // Member groups, one bit per ID; persisted
+  uint32_t groups() const { return _groups; }
+  void setGroups(uint32_t mask);
+
+  // Entry point for commands relayed over ESP-NOW
+  void handleForwarded(const GroupCommand &command);
+
+  uint32_t applied() const { return _applied; }
+  uint32_t duplicates() const { return _duplicates; }
+
+private:
+  struct Sender {
+    uint32_t id;
+    uint32_t seq;
+    bool used;
+  };
+
+  static void onUdp(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, uint16_t port);
+  bool member(uint8_t group) const;
+  uint8_t handle(const GroupCommand &command, bool &relay);
+  void sendAck(const GroupCommand &command, uint8_t status, bool relay, const ip_addr_t *addr, uint16_t port);
+
+  struct Stored {
+    uint16_t magic;
+    uint32_t groups;
+    uint32_t check;  // ~groups
+  };
+
+  struct udp_pcb *_pcb = NULL;
+  GroupActionCallback _callback = NULL;
+  const volatile bool *_relay = NULL;
+  uint32_t _groups = 0;
+  Sender _senders[GROUP_SENDERS] = {};
+  uint8_t _nextSender = 0;
+  uint8_t _mac[6] = {};
+  uint32_t _applied = 0;
+  uint32_t _duplicates = 0;
+};
+
+extern GroupControl groupControl;
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef LOOP_TIMING_H
+#define LOOP_TIMING_H
+
+#include <Arduino.h>
+
+// Throttle mode and duty-cycle accounting for the main loop.
+//
+// Throttling lowers the TX power and lets the loop idle longer between polls
+// of the web/WebSocket servers. The switch only runs a softAP, which has to
+// keep its receiver on for beacons, so modem/light sleep is not available.
+// PIR motion is interrupt driven, so it still switches the relay immediately.
+//
+// Each LOOP_WINDOW_MS window reports loop timing, not current draw (which
+// can't be measured on-board): the fraction of time the CPU was busy, and the
+// gap between server polls (an upper bound on the latency the idle time adds
+// to a request).
+
+#define LOOP_WINDOW_MS 10000
+#define LOOP_IDLE_MS 10
+#define LOOP_THROTTLE_IDLE_MS 50
+#define LOOP_TX_DBM 20.5f
+#define LOOP_THROTTLE_TX_DBM 10.0f
+
+class LoopTiming {
+public:
+  void begin(bool throttled);
+  void setThrottled(bool throttled);
+  bool throttled() const { return _throttled; }
+
+  // Bracket the work each loop() iteration does, then idle for idleMs()
+  void beginWork();
+  void endWork();
+  uint32_t idleMs() const { return _throttled ? LOOP_THROTTLE_IDLE_MS : LOOP_IDLE_MS; }
+
+  // Last complete window
+  uint16_t busyPermille() const { return _busyPermille; }
+  uint32_t gapAvgUs() const { return _gapAvgUs; }
+  uint32_t gapMaxUs() const { return _gapMaxUs; }
+
+private:
+  bool _throttled = false;
+  uint32_t _windowStartUs = 0;
+  uint32_t _workStartUs = 0;
+  uint32_t _busyUs = 0;
+  uint32_t _gapSumUs = 0;
+  uint32_t _gapCount = 0;
+  uint32_t _gapPeakUs = 0;
+  uint16_t _busyPermille = 0;
+  uint32_t _gapAvgUs = 0;
+  uint32_t _gapMaxUs = 0;
+};
+
+extern LoopTiming loopTiming;
+
+#endif
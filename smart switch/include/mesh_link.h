@@ -0,0 +1,72 @@
+#ifndef MESH_LINK_H
+#define MESH_LINK_H
+
+#include <Arduino.h>
+#include <mesh_protocol.h>
+#include <group_protocol.h>
+
+// ESP-NOW side of the switch (see mesh_protocol.h). Broadcasts the relay/PIR
+// state so an aggregating gas monitor can list the switch, and listens for
+// monitor frames to follow their gas alarm: one monitor by MAC, or any.
+// A monitor's alarm stays latched here until one of its frames clears it.
+// Group commands (group_protocol.h) share the link: a switch relays the ones
+// it got over UDP, and hands relayed ones from other switches to onGroup().
+
+#define MESH_BROADCAST_INTERVAL_MS 2000
+#define MESH_MAX_MONITORS 10
+
+typedef void (*MeshAlarmCallback)(bool active);
+typedef void (*MeshGroupCallback)(const GroupCommand &command);
+
+class MeshLink {
+public:
+  bool begin();
+
+  // Called when the combined alarm of the followed monitors changes
+  void onAlarm(MeshAlarmCallback callback) { _callback = callback; }
+
+  // Called with group commands relayed by other switches
+  void onGroup(MeshGroupCallback callback) { _groupCallback = callback; }
+
+  // Relays a group command to the other switches in radio range
+  void forwardGroup(const GroupCommand &command);
+
+  // Follow one monitor, or every monitor when mac is NULL
+  void setAlarmSource(const uint8_t *mac);
+  bool alarmSourceAny() const { return _any; }
+  const uint8_t *alarmSource() const { return _source; }
+  bool alarmActive() const { return _alarm; }
+
+  // Broadcasts the switch state; urgent sends right away, otherwise on the cadence
+  void publish(bool relay, bool autoMode, bool pir, bool urgent);
+
+  uint32_t framesReceived() const { return _received; }
+
+private:
+  struct Monitor {
+    bool used;
+    bool alarm;
+    uint8_t mac[6];
+  };
+
+  static void onReceive(uint8_t *mac, uint8_t *data, uint8_t len);
+  void handleFrame(const uint8_t *mac, const MeshFrame &frame);
+  void updateAlarm();
+
+  static MeshLink *_instance;
+
+  bool _started = false;
+  bool _any = true;
+  uint8_t _source[6] = {};
+  bool _alarm = false;
+  MeshAlarmCallback _callback = NULL;
+  MeshGroupCallback _groupCallback = NULL;
+  Monitor _monitors[MESH_MAX_MONITORS] = {};
+  uint16_t _seq = 0;
+  uint32_t _lastBroadcastMs = 0;
+  uint32_t _received = 0;
+};
+
+extern MeshLink mesh;
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef OTA_H
+#define OTA_H
+
+#include <Arduino.h>
+#include <ESP8266WebServer.h>
+#include <ota_session.h>
+
+// Firmware updates over HTTP (the protocol is in ota_session.h). The
+// ESP8266 has no second app slot to boot from: the upload is staged in the
+// free flash above the sketch, and eboot copies it over the running sketch
+// on the next boot, after Update.end() has checked its MD5. The old image is
+// gone once that copy is done, so rather than booting back into it, a new
+// image boots on trial: a record in RTC user memory counts its boots until
+// loop() has kept running for OTA_CONFIRM_MS. An image that resets more than
+// OTA_TRIAL_BOOTS times before that starts in recovery mode, with only the
+// softAP and the /api/ota routes, so a working image can go back on without
+// a cable. RTC memory does not survive a power cut, which ends a trial.
+
+#define OTA_RTC_OFFSET 40  // In 4-byte blocks; the state record (state_store.h) takes 32..36
+#define OTA_TRIAL_BOOTS 3
+#define OTA_CONFIRM_MS 30000
+#define OTA_TRIAL_MAGIC 0x4F544131  // "OTA1"
+
+class OtaService {
+public:
+  // Counts a trial boot and decides on recovery mode; call early in setup()
+  void begin();
+
+  // Registers the /api/ota routes
+  void addRoutes(ESP8266WebServer &server);
+
+  // Confirms a trial image, restarts into a finished upload; call from loop()
+  void poll();
+
+  bool trial() const { return _trial; }
+  bool recovery() const { return _recovery; }
+
+private:
+  struct RtcRecord {
+    uint32_t magic;
+    uint32_t boots;
+    uint32_t crc;
+  };
+
+  void writeRecord(uint32_t boots);
+  void sendStatus(int code);
+  uint32_t chunkOffset();
+
+  ESP8266WebServer *_server = NULL;
+  OtaSession _session;
+  bool _trial = false;
+  bool _recovery = false;
+};
+
+extern OtaService ota;
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef STATE_STORE_H
+#define STATE_STORE_H
+
+#include <Arduino.h>
+
+// Relay state across resets. The loop mirrors the state into RTC user
+// memory, which survives brownout, watchdog and software resets, so setup()
+// can drive the relay to its old state before WiFi is even started. A cold
+// boot finds no valid RTC record and falls back to the copy in flash, which
+// only holds what a user chose (mode, manual relay state, hold time) and is
+// written a few seconds after the last change to spare the flash.
+
+#define STATE_RTC_OFFSET 32          // In 4-byte blocks; the first 128 bytes carry the eboot OTA command
+#define STATE_RTC_REFRESH_MS 250     // Bounds how stale the restored off-timer can be
+#define STATE_FLASH_DELAY_MS 3000
+#define STATE_MAGIC 0x53574331       // "SWC1"
+
+struct SwitchState {
+  bool relay;
+  bool autoMode;
+  uint32_t holdMs;
+  uint32_t autoOffInMs;  // Left on the PIR off-timer; 0 when it is not running
+};
+
+class StateStore {
+public:
+  // Reads the RTC record, or the flash copy on a cold boot; false when neither is valid
+  bool restore(SwitchState &state);
+
+  // Mirrors the state into RTC memory, flash after a quiet period; call from loop()
+  void save(const SwitchState &state);
+
+  bool fromRtc() const { return _fromRtc; }
+
+private:
+  struct RtcRecord {
+    uint32_t magic;
+    uint8_t relay;
+    uint8_t autoMode;
+    uint16_t reserved;
+    uint32_t holdMs;
+    uint32_t autoOffInMs;
+    uint32_t crc;
+  };
+
+  struct FlashRecord {
+    uint32_t magic;
+    uint8_t relay;  // Manual mode only; auto mode starts off
+    uint8_t autoMode;
+    uint16_t reserved;
+    uint32_t holdMs;
+    uint32_t crc;
+  };
+
+  bool sameFlash(const SwitchState &state) const;
+
+  SwitchState _rtc = {};
+  SwitchState _flash = {};
+  uint32_t _rtcAtMs = 0;
+  uint32_t _changedAtMs = 0;
+  bool _flashDirty = false;
+  bool _fromRtc = false;
+};
+
+extern StateStore stateStore;
+
+#endif
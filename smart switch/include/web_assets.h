@@ -0,0 +1,57 @@
+// Generated by tools/embed_web.py from web/ -- do not edit
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <Arduino.h>
+
+#define WEB_INDEX_HTML_LEN 709
+#define WEB_INDEX_HTML_ETAG "\"9ed68dba\""
+static const uint8_t WEB_INDEX_HTML_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x9d, 0x94, 0xdf, 0x6f, 0xda, 0x30,
+  0x10, 0xc7, 0xdf, 0xf9, 0x2b, 0xae, 0xed, 0x83, 0x41, 0x6a, 0x02, 0xf4, 0x97, 0xd4, 0xfc, 0x9a,
+  0x3a, 0x06, 0x52, 0x1f, 0xba, 0xa2, 0xc1, 0xcb, 0x1e, 0x4d, 0x62, 0x88, 0xd7, 0xc4, 0x8e, 0x6c,
+  0x67, 0x81, 0x21, 0xfe, 0xf7, 0x9d, 0x1d, 0x46, 0xc7, 0xda, 0xb5, 0xd3, 0x84, 0x20, 0xdc, 0xe5,
+  0xee, 0x73, 0xe7, 0xaf, 0xcf, 0x8e, 0x4e, 0x3e, 0x3d, 0x8e, 0xe6, 0x5f, 0xa7, 0x63, 0xc8, 0x4d,
+  0x59, 0x24, 0x9d, 0xc8, 0x3d, 0xa2, 0x9c, 0xd1, 0x0c, 0x8d, 0x92, 0x19, 0x0a, 0x82, 0x96, 0x2c,
+  0x26, 0xdf, 0x39, 0x6b, 0x2a, 0xa9, 0x0c, 0x81, 0x54, 0x0a, 0xc3, 0x84, 0x89, 0x49, 0xc3, 0x33,
+  0x93, 0xc7, 0x19, 0xfb, 0xce, 0x53, 0xe6, 0x39, 0xe3, 0x1c, 0xb8, 0xe0, 0x86, 0xd3, 0xc2, 0xd3,
+  0x29, 0x2d, 0x58, 0x3c, 0xf4, 0x07, 0x04, 0x31, 0xda, 0x6c, 0x0a, 0x96, 0x2c, 0x64, 0xb6, 0x81,
+  0xed, 0x12, 0xb3, 0xbd, 0x25, 0x2d, 0x79, 0xb1, 0x09, 0xe0, 0x4e, 0x61, 0x6c, 0x08, 0x86, 0xad,
+  0x8d, 0x47, 0x0b, 0xbe, 0x12, 0x01, 0xa4, 0x88, 0x66, 0x2a, 0x84, 0x92, 0xaa, 0x15, 0x17, 0x9e,
+  0x91, 0x55, 0x00, 0xd7, 0x83, 0x6a, 0x1d, 0xee, 0x3a, 0x8b, 0xda, 0x18, 0x29, 0x60, 0xbb, 0xa0,
+  0xe9, 0xd3, 0x4a, 0xc9, 0x5a, 0x64, 0x5e, 0x2a, 0x0b, 0xa9, 0x02, 0x38, 0xbb, 0x1a, 0xdd, 0x4d,
+  0xae, 0x07, 0x21, 0x2c, 0xa4, 0xca, 0x18, 0x3a, 0x84, 0x14, 0x2c, 0x84, 0xfd, 0xdb, 0x26, 0xe7,
+  0x06, 0xad, 0x8a, 0x66, 0x19, 0x17, 0xab, 0x00, 0x86, 0xd7, 0xd5, 0x1a, 0x2e, 0x2f, 0x90, 0xd9,
+  0x79, 0xad, 0xb2, 0xeb, 0x50, 0xf3, 0x1f, 0x0c, 0x23, 0x6f, 0x30, 0x68, 0xdf, 0x4a, 0x00, 0x57,
+  0x98, 0x66, 0xb3, 0x20, 0xad, 0x95, 0xb6, 0xe0, 0x4a, 0xf2, 0x36, 0xa5, 0x2d, 0xeb, 0x29, 0x9a,
+  0xf1, 0x5a, 0x63, 0x9a, 0xeb, 0x37, 0xea, 0xb7, 0xeb, 0xee, 0x44, 0x7d, 0x27, 0x67, 0x64, 0x05,
+  0xb0, 0x0a, 0x0f, 0x93, 0xf1, 0x6c, 0x3a, 0x18, 0xc2, 0x0c, 0xc1, 0x06, 0x66, 0x0d, 0x37, 0x69,
+  0x8e, 0x31, 0x43, 0x7c, 0x57, 0x25, 0xa3, 0x5a, 0x29, 0x6c, 0x04, 0xb4, 0xa1, 0x06, 0x3b, 0x88,
+  0x74, 0x45, 0x05, 0xf0, 0x2c, 0x26, 0xce, 0x41, 0x12, 0xdf, 0xf7, 0x11, 0x8c, 0xce, 0x24, 0xea,
+  0x57, 0x2e, 0xe3, 0x41, 0x66, 0x47, 0x81, 0x25, 0xda, 0x2f, 0xe3, 0xf6, 0xe2, 0x49, 0x91, 0x16,
+  0x3c, 0x7d, 0x8a, 0x4f, 0x35, 0x13, 0x59, 0x97, 0xf4, 0x69, 0xc5, 0xfb, 0x8a, 0x15, 0x74, 0x43,
+  0xce, 0xa1, 0x2d, 0x11, 0x1b, 0xb9, 0x5a, 0x15, 0x8c, 0xf4, 0x4e, 0x93, 0xb9, 0xfb, 0x77, 0xe8,
+  0xb0, 0x45, 0xe0, 0x3a, 0x94, 0xfb, 0x1e, 0x98, 0xb6, 0x28, 0xad, 0x8d, 0x24, 0xaf, 0xd2, 0x5d,
+  0x3b, 0x08, 0xb7, 0x11, 0xb1, 0x51, 0xb5, 0x23, 0xdf, 0xa1, 0x01, 0xb6, 0xf1, 0x03, 0xf5, 0x88,
+  0x56, 0x52, 0x51, 0xd3, 0xe2, 0x1f, 0x78, 0x4b, 0x5a, 0x68, 0x07, 0x7c, 0x70, 0x19, 0x7f, 0x22,
+  0x75, 0xaa, 0x78, 0x65, 0x92, 0xce, 0xb2, 0x16, 0xa9, 0xe1, 0x08, 0xd7, 0xb9, 0x6c, 0xba, 0xba,
+  0x07, 0xdb, 0x0e, 0x40, 0x26, 0xd3, 0xba, 0x44, 0xa9, 0xfd, 0x15, 0x33, 0xe3, 0x82, 0xd9, 0xbf,
+  0x1f, 0x37, 0xf7, 0x58, 0xa6, 0x55, 0xba, 0xe7, 0xdb, 0xe1, 0x18, 0xb5, 0xc3, 0x0e, 0x31, 0x68,
+  0xdf, 0xf9, 0xe1, 0x03, 0x90, 0xc7, 0xcf, 0x04, 0x02, 0x7c, 0x4c, 0x26, 0x24, 0x7c, 0x0b, 0xe4,
+  0x5a, 0x7d, 0xc9, 0xb1, 0x9d, 0x5b, 0x8c, 0x15, 0xa1, 0xa4, 0x86, 0xa7, 0xd0, 0x9d, 0xde, 0x7f,
+  0xe9, 0x39, 0x66, 0xbb, 0x8e, 0xb7, 0xb1, 0x4e, 0xeb, 0x9e, 0xef, 0xa6, 0xcb, 0x7f, 0x3e, 0x0c,
+  0x23, 0x3b, 0xed, 0x47, 0x05, 0xce, 0x2e, 0x86, 0xb7, 0x37, 0x93, 0x4b, 0x07, 0x3e, 0xbb, 0x1d,
+  0xdb, 0xcf, 0x3b, 0x0d, 0xb7, 0xd5, 0xff, 0xce, 0x3e, 0x79, 0x0f, 0xbe, 0x7b, 0xd6, 0x5a, 0xb1,
+  0xa5, 0x62, 0x3a, 0xef, 0xb6, 0x6a, 0x2f, 0x19, 0xce, 0x10, 0x6e, 0xa1, 0x15, 0xb1, 0xd6, 0x56,
+  0x95, 0x9c, 0x89, 0xee, 0x21, 0xb8, 0xab, 0x30, 0x0c, 0x53, 0x4c, 0xad, 0x30, 0xd3, 0xff, 0xa6,
+  0xa5, 0xe8, 0xf6, 0x42, 0xd8, 0xed, 0xe3, 0xec, 0xbe, 0xf5, 0x8e, 0xe8, 0x6e, 0x22, 0x2a, 0x6a,
+  0xef, 0x1c, 0x7b, 0xae, 0x7e, 0x2f, 0xd2, 0x7a, 0xad, 0x0d, 0x80, 0x37, 0x58, 0x2e, 0x33, 0x6c,
+  0x71, 0xfa, 0x38, 0x9b, 0x93, 0x73, 0xe7, 0xb3, 0xa7, 0x91, 0x29, 0x3c, 0xa7, 0x5b, 0x20, 0xfb,
+  0x7d, 0xf1, 0xe6, 0x9b, 0x8a, 0x11, 0x0c, 0xa3, 0x55, 0x85, 0x13, 0x47, 0x6d, 0x89, 0xfe, 0xda,
+  0x6b, 0x9a, 0xc6, 0x5b, 0x4a, 0x55, 0x7a, 0xb5, 0x2a, 0x98, 0x48, 0x71, 0x3b, 0x33, 0x02, 0xbb,
+  0x96, 0x62, 0xab, 0x06, 0xee, 0x17, 0xcd, 0xdd, 0xff, 0xae, 0xe7, 0x20, 0x52, 0x88, 0xd7, 0xc4,
+  0xaf, 0x71, 0xc5, 0x09, 0xb6, 0x57, 0x05, 0xde, 0x09, 0xee, 0x4e, 0xfe, 0x09, 0xb2, 0xb5, 0x35,
+  0xc4, 0xa4, 0x05, 0x00, 0x00,
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include "discovery.h"
+
+#include <ESP8266WiFi.h>
+#include <ESP8266mDNS.h>
+
+DeviceDiscovery discovery;
+
+bool DeviceDiscovery::begin(const char *firmware) {
+  // Same MAC-based ID format as the gas monitors
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  char id[DISCOVERY_ID_SIZE];
+  snprintf(id, sizeof(id), "%02X%02X%02X%02X%02X%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+  _reply.magic = DISCOVERY_MAGIC;
+  _reply.version = DISCOVERY_VERSION;
+  _reply.kind = DISCOVERY_KIND_SWITCH;
+  _reply.httpPort = DISCOVERY_HTTP_PORT;
+  _reply.wsPort = DISCOVERY_WS_PORT;
+  discoveryCopyText(_reply.wsPath, sizeof(_reply.wsPath), DISCOVERY_WS_PATH);
+  discoveryCopyText(_reply.deviceId, sizeof(_reply.deviceId), id);
+  discoveryCopyText(_reply.firmware, sizeof(_reply.firmware), firmware);
+
+  char host[32];
+  snprintf(host, sizeof(host), DISCOVERY_HOST_PREFIX "%02x%02x%02x%02x%02x%02x",
+           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  if (MDNS.begin(host)) {
+    MDNS.addService(DISCOVERY_SERVICE, "tcp", DISCOVERY_HTTP_PORT);
+    MDNS.addServiceTxt(DISCOVERY_SERVICE, "tcp", "id", id);
+    MDNS.addServiceTxt(DISCOVERY_SERVICE, "tcp", "fw", firmware);
+    MDNS.addServiceTxt(DISCOVERY_SERVICE, "tcp", "ws", DISCOVERY_WS_PATH);
+    MDNS.addServiceTxt(DISCOVERY_SERVICE, "tcp", "wsport", String(DISCOVERY_WS_PORT).c_str());
+    MDNS.addServiceTxt(DISCOVERY_SERVICE, "tcp", "udp", String(DISCOVERY_PORT).c_str());
+  } else {
+    Serial.println("mDNS responder failed to start");
+  }
+
+  _started = _udp.begin(DISCOVERY_PORT);
+  Serial.printf("Discovery: %s.local, UDP %u\n", host, DISCOVERY_PORT);
+  return _started;
+}
+
+void DeviceDiscovery::poll() {
+  MDNS.update();
+  if (!_started) return;
+
+  for (uint8_t i = 0; i < DISCOVERY_REQUESTS_PER_POLL; i++) {
+    int len = _udp.parsePacket();
+    if (len <= 0) return;
+
+    uint8_t request[sizeof(DiscoveryRequest)];
+    int read = _udp.read(request, sizeof(request));
+    if (len != read || !discoveryRequestMatches(request, read, DISCOVERY_KIND_SWITCH)) {
+      continue;
+    }
+
+    _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
+    _udp.write((const uint8_t *)&_reply, sizeof(_reply));
+    _udp.endPacket();
+  }
+}
@@ -0,0 +1,133 @@
+#include "group_control.h"
+
+#include <ESP8266WiFi.h>
+#include <EEPROM.h>
+#include <lwip/igmp.h>
+
+#include "mesh_link.h"
+
+GroupControl groupControl;
+
+bool GroupControl::begin(GroupActionCallback callback, const volatile bool *relay) {
+  _callback = callback;
+  _relay = relay;
+  WiFi.macAddress(_mac);
+
+  EEPROM.begin(EEPROM_SIZE);
+  Stored stored;
+  EEPROM.get(GROUP_EEPROM_OFFSET, stored);
+  if (stored.magic == GROUP_EEPROM_MAGIC && stored.check == ~stored.groups) {
+    _groups = stored.groups;
+  }
+
+  _pcb = udp_new();
+  if (_pcb == NULL || udp_bind(_pcb, IP_ADDR_ANY, GROUP_PORT) != ERR_OK) {
+    Serial.println("Group control: UDP bind failed");
+    return false;
+  }
+  udp_recv(_pcb, onUdp, this);
+
+  // Join on every interface; the softAP is the only one today
+  ip4_addr_t group;
+  IP4_ADDR(&group, GROUP_MULTICAST_ADDR);
+  igmp_joingroup(IP4_ADDR_ANY4, &group);
+
+  Serial.printf("Group control: UDP %u, groups 0x%08lx\n", GROUP_PORT, (unsigned long)_groups);
+  return true;
+}
+
+void GroupControl::setGroups(uint32_t mask) {
+  if (mask == _groups) return;
+  _groups = mask;
+
+  Stored stored = {GROUP_EEPROM_MAGIC, mask, ~mask};
+  EEPROM.put(GROUP_EEPROM_OFFSET, stored);
+  EEPROM.commit();
+}
+
+// lwIP receive callback; the SDK calls it between loop() iterations
+void GroupControl::onUdp(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, uint16_t port) {
+  GroupControl *self = (GroupControl *)arg;
+  GroupCommand command;
+  bool valid = p->tot_len == sizeof(command) &&
+               pbuf_copy_partial(p, &command, sizeof(command), 0) == sizeof(command) &&
+               groupCommandValid((const uint8_t *)&command, sizeof(command));
+  pbuf_free(p);
+  if (!valid) return;
+
+  if (!self->member(command.group)) return;
+
+  // Other switches may sit on another softAP; the radio reaches them anyway
+  if (!(command.flags & GROUP_FLAG_FORWARDED)) {
+    mesh.forwardGroup(command);
+  }
+
+  bool relay;
+  uint8_t status = self->handle(command, relay);
+  if (!(command.flags & GROUP_FLAG_NO_ACK)) {
+    self->sendAck(command, status, relay, addr, port);
+  }
+}
+
+void GroupControl::handleForwarded(const GroupCommand &command) {
+  if (member(command.group)) {
+    bool relay;
+    handle(command, relay);
+  }
+}
+
+bool GroupControl::member(uint8_t group) const {
+  return group == GROUP_ALL || (group < GROUP_MAX_GROUPS && (_groups & (1UL << group)));
+}
+
+// Applies each (sender, seq) once; retries and relayed copies only get the status again
+uint8_t GroupControl::handle(const GroupCommand &command, bool &relay) {
+  Sender *sender = NULL;
+  for (uint8_t i = 0; i < GROUP_SENDERS; i++) {
+    if (_senders[i].used && _senders[i].id == command.sender) {
+      sender = &_senders[i];
+      break;
+    }
+  }
+
+  if (sender != NULL) {
+    int32_t age = (int32_t)(sender->seq - command.seq);
+    if (age >= 0) {
+      _duplicates++;
+      relay = *_relay;
+      return age == 0 ? GROUP_ACK_DUPLICATE : GROUP_ACK_STALE;
+    }
+  } else {
+    // Oldest remembered sender makes room
+    sender = &_senders[_nextSender];
+    _nextSender = (_nextSender + 1) % GROUP_SENDERS;
+    sender->used = true;
+    sender->id = command.sender;
+  }
+
+  sender->seq = command.seq;
+  uint8_t status = _callback(command.action, relay);
+  if (status == GROUP_ACK_APPLIED) {
+    _applied++;
+  }
+  return status;
+}
+
+void GroupControl::sendAck(const GroupCommand &command, uint8_t status, bool relay, const ip_addr_t *addr, uint16_t port) {
+  struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, sizeof(GroupAck), PBUF_RAM);
+  if (p == NULL) return;
+
+  GroupAck *ack = (GroupAck *)p->payload;
+  ack->magic = GROUP_MAGIC;
+  ack->version = GROUP_VERSION;
+  ack->type = GROUP_TYPE_ACK;
+  ack->status = status;
+  ack->group = command.group;
+  ack->relay = relay ? 1 : 0;
+  memcpy(ack->mac, _mac, sizeof(ack->mac));
+  ack->sender = command.sender;
+  ack->seq = command.seq;
+
+  udp_sendto(_pcb, p, addr, port);
+  pbuf_free(p);
+}
@@ -0,0 +1,45 @@
+#include "loop_timing.h"
+
+#include <ESP8266WiFi.h>
+
+LoopTiming loopTiming;
+
+void LoopTiming::begin(bool throttled) {
+  _windowStartUs = micros();
+  _workStartUs = _windowStartUs;
+  setThrottled(throttled);
+}
+
+void LoopTiming::setThrottled(bool throttled) {
+  _throttled = throttled;
+  WiFi.setOutputPower(throttled ? LOOP_THROTTLE_TX_DBM : LOOP_TX_DBM);
+}
+
+void LoopTiming::beginWork() {
+  uint32_t now = micros();
+  uint32_t gap = now - _workStartUs;
+  _workStartUs = now;
+
+  _gapSumUs += gap;
+  _gapCount++;
+  if (gap > _gapPeakUs) {
+    _gapPeakUs = gap;
+  }
+
+  uint32_t elapsed = now - _windowStartUs;
+  if (elapsed >= LOOP_WINDOW_MS * 1000UL) {
+    _busyPermille = (uint64_t)_busyUs * 1000 / elapsed;
+    _gapAvgUs = _gapSumUs / _gapCount;
+    _gapMaxUs = _gapPeakUs;
+
+    _windowStartUs = now;
+    _busyUs = 0;
+    _gapSumUs = 0;
+    _gapCount = 0;
+    _gapPeakUs = 0;
+  }
+}
+
+void LoopTiming::endWork() {
+  _busyUs += micros() - _workStartUs;
+}
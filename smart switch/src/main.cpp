@@ -1,5 +1,21 @@
 #include <ESP8266WiFi.h>
 #include <ESP8266WebServer.h>
+#include <WebSocketsServer.h>
+#include <Ticker.h>
+#include <boards.h>
+
+#include "web_assets.h"
+#include "loop_timing.h"
+#include "mesh_link.h"
+#include "discovery.h"
+#include "group_control.h"
+#include "state_store.h"
+#include "ota.h"
+
+// Reported over mDNS and UDP discovery
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "1.3.0"
+#endif
 
 // Network credentials for AP mode
 const char* ssid = "SmartSwitch";
@@ -11,109 +27,338 @@ IPAddress subnet(255, 255, 255, 0);
 // Web server port
 ESP8266WebServer server(80);
 
+// State push channel: every client gets the /status JSON on connect and on each change
+WebSocketsServer webSocket(81);
+
 // GPIO pin configuration
-const int relayPin = 0; // GPIO2 on ESP-01
-const int pirPin = 2;   // GPIO0 on ESP-01 for PIR sensor
+// Pin map (boards.h); relay and PIR go straight to the GPIO registers, ISR included
+#ifndef SWITCH_BOARD
+#define SWITCH_BOARD SmartSwitchEsp01
+#endif
+using Board = SWITCH_BOARD;
+using RelayOut = Board::Relay;
+using PirIn = Board::Pir;
 
-// State variables
-bool relayState = false;
+// State variables (relay and PIR state are also written from the PIR interrupt)
+volatile bool relayState = false;
 bool autoMode = false;
-bool pirDetected = false;
-unsigned long lastPirDetection = 0;
-const unsigned long AUTO_OFF_DELAY = 60000; // 60 seconds delay before turning off light when no motion
+volatile bool pirDetected = false;
+volatile unsigned long lastPirDetection = 0;
+uint8_t publishedState = 0xFF; // Packed relay/auto/PIR/throttle/override last pushed to WebSocket clients
+unsigned long publishedHold = 0;
+const unsigned long AUTO_OFF_DELAY = 60000; // Default hold time before turning off light when no motion
+const unsigned long MIN_HOLD_TIME = 1000;
+const unsigned long MAX_HOLD_TIME = 3600000;
+unsigned long holdTime = AUTO_OFF_DELAY; // Set at runtime through /setmode?hold=<seconds>
+
+// PIR edges interrupt the CPU and switch the relay on directly; the off-delay
+// runs on a Ticker armed by the loop when motion ends
+volatile bool pirEdge = false;
+Ticker autoOffTimer;
+unsigned long autoOffDeadline = 0; // millis() when the running off-timer fires
+
+// Gas alarm from a monitor on the ESP-NOW mesh can force the relay on
+// (e.g. a ventilation fan) or off (e.g. an appliance supply) until it clears
+enum AlarmAction { ALARM_ACTION_NONE, ALARM_ACTION_ON, ALARM_ACTION_OFF };
+AlarmAction alarmAction = ALARM_ACTION_NONE;
+volatile bool alarmOverride = false;
 
 void handleRoot();
 void handleToggle();
 void handleStatus();
 void handleSetMode();
 void handleNotFound();
+void handleApiRelay();
+void handleApiMode();
+void applyModeArgs();
+void sendStatus(int code);
+void handleWebSocketEvent(uint8_t num, WStype_t type, uint8_t *payload, size_t length);
+size_t formatStatus(char *buf, size_t size);
+void publishState();
+void IRAM_ATTR handlePirInterrupt();
+void IRAM_ATTR motionOn();
+void updateAutoOffTimer();
+void handleAutoOff();
+void handleMeshAlarm(bool active);
+void applyAlarmOverride();
+uint8_t applyGroupAction(uint8_t action, bool &relay);
+void handleMeshGroup(const GroupCommand &command);
+void restoreAutoOff(uint32_t remainingMs);
+SwitchState currentState();
+void startAccessPoint();
+void startRecovery();
 
 void setup() {
+  // State from before a brownout or watchdog reset goes back on the relay
+  // first, milliseconds after boot and long before WiFi is up
+  SwitchState saved;
+  bool restored = stateStore.restore(saved);
+  if (restored) {
+    relayState = saved.relay;
+    autoMode = saved.autoMode;
+    holdTime = constrain(saved.holdMs, MIN_HOLD_TIME, MAX_HOLD_TIME);
+  }
+  RelayOut::begin(relayState);
+
   Serial.begin(115200);
   delay(10);
+
+  // A new image that keeps resetting only brings up what it takes to replace it
+  ota.begin();
+  if (ota.recovery()) {
+    startRecovery();
+    return;
+  }
   
   // Initialize pins
-  pinMode(relayPin, OUTPUT);
-  pinMode(pirPin, INPUT);
-  digitalWrite(relayPin, HIGH); // Ensure relay starts in OFF state
-  
-  // Configure access point with static IP
-  WiFi.mode(WIFI_AP);
-  WiFi.softAPConfig(staticIP, gateway, subnet);
-  WiFi.softAP(ssid, password);
+  PirIn::begin();
+  attachInterrupt(digitalPinToInterrupt(PirIn::pin), handlePirInterrupt, CHANGE);
+  if (autoMode) {
+    restoreAutoOff(restored ? saved.autoOffInMs : 0);
+  }
+  Serial.printf("State %s: relay %s, %s mode\n",
+                !restored ? "defaults" : stateStore.fromRtc() ? "from RTC" : "from flash",
+                relayState ? "on" : "off", autoMode ? "auto" : "manual");
   
-  Serial.println();
-  Serial.print("Access Point \"");
-  Serial.print(ssid);
-  Serial.println("\" started");
-  Serial.print("IP address: ");
-  Serial.println(WiFi.softAPIP());
+  startAccessPoint();
   
   // Set up web server routes
   server.on("/", handleRoot);
   server.on("/toggle", handleToggle);
   server.on("/status", handleStatus);
   server.on("/setmode", handleSetMode);
+  // JSON variants for apps: reply with the new state instead of redirecting to /
+  server.on("/api/relay", HTTP_POST, handleApiRelay);
+  server.on("/api/mode", HTTP_POST, handleApiMode);
+  // Firmware upload, staged next to the running sketch (ota.h)
+  ota.addRoutes(server);
   server.onNotFound(handleNotFound);
+
+  // Needed to answer revalidation of the cached page with 304
+  const char *headerKeys[] = {"If-None-Match"};
+  server.collectHeaders(headerKeys, 1);
+  
+  // Let one app connection carry several requests
+  server.keepAlive(true);
   
   // Start server
   server.begin();
   Serial.println("HTTP server started");
-  digitalWrite(relayPin, LOW); // Turn on relay when server starts
+
+  webSocket.begin();
+  webSocket.onEvent(handleWebSocketEvent);
+  loopTiming.begin(false);
+
+  mesh.begin();
+  mesh.onAlarm(handleMeshAlarm);
+  groupControl.begin(applyGroupAction, &relayState);
+  mesh.onGroup(handleMeshGroup);
+  discovery.begin(FIRMWARE_VERSION);
 }
 
 void loop() {
+  if (ota.recovery()) {
+    server.handleClient();
+    ota.poll();
+    delay(1);
+    return;
+  }
+
+  loopTiming.beginWork();
   server.handleClient();
+  webSocket.loop();
+  discovery.poll();
+  ota.poll();
   
-  // Handle PIR sensor logic when in auto mode
-  if (autoMode) {
-    int pirState = digitalRead(pirPin);
-    
-    if (pirState == HIGH) {
-      pirDetected = true;
-      lastPirDetection = millis();
-      
-      // Turn on relay if it's off
-      if (!relayState) {
-        relayState = true;
-        digitalWrite(relayPin, HIGH);
-        Serial.println("Motion detected - Turning ON");
-      }
-    } else if (pirDetected && (millis() - lastPirDetection > AUTO_OFF_DELAY)) {
-      // Turn off relay after delay if no motion is detected
-      pirDetected = false;
-      relayState = false;
-      digitalWrite(relayPin, LOW);
-      Serial.println("No motion for delay period - Turning OFF");
+  // The interrupt already switched the relay; follow up on the off timer
+  if (pirEdge) {
+    pirEdge = false;
+    if (autoMode && PirIn::level()) {
+      Serial.println("Motion detected - Turning ON");
     }
+    updateAutoOffTimer();
   }
+
+  publishState();
+  stateStore.save(currentState());
+  loopTiming.endWork();
   
-  delay(10);
+  delay(loopTiming.idleMs());
+}
+
+// Configure access point with static IP
+void startAccessPoint() {
+  WiFi.mode(WIFI_AP);
+  WiFi.softAPConfig(staticIP, gateway, subnet);
+  WiFi.softAP(ssid, password);
+  
+  Serial.println();
+  Serial.print("Access Point \"");
+  Serial.print(ssid);
+  Serial.println("\" started");
+  Serial.print("IP address: ");
+  Serial.println(WiFi.softAPIP());
+}
+
+// SoftAP and the OTA routes only; the relay keeps its restored state
+void startRecovery() {
+  startAccessPoint();
+  ota.addRoutes(server);
+  server.onNotFound([]() {
+    server.send(503, "text/plain", "Recovery mode: upload a firmware image through /api/ota");
+  });
+  server.begin();
+  Serial.println("Recovery mode, waiting for a firmware upload");
+}
+
+void IRAM_ATTR handlePirInterrupt() {
+  pirEdge = true;
+  if (autoMode && PirIn::level()) {
+    motionOn();
+  }
+}
+
+void IRAM_ATTR motionOn() {
+  pirDetected = true;
+  lastPirDetection = millis();
+  if (!relayState && !alarmOverride) {
+    relayState = true;
+    RelayOut::on();
+  }
+}
+
+// Motion restarts the hold period: cancel while the PIR is high, arm when it drops
+void updateAutoOffTimer() {
+  if (!autoMode) {
+    autoOffTimer.detach();
+  } else if (PirIn::level()) {
+    autoOffTimer.detach();
+  } else if (pirDetected) {
+    autoOffDeadline = millis() + holdTime;
+    autoOffTimer.once_ms(holdTime, handleAutoOff);
+  }
+}
+
+// Auto mode after a reset: the hold that was running picks up where it was
+void restoreAutoOff(uint32_t remainingMs) {
+  if (PirIn::level()) {
+    motionOn();
+    return;
+  }
+  if (relayState && remainingMs > 0) {
+    pirDetected = true;
+    lastPirDetection = millis();
+    autoOffDeadline = millis() + remainingMs;
+    autoOffTimer.once_ms(remainingMs, handleAutoOff);
+  } else if (relayState) {
+    // On with no timer left to run; treat it as motion that just ended
+    pirDetected = true;
+    updateAutoOffTimer();
+  }
+}
+
+SwitchState currentState() {
+  SwitchState state;
+  state.relay = relayState;
+  state.autoMode = autoMode;
+  state.holdMs = holdTime;
+  state.autoOffInMs = 0;
+  if (autoOffTimer.active()) {
+    long left = (long)(autoOffDeadline - millis());
+    state.autoOffInMs = left > 0 ? left : 1;
+  } else if (autoMode && pirDetected) {
+    state.autoOffInMs = holdTime;  // Motion still going; the full hold follows
+  }
+  return state;
+}
+
+void handleAutoOff() {
+  bool switchedOff = false;
+
+  // A motion edge between the level check and the relay write must win
+  noInterrupts();
+  if (autoMode && pirDetected && !alarmOverride && !PirIn::level()) {
+    pirDetected = false;
+    relayState = false;
+    RelayOut::off();
+    switchedOff = true;
+  }
+  interrupts();
+
+  if (switchedOff) {
+    Serial.println("No motion for delay period - Turning OFF");
+  }
+}
+
+void handleMeshAlarm(bool active) {
+  if (active) {
+    Serial.println("Mesh gas alarm");
+    applyAlarmOverride();
+    return;
+  }
+
+  if (alarmOverride) {
+    alarmOverride = false;
+    // Hand the relay back to the PIR hold logic
+    if (autoMode) {
+      pirDetected = relayState;
+      updateAutoOffTimer();
+    }
+  }
+}
+
+void applyAlarmOverride() {
+  if (alarmAction == ALARM_ACTION_NONE || !mesh.alarmActive()) {
+    alarmOverride = false;
+    return;
+  }
+
+  autoOffTimer.detach();
+  noInterrupts();
+  alarmOverride = true;
+  relayState = alarmAction == ALARM_ACTION_ON;
+  RelayOut::write(relayState);
+  interrupts();
+}
+
+// Group command from UDP or a relaying switch; same rules as /api/relay
+uint8_t applyGroupAction(uint8_t action, bool &relay) {
+  if (autoMode || alarmOverride) {
+    relay = relayState;
+    return GROUP_ACK_BLOCKED;
+  }
+
+  bool target = action == GROUP_ACTION_RELAY_ON;
+  relay = target;
+  if (relayState == target) {
+    return GROUP_ACK_UNCHANGED;
+  }
+  relayState = target;
+  RelayOut::write(target);
+  return GROUP_ACK_APPLIED;
 }
 
-// Handle root URL
+void handleMeshGroup(const GroupCommand &command) {
+  groupControl.handleForwarded(command);
+}
+
+// Handle root URL: a static gzipped page in flash that reads /status itself
 void handleRoot() {
-  String html = "<html><head>";
-  html += "<meta name='viewport' content='width=device-width, initial-scale=1.0'>";
-  html += "<style>body {font-family: Arial; text-align: center; margin-top: 50px;}";
-  html += "button {background-color: #4CAF50; border: none; color: white; padding: 15px 32px;";
-  html += "text-align: center; font-size: 16px; margin: 4px 2px; cursor: pointer; border-radius: 10px;}</style>";
-  html += "</head><body>";
-  html += "<h1>ESP01 Smart Switch</h1>";
-  html += "<p>Current state: " + String(relayState ? "ON" : "OFF") + "</p>";
-  html += "<p>Mode: " + String(autoMode ? "Automatic (PIR)" : "Manual") + "</p>";
-  html += "<button onclick='location.href=\"/toggle\"'>Toggle Switch</button><br><br>";
-  html += "<button onclick='location.href=\"/setmode?auto=true\"' style='background-color:" + String(autoMode ? "#2196F3" : "#9E9E9E") + "'>Auto Mode</button> ";
-  html += "<button onclick='location.href=\"/setmode?auto=false\"' style='background-color:" + String(!autoMode ? "#2196F3" : "#9E9E9E") + "'>Manual Mode</button>";
-  html += "</body></html>";
-  server.send(200, "text/html", html);
+  server.sendHeader("ETag", WEB_INDEX_HTML_ETAG);
+  server.sendHeader("Cache-Control", "no-cache");
+  if (server.header("If-None-Match") == WEB_INDEX_HTML_ETAG) {
+    server.send(304);
+    return;
+  }
+  server.sendHeader("Content-Encoding", "gzip");
+  server.send_P(200, "text/html", (PGM_P)WEB_INDEX_HTML_GZ, WEB_INDEX_HTML_LEN);
 }
 
 // Handle toggle request (only works in manual mode)
 void handleToggle() {
-  if (!autoMode) {
+  if (!autoMode && !alarmOverride) {
     relayState = !relayState;
-    digitalWrite(relayPin, relayState ? HIGH : LOW);
+    RelayOut::write(relayState);
   }
   server.sendHeader("Location", "/");
   server.send(302, "text/plain", "");
@@ -121,31 +366,175 @@ void handleToggle() {
 
 // Handle mode setting
 void handleSetMode() {
+  applyModeArgs();
+  server.sendHeader("Location", "/");
+  server.send(302, "text/plain", "");
+}
+
+// POST /api/relay, state=on|off|toggle (only works in manual mode without a mesh alarm)
+void handleApiRelay() {
+  if (autoMode || alarmOverride) {
+    sendStatus(409);
+    return;
+  }
+
+  String value = server.arg("state");
+  if (value == "toggle") {
+    relayState = !relayState;
+  } else if (value == "on" || value == "true" || value == "1") {
+    relayState = true;
+  } else if (value == "off" || value == "false" || value == "0") {
+    relayState = false;
+  } else {
+    sendStatus(400);
+    return;
+  }
+  RelayOut::write(relayState);
+  sendStatus(200);
+}
+
+// POST /api/mode, same auto/hold/throttle arguments as /setmode
+void handleApiMode() {
+  applyModeArgs();
+  sendStatus(200);
+}
+
+// Shared by /setmode and /api/mode
+void applyModeArgs() {
   if (server.hasArg("auto")) {
     String autoArg = server.arg("auto");
     
     if (autoArg == "true") {
       autoMode = true;
-      // Reset PIR state when entering auto mode
+      // Reset PIR state when entering auto mode; motion already in progress counts
       pirDetected = false;
+      if (PirIn::level()) {
+        motionOn();
+      }
+      updateAutoOffTimer();
     } else if (autoArg == "false") {
       autoMode = false;
+      autoOffTimer.detach();
       // Turn off relay when exiting auto mode
-      relayState = false;
-      digitalWrite(relayPin, LOW);
+      if (!alarmOverride) {
+        relayState = false;
+        RelayOut::off();
+      }
     }
   }
-  
-  server.sendHeader("Location", "/");
-  server.send(302, "text/plain", "");
+
+  // Which monitor's gas alarm drives the relay, and how
+  if (server.hasArg("source")) {
+    String source = server.arg("source");
+    unsigned int b[6];
+    if (source == "any") {
+      mesh.setAlarmSource(NULL);
+    } else if (sscanf(source.c_str(), "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) == 6) {
+      uint8_t mac[6] = {(uint8_t)b[0], (uint8_t)b[1], (uint8_t)b[2], (uint8_t)b[3], (uint8_t)b[4], (uint8_t)b[5]};
+      mesh.setAlarmSource(mac);
+    }
+  }
+  if (server.hasArg("alarm")) {
+    String action = server.arg("alarm");
+    if (action == "on") {
+      alarmAction = ALARM_ACTION_ON;
+    } else if (action == "off") {
+      alarmAction = ALARM_ACTION_OFF;
+    } else if (action == "none") {
+      alarmAction = ALARM_ACTION_NONE;
+    }
+    applyAlarmOverride();
+  }
+
+  // Group control membership: comma-separated IDs 0..31, or "none"
+  if (server.hasArg("groups")) {
+    String list = server.arg("groups");
+    uint32_t mask = 0;
+    if (list != "none") {
+      const char *p = list.c_str();
+      while (*p != '\0') {
+        char *end;
+        unsigned long id = strtoul(p, &end, 10);
+        if (end == p) break;
+        if (id < GROUP_MAX_GROUPS) {
+          mask |= 1UL << id;
+        }
+        p = *end == ',' ? end + 1 : end;
+      }
+    }
+    groupControl.setGroups(mask);
+  }
+
+  // Lower TX power and a longer loop idle; the AP radio itself stays on
+  if (server.hasArg("throttle")) {
+    loopTiming.setThrottled(server.arg("throttle") == "on");
+  }
+
+  // Hold time in seconds; applies from the next time motion ends
+  if (server.hasArg("hold")) {
+    unsigned long hold = strtoul(server.arg("hold").c_str(), NULL, 10) * 1000UL;
+    holdTime = constrain(hold, MIN_HOLD_TIME, MAX_HOLD_TIME);
+  }
 }
 
 // Handle status request (for API)
 void handleStatus() {
-  String json = "{\"state\":" + String(relayState ? "true" : "false");
-  json += ", \"auto\":" + String(autoMode ? "true" : "false");
-  json += ", \"pir\":" + String(pirDetected ? "true" : "false") + "}";
-  server.send(200, "application/json", json);
+  sendStatus(200);
+}
+
+void sendStatus(int code) {
+  char json[320];
+  formatStatus(json, sizeof(json));
+  server.send(code, "application/json", json);
+}
+
+size_t formatStatus(char *buf, size_t size) {
+  static const char *const actions[] = {"none", "on", "off"};
+  const uint8_t *source = mesh.alarmSource();
+  char sourceText[18] = "any";
+  if (!mesh.alarmSourceAny()) {
+    snprintf(sourceText, sizeof(sourceText), "%02X:%02X:%02X:%02X:%02X:%02X",
+             source[0], source[1], source[2], source[3], source[4], source[5]);
+  }
+
+  return snprintf(buf, size,
+                  "{\"state\":%s, \"auto\":%s, \"pir\":%s, \"hold\":%lu, "
+                  "\"loop\":{\"throttle\":%s, \"busy\":%u.%u, \"gapAvgUs\":%lu, \"gapMaxUs\":%lu}, "
+                  "\"mesh\":{\"alarm\":%s, \"action\":\"%s\", \"source\":\"%s\", \"override\":%s}, "
+                  "\"groups\":%lu}",
+                  relayState ? "true" : "false", autoMode ? "true" : "false", pirDetected ? "true" : "false",
+                  holdTime / 1000, loopTiming.throttled() ? "true" : "false",
+                  loopTiming.busyPermille() / 10, loopTiming.busyPermille() % 10,
+                  (unsigned long)loopTiming.gapAvgUs(), (unsigned long)loopTiming.gapMaxUs(),
+                  mesh.alarmActive() ? "true" : "false", actions[alarmAction], sourceText,
+                  alarmOverride ? "true" : "false", (unsigned long)groupControl.groups());
+}
+
+// Pushes the state to all WebSocket clients when anything changed since the last push
+void publishState() {
+  uint8_t state = (relayState ? 1 : 0) | (autoMode ? 2 : 0) | (pirDetected ? 4 : 0);
+  state |= (loopTiming.throttled() ? 8 : 0) | (alarmOverride ? 16 : 0);
+  bool changed = state != publishedState || holdTime != publishedHold;
+
+  // Mesh peers get changes right away and a heartbeat otherwise
+  mesh.publish(relayState, autoMode, pirDetected, changed);
+  if (!changed) {
+    return;
+  }
+  publishedState = state;
+  publishedHold = holdTime;
+
+  char json[320];
+  size_t len = formatStatus(json, sizeof(json));
+  webSocket.broadcastTXT(json, len);
+}
+
+void handleWebSocketEvent(uint8_t num, WStype_t type, uint8_t *payload, size_t length) {
+  if (type == WStype_CONNECTED) {
+    char json[320];
+    size_t len = formatStatus(json, sizeof(json));
+    webSocket.sendTXT(num, json, len);
+  }
 }
 
 // Handle 404
@@ -0,0 +1,123 @@
+#include "mesh_link.h"
+
+#include <ESP8266WiFi.h>
+#include <espnow.h>
+
+MeshLink mesh;
+MeshLink *MeshLink::_instance = NULL;
+
+bool MeshLink::begin() {
+  _instance = this;
+
+  // Needs the WiFi driver up; frames go out on the softAP's channel
+  if (esp_now_init() != 0) {
+    Serial.println("ESP-NOW init failed, mesh disabled");
+    return false;
+  }
+  esp_now_set_self_role(ESP_NOW_ROLE_COMBO);
+  esp_now_add_peer((uint8_t *)MESH_BROADCAST, ESP_NOW_ROLE_COMBO, WiFi.channel(), NULL, 0);
+  esp_now_register_recv_cb(onReceive);
+  _started = true;
+  return true;
+}
+
+void MeshLink::setAlarmSource(const uint8_t *mac) {
+  _any = mac == NULL;
+  if (mac != NULL) {
+    memcpy(_source, mac, sizeof(_source));
+  }
+  updateAlarm();
+}
+
+void MeshLink::publish(bool relay, bool autoMode, bool pir, bool urgent) {
+  if (!_started) return;
+
+  uint32_t now = millis();
+  if (!urgent && now - _lastBroadcastMs < MESH_BROADCAST_INTERVAL_MS) {
+    return;
+  }
+  _lastBroadcastMs = now;
+
+  MeshFrame frame = {};
+  frame.magic = MESH_MAGIC;
+  frame.version = MESH_VERSION;
+  frame.kind = MESH_KIND_SWITCH;
+  frame.flags = (relay ? MESH_FLAG_RELAY : 0) | (autoMode ? MESH_FLAG_AUTO : 0) |
+                (pir ? MESH_FLAG_PIR : 0) | (urgent ? MESH_FLAG_URGENT : 0);
+  frame.seq = _seq++;
+  frame.uptimeMs = now;
+  esp_now_send((uint8_t *)MESH_BROADCAST, (uint8_t *)&frame, sizeof(frame));
+}
+
+void MeshLink::forwardGroup(const GroupCommand &command) {
+  if (!_started) return;
+
+  GroupCommand relayed = command;
+  relayed.flags |= GROUP_FLAG_FORWARDED | GROUP_FLAG_NO_ACK;
+  esp_now_send((uint8_t *)MESH_BROADCAST, (uint8_t *)&relayed, sizeof(relayed));
+}
+
+// Runs in the SDK's WiFi context, between loop() iterations
+void MeshLink::onReceive(uint8_t *mac, uint8_t *data, uint8_t len) {
+  if (_instance == NULL) {
+    return;
+  }
+  if (groupCommandValid(data, len)) {
+    if (_instance->_groupCallback != NULL) {
+      GroupCommand command;
+      memcpy(&command, data, sizeof(command));
+      _instance->_groupCallback(command);
+    }
+    return;
+  }
+  if (!meshFrameValid(data, len)) {
+    return;
+  }
+  MeshFrame frame;
+  memcpy(&frame, data, sizeof(frame));
+  _instance->handleFrame(mac, frame);
+}
+
+void MeshLink::handleFrame(const uint8_t *mac, const MeshFrame &frame) {
+  _received++;
+  if (frame.kind != MESH_KIND_MONITOR) {
+    return;
+  }
+
+  Monitor *slot = NULL;
+  for (size_t i = 0; i < MESH_MAX_MONITORS; i++) {
+    if (_monitors[i].used && memcmp(_monitors[i].mac, mac, 6) == 0) {
+      slot = &_monitors[i];
+      break;
+    }
+    if (slot == NULL && !_monitors[i].used) {
+      slot = &_monitors[i];
+    }
+  }
+  if (slot == NULL) {
+    return;  // Table full of other monitors
+  }
+
+  slot->used = true;
+  memcpy(slot->mac, mac, 6);
+  slot->alarm = (frame.flags & MESH_FLAG_ALARM) != 0;
+  updateAlarm();
+}
+
+void MeshLink::updateAlarm() {
+  bool alarm = false;
+  for (size_t i = 0; i < MESH_MAX_MONITORS; i++) {
+    const Monitor &monitor = _monitors[i];
+    if (monitor.used && monitor.alarm && (_any || memcmp(monitor.mac, _source, 6) == 0)) {
+      alarm = true;
+      break;
+    }
+  }
+
+  if (alarm != _alarm) {
+    _alarm = alarm;
+    if (_callback != NULL) {
+      _callback(alarm);
+    }
+  }
+}
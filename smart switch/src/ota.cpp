@@ -0,0 +1,106 @@
+#include "ota.h"
+
+#include <coredecls.h>
+
+OtaService ota;
+
+void OtaService::begin() {
+  RtcRecord record;
+  if (!ESP.rtcUserMemoryRead(OTA_RTC_OFFSET, (uint32_t *)&record, sizeof(record)) ||
+      record.magic != OTA_TRIAL_MAGIC || record.crc != crc32(&record, offsetof(RtcRecord, crc))) {
+    return;
+  }
+
+  _trial = true;
+  writeRecord(record.boots + 1);
+  if (record.boots + 1 > OTA_TRIAL_BOOTS) {
+    _recovery = true;
+    Serial.printf("OTA: new image reset %lu times on trial, starting in recovery mode\n", (unsigned long)record.boots);
+  } else {
+    Serial.printf("OTA: new image on trial, boot %lu of %u\n", (unsigned long)record.boots + 1, OTA_TRIAL_BOOTS);
+  }
+}
+
+void OtaService::addRoutes(ESP8266WebServer &server) {
+  _server = &server;
+
+  server.on("/api/ota", HTTP_GET, [this]() {
+    sendStatus(200);
+  });
+
+  server.on("/api/ota/begin", HTTP_POST, [this]() {
+    if (!_server->hasArg("size") || !_server->hasArg("md5")) {
+      sendStatus(400);
+      return;
+    }
+    uint32_t size = strtoul(_server->arg("size").c_str(), NULL, 10);
+    sendStatus(_session.begin(size, _server->arg("md5").c_str()));
+  });
+
+  // The raw body is written in HTTP_RAW_BUFLEN pieces as it is read; the
+  // reply says whether all of it landed, so a retried chunk that already did
+  // is acknowledged
+  server.on("/api/ota/chunk", HTTP_POST,
+    [this]() {
+      if (!_server->hasArg("offset")) {
+        sendStatus(400);
+        return;
+      }
+      uint32_t end = chunkOffset() + _server->clientContentLength();
+      int code = _session.state() == OTA_FAILED ? 500 : _session.offset() == end ? 200 : 409;
+      sendStatus(code);
+    },
+    [this]() {
+      HTTPRaw &raw = _server->raw();
+      if (raw.status == RAW_WRITE && _server->hasArg("offset")) {
+        _session.write(chunkOffset() + raw.totalSize - raw.currentSize, raw.buf, raw.currentSize);
+      }
+    });
+
+  server.on("/api/ota/finish", HTTP_POST, [this]() {
+    bool installed = _session.state() == OTA_READY;
+    int code = _session.finish();
+    if (code == 200 && !installed) {
+      // eboot installs it on the restart; the trial starts with that boot
+      writeRecord(0);
+    }
+    sendStatus(code);
+  });
+
+  server.on("/api/ota/abort", HTTP_POST, [this]() {
+    _session.abort();
+    sendStatus(200);
+  });
+}
+
+void OtaService::poll() {
+  // Recovery mode runs the image on trial, so it never confirms it
+  if (_trial && !_recovery && millis() >= OTA_CONFIRM_MS) {
+    _trial = false;
+    RtcRecord record = {};
+    ESP.rtcUserMemoryWrite(OTA_RTC_OFFSET, (uint32_t *)&record, sizeof(record));
+    Serial.println("OTA: new image confirmed");
+  }
+
+  if (_session.restartDue()) {
+    ESP.restart();
+  }
+}
+
+void OtaService::writeRecord(uint32_t boots) {
+  RtcRecord record = {};
+  record.magic = OTA_TRIAL_MAGIC;
+  record.boots = boots;
+  record.crc = crc32(&record, offsetof(RtcRecord, crc));
+  ESP.rtcUserMemoryWrite(OTA_RTC_OFFSET, (uint32_t *)&record, sizeof(record));
+}
+
+void OtaService::sendStatus(int code) {
+  char json[OTA_STATUS_SIZE];
+  _session.formatStatus(json, sizeof(json));
+  _server->send(code, "application/json", json);
+}
+
+uint32_t OtaService::chunkOffset() {
+  return strtoul(_server->arg("offset").c_str(), NULL, 10);
+}
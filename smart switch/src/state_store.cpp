@@ -0,0 +1,84 @@
+#include "state_store.h"
+
+#include <EEPROM.h>
+#include <coredecls.h>
+
+#include "eeprom_layout.h"
+
+StateStore stateStore;
+
+bool StateStore::restore(SwitchState &state) {
+  // The flash copy is read either way, so save() knows what it holds
+  FlashRecord flash;
+  EEPROM.begin(EEPROM_SIZE);
+  EEPROM.get(STATE_EEPROM_OFFSET, flash);
+  bool flashValid = flash.magic == STATE_MAGIC && flash.crc == crc32(&flash, offsetof(FlashRecord, crc));
+  if (flashValid) {
+    _flash.relay = flash.relay != 0 && flash.autoMode == 0;
+    _flash.autoMode = flash.autoMode != 0;
+    _flash.holdMs = flash.holdMs;
+    _flash.autoOffInMs = 0;
+  }
+
+  RtcRecord rtc;
+  if (ESP.rtcUserMemoryRead(STATE_RTC_OFFSET, (uint32_t *)&rtc, sizeof(rtc)) &&
+      rtc.magic == STATE_MAGIC && rtc.crc == crc32(&rtc, offsetof(RtcRecord, crc))) {
+    state.relay = rtc.relay != 0;
+    state.autoMode = rtc.autoMode != 0;
+    state.holdMs = rtc.holdMs;
+    state.autoOffInMs = rtc.autoOffInMs;
+    _fromRtc = true;
+  } else if (flashValid) {
+    // Cold boot: RTC memory lost power; only the user's choices are in flash
+    state = _flash;
+  } else {
+    return false;
+  }
+
+  _rtc = state;
+  return true;
+}
+
+void StateStore::save(const SwitchState &state) {
+  uint32_t now = millis();
+
+  bool changed = state.relay != _rtc.relay || state.autoMode != _rtc.autoMode || state.holdMs != _rtc.holdMs;
+  bool timerDue = (state.autoOffInMs != 0 || _rtc.autoOffInMs != 0) && now - _rtcAtMs >= STATE_RTC_REFRESH_MS;
+  if (changed || timerDue) {
+    RtcRecord rtc = {};
+    rtc.magic = STATE_MAGIC;
+    rtc.relay = state.relay;
+    rtc.autoMode = state.autoMode;
+    rtc.holdMs = state.holdMs;
+    rtc.autoOffInMs = state.autoOffInMs;
+    rtc.crc = crc32(&rtc, offsetof(RtcRecord, crc));
+    ESP.rtcUserMemoryWrite(STATE_RTC_OFFSET, (uint32_t *)&rtc, sizeof(rtc));
+    _rtc = state;
+    _rtcAtMs = now;
+  }
+
+  // Flash only takes settled user choices; PIR-driven relay changes never reach it
+  if (!sameFlash(state)) {
+    _flashDirty = true;
+    _changedAtMs = now;
+    _flash = state;
+  }
+  if (_flashDirty && now - _changedAtMs >= STATE_FLASH_DELAY_MS) {
+    FlashRecord flash = {};
+    flash.magic = STATE_MAGIC;
+    flash.relay = _flash.relay && !_flash.autoMode;
+    flash.autoMode = _flash.autoMode;
+    flash.holdMs = _flash.holdMs;
+    flash.crc = crc32(&flash, offsetof(FlashRecord, crc));
+    EEPROM.put(STATE_EEPROM_OFFSET, flash);
+    EEPROM.commit();
+    _flashDirty = false;
+  }
+}
+
+bool StateStore::sameFlash(const SwitchState &state) const {
+  if (state.autoMode != _flash.autoMode || state.holdMs != _flash.holdMs) {
+    return false;
+  }
+  return state.autoMode || state.relay == _flash.relay;
+}
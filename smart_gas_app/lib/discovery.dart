@@ -0,0 +1,98 @@
+import 'dart:async';
+import 'dart:io';
+import 'dart:typed_data';
+
+// UDP discovery of gas monitors and smart switches, one broadcast and one
+// reply per device. Layout: shared/DeviceDiscovery/src/discovery_protocol.h
+const int discoveryPort = 47810;
+const int discoveryMagic = 0x44;
+const int discoveryVersion = 1;
+const int discoveryKindAny = 0;
+const int discoveryKindMonitor = 1;
+const int discoveryKindSwitch = 2;
+const int discoveryFlagAggregator = 0x01;
+const int discoveryReplySize = 44;
+
+class DiscoveredDevice {
+  final String address;
+  final int kind;
+  final int flags;
+  final int httpPort;
+  final int wsPort;
+  final String wsPath;
+  final String deviceId;
+  final String firmware;
+
+  DiscoveredDevice({
+    required this.address,
+    required this.kind,
+    required this.flags,
+    required this.httpPort,
+    required this.wsPort,
+    required this.wsPath,
+    required this.deviceId,
+    required this.firmware,
+  });
+
+  bool get aggregator => (flags & discoveryFlagAggregator) != 0;
+
+  static DiscoveredDevice? fromDatagram(Datagram datagram) {
+    final data = datagram.data;
+    if (data.length != discoveryReplySize || data[0] != discoveryMagic || data[1] != discoveryVersion) {
+      return null;
+    }
+    final view = ByteData.sublistView(data);
+    return DiscoveredDevice(
+      address: datagram.address.address,
+      kind: data[2],
+      flags: data[3],
+      httpPort: view.getUint16(4, Endian.little),
+      wsPort: view.getUint16(6, Endian.little),
+      wsPath: _text(data, 8, 8),
+      deviceId: _text(data, 16, 16),
+      firmware: _text(data, 32, 12),
+    );
+  }
+
+  // NUL-padded field; a value that fills it has no NUL
+  static String _text(Uint8List data, int offset, int size) {
+    var end = offset;
+    while (end < offset + size && data[end] != 0) {
+      end++;
+    }
+    return String.fromCharCodes(data, offset, end);
+  }
+}
+
+// Broadcasts a request (twice, in case one is lost) and collects the replies
+// that arrive within the timeout, one entry per device address
+Future<List<DiscoveredDevice>> discoverDevices({
+  int kind = discoveryKindAny,
+  Duration timeout = const Duration(milliseconds: 800),
+}) async {
+  final found = <String, DiscoveredDevice>{};
+  final socket = await RawDatagramSocket.bind(InternetAddress.anyIPv4, 0);
+  socket.broadcastEnabled = true;
+
+  final request = Uint8List.fromList([discoveryMagic, discoveryVersion, kind, 0]);
+  final broadcast = InternetAddress('255.255.255.255');
+
+  final subscription = socket.listen((event) {
+    if (event != RawSocketEvent.read) return;
+    final datagram = socket.receive();
+    if (datagram == null) return;
+    final device = DiscoveredDevice.fromDatagram(datagram);
+    if (device != null && (kind == discoveryKindAny || device.kind == kind)) {
+      found[device.address] = device;
+    }
+  });
+
+  socket.send(request, broadcast, discoveryPort);
+  await Future.delayed(Duration(milliseconds: 200));
+  socket.send(request, broadcast, discoveryPort);
+  await Future.delayed(timeout - Duration(milliseconds: 200));
+
+  await subscription.cancel();
+  socket.close();
+  return found.values.toList();
+}
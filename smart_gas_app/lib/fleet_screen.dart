@@ -0,0 +1,193 @@
+import 'package:flutter/material.dart';
+import 'package:flutter_neumorphic_plus/flutter_neumorphic.dart';
+import 'discovery.dart';
+import 'fleet_telemetry.dart';
+
+// Control-room view of every monitor on the network at once (desktop only).
+// Devices come from discovery or by address; all of them stream through the
+// native telemetry engine, so the grid rebuilds at most once per frame.
+class FleetScreen extends StatefulWidget {
+  @override
+  _FleetScreenState createState() => _FleetScreenState();
+}
+
+class _FleetScreenState extends State<FleetScreen> {
+  final FleetTelemetry _fleet = FleetTelemetry();
+  final _addressController = TextEditingController();
+  bool _isSearching = false;
+
+  @override
+  void initState() {
+    super.initState();
+    _fleet.addListener(_onTelemetry);
+    WidgetsBinding.instance.addPostFrameCallback((_) => _findDevices());
+  }
+
+  @override
+  void dispose() {
+    _fleet.removeListener(_onTelemetry);
+    _fleet.dispose();
+    _addressController.dispose();
+    super.dispose();
+  }
+
+  void _onTelemetry() {
+    if (mounted) setState(() {});
+  }
+
+  bool _watching(String host) => _fleet.devices.values.any((device) => device.host == host);
+
+  // Adds every monitor that answers and is not already in the grid
+  Future<void> _findDevices() async {
+    setState(() {
+      _isSearching = true;
+    });
+
+    List<DiscoveredDevice> found = [];
+    try {
+      found = await discoverDevices(kind: discoveryKindMonitor);
+    } catch (e) {
+      print('Discovery error: $e');
+    }
+
+    for (final device in found) {
+      if (!mounted) return;
+      if (!_watching(device.address)) {
+        await _fleet.add(device.address, port: device.wsPort, path: device.wsPath);
+      }
+    }
+
+    if (!mounted) return;
+    setState(() {
+      _isSearching = false;
+    });
+  }
+
+  Future<void> _addAddress() async {
+    final address = _addressController.text.trim();
+    if (address.isEmpty || _watching(address)) return;
+    _addressController.clear();
+    await _fleet.add(address);
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    final devices = _fleet.devices.values.toList();
+    final alarms = devices.where((device) => device.alarmActive).length;
+
+    return Scaffold(
+      backgroundColor: NeumorphicTheme.baseColor(context),
+      appBar: AppBar(
+        backgroundColor: NeumorphicTheme.baseColor(context),
+        elevation: 0,
+        foregroundColor: Colors.grey[800],
+        title: Text('Fleet · ${_fleet.openLinks}/${devices.length} online'
+            '${alarms > 0 ? ' · $alarms in alarm' : ''}'),
+        actions: [
+          SizedBox(
+            width: 200,
+            child: TextField(
+              controller: _addressController,
+              decoration: InputDecoration(hintText: 'Add by IP address', border: InputBorder.none),
+              onSubmitted: (_) => _addAddress(),
+            ),
+          ),
+          IconButton(
+            tooltip: 'Add',
+            icon: Icon(Icons.add),
+            onPressed: _addAddress,
+          ),
+          IconButton(
+            tooltip: 'Find devices on this network',
+            icon: _isSearching
+              ? SizedBox(width: 16, height: 16, child: CircularProgressIndicator(strokeWidth: 2))
+              : Icon(Icons.search),
+            onPressed: _isSearching ? null : _findDevices,
+          ),
+        ],
+      ),
+      body: devices.isEmpty
+        ? Center(
+            child: Text(
+              _isSearching ? 'Looking for monitors…' : 'No monitors yet. Search again or add one by address.',
+              style: TextStyle(color: Colors.grey[700]),
+            ),
+          )
+        : GridView.builder(
+            padding: EdgeInsets.all(16),
+            gridDelegate: SliverGridDelegateWithMaxCrossAxisExtent(
+              maxCrossAxisExtent: 240,
+              mainAxisExtent: 150,
+              crossAxisSpacing: 12,
+              mainAxisSpacing: 12,
+            ),
+            itemCount: devices.length,
+            itemBuilder: (context, index) => _buildTile(devices[index]),
+          ),
+    );
+  }
+
+  Widget _buildTile(FleetDevice device) {
+    final online = device.link == FleetLink.open;
+    final Color accent = !online
+      ? Colors.grey
+      : device.alarmActive
+        ? Colors.red
+        : device.preAlarm
+          ? Colors.orange
+          : Colors.green;
+
+    return Neumorphic(
+      style: NeumorphicStyle(
+        depth: 3,
+        intensity: 0.6,
+        boxShape: NeumorphicBoxShape.roundRect(BorderRadius.circular(12)),
+        border: NeumorphicBorder(color: accent.withOpacity(0.7), width: device.alarmActive ? 2 : 0.5),
+      ),
+      padding: EdgeInsets.all(12),
+      child: Column(
+        crossAxisAlignment: CrossAxisAlignment.start,
+        children: [
+          Row(
+            children: [
+              Icon(online ? Icons.sensors : Icons.sensors_off, size: 16, color: accent),
+              SizedBox(width: 6),
+              Expanded(
+                child: Text(device.host, style: TextStyle(fontWeight: FontWeight.bold), overflow: TextOverflow.ellipsis),
+              ),
+              IconButton(
+                tooltip: 'Remove',
+                visualDensity: VisualDensity.compact,
+                icon: Icon(Icons.close, size: 16),
+                onPressed: () => _fleet.remove(device),
+              ),
+            ],
+          ),
+          Spacer(),
+          Text(
+            online || device.frames > 0 ? '${device.gasLevel.toStringAsFixed(0)} ppm' : '—',
+            style: TextStyle(fontSize: 24, fontWeight: FontWeight.bold, color: accent),
+          ),
+          Text(
+            '${device.temperature.toStringAsFixed(1)} °C  ·  ${device.humidity.toStringAsFixed(0)} %  ·  limit ${device.gasThreshold.toStringAsFixed(0)}',
+            style: TextStyle(fontSize: 12, color: Colors.grey[700]),
+          ),
+          Spacer(),
+          Row(
+            children: [
+              Text(device.autoMode ? 'Auto' : 'Manual', style: TextStyle(fontSize: 12, color: Colors.grey[700])),
+              Spacer(),
+              Text('Relay', style: TextStyle(fontSize: 12)),
+              Switch(
+                value: device.relayState,
+                onChanged: online
+                  ? (state) => _fleet.send(device, {'command': 'setRelay', 'state': state})
+                  : null,
+              ),
+            ],
+          ),
+        ],
+      ),
+    );
+  }
+}
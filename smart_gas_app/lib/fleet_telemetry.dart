@@ -0,0 +1,126 @@
+import 'dart:convert';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+// Live telemetry from many monitors at once, served by the native engine in
+// the desktop runners (native/telemetry_engine.h). The engine keeps every
+// WebSocket on its own I/O thread and sends at most one batch per display
+// frame, holding only the devices that changed since the last one, so the UI
+// thread copies a few bytes per device instead of decoding every message.
+const _methods = MethodChannel('smart_gas_app/telemetry');
+const _batchChannel = BasicMessageChannel<ByteData?>('smart_gas_app/telemetry/batch', BinaryCodec());
+
+const int _batchMagic = 0x42;
+const int _batchVersion = 1;
+const int _headerSize = 8;
+const int _recordSize = 28;
+
+enum FleetLink { connecting, open, offline }
+
+class FleetDevice {
+  final int handle;
+  final String host;
+  FleetLink link = FleetLink.connecting;
+  bool alarmActive = false;
+  bool preAlarm = false;
+  bool relayState = false;
+  bool autoMode = false;
+  double gasLevel = 0;
+  double temperature = 0;
+  double humidity = 0;
+  double gasThreshold = 0;
+  double tempThreshold = 0;
+  int uptimeMs = 0;
+  int frames = 0;  // Telemetry frames received in total
+
+  FleetDevice(this.handle, this.host);
+}
+
+class FleetTelemetry extends ChangeNotifier {
+  final Map<int, FleetDevice> _devices = {};
+  int _openLinks = 0;
+  int _batchCount = 0;
+
+  // Only the Windows and Linux runners register the channel
+  static bool get supported => !kIsWeb && (Platform.isWindows || Platform.isLinux);
+
+  Map<int, FleetDevice> get devices => _devices;
+  int get openLinks => _openLinks;
+  int get batchCount => _batchCount;
+
+  FleetTelemetry() {
+    _batchChannel.setMessageHandler(_onBatch);
+  }
+
+  Future<FleetDevice> add(String host, {int port = 80, String path = '/ws'}) async {
+    final handle = await _methods.invokeMethod<int>('addDevice', {'host': host, 'port': port, 'path': path});
+    final device = FleetDevice(handle!, host);
+    _devices[handle] = device;
+    notifyListeners();
+    return device;
+  }
+
+  Future<void> remove(FleetDevice device) async {
+    _devices.remove(device.handle);
+    notifyListeners();
+    await _methods.invokeMethod('removeDevice', {'handle': device.handle});
+  }
+
+  // Same JSON commands as the single-device dashboard, e.g. {'command': 'setRelay', 'state': true}
+  Future<bool> send(FleetDevice device, Map<String, dynamic> command) async {
+    final queued = await _methods.invokeMethod<bool>('send', {'handle': device.handle, 'command': jsonEncode(command)});
+    return queued ?? false;
+  }
+
+  // Interval every device is asked to send analog changes at, in ms
+  Future<void> setInterval(int ms) => _methods.invokeMethod('setInterval', {'interval': ms});
+
+  Future<ByteData?> _onBatch(ByteData? batch) async {
+    if (batch == null || batch.lengthInBytes < _headerSize ||
+        batch.getUint8(0) != _batchMagic || batch.getUint8(1) != _batchVersion) {
+      return null;
+    }
+    final count = batch.getUint16(2, Endian.little);
+    _openLinks = batch.getUint16(4, Endian.little);
+    if (batch.lengthInBytes < _headerSize + count * _recordSize) return null;
+
+    for (var i = 0; i < count; i++) {
+      final at = _headerSize + i * _recordSize;
+      final device = _devices[batch.getUint32(at, Endian.little)];
+      if (device == null) continue;  // Removed while the batch was on its way
+
+      final link = batch.getUint8(at + 4);
+      device.link = link < FleetLink.values.length ? FleetLink.values[link] : FleetLink.offline;
+      final flags = batch.getUint8(at + 5);
+      device.alarmActive = (flags & 0x01) != 0;
+      device.relayState = (flags & 0x02) != 0;
+      device.autoMode = (flags & 0x04) != 0;
+      device.preAlarm = (flags & 0x10) != 0;
+      device.gasLevel = batch.getUint16(at + 6, Endian.little).toDouble();
+      device.temperature = batch.getInt16(at + 8, Endian.little) / 100.0;
+      device.humidity = batch.getUint16(at + 10, Endian.little) / 100.0;
+      device.gasThreshold = batch.getFloat32(at + 12, Endian.little);
+      device.tempThreshold = batch.getFloat32(at + 16, Endian.little);
+      device.uptimeMs = batch.getUint32(at + 20, Endian.little);
+      device.frames += batch.getUint32(at + 24, Endian.little);
+    }
+
+    // One rebuild per batch, i.e. per frame, however many devices changed
+    _batchCount++;
+    notifyListeners();
+    return null;
+  }
+
+  @override
+  void dispose() {
+    _batchChannel.setMessageHandler(null);
+    for (final handle in _devices.keys) {
+      _methods.invokeMethod('removeDevice', {'handle': handle});
+    }
+    _devices.clear();
+    super.dispose();
+  }
+}
@@ -2,10 +2,14 @@ import 'package:flutter/material.dart';
 import 'package:web_socket_channel/io.dart';
 import 'package:http/http.dart' as http;
 import 'dart:convert';
+import 'dart:typed_data';
 import 'package:flutter_neumorphic_plus/flutter_neumorphic.dart';
 import 'package:provider/provider.dart';
 import 'package:fl_chart/fl_chart.dart';
 import 'package:shared_preferences/shared_preferences.dart';
+import 'discovery.dart';
+import 'fleet_screen.dart';
+import 'fleet_telemetry.dart';
 
 void main() {
   runApp(
@@ -51,6 +55,7 @@ class MonitoringSystem extends ChangeNotifier {
   double _humidity = 0.0;
   double _gasLevel = 0.0;
   bool _alarmActive = false;
+  bool _preAlarm = false;
   bool _relayState = false;
   bool _autoMode = true;
   double _gasThreshold = 500.0;
@@ -68,6 +73,7 @@ class MonitoringSystem extends ChangeNotifier {
   double get humidity => _humidity;
   double get gasLevel => _gasLevel;
   bool get alarmActive => _alarmActive;
+  bool get preAlarm => _preAlarm;
   bool get relayState => _relayState;
   bool get autoMode => _autoMode;
   double get gasThreshold => _gasThreshold;
@@ -108,13 +114,18 @@ class MonitoringSystem extends ChangeNotifier {
   
   void _setupWebSocket() {
     try {
-      _channel = IOWebSocketChannel.connect('ws://$_deviceIP:81');
+      _channel = IOWebSocketChannel.connect('ws://$_deviceIP/ws');
       
       _channel!.stream.listen(
         (message) {
-          final data = jsonDecode(message);
-          // print('WebSocket message: $data');
-          _updateFromJson(data);
+          if (message is List<int>) {
+            // Binary telemetry frame
+            if (!_updateFromFrame(Uint8List.fromList(message))) return;
+          } else {
+            final data = jsonDecode(message);
+            // print('WebSocket message: $data');
+            _updateFromJson(data);
+          }
           notifyListeners();
         },
         onDone: () {
@@ -128,8 +139,8 @@ class MonitoringSystem extends ChangeNotifier {
         },
       );
       
-      // Request initial status
-      _channel!.sink.add(jsonEncode({'command': 'getStatus'}));
+      // Switch to binary telemetry; the device answers with a full snapshot
+      _channel!.sink.add(jsonEncode({'command': 'subscribe', 'format': 'binary'}));
     } catch (e) {
       print('WebSocket connection error: $e');
       _connected = false;
@@ -138,16 +149,50 @@ class MonitoringSystem extends ChangeNotifier {
   }
   
   void _updateFromJson(dynamic data) {
+    // Only telemetry (and the untyped /api/status reply) carries readings;
+    // aggregator device tables, command acks and rule notices do not
+    if (data is! Map) return;
+    final type = data['type'];
+    if (type != null && type != 'snapshot' && type != 'delta') return;
+
     if (data.containsKey('temperature')) _temperature = data['temperature'].toDouble();
     if (data.containsKey('humidity')) _humidity = data['humidity'].toDouble();
     if (data.containsKey('gasLevel')) _gasLevel = data['gasLevel'].toDouble();
     if (data.containsKey('alarmActive')) _alarmActive = data['alarmActive'];
+    if (data.containsKey('preAlarm')) _preAlarm = data['preAlarm'];
     if (data.containsKey('relayState')) _relayState = data['relayState'];
     if (data.containsKey('autoMode')) _autoMode = data['autoMode'];
     if (data.containsKey('gasThreshold')) _gasThreshold = data['gasThreshold'].toDouble();
     if (data.containsKey('tempThreshold')) _tempThreshold = data['tempThreshold'].toDouble();
     if (data.containsKey('deviceID')) _deviceID = data['deviceID'];
+
+    // A delta that only changed the relay or a threshold adds no chart point
+    if (data.containsKey('temperature') || data.containsKey('gasLevel')) {
+      _addHistoryPoint();
+    }
+  }
+  
+  // Decodes a binary telemetry frame (see telemetry_codec.h in the firmware);
+  // version 1 carried the gas level in 1/16 ADC counts, version 2 in ppm
+  bool _updateFromFrame(Uint8List bytes) {
+    if (bytes.length < 22 || bytes[0] != 0x47 || (bytes[1] != 1 && bytes[1] != 2)) return false;
+    final frame = ByteData.sublistView(bytes);
+    final flags = frame.getUint8(2);
+    _alarmActive = (flags & 0x01) != 0;
+    _relayState = (flags & 0x02) != 0;
+    _autoMode = (flags & 0x04) != 0;
+    _preAlarm = (flags & 0x10) != 0;
+    _temperature = frame.getInt16(8, Endian.little) / 100.0;
+    _humidity = frame.getUint16(10, Endian.little) / 100.0;
+    _gasLevel = frame.getUint16(12, Endian.little) / (bytes[1] == 1 ? 16.0 : 1.0);
+    _gasThreshold = frame.getFloat32(14, Endian.little);
+    _tempThreshold = frame.getFloat32(18, Endian.little);
     
+    _addHistoryPoint();
+    return true;
+  }
+  
+  void _addHistoryPoint() {
     // Add historical data points (limit to 20 points)
     final now = DateTime.now();
     _temperatureHistory.add(SensorReading(time: now, value: _temperature));
@@ -252,6 +297,8 @@ class _DeviceConnectionScreenState extends State<DeviceConnectionScreen> {
   String _lastDeviceID = '';
   String _lastDeviceIP = '';
   bool _showLastDevice = false;
+  bool _isSearching = false;
+  List<DiscoveredDevice> _foundDevices = [];
   
   @override
   void initState() {
@@ -259,6 +306,55 @@ class _DeviceConnectionScreenState extends State<DeviceConnectionScreen> {
     _loadLastDevice();
   }
   
+  // One UDP broadcast finds every monitor on the network
+  Future<void> _findDevices() async {
+    setState(() {
+      _isSearching = true;
+    });
+    
+    List<DiscoveredDevice> devices = [];
+    try {
+      devices = await discoverDevices(kind: discoveryKindMonitor);
+    } catch (e) {
+      print('Discovery error: $e');
+    }
+    
+    if (!mounted) return;
+    setState(() {
+      _isSearching = false;
+      _foundDevices = devices;
+    });
+    
+    if (devices.isEmpty) {
+      ScaffoldMessenger.of(context).showSnackBar(
+        SnackBar(content: Text('No monitors answered. Enter the IP address instead.')),
+      );
+    }
+  }
+  
+  Future<void> _connectTo(MonitoringSystem system, String ip) async {
+    setState(() {
+      _isConnecting = true;
+      _ipController.text = ip;
+    });
+    
+    final success = await system.connectToDevice(ip);
+    
+    if (!mounted) return;
+    setState(() {
+      _isConnecting = false;
+    });
+    
+    if (!success) {
+      ScaffoldMessenger.of(context).showSnackBar(
+        SnackBar(
+          content: Text('Failed to connect to device. Check IP and try again.'),
+          backgroundColor: Colors.red,
+        ),
+      );
+    }
+  }
+  
   Future<void> _loadLastDevice() async {
     final system = Provider.of<MonitoringSystem>(context, listen: false);
     final lastDevice = await system.getLastConnectedDevice();
@@ -375,6 +471,40 @@ class _DeviceConnectionScreenState extends State<DeviceConnectionScreen> {
                         ),
                   ),
                 ),
+                SizedBox(height: 12),
+                TextButton.icon(
+                  onPressed: _isSearching || _isConnecting ? null : _findDevices,
+                  icon: _isSearching
+                    ? SizedBox(width: 16, height: 16, child: CircularProgressIndicator(strokeWidth: 2))
+                    : Icon(Icons.search),
+                  label: Text('Find devices on this network'),
+                ),
+                if (FleetTelemetry.supported)
+                  TextButton.icon(
+                    onPressed: _isConnecting
+                      ? null
+                      : () => Navigator.of(context).push(MaterialPageRoute(builder: (context) => FleetScreen())),
+                    icon: Icon(Icons.grid_view),
+                    label: Text('Watch all monitors (fleet view)'),
+                  ),
+                for (final device in _foundDevices)
+                  Padding(
+                    padding: EdgeInsets.only(top: 8),
+                    child: Neumorphic(
+                      style: NeumorphicStyle(
+                        depth: 3,
+                        intensity: 0.6,
+                        boxShape: NeumorphicBoxShape.roundRect(BorderRadius.circular(12)),
+                      ),
+                      child: ListTile(
+                        leading: Icon(device.aggregator ? Icons.hub : Icons.gas_meter_outlined, color: Colors.blue[700]),
+                        title: Text('ID: ${device.deviceId}', style: TextStyle(fontWeight: FontWeight.bold)),
+                        subtitle: Text('IP: ${device.address}  ·  firmware ${device.firmware}'),
+                        trailing: Icon(Icons.arrow_forward_ios, size: 16),
+                        onTap: _isConnecting ? null : () => _connectTo(system, device.address),
+                      ),
+                    ),
+                  ),
                 SizedBox(height: 32),
                 if (_showLastDevice)
                   Column(
@@ -835,6 +965,32 @@ class _DashboardScreenState extends State<DashboardScreen> with SingleTickerProv
                 ],
               ),
             ),
+          if (system.preAlarm && !system.alarmActive)
+            Neumorphic(
+              style: NeumorphicStyle(
+                depth: 4,
+                intensity: 0.8,
+                boxShape: NeumorphicBoxShape.roundRect(BorderRadius.circular(12)),
+                color: Colors.orange[700],
+              ),
+              padding: EdgeInsets.all(16),
+              margin: EdgeInsets.only(bottom: 16),
+              child: Row(
+                children: [
+                  Icon(Icons.trending_up, color: Colors.white, size: 32),
+                  SizedBox(width: 16),
+                  Expanded(
+                    child: Text(
+                      'Gas level rising fast, approaching the threshold',
+                      style: TextStyle(
+                        fontSize: 16,
+                        color: Colors.white,
+                      ),
+                    ),
+                  ),
+                ],
+              ),
+            ),
           Row(
             children: [
               Expanded(
@@ -864,7 +1020,7 @@ class _DashboardScreenState extends State<DashboardScreen> with SingleTickerProv
           SizedBox(height: 16),
           _buildSensorCard(
             title: 'Gas Level',
-            value: system.gasLevel.toStringAsFixed(0),
+            value: '${system.gasLevel.toStringAsFixed(0)} ppm',
             subtitle: system.gasLevel > system.gasThreshold 
               ? 'Gas leak detected!' 
               : 'Normal',
@@ -0,0 +1,122 @@
+#include "telemetry_channel.h"
+
+#include <cstring>
+#include <vector>
+
+#include "telemetry_engine.h"
+
+namespace {
+
+constexpr char kMethodChannel[] = "smart_gas_app/telemetry";
+constexpr char kBatchChannel[] = "smart_gas_app/telemetry/batch";
+
+struct TelemetryChannel {
+  TelemetryEngine engine;
+  FlBinaryMessenger* messenger = nullptr;
+  FlMethodChannel* channel = nullptr;
+  std::vector<uint8_t> batch;
+};
+
+FlValue* lookup(FlValue* args, const char* key, FlValueType type) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return nullptr;
+  }
+  FlValue* value = fl_value_lookup_string(args, key);
+  return value != nullptr && fl_value_get_type(value) == type ? value : nullptr;
+}
+
+int64_t lookup_int(FlValue* args, const char* key, int64_t fallback) {
+  FlValue* value = lookup(args, key, FL_VALUE_TYPE_INT);
+  return value != nullptr ? fl_value_get_int(value) : fallback;
+}
+
+const gchar* lookup_string(FlValue* args, const char* key) {
+  FlValue* value = lookup(args, key, FL_VALUE_TYPE_STRING);
+  return value != nullptr ? fl_value_get_string(value) : nullptr;
+}
+
+FlMethodResponse* bad_arguments(const gchar* message) {
+  return FL_METHOD_RESPONSE(fl_method_error_response_new("bad-arguments", message, nullptr));
+}
+
+FlMethodResponse* handle_method_call(TelemetryChannel* self, FlMethodCall* method_call) {
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  if (strcmp(method, "addDevice") == 0) {
+    const gchar* host = lookup_string(args, "host");
+    const gchar* path = lookup_string(args, "path");
+    int64_t port = lookup_int(args, "port", 80);
+    if (host == nullptr || port <= 0 || port > 65535) {
+      return bad_arguments("addDevice needs a host and a valid port");
+    }
+    int32_t handle = self->engine.AddDevice(host, static_cast<uint16_t>(port), path != nullptr ? path : "/ws");
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_int(handle)));
+  }
+
+  if (strcmp(method, "removeDevice") == 0) {
+    self->engine.RemoveDevice(static_cast<int32_t>(lookup_int(args, "handle", 0)));
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+  }
+
+  if (strcmp(method, "send") == 0) {
+    const gchar* command = lookup_string(args, "command");
+    if (command == nullptr) {
+      return bad_arguments("send needs a command");
+    }
+    bool queued = self->engine.SendCommand(static_cast<int32_t>(lookup_int(args, "handle", 0)), command);
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(queued)));
+  }
+
+  if (strcmp(method, "setInterval") == 0) {
+    int64_t interval = lookup_int(args, "interval", 0);
+    if (interval <= 0 || interval > 60000) {
+      return bad_arguments("setInterval needs 1-60000 ms");
+    }
+    self->engine.SetInterval(static_cast<uint16_t>(interval));
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+}
+
+void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call, gpointer user_data) {
+  g_autoptr(FlMethodResponse) response =
+      handle_method_call(static_cast<TelemetryChannel*>(user_data), method_call);
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to answer %s: %s", kMethodChannel, error->message);
+  }
+}
+
+// Runs on the view's frame clock, so Dart gets at most one batch per frame
+// and none while the window is hidden
+gboolean tick_cb(GtkWidget* widget, GdkFrameClock* frame_clock, gpointer user_data) {
+  TelemetryChannel* self = static_cast<TelemetryChannel*>(user_data);
+  if (self->engine.TakeBatch(&self->batch)) {
+    g_autoptr(GBytes) message = g_bytes_new(self->batch.data(), self->batch.size());
+    fl_binary_messenger_send_on_channel(self->messenger, kBatchChannel, message, nullptr, nullptr, nullptr);
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+void telemetry_channel_free(gpointer data) {
+  TelemetryChannel* self = static_cast<TelemetryChannel*>(data);
+  g_clear_object(&self->channel);
+  g_clear_object(&self->messenger);
+  delete self;
+}
+
+}  // namespace
+
+void telemetry_channel_register(FlView* view) {
+  TelemetryChannel* self = new TelemetryChannel();
+  self->messenger = FL_BINARY_MESSENGER(g_object_ref(fl_engine_get_binary_messenger(fl_view_get_engine(view))));
+
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  self->channel = fl_method_channel_new(self->messenger, kMethodChannel, FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(self->channel, method_call_cb, self, nullptr);
+
+  gtk_widget_add_tick_callback(GTK_WIDGET(view), tick_cb, self, nullptr);
+  g_object_set_data_full(G_OBJECT(view), "telemetry-channel", self, telemetry_channel_free);
+}
@@ -0,0 +1,17 @@
+#ifndef FLUTTER_TELEMETRY_CHANNEL_H_
+#define FLUTTER_TELEMETRY_CHANNEL_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+/**
+ * telemetry_channel_register:
+ * @view: the #FlView hosting the app.
+ *
+ * Serves the "smart_gas_app/telemetry" method channel (addDevice,
+ * removeDevice, send, setInterval) from a native #TelemetryEngine and pushes
+ * its batches on "smart_gas_app/telemetry/batch" once per frame of @view.
+ * The engine lives as long as @view.
+ */
+void telemetry_channel_register(FlView* view);
+
+#endif  // FLUTTER_TELEMETRY_CHANNEL_H_
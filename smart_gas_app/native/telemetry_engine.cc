@@ -0,0 +1,618 @@
+#include "telemetry_engine.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+namespace {
+
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+const SocketHandle kNoSocket = INVALID_SOCKET;
+const int kSendFlags = 0;
+
+int LastSocketError() { return WSAGetLastError(); }
+bool WouldBlock(int error) { return error == WSAEWOULDBLOCK; }
+bool ConnectPending(int error) { return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS; }
+void CloseSocket(SocketHandle socket) { closesocket(socket); }
+int PollSockets(pollfd* fds, size_t count, int timeout_ms) {
+  return WSAPoll(fds, static_cast<ULONG>(count), timeout_ms);
+}
+bool SetNonBlocking(SocketHandle socket) {
+  u_long enabled = 1;
+  return ioctlsocket(socket, FIONBIO, &enabled) == 0;
+}
+#else
+using SocketHandle = int;
+const SocketHandle kNoSocket = -1;
+const int kSendFlags = MSG_NOSIGNAL;
+
+int LastSocketError() { return errno; }
+bool WouldBlock(int error) { return error == EAGAIN || error == EWOULDBLOCK; }
+bool ConnectPending(int error) { return error == EINPROGRESS; }
+void CloseSocket(SocketHandle socket) { close(socket); }
+int PollSockets(pollfd* fds, size_t count, int timeout_ms) {
+  return poll(fds, static_cast<nfds_t>(count), timeout_ms);
+}
+bool SetNonBlocking(SocketHandle socket) {
+  int flags = fcntl(socket, F_GETFL, 0);
+  return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// Firmware binary telemetry frame, see telemetry_codec.h
+constexpr uint8_t kFrameMagic = 0x47;
+constexpr size_t kFrameSize = 22;
+
+constexpr int kReceiveSize = 4096;
+constexpr int kPollMs = 20;  // Also how long an AddDevice or command can wait
+constexpr auto kConnectTimeout = std::chrono::seconds(5);
+constexpr auto kPingInterval = std::chrono::seconds(10);
+constexpr auto kSilenceTimeout = std::chrono::seconds(30);
+constexpr int kMinBackoffMs = 1000;
+constexpr int kMaxBackoffMs = 30000;
+
+uint16_t ReadU16(const uint8_t* bytes) {
+  return static_cast<uint16_t>(bytes[0] | bytes[1] << 8);
+}
+
+uint32_t ReadU32(const uint8_t* bytes) {
+  return static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 |
+         static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+}
+
+float ReadF32(const uint8_t* bytes) {
+  uint32_t raw = ReadU32(bytes);
+  float value;
+  memcpy(&value, &raw, sizeof(value));
+  return value;
+}
+
+void PutU16(std::vector<uint8_t>* out, uint16_t value) {
+  out->push_back(static_cast<uint8_t>(value));
+  out->push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void PutU32(std::vector<uint8_t>* out, uint32_t value) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    out->push_back(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+void PutF32(std::vector<uint8_t>* out, float value) {
+  uint32_t raw;
+  memcpy(&raw, &value, sizeof(raw));
+  PutU32(out, raw);
+}
+
+}  // namespace
+
+// One device's WebSocket: connect, upgrade, subscribe, then decode frames
+class TelemetryEngine::Link {
+ public:
+  Link(const std::string& host, uint16_t port, const std::string& path, uint16_t interval_ms)
+      : host_(host), port_(port), path_(path), retry_at_(Clock::now()), interval_ms_(interval_ms) {
+    std::random_device seed;
+    random_.seed(seed());
+  }
+
+  ~Link() { Close(); }
+
+  // Socket to poll and the events wanted, kNoSocket while backing off
+  SocketHandle Socket() const { return socket_; }
+  short Events() const {
+    return static_cast<short>(POLLIN | (phase_ == kConnecting || !out_.empty() ? POLLOUT : 0));
+  }
+
+  void Tick(Clock::time_point now) {
+    if (phase_ == kIdle && now >= retry_at_) {
+      Connect(now);
+    } else if ((phase_ == kConnecting || phase_ == kUpgrading) && now - phase_at_ > kConnectTimeout) {
+      Fail(now);
+    } else if (phase_ == kOpen && now - phase_at_ > kSilenceTimeout) {
+      // A quiet sensor sends nothing, so the pings keep traffic flowing;
+      // without any, the link is half open and never errors out by itself
+      Fail(now);
+    } else if (phase_ == kOpen && now - pinged_at_ > kPingInterval) {
+      QueueFrame(0x9, std::string());
+      pinged_at_ = now;
+    }
+  }
+
+  void OnEvents(short revents, Clock::time_point now) {
+    if (phase_ == kConnecting && (revents & (POLLOUT | POLLERR | POLLHUP))) {
+      int error = 0;
+      socklen_t length = static_cast<socklen_t>(sizeof(error));
+      getsockopt(socket_, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length);
+      if (error != 0 || (revents & (POLLERR | POLLHUP))) {
+        Fail(now);
+        return;
+      }
+      SendUpgrade(now);
+    }
+    if (revents & POLLIN) {
+      Receive(now);
+    } else if (revents & (POLLERR | POLLHUP | POLLNVAL)) {
+      Fail(now);
+    }
+    if (socket_ != kNoSocket && !out_.empty()) {
+      Flush(now);
+    }
+  }
+
+  void Send(const std::string& json) {
+    if (phase_ == kOpen) {
+      QueueFrame(0x1, json);
+    }
+  }
+
+  void SetInterval(uint16_t interval_ms) {
+    interval_ms_ = interval_ms;
+    Subscribe();
+  }
+
+  // Moves the latest state into the published record; false when unchanged
+  bool TakeChanges(Record* record) {
+    if (!changed_) {
+      return false;
+    }
+    uint32_t frames = record->dirty ? record->frames : 0;
+    *record = record_;
+    record->frames = frames + pending_frames_;
+    record->dirty = true;
+    pending_frames_ = 0;
+    changed_ = false;
+    return true;
+  }
+
+  bool open() const { return phase_ == kOpen; }
+
+ private:
+  enum Phase { kIdle, kConnecting, kUpgrading, kOpen };
+
+  void Connect(Clock::time_point now) {
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* address = nullptr;
+    if (getaddrinfo(host_.c_str(), std::to_string(port_).c_str(), &hints, &address) != 0 ||
+        address == nullptr) {
+      Fail(now);
+      return;
+    }
+
+    socket_ = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    bool started = socket_ != kNoSocket && SetNonBlocking(socket_);
+    if (started) {
+      int enabled = 1;
+      setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enabled),
+                 static_cast<socklen_t>(sizeof(enabled)));
+      started = connect(socket_, address->ai_addr, static_cast<socklen_t>(address->ai_addrlen)) == 0 ||
+                ConnectPending(LastSocketError());
+    }
+    freeaddrinfo(address);
+    if (!started) {
+      Fail(now);
+      return;
+    }
+
+    phase_ = kConnecting;
+    phase_at_ = now;
+    SetLink(kLinkConnecting);
+  }
+
+  void SendUpgrade(Clock::time_point now) {
+    uint8_t key[16];
+    for (uint8_t& byte : key) {
+      byte = static_cast<uint8_t>(random_());
+    }
+    static const char kBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string encoded;
+    for (size_t i = 0; i < sizeof(key); i += 3) {
+      uint32_t group = static_cast<uint32_t>(key[i]) << 16;
+      if (i + 1 < sizeof(key)) group |= static_cast<uint32_t>(key[i + 1]) << 8;
+      if (i + 2 < sizeof(key)) group |= key[i + 2];
+      encoded += kBase64[(group >> 18) & 63];
+      encoded += kBase64[(group >> 12) & 63];
+      encoded += i + 1 < sizeof(key) ? kBase64[(group >> 6) & 63] : '=';
+      encoded += i + 2 < sizeof(key) ? kBase64[group & 63] : '=';
+    }
+
+    // The devices are on the local network and trusted, so Sec-WebSocket-Accept is not checked
+    std::string request = "GET " + path_ + " HTTP/1.1\r\nHost: " + host_ + ":" + std::to_string(port_) +
+                          "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: " +
+                          encoded + "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    out_.insert(out_.end(), request.begin(), request.end());
+    phase_ = kUpgrading;
+    phase_at_ = now;
+  }
+
+  void Receive(Clock::time_point now) {
+    char buffer[kReceiveSize];
+    for (;;) {
+      int got = static_cast<int>(recv(socket_, buffer, kReceiveSize, 0));
+      if (got > 0) {
+        in_.insert(in_.end(), buffer, buffer + got);
+        continue;
+      }
+      if (got < 0 && WouldBlock(LastSocketError())) {
+        break;
+      }
+      Fail(now);
+      return;
+    }
+
+    if (phase_ == kUpgrading) {
+      static const char kEnd[] = "\r\n\r\n";
+      auto end = std::search(in_.begin(), in_.end(), kEnd, kEnd + 4);
+      if (end == in_.end()) {
+        return;
+      }
+      static const char kSwitching[] = "HTTP/1.1 101";
+      if (in_.size() < sizeof(kSwitching) - 1 ||
+          !std::equal(kSwitching, kSwitching + sizeof(kSwitching) - 1, in_.begin())) {
+        Fail(now);
+        return;
+      }
+      in_.erase(in_.begin(), end + 4);
+      phase_ = kOpen;
+      phase_at_ = now;
+      pinged_at_ = now;
+      backoff_ms_ = kMinBackoffMs;
+      SetLink(kLinkOpen);
+      // The device answers the subscription with a full binary snapshot
+      Subscribe();
+    }
+
+    if (phase_ == kOpen) {
+      ParseFrames(now);
+    }
+  }
+
+  void ParseFrames(Clock::time_point now) {
+    size_t offset = 0;
+    while (in_.size() - offset >= 2) {
+      const uint8_t* head = in_.data() + offset;
+      uint8_t opcode = head[0] & 0x0F;
+      bool masked = (head[1] & 0x80) != 0;
+      uint64_t length = head[1] & 0x7F;
+      size_t header = 2;
+      if (length == 126) {
+        if (in_.size() - offset < 4) break;
+        length = static_cast<uint64_t>(head[2]) << 8 | head[3];
+        header = 4;
+      } else if (length == 127) {
+        if (in_.size() - offset < 10) break;
+        length = 0;
+        for (int i = 0; i < 8; i++) {
+          length = length << 8 | head[2 + i];
+        }
+        header = 10;
+      }
+      size_t mask_at = header;
+      if (masked) {
+        header += 4;
+      }
+      if (length > (1u << 20)) {
+        Fail(now);  // No device sends anything near this; the stream is broken
+        return;
+      }
+      if (in_.size() - offset < header + length) {
+        break;
+      }
+
+      uint8_t* payload = in_.data() + offset + header;
+      size_t size = static_cast<size_t>(length);
+      if (masked) {
+        for (size_t i = 0; i < size; i++) {
+          payload[i] ^= head[mask_at + (i & 3)];
+        }
+      }
+      offset += header + size;
+      phase_at_ = now;
+
+      if (opcode == 0x2) {
+        Decode(payload, size);
+      } else if (opcode == 0x9) {
+        QueueFrame(0xA, std::string(reinterpret_cast<char*>(payload), size));
+      } else if (opcode == 0x8) {
+        Fail(now);
+        return;
+      }
+      // Text frames are command acks and the JSON snapshot sent before the
+      // subscription took effect; the binary snapshot that follows covers it
+    }
+    in_.erase(in_.begin(), in_.begin() + static_cast<std::ptrdiff_t>(offset));
+  }
+
+  void Decode(const uint8_t* frame, size_t size) {
+    if (size < kFrameSize || frame[0] != kFrameMagic || (frame[1] != 1 && frame[1] != 2)) {
+      return;
+    }
+    record_.flags = frame[2];
+    record_.uptime_ms = ReadU32(frame + 4);
+    record_.temperature = static_cast<int16_t>(ReadU16(frame + 8));
+    record_.humidity = ReadU16(frame + 10);
+    // Version 1 carried the gas level in 1/16 ADC counts
+    uint16_t gas = ReadU16(frame + 12);
+    record_.gas_level = frame[1] == 1 ? static_cast<uint16_t>(gas / 16) : gas;
+    record_.gas_threshold = ReadF32(frame + 14);
+    record_.temp_threshold = ReadF32(frame + 18);
+    pending_frames_++;
+    changed_ = true;
+  }
+
+  void Subscribe() {
+    if (phase_ == kOpen) {
+      QueueFrame(0x1, "{\"command\":\"subscribe\",\"format\":\"binary\",\"interval\":" +
+                          std::to_string(interval_ms_) + "}");
+    }
+  }
+
+  void QueueFrame(uint8_t opcode, const std::string& payload) {
+    size_t length = payload.size();
+    out_.push_back(static_cast<uint8_t>(0x80 | opcode));
+    if (length < 126) {
+      out_.push_back(static_cast<uint8_t>(0x80 | length));
+    } else {
+      out_.push_back(0x80 | 126);
+      out_.push_back(static_cast<uint8_t>(length >> 8));
+      out_.push_back(static_cast<uint8_t>(length));
+    }
+    uint32_t mask = static_cast<uint32_t>(random_());
+    uint8_t key[4] = {static_cast<uint8_t>(mask), static_cast<uint8_t>(mask >> 8),
+                      static_cast<uint8_t>(mask >> 16), static_cast<uint8_t>(mask >> 24)};
+    out_.insert(out_.end(), key, key + 4);
+    for (size_t i = 0; i < length; i++) {
+      out_.push_back(static_cast<uint8_t>(payload[i] ^ key[i & 3]));
+    }
+  }
+
+  void Flush(Clock::time_point now) {
+    while (!out_.empty()) {
+      int sent = static_cast<int>(send(socket_, reinterpret_cast<const char*>(out_.data()),
+                                       static_cast<int>(std::min<size_t>(out_.size(), 65536)),
+                                       kSendFlags));
+      if (sent > 0) {
+        out_.erase(out_.begin(), out_.begin() + sent);
+        continue;
+      }
+      if (sent < 0 && WouldBlock(LastSocketError())) {
+        return;
+      }
+      Fail(now);
+      return;
+    }
+  }
+
+  void Close() {
+    if (socket_ != kNoSocket) {
+      CloseSocket(socket_);
+      socket_ = kNoSocket;
+    }
+    in_.clear();
+    out_.clear();
+  }
+
+  void Fail(Clock::time_point now) {
+    Close();
+    phase_ = kIdle;
+    retry_at_ = now + std::chrono::milliseconds(backoff_ms_);
+    backoff_ms_ = std::min(backoff_ms_ * 2, kMaxBackoffMs);
+    SetLink(kLinkOffline);
+  }
+
+  void SetLink(uint8_t link) {
+    if (record_.link != link) {
+      record_.link = link;
+      changed_ = true;
+    }
+  }
+
+  std::string host_;
+  uint16_t port_;
+  std::string path_;
+  SocketHandle socket_ = kNoSocket;
+  Phase phase_ = kIdle;
+  Clock::time_point phase_at_;  // Connect start, or the last frame while open
+  Clock::time_point retry_at_;
+  Clock::time_point pinged_at_;
+  int backoff_ms_ = kMinBackoffMs;
+  uint16_t interval_ms_ = 250;
+  std::vector<uint8_t> in_;
+  std::vector<uint8_t> out_;
+  std::mt19937 random_;
+
+  Record record_;
+  uint32_t pending_frames_ = 0;
+  bool changed_ = true;
+};
+
+TelemetryEngine::TelemetryEngine() {
+#ifdef _WIN32
+  WSADATA data;
+  WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+  thread_ = std::thread(&TelemetryEngine::Run, this);
+}
+
+TelemetryEngine::~TelemetryEngine() {
+  running_ = false;
+  thread_.join();
+  links_.clear();
+#ifdef _WIN32
+  WSACleanup();
+#endif
+}
+
+int32_t TelemetryEngine::AddDevice(const std::string& host, uint16_t port, const std::string& path) {
+  std::lock_guard<std::mutex> guard(lock_);
+  int32_t handle = next_handle_++;
+  published_[handle] = Record();
+  requests_.push_back({Request::kAdd, handle, host, port, path});
+  return handle;
+}
+
+void TelemetryEngine::RemoveDevice(int32_t handle) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (published_.erase(handle) != 0) {
+    requests_.push_back({Request::kRemove, handle, std::string(), 0, std::string()});
+  }
+}
+
+bool TelemetryEngine::SendCommand(int32_t handle, const std::string& json) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (published_.count(handle) == 0) {
+    return false;
+  }
+  requests_.push_back({Request::kSend, handle, std::string(), 0, json});
+  return true;
+}
+
+void TelemetryEngine::SetInterval(uint16_t interval_ms) {
+  std::lock_guard<std::mutex> guard(lock_);
+  requests_.push_back({Request::kInterval, 0, std::string(), interval_ms, std::string()});
+}
+
+bool TelemetryEngine::TakeBatch(std::vector<uint8_t>* out) {
+  std::lock_guard<std::mutex> guard(lock_);
+  uint16_t count = 0;
+  for (const auto& entry : published_) {
+    if (entry.second.dirty) {
+      count++;
+    }
+  }
+  if (count == 0) {
+    return false;
+  }
+
+  out->clear();
+  out->reserve(kTelemetryBatchHeaderSize + count * kTelemetryRecordSize);
+  out->push_back(kTelemetryBatchMagic);
+  out->push_back(kTelemetryBatchVersion);
+  PutU16(out, count);
+  PutU16(out, open_links_);
+  PutU16(out, static_cast<uint16_t>(std::min<size_t>(published_.size(), 0xFFFF)));
+  for (auto& entry : published_) {
+    Record& record = entry.second;
+    if (!record.dirty) {
+      continue;
+    }
+    PutU32(out, static_cast<uint32_t>(entry.first));
+    out->push_back(record.link);
+    out->push_back(record.flags);
+    PutU16(out, record.gas_level);
+    PutU16(out, static_cast<uint16_t>(record.temperature));
+    PutU16(out, record.humidity);
+    PutF32(out, record.gas_threshold);
+    PutF32(out, record.temp_threshold);
+    PutU32(out, record.uptime_ms);
+    PutU32(out, record.frames);
+    record.dirty = false;
+    record.frames = 0;
+  }
+  return true;
+}
+
+void TelemetryEngine::Run() {
+  std::vector<pollfd> fds;
+  std::vector<Link*> polled;
+  while (running_) {
+    ApplyRequests();
+
+    Clock::time_point now = Clock::now();
+    fds.clear();
+    polled.clear();
+    for (auto& entry : links_) {
+      Link* link = entry.second.get();
+      link->Tick(now);
+      if (link->Socket() != kNoSocket) {
+        pollfd fd = {};
+        fd.fd = link->Socket();
+        fd.events = link->Events();
+        fds.push_back(fd);
+        polled.push_back(link);
+      }
+    }
+
+    if (fds.empty()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(kPollMs));
+    } else if (PollSockets(fds.data(), fds.size(), kPollMs) > 0) {
+      now = Clock::now();
+      for (size_t i = 0; i < fds.size(); i++) {
+        if (fds[i].revents != 0) {
+          polled[i]->OnEvents(fds[i].revents, now);
+        }
+      }
+    }
+
+    Publish();
+  }
+}
+
+void TelemetryEngine::ApplyRequests() {
+  std::vector<Request> requests;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    requests.swap(requests_);
+  }
+
+  for (const Request& request : requests) {
+    auto link = links_.find(request.handle);
+    switch (request.kind) {
+      case Request::kAdd:
+        links_[request.handle].reset(new Link(request.host, request.port, request.text, interval_ms_));
+        break;
+      case Request::kRemove:
+        if (link != links_.end()) {
+          links_.erase(link);
+        }
+        break;
+      case Request::kSend:
+        if (link != links_.end()) {
+          link->second->Send(request.text);
+        }
+        break;
+      case Request::kInterval:
+        interval_ms_ = request.port;
+        for (auto& entry : links_) {
+          entry.second->SetInterval(interval_ms_);
+        }
+        break;
+    }
+  }
+}
+
+// Folds each link's latest state into the record Dart will get next frame
+void TelemetryEngine::Publish() {
+  std::lock_guard<std::mutex> guard(lock_);
+  uint16_t open = 0;
+  for (auto& entry : links_) {
+    if (entry.second->open()) {
+      open++;
+    }
+    auto record = published_.find(entry.first);
+    if (record != published_.end()) {
+      entry.second->TakeChanges(&record->second);
+    }
+  }
+  open_links_ = open;
+}
@@ -0,0 +1,105 @@
+#ifndef NATIVE_TELEMETRY_ENGINE_H_
+#define NATIVE_TELEMETRY_ENGINE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Batch handed to Dart (lib/fleet_telemetry.dart), little-endian:
+//   header  u8 magic, u8 version, u16 record count, u16 open connections,
+//           u16 devices tracked
+//   record  u32 handle, u8 link state, u8 telemetry flags, u16 gas level ppm,
+//           i16 temperature 0.01 C, u16 humidity 0.01 %, f32 gas threshold,
+//           f32 temperature threshold, u32 device uptime ms, u32 frames folded
+//           into this record since the previous batch
+// Telemetry fields are those of the firmware's binary frame (TelemetryFrame
+// in telemetry_codec.h); they hold their last values while a link is down.
+constexpr uint8_t kTelemetryBatchMagic = 0x42;  // 'B'
+constexpr uint8_t kTelemetryBatchVersion = 1;
+constexpr size_t kTelemetryBatchHeaderSize = 8;
+constexpr size_t kTelemetryRecordSize = 28;
+
+enum TelemetryLinkState : uint8_t {
+  kLinkConnecting = 0,
+  kLinkOpen = 1,
+  kLinkOffline = 2,  // Waiting to reconnect
+};
+
+// WebSocket telemetry from many gas monitors on one background thread. Each
+// link subscribes to binary frames, so the thread only copies fixed-layout
+// fields, and every device keeps just its latest state: however many frames
+// arrive between two TakeBatch calls, the batch carries one record per device
+// that changed. The runner calls TakeBatch once per display frame.
+class TelemetryEngine {
+ public:
+  TelemetryEngine();
+  ~TelemetryEngine();
+
+  TelemetryEngine(const TelemetryEngine&) = delete;
+  TelemetryEngine& operator=(const TelemetryEngine&) = delete;
+
+  // Starts a link to ws://host:port/path and keeps it up, reconnecting with
+  // backoff. host should be an address (from discovery); names are resolved
+  // on the I/O thread and block it while they do.
+  int32_t AddDevice(const std::string& host, uint16_t port, const std::string& path);
+  void RemoveDevice(int32_t handle);
+
+  // Queues a JSON command for the device; dropped if its link is not open.
+  // False for an unknown handle.
+  bool SendCommand(int32_t handle, const std::string& json);
+
+  // Telemetry interval requested from every device, applied on (re)subscribe
+  void SetInterval(uint16_t interval_ms);
+
+  // Replaces out with a batch of the devices that changed since the last
+  // call; false (and out untouched) when none did
+  bool TakeBatch(std::vector<uint8_t>* out);
+
+ private:
+  struct Record {
+    uint8_t link = kLinkConnecting;
+    uint8_t flags = 0;
+    uint16_t gas_level = 0;
+    int16_t temperature = 0;
+    uint16_t humidity = 0;
+    float gas_threshold = 0;
+    float temp_threshold = 0;
+    uint32_t uptime_ms = 0;
+    uint32_t frames = 0;
+    bool dirty = true;
+  };
+
+  struct Request {
+    enum Kind { kAdd, kRemove, kSend, kInterval } kind;
+    int32_t handle;
+    std::string host;
+    uint16_t port;
+    std::string text;  // Path for kAdd, JSON for kSend
+  };
+
+  class Link;
+
+  void Run();
+  void ApplyRequests();
+  void Publish();
+
+  std::mutex lock_;  // Guards requests_, published_, next_handle_ and open_links_
+  std::vector<Request> requests_;
+  std::map<int32_t, Record> published_;
+  int32_t next_handle_ = 1;
+  uint16_t open_links_ = 0;
+
+  // I/O thread only
+  std::map<int32_t, std::unique_ptr<Link>> links_;
+  uint16_t interval_ms_ = 250;
+
+  std::atomic<bool> running_{true};
+  std::thread thread_;
+};
+
+#endif  // NATIVE_TELEMETRY_ENGINE_H_
@@ -4,6 +4,15 @@
 
 #include "flutter/generated_plugin_registrant.h"
 
+namespace {
+
+// WM_TIMER id and period of the telemetry flush; the system timer resolution
+// rounds 16 ms up to about one 60 Hz display frame
+constexpr UINT_PTR kTelemetryTimerId = 1;
+constexpr UINT kTelemetryTimerMs = 16;
+
+}  // namespace
+
 FlutterWindow::FlutterWindow(const flutter::DartProject& project)
     : project_(project) {}
 
@@ -25,6 +34,9 @@ bool FlutterWindow::OnCreate() {
     return false;
   }
   RegisterPlugins(flutter_controller_->engine());
+  telemetry_ = std::make_unique<TelemetryChannel>(
+      flutter_controller_->engine()->messenger());
+  SetTimer(GetHandle(), kTelemetryTimerId, kTelemetryTimerMs, nullptr);
   SetChildContent(flutter_controller_->view()->GetNativeWindow());
 
   flutter_controller_->engine()->SetNextFrameCallback([&]() {
@@ -40,6 +52,8 @@ bool FlutterWindow::OnCreate() {
 }
 
 void FlutterWindow::OnDestroy() {
+  KillTimer(GetHandle(), kTelemetryTimerId);
+  telemetry_ = nullptr;
   if (flutter_controller_) {
     flutter_controller_ = nullptr;
   }
@@ -65,6 +79,12 @@ FlutterWindow::MessageHandler(HWND hwnd, UINT const message,
     case WM_FONTCHANGE:
       flutter_controller_->engine()->ReloadSystemFonts();
       break;
+    case WM_TIMER:
+      if (wparam == kTelemetryTimerId && telemetry_) {
+        telemetry_->Flush();
+        return 0;
+      }
+      break;
   }
 
   return Win32Window::MessageHandler(hwnd, message, wparam, lparam);
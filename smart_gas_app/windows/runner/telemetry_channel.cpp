@@ -0,0 +1,98 @@
+#include "telemetry_channel.h"
+
+#include <flutter/standard_method_codec.h>
+
+#include <string>
+
+namespace {
+
+constexpr char kMethodChannel[] = "smart_gas_app/telemetry";
+constexpr char kBatchChannel[] = "smart_gas_app/telemetry/batch";
+
+const flutter::EncodableValue* Lookup(const flutter::EncodableValue* args,
+                                      const char* key) {
+  const auto* map = std::get_if<flutter::EncodableMap>(args);
+  if (map == nullptr) {
+    return nullptr;
+  }
+  auto it = map->find(flutter::EncodableValue(key));
+  return it != map->end() ? &it->second : nullptr;
+}
+
+// Dart ints arrive as int32 or int64 depending on their size
+int64_t LookupInt(const flutter::EncodableValue* args, const char* key,
+                  int64_t fallback) {
+  const flutter::EncodableValue* value = Lookup(args, key);
+  if (value == nullptr || (!std::holds_alternative<int32_t>(*value) &&
+                           !std::holds_alternative<int64_t>(*value))) {
+    return fallback;
+  }
+  return value->LongValue();
+}
+
+const std::string* LookupString(const flutter::EncodableValue* args,
+                                const char* key) {
+  const flutter::EncodableValue* value = Lookup(args, key);
+  return value != nullptr ? std::get_if<std::string>(value) : nullptr;
+}
+
+}  // namespace
+
+TelemetryChannel::TelemetryChannel(flutter::BinaryMessenger* messenger)
+    : messenger_(messenger),
+      channel_(std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
+          messenger, kMethodChannel,
+          &flutter::StandardMethodCodec::GetInstance())) {
+  channel_->SetMethodCallHandler(
+      [this](const auto& call, auto result) {
+        HandleMethodCall(call, std::move(result));
+      });
+}
+
+void TelemetryChannel::Flush() {
+  if (engine_.TakeBatch(&batch_)) {
+    messenger_->Send(kBatchChannel, batch_.data(), batch_.size());
+  }
+}
+
+void TelemetryChannel::HandleMethodCall(
+    const flutter::MethodCall<flutter::EncodableValue>& call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  const flutter::EncodableValue* args = call.arguments();
+  const std::string& method = call.method_name();
+
+  if (method == "addDevice") {
+    const std::string* host = LookupString(args, "host");
+    const std::string* path = LookupString(args, "path");
+    int64_t port = LookupInt(args, "port", 80);
+    if (host == nullptr || port <= 0 || port > 65535) {
+      result->Error("bad-arguments", "addDevice needs a host and a valid port");
+      return;
+    }
+    int32_t handle = engine_.AddDevice(*host, static_cast<uint16_t>(port),
+                                       path != nullptr ? *path : "/ws");
+    result->Success(flutter::EncodableValue(handle));
+  } else if (method == "removeDevice") {
+    engine_.RemoveDevice(static_cast<int32_t>(LookupInt(args, "handle", 0)));
+    result->Success();
+  } else if (method == "send") {
+    const std::string* command = LookupString(args, "command");
+    if (command == nullptr) {
+      result->Error("bad-arguments", "send needs a command");
+      return;
+    }
+    bool queued = engine_.SendCommand(
+        static_cast<int32_t>(LookupInt(args, "handle", 0)), *command);
+    result->Success(flutter::EncodableValue(queued));
+  } else if (method == "setInterval") {
+    int64_t interval = LookupInt(args, "interval", 0);
+    if (interval <= 0 || interval > 60000) {
+      result->Error("bad-arguments", "setInterval needs 1-60000 ms");
+      return;
+    }
+    engine_.SetInterval(static_cast<uint16_t>(interval));
+    result->Success();
+  } else {
+    result->NotImplemented();
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef RUNNER_TELEMETRY_CHANNEL_H_
+#define RUNNER_TELEMETRY_CHANNEL_H_
+
+#include <flutter/binary_messenger.h>
+#include <flutter/encodable_value.h>
+#include <flutter/method_channel.h>
+
+#include <memory>
+#include <vector>
+
+#include "telemetry_engine.h"
+
+// Serves the "smart_gas_app/telemetry" method channel (addDevice,
+// removeDevice, send, setInterval) from a native TelemetryEngine and pushes
+// its batches on "smart_gas_app/telemetry/batch".
+class TelemetryChannel {
+ public:
+  explicit TelemetryChannel(flutter::BinaryMessenger* messenger);
+
+  // Sends what changed since the last call; the window calls it once per
+  // frame from a timer on the platform thread.
+  void Flush();
+
+ private:
+  void HandleMethodCall(
+      const flutter::MethodCall<flutter::EncodableValue>& call,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  flutter::BinaryMessenger* messenger_;
+  std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>> channel_;
+  TelemetryEngine engine_;
+  std::vector<uint8_t> batch_;
+};
+
+#endif  // RUNNER_TELEMETRY_CHANNEL_H_
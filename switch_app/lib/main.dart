@@ -3,6 +3,9 @@ import 'dart:convert';
 
 import 'package:flutter/material.dart';
 import 'package:http/http.dart' as http;
+import 'package:web_socket_channel/io.dart';
+
+import 'discovery.dart';
 
 void main() {
   runApp(const MyApp());
@@ -38,38 +41,70 @@ class _SmartSwitchPageState extends State<SmartSwitchPage> {
   bool pirActive = false;
   bool isConnected = false;
   String ipAddress = "192.168.4.1"; // Default ESP01 IP in AP mode
-  Timer? statusTimer;
+  IOWebSocketChannel? _channel;
+  StreamSubscription? _subscription;
+  Timer? _reconnectTimer;
+  // One client so actions reuse the switch's keep-alive connection
+  final http.Client _client = http.Client();
 
   @override
   void initState() {
     super.initState();
-    fetchStatus();
-    // Poll status every 3 seconds
-    statusTimer = Timer.periodic(const Duration(seconds: 3), (timer) {
-      fetchStatus();
-    });
+    connectWebSocket();
   }
 
   @override
   void dispose() {
-    statusTimer?.cancel();
+    _reconnectTimer?.cancel();
+    _subscription?.cancel();
+    _channel?.sink.close();
+    _client.close();
     super.dispose();
   }
 
+  // The switch pushes its state on connect and whenever it changes
+  void connectWebSocket() {
+    _reconnectTimer?.cancel();
+    _subscription?.cancel();
+    _channel?.sink.close();
+
+    _channel = IOWebSocketChannel.connect(
+      'ws://$ipAddress:81',
+      connectTimeout: const Duration(seconds: 5),
+    );
+    _subscription = _channel!.stream.listen(
+      (message) => _applyStatus(jsonDecode(message)),
+      onError: (error) => _onDisconnected(),
+      onDone: _onDisconnected,
+    );
+  }
+
+  void _onDisconnected() {
+    if (!mounted) return;
+    setState(() {
+      isConnected = false;
+    });
+    _reconnectTimer?.cancel();
+    _reconnectTimer = Timer(const Duration(seconds: 3), connectWebSocket);
+  }
+
+  void _applyStatus(dynamic data) {
+    setState(() {
+      switchState = data['state'];
+      autoMode = data['auto'];
+      pirActive = data['pir'];
+      isConnected = true;
+    });
+  }
+
   Future<void> fetchStatus() async {
     try {
-      final response = await http
+      final response = await _client
           .get(Uri.parse('http://$ipAddress/status'))
           .timeout(const Duration(seconds: 5));
 
       if (response.statusCode == 200) {
-        final data = jsonDecode(response.body);
-        setState(() {
-          switchState = data['state'];
-          autoMode = data['auto'];
-          pirActive = data['pir'];
-          isConnected = true;
-        });
+        _applyStatus(jsonDecode(response.body));
       } else {
         setState(() {
           isConnected = false;
@@ -92,12 +127,16 @@ class _SmartSwitchPageState extends State<SmartSwitchPage> {
     }
 
     try {
-      final response = await http
-          .get(Uri.parse('http://$ipAddress/toggle'))
+      final response = await _client
+          .post(
+            Uri.parse('http://$ipAddress/api/relay'),
+            body: {'state': 'toggle'},
+          )
           .timeout(const Duration(seconds: 5));
 
-      if (response.statusCode == 200 || response.statusCode == 302) {
-        fetchStatus();
+      // The reply carries the new state, so no follow-up request is needed
+      if (response.statusCode == 200 || response.statusCode == 409) {
+        _applyStatus(jsonDecode(response.body));
       }
     } catch (e) {
       ScaffoldMessenger.of(
@@ -108,16 +147,15 @@ class _SmartSwitchPageState extends State<SmartSwitchPage> {
 
   Future<void> toggleMode(bool setAuto) async {
     try {
-      final response = await http
-          .get(
-            Uri.parse(
-              'http://$ipAddress/setmode?auto=${setAuto ? 'true' : 'false'}',
-            ),
+      final response = await _client
+          .post(
+            Uri.parse('http://$ipAddress/api/mode'),
+            body: {'auto': setAuto ? 'true' : 'false'},
           )
           .timeout(const Duration(seconds: 5));
 
-      if (response.statusCode == 200 || response.statusCode == 302) {
-        fetchStatus();
+      if (response.statusCode == 200) {
+        _applyStatus(jsonDecode(response.body));
       }
     } catch (e) {
       ScaffoldMessenger.of(
@@ -439,49 +477,93 @@ class _SmartSwitchPageState extends State<SmartSwitchPage> {
 
   void _showSettingsDialog() {
     final ipController = TextEditingController(text: ipAddress);
+    List<DiscoveredDevice> found = [];
+    bool searching = false;
 
     showDialog(
       context: context,
       builder:
-          (context) => AlertDialog(
-            backgroundColor: const Color(0xFFE0E5EC),
-            title: const Text('Connection Settings'),
-            content: Column(
-              mainAxisSize: MainAxisSize.min,
-              children: [
-                TextField(
-                  controller: ipController,
-                  decoration: const InputDecoration(
-                    labelText: 'ESP01 IP Address',
-                    border: OutlineInputBorder(),
+          (context) => StatefulBuilder(
+            builder:
+                (context, setDialogState) => AlertDialog(
+                  backgroundColor: const Color(0xFFE0E5EC),
+                  title: const Text('Connection Settings'),
+                  content: Column(
+                    mainAxisSize: MainAxisSize.min,
+                    children: [
+                      TextField(
+                        controller: ipController,
+                        decoration: const InputDecoration(
+                          labelText: 'ESP01 IP Address',
+                          border: OutlineInputBorder(),
+                        ),
+                        keyboardType: TextInputType.number,
+                      ),
+                      // One UDP broadcast finds every switch on the network
+                      TextButton.icon(
+                        onPressed:
+                            searching
+                                ? null
+                                : () async {
+                                  setDialogState(() => searching = true);
+                                  List<DiscoveredDevice> devices = [];
+                                  try {
+                                    devices = await discoverDevices(
+                                      kind: discoveryKindSwitch,
+                                    );
+                                  } catch (e) {
+                                    debugPrint('Discovery error: $e');
+                                  }
+                                  setDialogState(() {
+                                    searching = false;
+                                    found = devices;
+                                    if (devices.length == 1) {
+                                      ipController.text = devices.first.address;
+                                    }
+                                  });
+                                },
+                        icon: const Icon(Icons.search),
+                        label: Text(searching ? 'Searching...' : 'Find switches'),
+                      ),
+                      for (final device in found)
+                        ListTile(
+                          dense: true,
+                          title: Text(device.address),
+                          subtitle: Text(
+                            '${device.deviceId}  ·  firmware ${device.firmware}',
+                          ),
+                          selected: ipController.text == device.address,
+                          onTap:
+                              () => setDialogState(
+                                () => ipController.text = device.address,
+                              ),
+                        ),
+                      const SizedBox(height: 15),
+                      const Text(
+                        'Default credentials:',
+                        style: TextStyle(fontWeight: FontWeight.bold),
+                      ),
+                      const Text('SSID: SmartSwitch'),
+                      const Text('Password: switch1234'),
+                    ],
                   ),
-                  keyboardType: TextInputType.number,
-                ),
-                const SizedBox(height: 15),
-                const Text(
-                  'Default credentials:',
-                  style: TextStyle(fontWeight: FontWeight.bold),
+                  actions: [
+                    TextButton(
+                      onPressed: () => Navigator.pop(context),
+                      child: const Text('Cancel'),
+                    ),
+                    NeomorphicButton(
+                      onPressed: () {
+                        setState(() {
+                          ipAddress = ipController.text;
+                        });
+                        connectWebSocket();
+                        Navigator.pop(context);
+                      },
+                      child: const Text('Save'),
+                    ),
+                  ],
                 ),
-                const Text('SSID: SmartSwitch'),
-                const Text('Password: switch1234'),
-              ],
-            ),
-            actions: [
-              TextButton(
-                onPressed: () => Navigator.pop(context),
-                child: const Text('Cancel'),
-              ),
-              NeomorphicButton(
-                onPressed: () {
-                  setState(() {
-                    ipAddress = ipController.text;
-                  });
-                  fetchStatus();
-                  Navigator.pop(context);
-                },
-                child: const Text('Save'),
-              ),
-            ],
           ),
     );
   }
@@ -0,0 +1,63 @@
+# Gzips every file under <project>/web into include/web_assets.h as PROGMEM
+# byte arrays, with a length and an ETag (CRC-32 of the compressed bytes) per
+# asset. Runs as a PlatformIO pre-build script (extra_scripts = pre:...) or by
+# hand: python tools/embed_web.py "<project dir>"
+import gzip
+import os
+import re
+import sys
+import zlib
+
+
+def symbol(name):
+    return "WEB_" + re.sub(r"[^A-Za-z0-9]", "_", name).upper()
+
+
+def render(web_dir):
+    lines = [
+        "// Generated by tools/embed_web.py from web/ -- do not edit",
+        "#ifndef WEB_ASSETS_H",
+        "#define WEB_ASSETS_H",
+        "",
+        "#include <Arduino.h>",
+        "",
+    ]
+    for name in sorted(os.listdir(web_dir)):
+        path = os.path.join(web_dir, name)
+        if not os.path.isfile(path):
+            continue
+        with open(path, "rb") as f:
+            # mtime=0 keeps the output, and so the ETag, stable across rebuilds
+            data = gzip.compress(f.read(), 9, mtime=0)
+        sym = symbol(name)
+        lines.append("#define %s_LEN %d" % (sym, len(data)))
+        lines.append('#define %s_ETAG "\\"%08x\\""' % (sym, zlib.crc32(data) & 0xFFFFFFFF))
+        lines.append("static const uint8_t %s_GZ[] PROGMEM = {" % sym)
+        for i in range(0, len(data), 16):
+            lines.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+        lines.append("};")
+        lines.append("")
+    lines.append("#endif")
+    return "\n".join(lines) + "\n"
+
+
+def embed(project_dir):
+    web_dir = os.path.join(project_dir, "web")
+    out_path = os.path.join(project_dir, "include", "web_assets.h")
+    content = render(web_dir)
+
+    # Only touch the header when an asset changed, so it doesn't force a rebuild
+    if os.path.exists(out_path):
+        with open(out_path) as f:
+            if f.read() == content:
+                return
+    with open(out_path, "w") as f:
+        f.write(content)
+    print("Embedded web assets into " + out_path)
+
+
+try:
+    Import("env")  # noqa: F821 (provided by PlatformIO)
+    embed(env["PROJECT_DIR"])  # noqa: F821
+except NameError:
+    embed(sys.argv[1] if len(sys.argv) > 1 else os.getcwd())
@@ -0,0 +1,83 @@
+#include "http_client.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <strings.h>
+
+#include "net.h"
+
+HttpResult httpRequest(const std::string &host, int port, const std::string &method,
+                       const std::string &path, const std::string &body, int timeoutMs) {
+  HttpResult result;
+  int fd = tcpConnect(host, port, timeoutMs, result.error);
+  if (fd < 0) {
+    return result;
+  }
+
+  std::string request = method + " " + path + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: close\r\n";
+  if (!body.empty()) {
+    request += "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+               std::to_string(body.size()) + "\r\n";
+  }
+  request += "\r\n" + body;
+  if (!sendAll(fd, request.data(), request.size())) {
+    result.error = "send failed";
+    close(fd);
+    return result;
+  }
+
+  // Read to end of stream, or to Content-Length once the headers are in
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+  std::string response;
+  size_t headerEnd = std::string::npos;
+  long contentLength = -1;
+  char buffer[2048];
+  for (;;) {
+    if (headerEnd != std::string::npos && contentLength >= 0 &&
+        response.size() >= headerEnd + 4 + (size_t)contentLength) {
+      break;
+    }
+    int left = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                   deadline - std::chrono::steady_clock::now()).count();
+    if (left <= 0 || !waitReadable(fd, left)) {
+      result.error = "response timeout";
+      break;
+    }
+    ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+    if (got <= 0) {
+      break;
+    }
+    response.append(buffer, (size_t)got);
+
+    if (headerEnd == std::string::npos) {
+      headerEnd = response.find("\r\n\r\n");
+      if (headerEnd != std::string::npos) {
+        for (size_t line = response.find("\r\n") + 2; line < headerEnd;) {
+          size_t next = response.find("\r\n", line);
+          if (strncasecmp(response.c_str() + line, "Content-Length:", 15) == 0) {
+            contentLength = strtol(response.c_str() + line + 15, nullptr, 10);
+          }
+          line = next + 2;
+        }
+      }
+    }
+  }
+  close(fd);
+
+  if (response.compare(0, 5, "HTTP/") == 0) {
+    size_t space = response.find(' ');
+    if (space != std::string::npos) {
+      result.status = atoi(response.c_str() + space + 1);
+    }
+  }
+  if (result.status == 0 && result.error.empty()) {
+    result.error = "malformed response";
+  }
+  if (headerEnd != std::string::npos) {
+    result.body = response.substr(headerEnd + 4);
+  }
+  return result;
+}
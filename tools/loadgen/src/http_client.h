@@ -0,0 +1,18 @@
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <string>
+
+struct HttpResult {
+  int status = 0;     // 0 when the request never got a status line
+  std::string error;  // Transport failure, empty otherwise
+  std::string body;
+};
+
+// One HTTP/1.1 request on its own connection (Connection: close), which is
+// how the apps and browsers hit the firmware's single-client servers. A
+// non-empty body is sent as application/x-www-form-urlencoded.
+HttpResult httpRequest(const std::string &host, int port, const std::string &method,
+                       const std::string &path, const std::string &body, int timeoutMs);
+
+#endif
@@ -0,0 +1,48 @@
+#include "latency.h"
+
+#include <algorithm>
+
+void LatencyRecorder::record(uint32_t us) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _interval.push_back(us);
+}
+
+LatencySummary LatencyRecorder::takeInterval() {
+  std::vector<uint32_t> samples;
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    samples.swap(_interval);
+    _all.insert(_all.end(), samples.begin(), samples.end());
+  }
+  return summarize(samples);
+}
+
+LatencySummary LatencyRecorder::total() {
+  std::vector<uint32_t> samples;
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    _all.insert(_all.end(), _interval.begin(), _interval.end());
+    _interval.clear();
+    samples = _all;
+  }
+  return summarize(samples);
+}
+
+// Nearest-rank percentiles; sorts the vector in place
+LatencySummary LatencyRecorder::summarize(std::vector<uint32_t> &samples) {
+  LatencySummary summary;
+  summary.count = samples.size();
+  if (samples.empty()) {
+    return summary;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  auto rank = [&](double p) {
+    size_t index = (size_t)(p * samples.size() + 0.999999);
+    return samples[std::min(samples.size(), std::max<size_t>(index, 1)) - 1] / 1000.0;
+  };
+  summary.p50Ms = rank(0.50);
+  summary.p99Ms = rank(0.99);
+  summary.maxMs = samples.back() / 1000.0;
+  return summary;
+}
@@ -0,0 +1,33 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct LatencySummary {
+  size_t count = 0;
+  double p50Ms = 0;
+  double p99Ms = 0;
+  double maxMs = 0;
+};
+
+// Latency samples in microseconds, recorded from any thread. The reporter
+// drains the current interval once a second for its CSV row and keeps every
+// sample for the end-of-run summary.
+class LatencyRecorder {
+public:
+  void record(uint32_t us);
+
+  LatencySummary takeInterval();
+  LatencySummary total();
+
+private:
+  static LatencySummary summarize(std::vector<uint32_t> &samples);
+
+  std::mutex _lock;
+  std::vector<uint32_t> _interval;
+  std::vector<uint32_t> _all;
+};
+
+#endif
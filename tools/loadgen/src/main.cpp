@@ -0,0 +1,519 @@
+// Load generator for the gas monitor and smart switch firmwares. Holds N
+// WebSocket clients open, polls HTTP endpoints at fixed rates, issues relay
+// (and, on the monitor, threshold) commands, and writes one CSV row per
+// second with throughput, error counts and latency percentiles:
+//   http     request to full response
+//   bcast    command sent to the broadcast carrying its new value, per client
+//   ack      WebSocket command to its {"type":"ack"} (monitor only)
+//
+// Commands only flip values between what the device reported and a
+// neighbour, and the original relay state and gas threshold are put back at
+// the end, so a run leaves the device as it found it.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "http_client.h"
+#include "latency.h"
+#include "options.h"
+#include "ws_client.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+uint32_t elapsedUs(Clock::time_point since) {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - since).count();
+}
+
+volatile sig_atomic_t interrupted = 0;
+std::atomic<bool> running{true};     // Clients and pollers
+std::atomic<bool> commanding{true};  // Command task; stops first so the clients see the restore
+
+struct Counters {
+  std::atomic<int> wsConnected{0};
+  std::atomic<uint64_t> wsConnects{0};
+  std::atomic<uint64_t> wsErrors{0};  // Failed connects and unexpected closes
+  std::atomic<uint64_t> wsMessages{0};
+  std::atomic<uint64_t> wsBytes{0};
+  std::atomic<uint64_t> httpRequests{0};
+  std::atomic<uint64_t> httpErrors{0};  // Transport failures and 4xx/5xx
+  std::atomic<uint64_t> commands{0};
+  std::atomic<uint64_t> commandErrors{0};  // Send failures, refusals, nack and missing acks
+  std::atomic<uint64_t> missedBroadcasts{0};
+} counters;
+
+LatencyRecorder httpLatency;
+LatencyRecorder broadcastLatency;
+LatencyRecorder ackLatency;
+
+// True when text holds marker followed by the end of the JSON value, so
+// "gasThreshold":50 does not match "gasThreshold":501
+bool containsValue(const std::string &text, const std::string &marker) {
+  for (size_t at = text.find(marker); at != std::string::npos; at = text.find(marker, at + 1)) {
+    char next = at + marker.size() < text.size() ? text[at + marker.size()] : '\0';
+    if (next == ',' || next == '}' || next == ' ' || next == '\0') {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool findBool(const std::string &text, const char *key, bool &value) {
+  size_t at = text.find(key);
+  if (at == std::string::npos) {
+    return false;
+  }
+  at = text.find_first_not_of(' ', at + strlen(key));
+  if (at == std::string::npos) {
+    return false;
+  }
+  value = text[at] == 't';
+  return text[at] == 't' || text[at] == 'f';
+}
+
+bool findNumber(const std::string &text, const char *key, double &value) {
+  size_t at = text.find(key);
+  if (at == std::string::npos) {
+    return false;
+  }
+  const char *start = text.c_str() + at + strlen(key);
+  char *end;
+  value = strtod(start, &end);
+  return end != start;
+}
+
+// The latest command of one kind and which clients have seen its effect.
+// Starting the next one settles the previous: every client that was
+// connected when it went out but never saw the value counts as a miss.
+class Probe {
+public:
+  explicit Probe(const char *name) : _name(name) {}
+
+  void start(const std::string &marker) {
+    std::lock_guard<std::mutex> guard(_lock);
+    settle();
+    _seq++;
+    _marker = marker;
+    _expected = counters.wsConnected;
+    _hits = 0;
+    _sentAt = Clock::now();
+  }
+
+  void finish() {
+    std::lock_guard<std::mutex> guard(_lock);
+    settle();
+    _expected = 0;
+  }
+
+  // Called by each client for every message; lastSeen is that client's own
+  void match(const std::string &message, uint64_t &lastSeen) {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_seq == 0 || lastSeen == _seq || !containsValue(message, _marker)) {
+      return;
+    }
+    uint32_t us = elapsedUs(_sentAt);
+    lastSeen = _seq;
+    _hits++;
+    _latency.record(us);
+    broadcastLatency.record(us);
+  }
+
+  const char *name() const { return _name; }
+  LatencySummary total() { return _latency.total(); }
+
+private:
+  void settle() {
+    if (_hits < _expected) {
+      counters.missedBroadcasts += _expected - _hits;
+    }
+  }
+
+  const char *_name;
+  std::mutex _lock;
+  uint64_t _seq = 0;
+  std::string _marker;
+  int _expected = 0;
+  int _hits = 0;
+  Clock::time_point _sentAt;
+  LatencyRecorder _latency;
+};
+
+Probe relayProbe("relay");
+Probe thresholdProbe("threshold");
+
+// What the device last reported, learnt from the broadcasts
+std::mutex observedLock;
+bool relayKnown = false;
+bool observedRelay = false;
+bool thresholdKnown = false;
+double observedThreshold = 0;
+
+// WebSocket commands waiting for their ack, by id
+std::mutex ackLock;
+std::map<long, Clock::time_point> pendingAcks;
+
+void handleAck(const std::string &message) {
+  // {"type":"ack","results":[{"id":7,"ok":true},...]}
+  static const char idKey[] = "\"id\":";
+  for (size_t at = message.find(idKey); at != std::string::npos; at = message.find(idKey, at + 1)) {
+    long id = strtol(message.c_str() + at + strlen(idKey), nullptr, 10);
+    size_t entryEnd = message.find('}', at);
+    size_t ok = message.find("\"ok\":", at);
+    bool failed = ok != std::string::npos && ok < entryEnd && message.compare(ok + 5, 5, "false") == 0;
+
+    std::lock_guard<std::mutex> guard(ackLock);
+    auto pending = pendingAcks.find(id);
+    if (pending == pendingAcks.end()) {
+      continue;
+    }
+    ackLatency.record(elapsedUs(pending->second));
+    pendingAcks.erase(pending);
+    if (failed) {
+      counters.commandErrors++;
+    }
+  }
+}
+
+void clientTask(const Options &options, WsClient &client, bool reportsState) {
+  const char *relayKey = options.target == Target::MONITOR ? "\"relayState\":" : "\"state\":";
+  uint64_t relaySeen = 0;
+  uint64_t thresholdSeen = 0;
+  std::string message;
+  bool binary;
+
+  while (running) {
+    std::string error;
+    if (!client.connect(options.host, options.wsPort, options.wsPath, options.timeoutMs, error)) {
+      counters.wsErrors++;
+      fprintf(stderr, "ws connect: %s\n", error.c_str());
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      continue;
+    }
+    counters.wsConnects++;
+    counters.wsConnected++;
+
+    WsClient::ReadResult result;
+    while (running && (result = client.read(message, binary, 200)) != WsClient::CLOSED) {
+      if (result != WsClient::MESSAGE) {
+        continue;
+      }
+      counters.wsMessages++;
+      counters.wsBytes += message.size();
+      if (binary) {
+        continue;  // Binary telemetry frames are counted, not decoded
+      }
+
+      relayProbe.match(message, relaySeen);
+      thresholdProbe.match(message, thresholdSeen);
+      if (message.find("\"type\":\"ack\"") != std::string::npos) {
+        handleAck(message);
+      }
+
+      // One client is enough to follow the device's state
+      if (reportsState) {
+        bool relay;
+        double threshold;
+        std::lock_guard<std::mutex> guard(observedLock);
+        if (findBool(message, relayKey, relay)) {
+          relayKnown = true;
+          observedRelay = relay;
+        }
+        if (findNumber(message, "\"gasThreshold\":", threshold)) {
+          thresholdKnown = true;
+          observedThreshold = threshold;
+        }
+      }
+    }
+
+    counters.wsConnected--;
+    if (running) {
+      counters.wsErrors++;
+      fprintf(stderr, "ws closed by device\n");
+    }
+  }
+  client.close();
+}
+
+// Open-loop poller: requests go out on schedule, not when the last one
+// finished, so a slow device shows up as latency and errors
+void pollTask(const Options &options, const PollSpec &poll, double rate) {
+  auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+  auto next = Clock::now();
+  while (running) {
+    next += interval;
+    Clock::time_point sentAt = Clock::now();
+    HttpResult result = httpRequest(options.host, options.httpPort, poll.method, poll.path, poll.body,
+                                    options.timeoutMs);
+    counters.httpRequests++;
+    if (!result.error.empty() || result.status >= 400) {
+      counters.httpErrors++;
+    } else {
+      httpLatency.record(elapsedUs(sentAt));
+    }
+
+    // More than a second behind: drop the backlog instead of bursting
+    if (Clock::now() - next > std::chrono::seconds(1)) {
+      next = Clock::now();
+    }
+    std::this_thread::sleep_until(next);
+  }
+}
+
+long nextCommandId = 1;
+
+bool sendCommand(WsClient &client, const std::string &body) {
+  long id = nextCommandId++;
+  std::string text = "{" + body + ",\"id\":" + std::to_string(id) + "}";
+  {
+    std::lock_guard<std::mutex> guard(ackLock);
+    pendingAcks[id] = Clock::now();
+  }
+  counters.commands++;
+  if (!client.sendText(text)) {
+    std::lock_guard<std::mutex> guard(ackLock);
+    pendingAcks.erase(id);
+    counters.commandErrors++;
+    return false;
+  }
+  return true;
+}
+
+bool setRelay(const Options &options, WsClient *commandClient, bool on) {
+  if (options.target == Target::MONITOR) {
+    return sendCommand(*commandClient, std::string("\"command\":\"setRelay\",\"state\":") + (on ? "true" : "false"));
+  }
+
+  // The switch takes commands over HTTP only; 409 means auto mode or a mesh alarm holds the relay
+  counters.commands++;
+  HttpResult result = httpRequest(options.host, options.httpPort, "POST", "/api/relay",
+                                  on ? "state=on" : "state=off", options.timeoutMs);
+  if (result.status != 200) {
+    counters.commandErrors++;
+    return false;
+  }
+  return true;
+}
+
+// ArduinoJson prints whole floats without a fraction, which keeps the marker exact
+long formatThreshold(double value) { return lround(value); }
+
+void commandTask(const Options &options, WsClient *commandClient) {
+  auto nextRelay = Clock::now() + std::chrono::milliseconds(options.relayIntervalMs);
+  auto nextThreshold = Clock::now() + std::chrono::milliseconds(options.thresholdIntervalMs);
+  bool thresholdBaseSet = false;
+  long thresholdBase = 0;
+
+  while (commanding) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    Clock::time_point now = Clock::now();
+
+    if (options.relayIntervalMs > 0 && now >= nextRelay) {
+      nextRelay = now + std::chrono::milliseconds(options.relayIntervalMs);
+      bool known, relay;
+      {
+        std::lock_guard<std::mutex> guard(observedLock);
+        known = relayKnown;
+        relay = observedRelay;
+      }
+      if (known) {
+        const char *key = options.target == Target::MONITOR ? "\"relayState\":" : "\"state\":";
+        relayProbe.start(std::string(key) + (relay ? "false" : "true"));
+        setRelay(options, commandClient, !relay);
+      }
+    }
+
+    if (options.thresholdIntervalMs > 0 && now >= nextThreshold) {
+      nextThreshold = now + std::chrono::milliseconds(options.thresholdIntervalMs);
+      bool known;
+      double threshold;
+      {
+        std::lock_guard<std::mutex> guard(observedLock);
+        known = thresholdKnown;
+        threshold = observedThreshold;
+      }
+      if (known) {
+        if (!thresholdBaseSet) {
+          thresholdBase = formatThreshold(threshold);
+          thresholdBaseSet = true;
+        }
+        long target = formatThreshold(threshold) == thresholdBase + 1 ? thresholdBase : thresholdBase + 1;
+        thresholdProbe.start("\"gasThreshold\":" + std::to_string(target));
+        sendCommand(*commandClient, "\"command\":\"setThresholds\",\"gas\":" + std::to_string(target));
+      }
+    }
+
+    // Acks that never came
+    std::lock_guard<std::mutex> guard(ackLock);
+    for (auto pending = pendingAcks.begin(); pending != pendingAcks.end();) {
+      if (now - pending->second > std::chrono::milliseconds(options.timeoutMs)) {
+        counters.commandErrors++;
+        pending = pendingAcks.erase(pending);
+      } else {
+        ++pending;
+      }
+    }
+  }
+}
+
+void restoreDevice(const Options &options, WsClient *commandClient, bool relaySet, bool relay,
+                   bool thresholdSet, double threshold) {
+  if (relaySet) {
+    if (options.target == Target::MONITOR) {
+      commandClient->sendText(std::string("{\"command\":\"setRelay\",\"state\":") + (relay ? "true" : "false") + "}");
+    } else {
+      httpRequest(options.host, options.httpPort, "POST", "/api/relay", relay ? "state=on" : "state=off",
+                  options.timeoutMs);
+    }
+  }
+  if (thresholdSet) {
+    char text[96];
+    snprintf(text, sizeof(text), "{\"command\":\"setThresholds\",\"gas\":%g}", threshold);
+    commandClient->sendText(text);
+  }
+}
+
+void onSignal(int) { interrupted = 1; }
+
+void printSummary(FILE *out, const char *name, LatencySummary summary) {
+  fprintf(out, "  %-10s n=%-8zu p50=%8.2f ms  p99=%8.2f ms  max=%8.2f ms\n", name, summary.count,
+          summary.p50Ms, summary.p99Ms, summary.maxMs);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    return 2;
+  }
+
+  FILE *csv = options.csvPath == "-" ? stdout : fopen(options.csvPath.c_str(), "w");
+  if (csv == nullptr) {
+    perror(options.csvPath.c_str());
+    return 1;
+  }
+  FILE *report = csv == stdout ? stderr : stdout;
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  std::vector<std::unique_ptr<WsClient>> clients;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < options.clients; i++) {
+    clients.emplace_back(new WsClient());
+  }
+  for (int i = 0; i < options.clients; i++) {
+    threads.emplace_back(clientTask, std::cref(options), std::ref(*clients[i]), i == 0);
+  }
+  for (const PollSpec &poll : options.polls) {
+    // One sequential poller manages a few requests a second against an ESP; spread faster rates
+    int pollers = std::min(16, std::max(1, (int)ceil(poll.rate / 5)));
+    for (int i = 0; i < pollers; i++) {
+      threads.emplace_back(pollTask, std::cref(options), std::cref(poll), poll.rate / pollers);
+    }
+  }
+
+  // Give the clients a moment to connect and report the state to restore
+  WsClient *commandClient = clients.empty() ? nullptr : clients[0].get();
+  auto startedAt = Clock::now();
+  while (!interrupted && options.clients > 0 && Clock::now() - startedAt < std::chrono::seconds(3)) {
+    {
+      std::lock_guard<std::mutex> guard(observedLock);
+      if (relayKnown && (thresholdKnown || options.target == Target::SWITCH)) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  bool originalRelaySet, originalRelay, originalThresholdSet;
+  double originalThreshold;
+  {
+    std::lock_guard<std::mutex> guard(observedLock);
+    originalRelaySet = relayKnown && options.relayIntervalMs > 0;
+    originalRelay = observedRelay;
+    originalThresholdSet = thresholdKnown && options.thresholdIntervalMs > 0;
+    originalThreshold = observedThreshold;
+  }
+  std::thread commands(commandTask, std::cref(options), commandClient);
+
+  fprintf(csv,
+          "elapsed_s,ws_connected,ws_connects,ws_errors,ws_msgs_per_s,ws_kbytes_per_s,"
+          "http_req_per_s,http_errors,http_p50_ms,http_p99_ms,"
+          "commands,command_errors,bcast_samples,bcast_p50_ms,bcast_p99_ms,missed_bcasts,"
+          "ack_p50_ms,ack_p99_ms\n");
+
+  uint64_t last[9] = {};
+  auto next = Clock::now();
+  for (int second = 1; second <= options.durationS && !interrupted; second++) {
+    next += std::chrono::seconds(1);
+    std::this_thread::sleep_until(next);
+
+    uint64_t now[9] = {counters.wsConnects, counters.wsErrors, counters.wsMessages, counters.wsBytes,
+                       counters.httpRequests, counters.httpErrors, counters.commands, counters.commandErrors,
+                       counters.missedBroadcasts};
+    uint64_t delta[9];
+    for (int i = 0; i < 9; i++) {
+      delta[i] = now[i] - last[i];
+      last[i] = now[i];
+    }
+    LatencySummary http = httpLatency.takeInterval();
+    LatencySummary bcast = broadcastLatency.takeInterval();
+    LatencySummary ack = ackLatency.takeInterval();
+
+    fprintf(csv, "%d,%d,%llu,%llu,%llu,%.1f,%llu,%llu,%.2f,%.2f,%llu,%llu,%zu,%.2f,%.2f,%llu,%.2f,%.2f\n", second,
+            counters.wsConnected.load(), (unsigned long long)delta[0], (unsigned long long)delta[1],
+            (unsigned long long)delta[2], delta[3] / 1024.0, (unsigned long long)delta[4],
+            (unsigned long long)delta[5], http.p50Ms, http.p99Ms, (unsigned long long)delta[6],
+            (unsigned long long)delta[7], bcast.count, bcast.p50Ms, bcast.p99Ms, (unsigned long long)delta[8],
+            ack.p50Ms, ack.p99Ms);
+    fflush(csv);
+  }
+
+  // Stop issuing commands, let the last broadcasts arrive, then put the device back
+  int seconds = (int)std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - startedAt).count();
+  commanding = false;
+  commands.join();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  relayProbe.finish();
+  thresholdProbe.finish();
+  restoreDevice(options, commandClient, originalRelaySet, originalRelay, originalThresholdSet, originalThreshold);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  running = false;
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  if (csv != stdout) {
+    fclose(csv);
+  }
+
+  seconds = std::max(seconds, 1);
+  fprintf(report, "%s %s:%d, %d ws clients on :%d%s, %d s\n",
+          options.target == Target::MONITOR ? "monitor" : "switch", options.host.c_str(), options.httpPort,
+          options.clients, options.wsPort, options.wsPath.c_str(), seconds);
+  fprintf(report, "  ws         %llu connects, %llu errors, %.1f msg/s\n",
+          (unsigned long long)counters.wsConnects.load(), (unsigned long long)counters.wsErrors.load(),
+          (double)counters.wsMessages / seconds);
+  fprintf(report, "  http       %.1f req/s, %llu errors of %llu\n", (double)counters.httpRequests / seconds,
+          (unsigned long long)counters.httpErrors.load(), (unsigned long long)counters.httpRequests.load());
+  fprintf(report, "  commands   %llu sent, %llu errors, %llu missed broadcasts\n",
+          (unsigned long long)counters.commands.load(), (unsigned long long)counters.commandErrors.load(),
+          (unsigned long long)counters.missedBroadcasts.load());
+  printSummary(report, "http", httpLatency.total());
+  printSummary(report, relayProbe.name(), relayProbe.total());
+  if (options.target == Target::MONITOR) {
+    printSummary(report, thresholdProbe.name(), thresholdProbe.total());
+    printSummary(report, "ack", ackLatency.total());
+  }
+  return counters.wsErrors + counters.httpErrors + counters.commandErrors > 0 ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+#include "net.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+int tcpConnect(const std::string &host, int port, int timeoutMs, std::string &error) {
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *result = nullptr;
+  std::string service = std::to_string(port);
+  int rc = getaddrinfo(host.c_str(), service.c_str(), &hints, &result);
+  if (rc != 0) {
+    error = gai_strerror(rc);
+    return -1;
+  }
+
+  int fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+  if (fd < 0) {
+    error = strerror(errno);
+    freeaddrinfo(result);
+    return -1;
+  }
+
+  // Non-blocking connect so an unreachable device fails within the timeout
+  int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  rc = connect(fd, result->ai_addr, result->ai_addrlen);
+  freeaddrinfo(result);
+  if (rc < 0 && errno != EINPROGRESS) {
+    error = strerror(errno);
+    close(fd);
+    return -1;
+  }
+  if (rc < 0) {
+    pollfd pfd = {fd, POLLOUT, 0};
+    if (poll(&pfd, 1, timeoutMs) <= 0) {
+      error = "connect timeout";
+      close(fd);
+      return -1;
+    }
+    int soError = 0;
+    socklen_t soLen = sizeof(soError);
+    getsockopt(fd, SOL_SOCKET, SO_ERROR, &soError, &soLen);
+    if (soError != 0) {
+      error = strerror(soError);
+      close(fd);
+      return -1;
+    }
+  }
+  fcntl(fd, F_SETFL, flags);
+
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return fd;
+}
+
+bool sendAll(int fd, const void *data, size_t len) {
+  const char *bytes = (const char *)data;
+  while (len > 0) {
+    ssize_t sent = send(fd, bytes, len, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent <= 0) {
+      return false;
+    }
+    bytes += sent;
+    len -= (size_t)sent;
+  }
+  return true;
+}
+
+bool waitReadable(int fd, int timeoutMs) {
+  pollfd pfd = {fd, POLLIN, 0};
+  return poll(&pfd, 1, timeoutMs) > 0;
+}
@@ -0,0 +1,17 @@
+#ifndef NET_H
+#define NET_H
+
+#include <string>
+
+// Blocking TCP helpers shared by the HTTP and WebSocket clients
+
+// Connected socket with TCP_NODELAY set, or -1 with the reason in error
+int tcpConnect(const std::string &host, int port, int timeoutMs, std::string &error);
+
+// Sends all of data; false when the peer closed or the socket failed
+bool sendAll(int fd, const void *data, size_t len);
+
+// Waits up to timeoutMs for the socket to become readable
+bool waitReadable(int fd, int timeoutMs);
+
+#endif
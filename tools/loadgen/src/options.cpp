@@ -0,0 +1,144 @@
+#include "options.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s --host ADDR [options]\n"
+          "  --target monitor|switch  firmware under test (monitor)\n"
+          "  --http-port N            HTTP server port (80)\n"
+          "  --ws-port N              WebSocket port (monitor 80, switch 81)\n"
+          "  --ws-path PATH           WebSocket path (monitor /ws, switch /)\n"
+          "  --clients N              concurrent WebSocket clients (4)\n"
+          "  --poll [POST ]PATH[?q]=RATE  poll an endpoint at RATE req/s; repeatable.\n"
+          "                           POST sends the query string as the form body.\n"
+          "                           Default: monitor /api/status=2,\n"
+          "                           switch /status=2\n"
+          "  --relay-ms N             relay command interval, 0 disables (2000)\n"
+          "  --threshold-ms N         monitor setThresholds interval, 0 disables (5000)\n"
+          "  --duration S             run time in seconds (60)\n"
+          "  --timeout-ms N           connect/response timeout (3000)\n"
+          "  --csv FILE               per-second results, - for stdout (loadgen.csv)\n"
+          "\n"
+          "Relay commands go over WebSocket (setRelay) on the monitor and to\n"
+          "POST /api/relay on the switch; latency is measured to the broadcast\n"
+          "that carries the new state on every client.\n",
+          program);
+}
+
+bool parsePoll(const char *arg, PollSpec &poll) {
+  std::string spec = arg;
+  poll.method = "GET";
+  if (spec.compare(0, 5, "POST ") == 0) {
+    poll.method = "POST";
+    spec.erase(0, 5);
+  }
+  size_t equals = spec.rfind('=');
+  if (equals == std::string::npos || spec.empty() || spec[0] != '/') {
+    return false;
+  }
+  poll.rate = atof(spec.c_str() + equals + 1);
+  poll.path = spec.substr(0, equals);
+  if (poll.method == "POST") {
+    size_t query = poll.path.find('?');
+    if (query != std::string::npos) {
+      poll.body = poll.path.substr(query + 1);
+      poll.path.erase(query);
+    }
+  }
+  return poll.rate > 0;
+}
+
+}  // namespace
+
+bool parseOptions(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    bool takesValue = strcmp(arg, "--help") != 0 && strcmp(arg, "-h") != 0;
+    if (takesValue && value == nullptr) {
+      fprintf(stderr, "%s needs a value\n", arg);
+      usage(argv[0]);
+      return false;
+    }
+
+    if (!takesValue) {
+      usage(argv[0]);
+      return false;
+    } else if (strcmp(arg, "--host") == 0) {
+      options.host = value;
+    } else if (strcmp(arg, "--target") == 0) {
+      if (strcmp(value, "monitor") == 0) {
+        options.target = Target::MONITOR;
+      } else if (strcmp(value, "switch") == 0) {
+        options.target = Target::SWITCH;
+      } else {
+        fprintf(stderr, "unknown target %s\n", value);
+        return false;
+      }
+    } else if (strcmp(arg, "--http-port") == 0) {
+      options.httpPort = atoi(value);
+    } else if (strcmp(arg, "--ws-port") == 0) {
+      options.wsPort = atoi(value);
+    } else if (strcmp(arg, "--ws-path") == 0) {
+      options.wsPath = value;
+    } else if (strcmp(arg, "--clients") == 0) {
+      options.clients = atoi(value);
+    } else if (strcmp(arg, "--poll") == 0) {
+      PollSpec poll;
+      if (!parsePoll(value, poll)) {
+        fprintf(stderr, "bad --poll %s, expected [POST ]/path=rate\n", value);
+        return false;
+      }
+      options.polls.push_back(poll);
+    } else if (strcmp(arg, "--relay-ms") == 0) {
+      options.relayIntervalMs = atoi(value);
+    } else if (strcmp(arg, "--threshold-ms") == 0) {
+      options.thresholdIntervalMs = atoi(value);
+    } else if (strcmp(arg, "--duration") == 0) {
+      options.durationS = atoi(value);
+    } else if (strcmp(arg, "--timeout-ms") == 0) {
+      options.timeoutMs = atoi(value);
+    } else if (strcmp(arg, "--csv") == 0) {
+      options.csvPath = value;
+    } else {
+      fprintf(stderr, "unknown option %s\n", arg);
+      usage(argv[0]);
+      return false;
+    }
+    i++;
+  }
+
+  if (options.host.empty()) {
+    usage(argv[0]);
+    return false;
+  }
+  if (options.clients < 0 || options.durationS <= 0 || options.timeoutMs <= 0) {
+    fprintf(stderr, "--clients must be >= 0, --duration and --timeout-ms > 0\n");
+    return false;
+  }
+
+  bool monitor = options.target == Target::MONITOR;
+  if (options.wsPort == 0) {
+    options.wsPort = monitor ? 80 : 81;
+  }
+  if (options.wsPath.empty()) {
+    options.wsPath = monitor ? "/ws" : "/";
+  }
+  if (options.polls.empty()) {
+    options.polls.push_back({"GET", monitor ? "/api/status" : "/status", "", 2});
+  }
+  if (!monitor) {
+    options.thresholdIntervalMs = 0;
+  }
+  if (monitor && options.clients == 0) {
+    // setRelay and setThresholds travel over the first client
+    options.relayIntervalMs = 0;
+    options.thresholdIntervalMs = 0;
+  }
+  return true;
+}
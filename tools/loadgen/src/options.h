@@ -0,0 +1,34 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include <vector>
+
+enum class Target { MONITOR, SWITCH };
+
+struct PollSpec {
+  std::string method;  // GET or POST
+  std::string path;
+  std::string body;    // Form body for POST
+  double rate;         // Requests per second, all pollers of the path together
+};
+
+struct Options {
+  std::string host;
+  Target target = Target::MONITOR;
+  int httpPort = 80;
+  int wsPort = 0;        // 0: the target's default
+  std::string wsPath;    // Empty: the target's default
+  int clients = 4;
+  std::vector<PollSpec> polls;
+  int relayIntervalMs = 2000;
+  int thresholdIntervalMs = 5000;  // Monitor only
+  int durationS = 60;
+  int timeoutMs = 3000;
+  std::string csvPath = "loadgen.csv";
+};
+
+// Fills in the target's defaults; prints usage and returns false on bad arguments
+bool parseOptions(int argc, char **argv, Options &options);
+
+#endif
@@ -0,0 +1,96 @@
+#include "sha1.h"
+
+#include <cstring>
+
+namespace {
+
+uint32_t rol(uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+void block(uint32_t h[5], const uint8_t *chunk) {
+  uint32_t w[80];
+  for (int i = 0; i < 16; i++) {
+    w[i] = (uint32_t)chunk[i * 4] << 24 | (uint32_t)chunk[i * 4 + 1] << 16 |
+           (uint32_t)chunk[i * 4 + 2] << 8 | chunk[i * 4 + 3];
+  }
+  for (int i = 16; i < 80; i++) {
+    w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+  }
+
+  uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+  for (int i = 0; i < 80; i++) {
+    uint32_t f, k;
+    if (i < 20) {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999;
+    } else if (i < 40) {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1;
+    } else if (i < 60) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDC;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6;
+    }
+    uint32_t t = rol(a, 5) + f + e + k + w[i];
+    e = d;
+    d = c;
+    c = rol(b, 30);
+    b = a;
+    a = t;
+  }
+  h[0] += a;
+  h[1] += b;
+  h[2] += c;
+  h[3] += d;
+  h[4] += e;
+}
+
+}  // namespace
+
+void sha1(const void *data, size_t len, uint8_t digest[20]) {
+  uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+  const uint8_t *bytes = (const uint8_t *)data;
+
+  size_t whole = len - len % 64;
+  for (size_t i = 0; i < whole; i += 64) {
+    block(h, bytes + i);
+  }
+
+  // Tail, the 0x80 marker and the bit length, in one or two blocks
+  uint8_t tail[128] = {};
+  size_t rest = len - whole;
+  memcpy(tail, bytes + whole, rest);
+  tail[rest] = 0x80;
+  size_t tailLen = rest + 1 + 8 <= 64 ? 64 : 128;
+  uint64_t bits = (uint64_t)len * 8;
+  for (int i = 0; i < 8; i++) {
+    tail[tailLen - 1 - i] = (uint8_t)(bits >> (i * 8));
+  }
+  for (size_t i = 0; i < tailLen; i += 64) {
+    block(h, tail + i);
+  }
+
+  for (int i = 0; i < 5; i++) {
+    digest[i * 4] = (uint8_t)(h[i] >> 24);
+    digest[i * 4 + 1] = (uint8_t)(h[i] >> 16);
+    digest[i * 4 + 2] = (uint8_t)(h[i] >> 8);
+    digest[i * 4 + 3] = (uint8_t)h[i];
+  }
+}
+
+std::string base64(const uint8_t *data, size_t len) {
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  out.reserve((len + 2) / 3 * 4);
+  for (size_t i = 0; i < len; i += 3) {
+    uint32_t group = (uint32_t)data[i] << 16;
+    if (i + 1 < len) group |= (uint32_t)data[i + 1] << 8;
+    if (i + 2 < len) group |= data[i + 2];
+    out += alphabet[(group >> 18) & 63];
+    out += alphabet[(group >> 12) & 63];
+    out += i + 1 < len ? alphabet[(group >> 6) & 63] : '=';
+    out += i + 2 < len ? alphabet[group & 63] : '=';
+  }
+  return out;
+}
@@ -0,0 +1,13 @@
+#ifndef SHA1_H
+#define SHA1_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Just enough of SHA-1 and base64 to compute and check the
+// Sec-WebSocket-Accept value of the opening handshake (RFC 6455 4.2.2)
+void sha1(const void *data, size_t len, uint8_t digest[20]);
+std::string base64(const uint8_t *data, size_t len);
+
+#endif
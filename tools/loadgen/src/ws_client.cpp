@@ -0,0 +1,230 @@
+#include "ws_client.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <random>
+#include <strings.h>
+
+#include "net.h"
+#include "sha1.h"
+
+bool WsClient::connect(const std::string &host, int port, const std::string &path, int timeoutMs,
+                       std::string &error) {
+  close();
+  int fd = tcpConnect(host, port, timeoutMs, error);
+  if (fd < 0) {
+    return false;
+  }
+
+  std::random_device random;
+  uint8_t nonce[16];
+  for (uint8_t &byte : nonce) {
+    byte = (uint8_t)random();
+  }
+  _maskSeed = random() | 1;
+  std::string key = base64(nonce, sizeof(nonce));
+  std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + host + ":" + std::to_string(port) +
+                        "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: " + key +
+                        "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+  if (!sendAll(fd, request.data(), request.size())) {
+    error = "handshake send failed";
+    ::close(fd);
+    return false;
+  }
+
+  // Response headers; anything after them is already frame data
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+  std::string response;
+  size_t headerEnd;
+  char buffer[1024];
+  while ((headerEnd = response.find("\r\n\r\n")) == std::string::npos) {
+    int left = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                   deadline - std::chrono::steady_clock::now()).count();
+    ssize_t got = left > 0 && waitReadable(fd, left) ? recv(fd, buffer, sizeof(buffer), 0) : -1;
+    if (got <= 0) {
+      error = got == 0 ? "closed during handshake" : "handshake timeout";
+      ::close(fd);
+      return false;
+    }
+    response.append(buffer, (size_t)got);
+  }
+
+  if (response.compare(0, 12, "HTTP/1.1 101") != 0) {
+    error = "upgrade refused: " + response.substr(0, response.find("\r\n"));
+    ::close(fd);
+    return false;
+  }
+
+  std::string expected = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+  uint8_t digest[20];
+  sha1(expected.data(), expected.size(), digest);
+  expected = base64(digest, sizeof(digest));
+  bool accepted = false;
+  for (size_t line = response.find("\r\n") + 2; line < headerEnd;) {
+    size_t next = response.find("\r\n", line);
+    if (strncasecmp(response.c_str() + line, "Sec-WebSocket-Accept:", 21) == 0) {
+      size_t value = response.find_first_not_of(' ', line + 21);
+      accepted = response.compare(value, next - value, expected) == 0;
+    }
+    line = next + 2;
+  }
+  if (!accepted) {
+    error = "bad Sec-WebSocket-Accept";
+    ::close(fd);
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(_sendLock);
+    _fd = fd;
+  }
+  _in = response.substr(headerEnd + 4);
+  _partial.clear();
+  return true;
+}
+
+void WsClient::close() {
+  if (_fd >= 0) {
+    uint8_t normal[2] = {0x03, 0xE8};  // 1000
+    sendFrame(CLOSE, normal, sizeof(normal));
+    drop();
+  }
+}
+
+// Under the send lock, so a sender never writes to a reused descriptor
+void WsClient::drop() {
+  std::lock_guard<std::mutex> guard(_sendLock);
+  if (_fd >= 0) {
+    ::close(_fd);
+    _fd = -1;
+  }
+}
+
+bool WsClient::sendText(const std::string &text) { return sendFrame(TEXT, text.data(), text.size()); }
+
+bool WsClient::sendFrame(uint8_t opcode, const void *data, size_t len) {
+  std::lock_guard<std::mutex> guard(_sendLock);
+  if (_fd < 0) {
+    return false;
+  }
+
+  std::string frame;
+  frame.reserve(len + 14);
+  frame += (char)(0x80 | opcode);
+  if (len < 126) {
+    frame += (char)(0x80 | len);
+  } else if (len <= 0xFFFF) {
+    frame += (char)(0x80 | 126);
+    frame += (char)(len >> 8);
+    frame += (char)len;
+  } else {
+    frame += (char)(0x80 | 127);
+    for (int i = 7; i >= 0; i--) {
+      frame += (char)((uint64_t)len >> (i * 8));
+    }
+  }
+
+  // Clients must mask; xorshift is plenty, the mask is not a security feature here
+  _maskSeed ^= _maskSeed << 13;
+  _maskSeed ^= _maskSeed >> 17;
+  _maskSeed ^= _maskSeed << 5;
+  uint8_t mask[4] = {(uint8_t)(_maskSeed >> 24), (uint8_t)(_maskSeed >> 16), (uint8_t)(_maskSeed >> 8),
+                     (uint8_t)_maskSeed};
+  frame.append((const char *)mask, 4);
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (size_t i = 0; i < len; i++) {
+    frame += (char)(bytes[i] ^ mask[i & 3]);
+  }
+  return sendAll(_fd, frame.data(), frame.size());
+}
+
+bool WsClient::fill(int timeoutMs) {
+  if (!waitReadable(_fd, timeoutMs)) {
+    return false;
+  }
+  char buffer[4096];
+  ssize_t got = recv(_fd, buffer, sizeof(buffer), 0);
+  if (got <= 0) {
+    drop();
+    return false;
+  }
+  _in.append(buffer, (size_t)got);
+  return true;
+}
+
+WsClient::ReadResult WsClient::read(std::string &message, bool &binary, int timeoutMs) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+  for (;;) {
+    if (_fd < 0) {
+      return CLOSED;
+    }
+
+    // Parse one frame if the buffer holds a whole one
+    if (_in.size() >= 2) {
+      const uint8_t *head = (const uint8_t *)_in.data();
+      bool fin = head[0] & 0x80;
+      uint8_t opcode = head[0] & 0x0F;
+      bool masked = head[1] & 0x80;
+      uint64_t len = head[1] & 0x7F;
+      size_t offset = 2;
+      if (len == 126 && _in.size() >= 4) {
+        len = (uint64_t)head[2] << 8 | head[3];
+        offset = 4;
+      } else if (len == 127 && _in.size() >= 10) {
+        len = 0;
+        for (int i = 0; i < 8; i++) {
+          len = len << 8 | head[2 + i];
+        }
+        offset = 10;
+      } else if (len >= 126) {
+        offset = SIZE_MAX;  // Extended length not in yet
+      }
+      size_t maskOffset = offset;
+      if (masked && offset != SIZE_MAX) {
+        offset += 4;
+      }
+
+      if (offset != SIZE_MAX && _in.size() >= offset + len) {
+        std::string payload = _in.substr(offset, (size_t)len);
+        if (masked) {
+          for (size_t i = 0; i < payload.size(); i++) {
+            payload[i] ^= _in[maskOffset + (i & 3)];
+          }
+        }
+        _in.erase(0, offset + (size_t)len);
+
+        if (opcode == PING) {
+          sendFrame(PONG, payload.data(), payload.size());
+        } else if (opcode == CLOSE) {
+          sendFrame(CLOSE, payload.data(), payload.size() >= 2 ? 2 : 0);
+          drop();
+          return CLOSED;
+        } else if (opcode == TEXT || opcode == BINARY || opcode == CONTINUATION) {
+          if (opcode != CONTINUATION) {
+            _partial.clear();
+            _partialBinary = opcode == BINARY;
+          }
+          _partial += payload;
+          if (fin) {
+            message.swap(_partial);
+            _partial.clear();
+            binary = _partialBinary;
+            return MESSAGE;
+          }
+        }
+        continue;
+      }
+    }
+
+    int left = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                   deadline - std::chrono::steady_clock::now()).count();
+    if (left <= 0) {
+      return TIMEOUT;
+    }
+    if (!fill(left)) {
+      return _fd < 0 ? CLOSED : TIMEOUT;
+    }
+  }
+}
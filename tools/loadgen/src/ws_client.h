@@ -0,0 +1,42 @@
+#ifndef WS_CLIENT_H
+#define WS_CLIENT_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Minimal RFC 6455 client: opening handshake, masked text frames out,
+// unfragmented or fragmented text/binary frames in, pings answered. One
+// thread reads while others may send.
+class WsClient {
+public:
+  enum ReadResult { MESSAGE, TIMEOUT, CLOSED };
+
+  ~WsClient() { close(); }
+
+  bool connect(const std::string &host, int port, const std::string &path, int timeoutMs, std::string &error);
+  void close();
+  bool connected() const { return _fd >= 0; }
+
+  bool sendText(const std::string &text);
+
+  // Next complete data message; binary messages come back as their raw bytes
+  ReadResult read(std::string &message, bool &binary, int timeoutMs);
+
+private:
+  enum Opcode : uint8_t { CONTINUATION = 0, TEXT = 1, BINARY = 2, CLOSE = 8, PING = 9, PONG = 10 };
+
+  bool sendFrame(uint8_t opcode, const void *data, size_t len);
+  bool fill(int timeoutMs);
+  void drop();
+
+  std::atomic<int> _fd{-1};
+  std::mutex _sendLock;
+  std::string _in;        // Received bytes not yet parsed into frames
+  std::string _partial;   // Payload of a fragmented message so far
+  bool _partialBinary = false;
+  uint32_t _maskSeed = 0x2545F491;
+};
+
+#endif
@@ -0,0 +1,95 @@
+# Uploads a firmware image to a gas monitor or smart switch over the
+# /api/ota routes (shared/OtaUpdate/src/ota_session.h). The image goes up in
+# chunks; a dropped connection or a device that moved on is picked up again
+# at the offset the device reports, so a flaky link only costs retries.
+#   python tools/ota_upload.py <host> .pio/build/<env>/firmware.bin
+import argparse
+import hashlib
+import json
+import sys
+import time
+import urllib.error
+import urllib.request
+
+
+def request(url, method="GET", data=None, timeout=10):
+    """Returns (status, JSON body); 4xx/5xx replies still carry the session state."""
+    headers = {"Content-Type": "application/octet-stream"} if data is not None else {}
+    req = urllib.request.Request(url, data=data, method=method, headers=headers)
+    try:
+        with urllib.request.urlopen(req, timeout=timeout) as reply:
+            return reply.status, json.loads(reply.read() or b"{}")
+    except urllib.error.HTTPError as e:
+        body = e.read()
+        try:
+            return e.code, json.loads(body)
+        except ValueError:
+            return e.code, {"error": body.decode(errors="replace")}
+
+
+def upload(base, image, chunk, retries, timeout):
+    md5 = hashlib.md5(image).hexdigest()
+    status, state = request("%s/api/ota/begin?size=%d&md5=%s" % (base, len(image), md5), "POST", b"", timeout)
+    if status != 200:
+        sys.exit("begin refused (%d): %s" % (status, state.get("error") or state))
+    offset = state["offset"]
+    if offset:
+        print("Resuming at %d of %d bytes" % (offset, len(image)))
+
+    failures = 0
+    started = time.monotonic()
+    while offset < len(image):
+        piece = image[offset:offset + chunk]
+        try:
+            status, state = request("%s/api/ota/chunk?offset=%d" % (base, offset), "POST", piece, timeout)
+        except OSError as e:
+            # The chunk may have landed in part; ask where the image ends now
+            failures += 1
+            if failures > retries:
+                sys.exit("giving up after %d failed chunks: %s" % (failures - 1, e))
+            print("\nChunk at %d failed (%s), retrying" % (offset, e))
+            time.sleep(min(2 ** failures, 10))
+            try:
+                status, state = request(base + "/api/ota", timeout=timeout)
+            except OSError:
+                continue
+            if state.get("state") != "receiving" or state.get("md5") != md5:
+                sys.exit("device dropped the session (%s); start again" % state.get("state"))
+            offset = state["offset"]
+            continue
+
+        if status == 200:
+            offset += len(piece)
+            failures = 0
+        elif status == 409 and state.get("state") == "receiving":
+            offset = state["offset"]
+        else:
+            sys.exit("chunk at %d refused (%d): %s" % (offset, status, state.get("error") or state))
+
+        rate = offset / max(time.monotonic() - started, 0.001) / 1024
+        print("\r%d / %d bytes, %.1f KB/s" % (offset, len(image), rate), end="", flush=True)
+    print()
+
+    status, state = request(base + "/api/ota/finish", "POST", b"", timeout)
+    if status != 200:
+        sys.exit("image rejected (%d): %s" % (status, state.get("error") or state))
+    print("Verified (md5 %s); the device restarts into the new image" % md5)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Firmware upload over /api/ota")
+    parser.add_argument("host", help="device address, e.g. 192.168.4.1")
+    parser.add_argument("image", help="firmware.bin from the PlatformIO build")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--chunk", type=int, default=16384, help="bytes per request (default 16384)")
+    parser.add_argument("--retries", type=int, default=8, help="failed chunks in a row before giving up")
+    parser.add_argument("--timeout", type=float, default=15, help="seconds per request")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    upload("http://%s:%d" % (args.host, args.port), image, args.chunk, args.retries, args.timeout)
+
+
+if __name__ == "__main__":
+    main()